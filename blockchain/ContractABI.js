@@ -35,6 +35,125 @@ const ABI = [
         "name": "AccessAttempt",
         "type": "event"
     },
+    {
+        "anonymous": false,
+        "inputs": [
+            {
+                "indexed": true,
+                "internalType": "uint32",
+                "name": "deviceId",
+                "type": "uint32"
+            },
+            {
+                "indexed": false,
+                "internalType": "enum RFIDAccess.EventKind",
+                "name": "kind",
+                "type": "uint8"
+            },
+            {
+                "indexed": false,
+                "internalType": "bytes10",
+                "name": "uid",
+                "type": "bytes10"
+            },
+            {
+                "indexed": false,
+                "internalType": "uint8",
+                "name": "uidLength",
+                "type": "uint8"
+            },
+            {
+                "indexed": false,
+                "internalType": "uint16",
+                "name": "fingerprintId",
+                "type": "uint16"
+            },
+            {
+                "indexed": false,
+                "internalType": "uint64",
+                "name": "timestamp",
+                "type": "uint64"
+            }
+        ],
+        "name": "AccessLogged",
+        "type": "event"
+    },
+    {
+        "anonymous": false,
+        "inputs": [
+            {
+                "indexed": true,
+                "internalType": "uint32",
+                "name": "deviceId",
+                "type": "uint32"
+            },
+            {
+                "indexed": true,
+                "internalType": "uint256",
+                "name": "anchorId",
+                "type": "uint256"
+            },
+            {
+                "indexed": false,
+                "internalType": "uint32",
+                "name": "firstSeq",
+                "type": "uint32"
+            },
+            {
+                "indexed": false,
+                "internalType": "uint32",
+                "name": "lastSeq",
+                "type": "uint32"
+            },
+            {
+                "indexed": false,
+                "internalType": "bytes32",
+                "name": "root",
+                "type": "bytes32"
+            },
+            {
+                "indexed": false,
+                "internalType": "bytes32",
+                "name": "head",
+                "type": "bytes32"
+            }
+        ],
+        "name": "Anchored",
+        "type": "event"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "uint32",
+                "name": "_deviceId",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint32",
+                "name": "_firstSeq",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint32",
+                "name": "_lastSeq",
+                "type": "uint32"
+            },
+            {
+                "internalType": "bytes32",
+                "name": "_root",
+                "type": "bytes32"
+            },
+            {
+                "internalType": "bytes32",
+                "name": "_head",
+                "type": "bytes32"
+            }
+        ],
+        "name": "anchor",
+        "outputs": [],
+        "stateMutability": "nonpayable",
+        "type": "function"
+    },
     {
         "inputs": [],
         "name": "getAccessCount",
@@ -83,6 +202,111 @@ const ABI = [
         "stateMutability": "view",
         "type": "function"
     },
+    {
+        "inputs": [],
+        "name": "getAnchorCount",
+        "outputs": [
+            {
+                "internalType": "uint256",
+                "name": "",
+                "type": "uint256"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
+    {
+        "inputs": [],
+        "name": "getPackedCount",
+        "outputs": [
+            {
+                "internalType": "uint256",
+                "name": "",
+                "type": "uint256"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
+    {
+        "inputs": [],
+        "name": "getPackedRecords",
+        "outputs": [
+            {
+                "components": [
+                    {
+                        "internalType": "bytes10",
+                        "name": "uid",
+                        "type": "bytes10"
+                    },
+                    {
+                        "internalType": "uint8",
+                        "name": "uidLength",
+                        "type": "uint8"
+                    },
+                    {
+                        "internalType": "uint16",
+                        "name": "fingerprintId",
+                        "type": "uint16"
+                    },
+                    {
+                        "internalType": "enum RFIDAccess.EventKind",
+                        "name": "kind",
+                        "type": "uint8"
+                    },
+                    {
+                        "internalType": "uint32",
+                        "name": "deviceId",
+                        "type": "uint32"
+                    },
+                    {
+                        "internalType": "uint64",
+                        "name": "timestamp",
+                        "type": "uint64"
+                    }
+                ],
+                "internalType": "struct RFIDAccess.PackedRecord[]",
+                "name": "",
+                "type": "tuple[]"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "bytes32",
+                "name": "_prev",
+                "type": "bytes32"
+            },
+            {
+                "internalType": "uint32",
+                "name": "_seq",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint32",
+                "name": "_timestamp",
+                "type": "uint32"
+            },
+            {
+                "internalType": "bytes32",
+                "name": "_record",
+                "type": "bytes32"
+            }
+        ],
+        "name": "leafHash",
+        "outputs": [
+            {
+                "internalType": "bytes32",
+                "name": "",
+                "type": "bytes32"
+            }
+        ],
+        "stateMutability": "pure",
+        "type": "function"
+    },
     {
         "inputs": [
             {
@@ -106,6 +330,102 @@ const ABI = [
         "stateMutability": "nonpayable",
         "type": "function"
     },
+    {
+        "inputs": [
+            {
+                "internalType": "string[]",
+                "name": "_rfidIds",
+                "type": "string[]"
+            },
+            {
+                "internalType": "bool[]",
+                "name": "_successes",
+                "type": "bool[]"
+            },
+            {
+                "internalType": "string[]",
+                "name": "_fingerprintIds",
+                "type": "string[]"
+            }
+        ],
+        "name": "logAccessBatch",
+        "outputs": [],
+        "stateMutability": "nonpayable",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "bytes32",
+                "name": "_record",
+                "type": "bytes32"
+            }
+        ],
+        "name": "logPacked",
+        "outputs": [],
+        "stateMutability": "nonpayable",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "bytes32[]",
+                "name": "_records",
+                "type": "bytes32[]"
+            }
+        ],
+        "name": "logPackedBatch",
+        "outputs": [],
+        "stateMutability": "nonpayable",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "bool",
+                "name": "_store",
+                "type": "bool"
+            }
+        ],
+        "name": "setStoreRecords",
+        "outputs": [],
+        "stateMutability": "nonpayable",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "uint256",
+                "name": "_anchorId",
+                "type": "uint256"
+            },
+            {
+                "internalType": "uint32",
+                "name": "_seq",
+                "type": "uint32"
+            },
+            {
+                "internalType": "bytes32",
+                "name": "_leaf",
+                "type": "bytes32"
+            },
+            {
+                "internalType": "bytes32[]",
+                "name": "_proof",
+                "type": "bytes32[]"
+            }
+        ],
+        "name": "verifyEvent",
+        "outputs": [
+            {
+                "internalType": "bool",
+                "name": "",
+                "type": "bool"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
     {
         "inputs": [
             {
@@ -140,6 +460,113 @@ const ABI = [
         "stateMutability": "view",
         "type": "function"
     },
+    {
+        "inputs": [
+            {
+                "internalType": "uint256",
+                "name": "",
+                "type": "uint256"
+            }
+        ],
+        "name": "anchors",
+        "outputs": [
+            {
+                "internalType": "uint32",
+                "name": "deviceId",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint32",
+                "name": "firstSeq",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint32",
+                "name": "lastSeq",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint64",
+                "name": "timestamp",
+                "type": "uint64"
+            },
+            {
+                "internalType": "bytes32",
+                "name": "root",
+                "type": "bytes32"
+            },
+            {
+                "internalType": "bytes32",
+                "name": "head",
+                "type": "bytes32"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "uint256",
+                "name": "",
+                "type": "uint256"
+            }
+        ],
+        "name": "packedRecords",
+        "outputs": [
+            {
+                "internalType": "bytes10",
+                "name": "uid",
+                "type": "bytes10"
+            },
+            {
+                "internalType": "uint8",
+                "name": "uidLength",
+                "type": "uint8"
+            },
+            {
+                "internalType": "uint16",
+                "name": "fingerprintId",
+                "type": "uint16"
+            },
+            {
+                "internalType": "enum RFIDAccess.EventKind",
+                "name": "kind",
+                "type": "uint8"
+            },
+            {
+                "internalType": "uint32",
+                "name": "deviceId",
+                "type": "uint32"
+            },
+            {
+                "internalType": "uint64",
+                "name": "timestamp",
+                "type": "uint64"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
+    {
+        "inputs": [
+            {
+                "internalType": "uint32",
+                "name": "",
+                "type": "uint32"
+            }
+        ],
+        "name": "lastAnchoredSeq",
+        "outputs": [
+            {
+                "internalType": "uint32",
+                "name": "",
+                "type": "uint32"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
+    },
     {
         "inputs": [],
         "name": "owner",
@@ -152,6 +579,19 @@ const ABI = [
         ],
         "stateMutability": "view",
         "type": "function"
+    },
+    {
+        "inputs": [],
+        "name": "storeRecords",
+        "outputs": [
+            {
+                "internalType": "bool",
+                "name": "",
+                "type": "bool"
+            }
+        ],
+        "stateMutability": "view",
+        "type": "function"
     }
 ];
 
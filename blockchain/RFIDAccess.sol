@@ -2,6 +2,7 @@
 pragma solidity ^0.8.0;
 
 contract RFIDAccess {
+    // String layout of the first gateway version, kept for existing clients
     struct AccessRecord {
         string rfidId;
         uint256 timestamp;
@@ -9,7 +10,35 @@ contract RFIDAccess {
         string fingerprintId;
     }
     
+    // Kind of a packed record
+    enum EventKind { Unlock, Deny, Tamper }
+    
+    // Fixed-width record, one storage slot (10 + 1 + 2 + 1 + 4 + 8 = 26 bytes)
+    struct PackedRecord {
+        bytes10 uid;
+        uint8 uidLength;
+        uint16 fingerprintId;
+        EventKind kind;
+        uint32 deviceId;
+        uint64 timestamp;
+    }
+    
+    // Merkle root over a window of a device's hash-chained events; the
+    // events themselves are kept off-chain by the gateway
+    struct Anchor {
+        uint32 deviceId;
+        uint32 firstSeq;
+        uint32 lastSeq;
+        uint64 timestamp;
+        bytes32 root;
+        bytes32 head;       // Leaf of lastSeq, the next window's first prev
+    }
+    
     AccessRecord[] public accessRecords;
+    PackedRecord[] public packedRecords;
+    bool public storeRecords;   // Packed records are event-only unless enabled
+    Anchor[] public anchors;
+    mapping(uint32 => uint32) public lastAnchoredSeq;
     address public owner;
     
     event AccessAttempt(
@@ -19,6 +48,24 @@ contract RFIDAccess {
         string fingerprintId
     );
     
+    event AccessLogged(
+        uint32 indexed deviceId,
+        EventKind kind,
+        bytes10 uid,
+        uint8 uidLength,
+        uint16 fingerprintId,
+        uint64 timestamp
+    );
+    
+    event Anchored(
+        uint32 indexed deviceId,
+        uint256 indexed anchorId,
+        uint32 firstSeq,
+        uint32 lastSeq,
+        bytes32 root,
+        bytes32 head
+    );
+    
     constructor() {
         owner = msg.sender;
     }
@@ -33,6 +80,30 @@ contract RFIDAccess {
         bool _success,
         string memory _fingerprintId
     ) public onlyOwner {
+        _recordAccess(_rfidId, _success, _fingerprintId);
+    }
+    
+    // Record several access attempts in one transaction (one AccessAttempt event each)
+    function logAccessBatch(
+        string[] calldata _rfidIds,
+        bool[] calldata _successes,
+        string[] calldata _fingerprintIds
+    ) public onlyOwner {
+        require(
+            _rfidIds.length == _successes.length && _rfidIds.length == _fingerprintIds.length,
+            "Batch arrays must have equal length"
+        );
+        
+        for (uint256 i = 0; i < _rfidIds.length; i++) {
+            _recordAccess(_rfidIds[i], _successes[i], _fingerprintIds[i]);
+        }
+    }
+    
+    function _recordAccess(
+        string memory _rfidId,
+        bool _success,
+        string memory _fingerprintId
+    ) internal {
         accessRecords.push(AccessRecord({
             rfidId: _rfidId,
             timestamp: block.timestamp,
@@ -48,6 +119,125 @@ contract RFIDAccess {
         );
     }
     
+    // Packed records, as sent by the firmware: one 32-byte word per event,
+    // big-endian from the top byte:
+    //   [0..9] uid, left-aligned   [10] uidLength   [11..12] fingerprintId
+    //   [13] kind                  [14..17] deviceId  [18..31] zero
+    function logPacked(bytes32 _record) public onlyOwner {
+        _recordPacked(_record);
+    }
+    
+    function logPackedBatch(bytes32[] calldata _records) public onlyOwner {
+        for (uint256 i = 0; i < _records.length; i++) {
+            _recordPacked(_records[i]);
+        }
+    }
+    
+    // Keep packed records in contract storage as well as in the event log
+    function setStoreRecords(bool _store) public onlyOwner {
+        storeRecords = _store;
+    }
+    
+    function _recordPacked(bytes32 _record) internal {
+        uint256 word = uint256(_record);
+        uint8 uidLength = uint8(word >> 168);
+        uint8 kind = uint8(word >> 144);
+        require(
+            uidLength <= 10 && kind <= uint8(EventKind.Tamper) && uint112(word) == 0,
+            "Malformed record"
+        );
+        
+        PackedRecord memory record = PackedRecord({
+            uid: bytes10(_record),
+            uidLength: uidLength,
+            fingerprintId: uint16(word >> 152),
+            kind: EventKind(kind),
+            deviceId: uint32(word >> 112),
+            timestamp: uint64(block.timestamp)
+        });
+        if (storeRecords) {
+            packedRecords.push(record);
+        }
+        
+        emit AccessLogged(
+            record.deviceId,
+            record.kind,
+            record.uid,
+            record.uidLength,
+            record.fingerprintId,
+            record.timestamp
+        );
+    }
+    
+    // Event chain, as built by the firmware (event_chain.h):
+    //   leaf = sha256(0x00 | prev leaf | seq | timestamp | packed record)
+    //   node = sha256(0x01 | left | right)
+    // with seq and timestamp as uint32 and a node without a right sibling
+    // carried up a level unchanged. Windows of a device must follow each
+    // other without gaps, starting at seq 1.
+    function anchor(
+        uint32 _deviceId,
+        uint32 _firstSeq,
+        uint32 _lastSeq,
+        bytes32 _root,
+        bytes32 _head
+    ) public onlyOwner {
+        require(_firstSeq == lastAnchoredSeq[_deviceId] + 1, "Sequence gap");
+        require(_lastSeq >= _firstSeq, "Empty window");
+        
+        lastAnchoredSeq[_deviceId] = _lastSeq;
+        anchors.push(Anchor({
+            deviceId: _deviceId,
+            firstSeq: _firstSeq,
+            lastSeq: _lastSeq,
+            timestamp: uint64(block.timestamp),
+            root: _root,
+            head: _head
+        }));
+        
+        emit Anchored(_deviceId, anchors.length - 1, _firstSeq, _lastSeq, _root, _head);
+    }
+    
+    function leafHash(
+        bytes32 _prev,
+        uint32 _seq,
+        uint32 _timestamp,
+        bytes32 _record
+    ) public pure returns (bytes32) {
+        return sha256(abi.encodePacked(bytes1(0x00), _prev, _seq, _timestamp, _record));
+    }
+    
+    // Whether _leaf is event _seq of the anchored window, given the sibling
+    // hashes from the leaf up (the gateway's GET /proof)
+    function verifyEvent(
+        uint256 _anchorId,
+        uint32 _seq,
+        bytes32 _leaf,
+        bytes32[] calldata _proof
+    ) public view returns (bool) {
+        Anchor storage window = anchors[_anchorId];
+        if (_seq < window.firstSeq || _seq > window.lastSeq) {
+            return false;
+        }
+        
+        uint256 index = _seq - window.firstSeq;
+        uint256 count = uint256(window.lastSeq) - window.firstSeq + 1;
+        uint256 used = 0;
+        bytes32 node = _leaf;
+        while (count > 1) {
+            if (index % 2 == 1) {
+                if (used == _proof.length) return false;
+                node = sha256(abi.encodePacked(bytes1(0x01), _proof[used++], node));
+            } else if (index + 1 < count) {
+                if (used == _proof.length) return false;
+                node = sha256(abi.encodePacked(bytes1(0x01), node, _proof[used++]));
+            }
+            index /= 2;
+            count = (count + 1) / 2;
+        }
+        return used == _proof.length && node == window.root;
+    }
+    
     function getAccessRecords() public view returns (AccessRecord[] memory) {
         return accessRecords;
     }
@@ -55,4 +245,16 @@ contract RFIDAccess {
     function getAccessCount() public view returns (uint256) {
         return accessRecords.length;
     }
+    
+    function getPackedRecords() public view returns (PackedRecord[] memory) {
+        return packedRecords;
+    }
+    
+    function getPackedCount() public view returns (uint256) {
+        return packedRecords.length;
+    }
+    
+    function getAnchorCount() public view returns (uint256) {
+        return anchors.length;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+// Compares single and batched access logging on a Hardhat network.
+// Run with: npx hardhat run bench-batch.js
+const { ethers } = require("hardhat");
+
+const EVENT_COUNT = 200;
+const BATCH_SIZES = [1, 5, 10, 25, 50];
+
+function makeEvent(i) {
+  const uid = (0x635A5900 + i).toString(16).toUpperCase().padStart(8, "0");
+  return {
+    rfidId: uid.match(/../g).join(":"),
+    success: i % 7 !== 0,
+    fingerprintId: String(i % 128),
+  };
+}
+
+async function benchSingle(rfidAccess, events) {
+  let gas = 0n;
+  const blocks = new Set();
+  const start = process.hrtime.bigint();
+  for (const e of events) {
+    const tx = await rfidAccess.logAccess(e.rfidId, e.success, e.fingerprintId);
+    const receipt = await tx.wait();
+    gas += receipt.gasUsed;
+    blocks.add(receipt.blockNumber);
+  }
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  return { gas, seconds, transactions: events.length, blocks: blocks.size };
+}
+
+async function benchBatched(rfidAccess, events, batchSize) {
+  let gas = 0n;
+  let transactions = 0;
+  const blocks = new Set();
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < events.length; i += batchSize) {
+    const batch = events.slice(i, i + batchSize);
+    const tx = await rfidAccess.logAccessBatch(
+      batch.map(e => e.rfidId),
+      batch.map(e => e.success),
+      batch.map(e => e.fingerprintId)
+    );
+    const receipt = await tx.wait();
+    gas += receipt.gasUsed;
+    blocks.add(receipt.blockNumber);
+    transactions++;
+  }
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  return { gas, seconds, transactions, blocks: blocks.size };
+}
+
+async function deploy() {
+  const RFIDAccess = await ethers.getContractFactory("RFIDAccess");
+  const rfidAccess = await RFIDAccess.deploy();
+  await rfidAccess.waitForDeployment();
+  return rfidAccess;
+}
+
+async function main() {
+  const events = Array.from({ length: EVENT_COUNT }, (_, i) => makeEvent(i));
+  const rows = [];
+
+  const single = await benchSingle(await deploy(), events);
+  rows.push({ mode: "logAccess", ...single });
+
+  for (const size of BATCH_SIZES) {
+    const result = await benchBatched(await deploy(), events, size);
+    rows.push({ mode: `logAccessBatch(${size})`, ...result });
+  }
+
+  console.log(`${EVENT_COUNT} events per run\n`);
+  console.table(rows.map(r => ({
+    mode: r.mode,
+    "events/sec": (EVENT_COUNT / r.seconds).toFixed(1),
+    "gas/event": (r.gas / BigInt(EVENT_COUNT)).toString(),
+    "events/tx": (EVENT_COUNT / r.transactions).toFixed(1),
+    "events/block": (EVENT_COUNT / r.blocks).toFixed(1),
+  })));
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exitCode = 1;
+});
@@ -0,0 +1,53 @@
+const { ethers } = require('ethers');
+
+// Event chain hashing, as in the firmware (event_chain.h) and
+// RFIDAccess.leafHash / verifyEvent:
+//   leaf = sha256(0x00 | prev leaf | seq | timestamp | packed record)
+//   node = sha256(0x01 | left | right)
+// A node without a right sibling is carried up a level unchanged.
+
+const ZERO_HASH = ethers.ZeroHash;
+
+function leafHash(prev, seq, timestamp, record) {
+    return ethers.sha256(ethers.solidityPacked(
+        ['bytes1', 'bytes32', 'uint32', 'uint32', 'bytes32'],
+        ['0x00', prev, seq, timestamp, record]
+    ));
+}
+
+function nodeHash(left, right) {
+    return ethers.sha256(ethers.solidityPacked(['bytes1', 'bytes32', 'bytes32'], ['0x01', left, right]));
+}
+
+function nextLevel(level) {
+    const next = [];
+    for (let i = 0; i < level.length; i += 2) {
+        next.push(i + 1 < level.length ? nodeHash(level[i], level[i + 1]) : level[i]);
+    }
+    return next;
+}
+
+function merkleRoot(leaves) {
+    let level = leaves;
+    while (level.length > 1) {
+        level = nextLevel(level);
+    }
+    return level[0];
+}
+
+// Sibling hashes from leaf index up to the root, for verifyEvent
+function merkleProof(leaves, index) {
+    const proof = [];
+    let level = leaves;
+    while (level.length > 1) {
+        const sibling = index ^ 1;
+        if (sibling < level.length) {
+            proof.push(level[sibling]);
+        }
+        level = nextLevel(level);
+        index = Math.floor(index / 2);
+    }
+    return proof;
+}
+
+module.exports = { ZERO_HASH, leafHash, nodeHash, merkleRoot, merkleProof };
@@ -1,6 +1,9 @@
+const fs = require('fs');
+const path = require('path');
 const express = require('express');
 const { ethers } = require('ethers');
 const ABI = require('./contractABI');
+const { ZERO_HASH, leafHash, merkleRoot, merkleProof } = require('./eventChain');
 const app = express();
 app.use(express.json());
 
@@ -9,10 +12,49 @@ const provider = new ethers.JsonRpcProvider('http://127.0.0.1:8545');
 const wallet = new ethers.Wallet('0xac0974bec39a17e36ba4a6b4d238ff944bacb478cbed5efcae784d7bf4f2ff80', provider);
 const contract = new ethers.Contract('0x5FbDB2315678afecb367f032d93F642f64180aa3', ABI, wallet);
 
+// Packed record from the firmware: one bytes32 as 0x + 64 hex digits
+// (layout in RFIDAccess.sol)
+const RECORD_PATTERN = /^0x[0-9a-fA-F]{64}$/;
+
+function isRecord(record) {
+    return typeof record === 'string' && RECORD_PATTERN.test(record);
+}
+
+// Legacy body from firmware before packed records:
+// {"rfidId":"63:5A:59:31","success":true,"fingerprintId":"1"}. Packed here
+// the way the firmware's packRecord() does; those devices had no id, so
+// they log as the firmware's default device.
+const LEGACY_DEVICE_ID = 1;
+const UID_SIZES = [4, 7, 10];
+
+function packLegacy({ rfidId, success, fingerprintId, device }) {
+    if (typeof rfidId !== 'string' || typeof success !== 'boolean') return null;
+    const hex = rfidId.replace(/[:\- ]/g, '');
+    if (!/^([0-9a-fA-F]{2})+$/.test(hex) || !UID_SIZES.includes(hex.length / 2)) return null;
+    const finger = fingerprintId === undefined || fingerprintId === '' ? 0 : Number(fingerprintId);
+    if (!Number.isInteger(finger) || finger < 0 || finger > 0xffff) return null;
+    const deviceId = device === undefined ? LEGACY_DEVICE_ID : device;
+    if (!Number.isInteger(deviceId) || deviceId < 0 || deviceId > 0xffffffff) return null;
+
+    const record = Buffer.alloc(32);
+    Buffer.from(hex, 'hex').copy(record, 0);
+    record[10] = hex.length / 2;
+    record.writeUInt16BE(finger, 11);
+    record[13] = success ? 0 : 1;   // EventKind.Unlock / Deny
+    record.writeUInt32BE(deviceId, 14);
+    return '0x' + record.toString('hex');
+}
+
 app.post('/log-access', async (req, res) => {
     try {
-        const { rfidId, success, fingerprintId } = req.body;
-        const tx = await contract.logAccess(rfidId, success, fingerprintId);
+        const record = req.body.record !== undefined ? req.body.record : packLegacy(req.body);
+        if (!isRecord(record)) {
+            return res.status(400).json({
+                success: false,
+                error: 'expected a 32-byte hex record, or rfidId, success and fingerprintId'
+            });
+        }
+        const tx = await contract.logPacked(record);
         await tx.wait();
         res.json({ success: true, txHash: tx.hash });
     } catch (error) {
@@ -20,6 +62,197 @@ app.post('/log-access', async (req, res) => {
     }
 });
 
+// Maximum events accepted in one batch request
+const MAX_BATCH_SIZE = 50;
+
+app.post('/log-access-batch', async (req, res) => {
+    try {
+        const { records } = req.body;
+        if (!Array.isArray(records) || records.length === 0 || records.length > MAX_BATCH_SIZE) {
+            return res.status(400).json({ success: false, error: `records must hold 1-${MAX_BATCH_SIZE} entries` });
+        }
+        if (!records.every(isRecord)) {
+            return res.status(400).json({ success: false, error: 'records must be 32-byte hex strings' });
+        }
+        const tx = await contract.logPackedBatch(records);
+        await tx.wait();
+        res.json({ success: true, txHash: tx.hash, count: records.length });
+    } catch (error) {
+        res.status(500).json({ success: false, error: error.message });
+    }
+});
+
+// ==================== EVENT CHAIN ====================
+// Full events of each device's hash chain, kept here while only a Merkle
+// root per window goes on-chain (RFIDAccess.anchor). Every change is
+// appended to a JSON-lines file and replayed on start.
+const STORE_PATH = path.join(__dirname, 'events.jsonl');
+const UINT32_MAX = 0xffffffff;
+
+// device -> { events: Map(seq -> { seq, t, record, leaf }), anchors: [...] }
+const chains = new Map();
+
+function deviceChain(device) {
+    if (!chains.has(device)) {
+        chains.set(device, { events: new Map(), anchors: [] });
+    }
+    return chains.get(device);
+}
+
+function anchoredSeq(chain) {
+    return chain.anchors.length > 0 ? chain.anchors[chain.anchors.length - 1].lastSeq : 0;
+}
+
+// Forget unanchored events after seq; the device sends them again
+function truncate(chain, seq) {
+    for (const key of [...chain.events.keys()]) {
+        if (key > seq) chain.events.delete(key);
+    }
+}
+
+function apply(entry) {
+    const chain = deviceChain(entry.device);
+    if (entry.type === 'event') {
+        chain.events.set(entry.seq, { seq: entry.seq, t: entry.t, record: entry.record, leaf: entry.leaf });
+    } else if (entry.type === 'truncate') {
+        truncate(chain, entry.seq);
+    } else if (entry.type === 'anchor') {
+        chain.anchors.push(entry);
+    }
+}
+
+function store(entry) {
+    apply(entry);
+    fs.appendFileSync(STORE_PATH, JSON.stringify(entry) + '\n');
+}
+
+if (fs.existsSync(STORE_PATH)) {
+    for (const line of fs.readFileSync(STORE_PATH, 'utf8').split('\n')) {
+        if (line.trim() !== '') apply(JSON.parse(line));
+    }
+}
+
+function isUint32(value, min = 0) {
+    return Number.isInteger(value) && value >= min && value <= UINT32_MAX;
+}
+
+// Band identifier in bytes 14..17 of a packed record
+function recordDevice(record) {
+    return parseInt(record.slice(30, 38), 16);
+}
+
+app.post('/events', (req, res) => {
+    const { device, events } = req.body;
+    if (!isUint32(device)) {
+        return res.status(400).json({ success: false, error: 'device must be a uint32' });
+    }
+    if (!Array.isArray(events) || events.length === 0 || events.length > MAX_BATCH_SIZE) {
+        return res.status(400).json({ success: false, error: `events must hold 1-${MAX_BATCH_SIZE} entries` });
+    }
+    const valid = events.every((event, i) =>
+        event !== null && typeof event === 'object' &&
+        isUint32(event.seq, 1) && event.seq === events[0].seq + i &&
+        isUint32(event.t) && isRecord(event.record) && recordDevice(event.record) === device);
+    if (!valid) {
+        return res.status(400).json({ success: false, error: 'events must be consecutive {seq, t, record} of this device' });
+    }
+
+    const chain = deviceChain(device);
+    for (const { seq, t, record } of events) {
+        const normalized = record.toLowerCase();
+        const stored = chain.events.get(seq);
+        if (stored && stored.t === t && stored.record === normalized) {
+            continue;  // Sent again after a reboot or a lost answer
+        }
+        if (seq <= anchoredSeq(chain)) {
+            return res.status(409).json({ success: false, error: `Event ${seq} is already anchored` });
+        }
+        const prev = seq === 1 ? ZERO_HASH : chain.events.get(seq - 1)?.leaf;
+        if (prev === undefined) {
+            return res.status(409).json({ success: false, error: `Missing event ${seq - 1}` });
+        }
+        if (stored) {
+            store({ type: 'truncate', device, seq: seq - 1 });
+        }
+        store({ type: 'event', device, seq, t, record: normalized, leaf: leafHash(prev, seq, t, normalized) });
+    }
+    res.json({ success: true, count: events.length });
+});
+
+// Sequence ranges of the delivered events, checked against what the device
+// hashed before anything is sent on-chain
+app.post('/anchor', async (req, res) => {
+    try {
+        const { device, firstSeq, lastSeq, root, head } = req.body;
+        if (!isUint32(device) || !isUint32(firstSeq, 1) || !isUint32(lastSeq, firstSeq) ||
+            !isRecord(root) || !isRecord(head)) {
+            return res.status(400).json({ success: false, error: 'anchor must be {device, firstSeq, lastSeq, root, head}' });
+        }
+
+        const chain = deviceChain(device);
+        const done = chain.anchors.find((anchor) => anchor.firstSeq === firstSeq);
+        if (done) {
+            // The device did not see our answer and sent the window again
+            if (done.lastSeq === lastSeq && done.root === root.toLowerCase()) {
+                return res.json({ success: true, anchorId: done.anchorId });
+            }
+            return res.status(409).json({ success: false, error: `Events from ${firstSeq} are already anchored` });
+        }
+
+        const leaves = [];
+        for (let seq = firstSeq; seq <= lastSeq; seq++) {
+            const event = chain.events.get(seq);
+            if (!event) {
+                return res.status(409).json({ success: false, error: `Missing event ${seq}` });
+            }
+            leaves.push(event.leaf);
+        }
+        if (merkleRoot(leaves) !== root.toLowerCase() || leaves[leaves.length - 1] !== head.toLowerCase()) {
+            return res.status(409).json({ success: false, error: 'Root does not match the delivered events' });
+        }
+
+        const tx = await contract.anchor(device, firstSeq, lastSeq, root, head);
+        const receipt = await tx.wait();
+        const anchored = receipt.logs
+            .map((log) => contract.interface.parseLog(log))
+            .find((log) => log && log.name === 'Anchored');
+        const anchorId = Number(anchored.args.anchorId);
+        store({ type: 'anchor', device, anchorId, firstSeq, lastSeq, root: root.toLowerCase(), head: head.toLowerCase() });
+        res.json({ success: true, txHash: tx.hash, anchorId });
+    } catch (error) {
+        res.status(500).json({ success: false, error: error.message });
+    }
+});
+
+// Inclusion proof for one anchored event, checkable with RFIDAccess.verifyEvent
+app.get('/proof/:device/:seq', (req, res) => {
+    const device = Number(req.params.device);
+    const seq = Number(req.params.seq);
+    if (!isUint32(device) || !isUint32(seq, 1)) {
+        return res.status(400).json({ success: false, error: 'device and seq must be uint32' });
+    }
+    const chain = deviceChain(device);
+    const anchor = chain.anchors.find((window) => seq >= window.firstSeq && seq <= window.lastSeq);
+    if (!anchor) {
+        return res.status(404).json({ success: false, error: `Event ${seq} is not anchored` });
+    }
+
+    const leaves = [];
+    for (let i = anchor.firstSeq; i <= anchor.lastSeq; i++) {
+        leaves.push(chain.events.get(i).leaf);
+    }
+    const event = chain.events.get(seq);
+    res.json({
+        success: true,
+        anchorId: anchor.anchorId,
+        seq,
+        t: event.t,
+        record: event.record,
+        leaf: event.leaf,
+        proof: merkleProof(leaves, seq - anchor.firstSeq)
+    });
+});
+
 app.listen(3000, () => {
     console.log('Server running on port 3000');
 });
\ No newline at end of file
@@ -1,6 +1,23 @@
 const { expect } = require("chai");
 const { ethers } = require("hardhat");
 const { anyValue } = require("@nomicfoundation/hardhat-chai-matchers/withArgs");
+const { ZERO_HASH, leafHash, merkleRoot, merkleProof } = require("./eventChain");
+
+// Packed record word as built by the firmware (event_codec.h packRecord)
+const Kind = { Unlock: 0, Deny: 1, Tamper: 2 };
+
+function packRecord(uid, kind, fingerprintId, deviceId) {
+  const bytes = new Uint8Array(32);
+  bytes.set(uid);
+  bytes[10] = uid.length;
+  bytes[11] = fingerprintId >> 8;
+  bytes[12] = fingerprintId & 0xff;
+  bytes[13] = kind;
+  new DataView(bytes.buffer).setUint32(14, deviceId);
+  return ethers.hexlify(bytes);
+}
+
+const UID4 = [0x63, 0x5a, 0x59, 0x31];
 
 describe("RFIDAccess", function () {
   let rfidAccess;
@@ -49,4 +66,225 @@ describe("RFIDAccess", function () {
       expect(await rfidAccess.getAccessCount()).to.equal(2);
     });
   });
+
+  describe("Batch Logging", function () {
+    it("Should emit one event per batched access", async function () {
+      const tx = rfidAccess.logAccessBatch(
+        ["63:5A:59:31", "TAMPER"],
+        [true, false],
+        ["1", "0"]
+      );
+      await expect(tx)
+        .to.emit(rfidAccess, "AccessAttempt")
+        .withArgs("63:5A:59:31", anyValue, true, "1");
+      await expect(tx)
+        .to.emit(rfidAccess, "AccessAttempt")
+        .withArgs("TAMPER", anyValue, false, "0");
+    });
+
+    it("Should store batched records in order", async function () {
+      await rfidAccess.logAccessBatch(["A1", "B2", "C3"], [true, false, true], ["1", "2", "3"]);
+
+      const records = await rfidAccess.getAccessRecords();
+      expect(records.length).to.equal(3);
+      expect(records[1].rfidId).to.equal("B2");
+      expect(records[1].success).to.equal(false);
+      expect(records[2].fingerprintId).to.equal("3");
+    });
+
+    it("Should reject batches with mismatched lengths", async function () {
+      await expect(
+        rfidAccess.logAccessBatch(["A1", "B2"], [true], ["1", "2"])
+      ).to.be.revertedWith("Batch arrays must have equal length");
+    });
+
+    it("Should not allow non-owner to log a batch", async function () {
+      await expect(
+        rfidAccess.connect(otherAccount).logAccessBatch(["A1"], [true], ["1"])
+      ).to.be.revertedWith("Only owner can call this function");
+    });
+  });
+
+  describe("Packed Records", function () {
+    it("Should accept the firmware's packed record", async function () {
+      // Same vector as test_access_event in firmware/test/test_event_codec
+      const record = "0x635A593100000000000004000100000000070000000000000000000000000000";
+      expect(record.toLowerCase()).to.equal(packRecord(UID4, Kind.Unlock, 1, 7));
+      await expect(rfidAccess.logPacked(record))
+        .to.emit(rfidAccess, "AccessLogged")
+        .withArgs(7, Kind.Unlock, "0x635a5931000000000000", 4, 1, anyValue);
+    });
+
+    it("Should be event-only unless storage is enabled", async function () {
+      await rfidAccess.logPacked(packRecord(UID4, Kind.Deny, 0, 1));
+      expect(await rfidAccess.getPackedCount()).to.equal(0);
+
+      await rfidAccess.setStoreRecords(true);
+      await rfidAccess.logPacked(packRecord(UID4, Kind.Unlock, 3, 1));
+      await rfidAccess.logPacked(packRecord([], Kind.Tamper, 0, 2));
+
+      const records = await rfidAccess.getPackedRecords();
+      expect(records.length).to.equal(2);
+      expect(records[0].uid).to.equal("0x635a5931000000000000");
+      expect(records[0].uidLength).to.equal(4);
+      expect(records[0].fingerprintId).to.equal(3);
+      expect(records[0].kind).to.equal(Kind.Unlock);
+      expect(records[1].kind).to.equal(Kind.Tamper);
+      expect(records[1].deviceId).to.equal(2);
+    });
+
+    it("Should log a packed batch in order", async function () {
+      const tx = rfidAccess.logPackedBatch([
+        packRecord(UID4, Kind.Unlock, 1, 5),
+        packRecord([], Kind.Tamper, 0, 5),
+      ]);
+      await expect(tx)
+        .to.emit(rfidAccess, "AccessLogged")
+        .withArgs(5, Kind.Unlock, "0x635a5931000000000000", 4, 1, anyValue);
+      await expect(tx)
+        .to.emit(rfidAccess, "AccessLogged")
+        .withArgs(5, Kind.Tamper, "0x00000000000000000000", 0, 0, anyValue);
+    });
+
+    it("Should reject malformed records", async function () {
+      const word = packRecord(UID4, Kind.Unlock, 1, 1);
+      const withLength = (n) => word.slice(0, 22) + n.toString(16).padStart(2, "0") + word.slice(24);
+      const withKind = (k) => word.slice(0, 28) + k.toString(16).padStart(2, "0") + word.slice(30);
+      await expect(rfidAccess.logPacked(withLength(11))).to.be.revertedWith("Malformed record");
+      await expect(rfidAccess.logPacked(withKind(3))).to.be.revertedWith("Malformed record");
+      await expect(rfidAccess.logPacked(word.slice(0, 65) + "1")).to.be.revertedWith("Malformed record");
+    });
+
+    it("Should not allow non-owner to log or change storage", async function () {
+      await expect(
+        rfidAccess.connect(otherAccount).logPacked(packRecord(UID4, Kind.Unlock, 1, 1))
+      ).to.be.revertedWith("Only owner can call this function");
+      await expect(
+        rfidAccess.connect(otherAccount).setStoreRecords(true)
+      ).to.be.revertedWith("Only owner can call this function");
+    });
+  });
+
+  describe("Anchoring", function () {
+    // Same vectors as test_leaf_and_root_vectors in firmware/test/test_event_chain
+    const LEAF1 = "0x8bb8b4008c9ba4f979e3658ca942e8cc246c897fbfe109764e90e9c92fffba27";
+    const LEAF3 = "0xe2b75e0c23ec9c5b8e0d363b7a88c66f2415874921250cbe2dd7348a6aa30ae0";
+    const ROOT3 = "0x8a3d5530ff9695dccd4866de83577f4733c77f221a4f49d1f62edeab88f61604";
+
+    // Leaves of a device's first events, chained from the zero hash
+    function chainLeaves(events, deviceId) {
+      const leaves = [];
+      let prev = ZERO_HASH;
+      events.forEach(([t, uid, kind, fingerprintId], i) => {
+        prev = leafHash(prev, i + 1, t, packRecord(uid, kind, fingerprintId, deviceId));
+        leaves.push(prev);
+      });
+      return leaves;
+    }
+
+    const EVENTS = [
+      [1000, UID4, Kind.Unlock, 1],
+      [2000, UID4, Kind.Deny, 0],
+      [3000, [], Kind.Tamper, 0],
+    ];
+
+    it("Should hash leaves and roots as the firmware does", async function () {
+      const leaves = chainLeaves(EVENTS, 7);
+      expect(leaves[0]).to.equal(LEAF1);
+      expect(leaves[2]).to.equal(LEAF3);
+      expect(merkleRoot(leaves)).to.equal(ROOT3);
+      expect(await rfidAccess.leafHash(ZERO_HASH, 1, 1000, packRecord(UID4, Kind.Unlock, 1, 7))).to.equal(LEAF1);
+    });
+
+    it("Should anchor consecutive windows per device", async function () {
+      await expect(rfidAccess.anchor(7, 1, 3, ROOT3, LEAF3))
+        .to.emit(rfidAccess, "Anchored")
+        .withArgs(7, 0, 1, 3, ROOT3, LEAF3);
+      expect(await rfidAccess.lastAnchoredSeq(7)).to.equal(3);
+
+      await expect(rfidAccess.anchor(7, 5, 6, ROOT3, LEAF3)).to.be.revertedWith("Sequence gap");
+      await expect(rfidAccess.anchor(7, 4, 3, ROOT3, LEAF3)).to.be.revertedWith("Empty window");
+      await rfidAccess.anchor(7, 4, 4, ROOT3, LEAF3);
+      await rfidAccess.anchor(8, 1, 1, LEAF1, LEAF1);
+      expect(await rfidAccess.getAnchorCount()).to.equal(3);
+    });
+
+    it("Should verify every event of a window against its root", async function () {
+      for (const count of [1, 2, 3, 5, 8, 13]) {
+        const events = Array.from({ length: count }, (_, i) => [1000 * (i + 1), UID4, Kind.Unlock, i]);
+        const leaves = chainLeaves(events, count);
+        await rfidAccess.anchor(count, 1, count, merkleRoot(leaves), leaves[count - 1]);
+        const anchorId = (await rfidAccess.getAnchorCount()) - 1n;
+
+        for (let i = 0; i < count; i++) {
+          const proof = merkleProof(leaves, i);
+          expect(await rfidAccess.verifyEvent(anchorId, i + 1, leaves[i], proof)).to.equal(true);
+          if (count > 1) {
+            expect(await rfidAccess.verifyEvent(anchorId, (i + 1) % count + 1, leaves[i], proof)).to.equal(false);
+          }
+        }
+        expect(await rfidAccess.verifyEvent(anchorId, count + 1, leaves[0], [])).to.equal(false);
+      }
+    });
+
+    it("Should not allow non-owner to anchor", async function () {
+      await expect(
+        rfidAccess.connect(otherAccount).anchor(7, 1, 3, ROOT3, LEAF3)
+      ).to.be.revertedWith("Only owner can call this function");
+    });
+
+    it("Should anchor a window for less gas than logging its events", async function () {
+      const WINDOW = 64;
+      const word = packRecord(UID4, Kind.Unlock, 1, 1);
+      const batch = await (await rfidAccess.logPackedBatch(Array(10).fill(word))).wait();
+      const anchored = await (await rfidAccess.anchor(1, 1, WINDOW, ROOT3, LEAF3)).wait();
+      const perEvent = anchored.gasUsed / BigInt(WINDOW);
+      console.log(`anchor(${WINDOW}): ${anchored.gasUsed} gas, ${perEvent} gas/event`);
+      expect(perEvent).to.be.lessThan(batch.gasUsed / 10n);
+    });
+  });
+
+  describe("Gas", function () {
+    const BATCH = 10;
+
+    async function gasOf(txPromise) {
+      const receipt = await (await txPromise).wait();
+      return receipt.gasUsed;
+    }
+
+    // Steady-state cost: the first write to a fresh array pays for its length slot
+    async function measure(log) {
+      await log();
+      return gasOf(log());
+    }
+
+    it("Should log packed records for less gas than strings", async function () {
+      const uid = "63:5A:59:31";
+      const word = packRecord(UID4, Kind.Unlock, 1, 1);
+      const rows = {};
+
+      rows["string, stored"] = await measure(() => rfidAccess.logAccess(uid, true, "1"));
+      rows["packed, event-only"] = await measure(() => rfidAccess.logPacked(word));
+      await rfidAccess.setStoreRecords(true);
+      rows["packed, stored"] = await measure(() => rfidAccess.logPacked(word));
+      await rfidAccess.setStoreRecords(false);
+
+      const strings = Array(BATCH).fill(uid);
+      const words = Array(BATCH).fill(word);
+      const perEvent = (gas) => gas / BigInt(BATCH);
+      rows[`string batch(${BATCH}), stored`] = perEvent(await measure(() =>
+        rfidAccess.logAccessBatch(strings, Array(BATCH).fill(true), Array(BATCH).fill("1"))));
+      rows[`packed batch(${BATCH}), event-only`] = perEvent(await measure(() =>
+        rfidAccess.logPackedBatch(words)));
+      await rfidAccess.setStoreRecords(true);
+      rows[`packed batch(${BATCH}), stored`] = perEvent(await measure(() =>
+        rfidAccess.logPackedBatch(words)));
+
+      console.table(Object.entries(rows).map(([layout, gas]) => ({ layout, "gas/event": gas.toString() })));
+
+      expect(rows["packed, stored"]).to.be.lessThan(rows["string, stored"]);
+      expect(rows["packed, event-only"]).to.be.lessThan(rows["packed, stored"]);
+      expect(rows[`packed batch(${BATCH}), stored`]).to.be.lessThan(rows[`string batch(${BATCH}), stored`]);
+    });
+  });
 });
\ No newline at end of file
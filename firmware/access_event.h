@@ -0,0 +1,46 @@
+#ifndef ACCESS_EVENT_H
+#define ACCESS_EVENT_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Kind of event reported to the blockchain gateway
+enum AccessEventType : uint8_t {
+  EVENT_ACCESS,   // Card + fingerprint decision
+  EVENT_TAMPER    // Tilt sensor alarm
+};
+
+// Plain-old-data record handed from the security path to the network task.
+// Raw values only; all text formatting happens on the network side.
+struct AccessEvent {
+  uint32_t timestamp;       // millis() when the event was raised
+  uint8_t  type;            // AccessEventType
+  bool     success;
+  uint8_t  uidSize;
+  uint8_t  uid[10];
+  uint16_t fingerprintId;
+
+  static AccessEvent access(uint32_t now, const uint8_t cardUID[], uint8_t size,
+                            bool granted, uint16_t fingerprintId) {
+    AccessEvent event;
+    memset(&event, 0, sizeof(event));
+    event.timestamp = now;
+    event.type = EVENT_ACCESS;
+    event.success = granted;
+    event.uidSize = size > sizeof(event.uid) ? sizeof(event.uid) : size;
+    memcpy(event.uid, cardUID, event.uidSize);
+    event.fingerprintId = fingerprintId;
+    return event;
+  }
+
+  static AccessEvent tamper(uint32_t now) {
+    AccessEvent event;
+    memset(&event, 0, sizeof(event));
+    event.timestamp = now;
+    event.type = EVENT_TAMPER;
+    return event;
+  }
+
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef ADMIN_COMMAND_H
+#define ADMIN_COMMAND_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Serial console request, parsed by the admin task and carried to the
+// security task over a bounded queue. The security task owns the reader,
+// the sensor and the card table, so it runs the command and prints the
+// result.
+enum AdminCommandType : uint8_t {
+  ADMIN_ENROLL,       // Enroll fingerCount samples of a finger from fingerprintId
+  ADMIN_ADD_CARD,     // Add the next card, bound to fingerCount fingers from fingerprintId
+  ADMIN_LIST_CARDS,
+  ADMIN_LOCK,
+  ADMIN_STATUS,
+  ADMIN_STATS,
+  ADMIN_STATS_JSON,
+  ADMIN_CANCEL        // Stop the console job in progress
+};
+
+struct AdminCommand {
+  uint8_t  type;            // AdminCommandType
+  uint8_t  fingerCount;     // Fingers bound to a card, or samples to enroll
+  uint16_t fingerprintId;
+
+  static AdminCommand make(AdminCommandType type, uint16_t fingerprintId = 0, uint8_t fingerCount = 0) {
+    AdminCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = type;
+    command.fingerprintId = fingerprintId;
+    command.fingerCount = fingerCount;
+    return command;
+  }
+};
+
+#endif
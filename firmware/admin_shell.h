@@ -0,0 +1,156 @@
+#ifndef ADMIN_SHELL_H
+#define ADMIN_SHELL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "hal.h"
+
+// ==================== ADMIN SHELL ====================
+// Serial console without blocking reads. Bytes are fed in one at a time as
+// they arrive and collected into a fixed line buffer; a completed line is
+// split into words in place and dispatched through a table of commands, so
+// nothing is allocated and nothing waits for input. Arguments come on the
+// same line ("enroll 12", "addcard 3 2"); commands never prompt.
+//
+// A line longer than ADMIN_LINE_MAX is dropped whole rather than run cut
+// short. Backspace edits the line. Handlers run on the caller's task and
+// must return at once: work that takes longer belongs to a job on the task
+// that owns the hardware (see SecuritySystem's admin jobs).
+
+typedef void (*ShellHandler)(void* context, uint8_t argc, char* argv[]);
+
+struct ShellCommand {
+  const char* name;
+  const char* args;       // Usage after the name, "" if none
+  const char* help;
+  uint8_t minArgs;        // Words after the name
+  uint8_t maxArgs;
+  ShellHandler handler;
+};
+
+class AdminShell {
+private:
+  const ShellCommand* commands;
+  uint8_t commandCount;
+  void* context;
+
+  char line[ADMIN_LINE_MAX];
+  uint8_t length;
+  bool overflowed;            // Discarding until the end of the line
+
+  // Counters
+  uint32_t lines;
+  uint32_t rejected;          // Unknown, malformed or too long
+
+  void printUsage(const ShellCommand &command) {
+    Serial.print("Usage: ");
+    Serial.print(command.name);
+    if (command.args[0] != '\0') {
+      Serial.print(" ");
+      Serial.print(command.args);
+    }
+    Serial.println();
+  }
+
+  void printHelp() {
+    Serial.println("Available commands:");
+    for (uint8_t i = 0; i < commandCount; i++) {
+      Serial.printf("  %-8s %-16s %s\n", commands[i].name, commands[i].args, commands[i].help);
+    }
+    Serial.printf("  %-8s %-16s %s\n", "help", "", "Show this help");
+  }
+
+  void run() {
+    char* argv[ADMIN_MAX_ARGS];
+    uint8_t argc = 0;
+    char* cursor = line;
+    for (;;) {
+      while (*cursor == ' ') *cursor++ = '\0';
+      if (*cursor == '\0') break;
+      if (argc == ADMIN_MAX_ARGS) {
+        Serial.println("Too many arguments.");
+        rejected++;
+        return;
+      }
+      argv[argc++] = cursor;
+      while (*cursor != '\0' && *cursor != ' ') cursor++;
+    }
+    if (argc == 0) return;  // Blank line
+    lines++;
+
+    if (strcmp(argv[0], "help") == 0) {
+      printHelp();
+      return;
+    }
+    for (uint8_t i = 0; i < commandCount; i++) {
+      const ShellCommand &command = commands[i];
+      if (strcmp(argv[0], command.name) != 0) continue;
+      if (argc - 1 < command.minArgs || argc - 1 > command.maxArgs) {
+        printUsage(command);
+        rejected++;
+        return;
+      }
+      command.handler(context, argc, argv);
+      return;
+    }
+    Serial.print("Unknown command: ");
+    Serial.print(argv[0]);
+    Serial.println(" (type help)");
+    rejected++;
+  }
+
+public:
+  AdminShell(const ShellCommand* _commands, uint8_t _commandCount, void* _context)
+    : commands(_commands), commandCount(_commandCount), context(_context), length(0), overflowed(false),
+      lines(0), rejected(0) {
+    line[0] = '\0';
+  }
+
+  // One byte of console input. Runs the command when it ends a line;
+  // otherwise O(1).
+  void feed(char c) {
+    if (c == '\r' || c == '\n') {
+      if (overflowed) {
+        Serial.println("Line too long, ignored.");
+        rejected++;
+      } else {
+        line[length] = '\0';
+        run();
+      }
+      length = 0;
+      overflowed = false;
+      return;
+    }
+    if (c == '\b' || c == 0x7F) {
+      if (length > 0 && !overflowed) length--;
+      return;
+    }
+    if (c == '\t') c = ' ';
+    if ((uint8_t)c < ' ' || overflowed) return;
+    if (length == ADMIN_LINE_MAX - 1) {
+      overflowed = true;
+      return;
+    }
+    line[length++] = c;
+  }
+
+  // Characters waiting for the end of their line
+  uint8_t pending() const { return length; }
+
+  uint32_t getLines() const { return lines; }
+  uint32_t getRejected() const { return rejected; }
+
+  // Whole decimal number within [min, max]; false for anything else
+  static bool parseNumber(const char* text, uint32_t min, uint32_t max, uint32_t &value) {
+    if (text == nullptr || *text < '0' || *text > '9') return false;
+    char* end;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (*end != '\0' || parsed < min || parsed > max) return false;
+    value = (uint32_t)parsed;
+    return true;
+  }
+};
+
+#endif
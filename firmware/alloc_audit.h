@@ -0,0 +1,84 @@
+#ifndef ALLOC_AUDIT_H
+#define ALLOC_AUDIT_H
+
+// ==================== ALLOCATION AUDIT ====================
+// Debug builds (-DCASHBAND_ALLOC_AUDIT) count heap allocations per task and
+// let a scope assert that it made none. On the ESP32 malloc/calloc/realloc
+// are intercepted with the linker's --wrap option (see env:esp32dev_debug),
+// which also catches String and operator new. Host builds count operator new.
+// Release builds compile the scopes away.
+//
+// Include from exactly one translation unit.
+
+#ifdef CASHBAND_ALLOC_AUDIT
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+
+static __thread uint32_t allocAuditCount = 0;
+
+inline uint32_t allocationCount() {
+  return allocAuditCount;
+}
+
+#ifdef ARDUINO
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  allocAuditCount++;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  allocAuditCount++;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  allocAuditCount++;
+  return __real_realloc(ptr, size);
+}
+}
+#else
+void* operator new(size_t size) {
+  allocAuditCount++;
+  void* ptr = malloc(size ? size : 1);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  allocAuditCount++;
+  void* ptr = malloc(size ? size : 1);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+#endif
+
+// Asserts on scope exit that the current task did not allocate
+class AllocFreeScope {
+private:
+  uint32_t start;
+
+public:
+  AllocFreeScope() : start(allocAuditCount) {}
+  ~AllocFreeScope() {
+    assert(allocAuditCount == start && "heap allocation on an allocation-free path");
+  }
+};
+
+#define ALLOC_FREE_SCOPE() AllocFreeScope allocFreeScope_
+#else
+#define ALLOC_FREE_SCOPE()
+#endif
+
+#endif
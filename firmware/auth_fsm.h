@@ -0,0 +1,206 @@
+#ifndef AUTH_FSM_H
+#define AUTH_FSM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ==================== AUTHENTICATION STATE MACHINE ====================
+// Card + fingerprint authentication driven by an explicit clock. Every call
+// to update() performs at most one driver operation, so the main loop keeps
+// servicing auto-lock, tamper detection and the admin console whatever phase
+// the authentication is in.
+//
+// While waiting for a finger the sensor is captured as soon as the driver
+// reports a touch, and polled at FP_POLL_INTERVAL otherwise. A failed image
+// conversion (smudged or partial image) recaptures within the same scan
+// window, up to FP_CONVERT_RETRIES times.
+//
+//   Idle -> CardRead -> AwaitFinger -> Capture -> Search -> Unlock
+//              |             |            |          |
+//              +-------------+------------+----------+---> Reject -> Idle
+
+#define FP_POLL_INTERVAL    100     // Sensor polling period while waiting for a finger
+#define FP_PROMPT_DURATION  1000    // Success LED blinks for this long after a card match
+#define REJECT_HOLD_TIME    1000    // Error indication before accepting a new card
+#define FP_CONVERT_RETRIES  2       // Recaptures after a failed image conversion
+
+// Result of a single fingerprint sensor operation
+enum FpResult : uint8_t {
+  FP_OK,
+  FP_NO_FINGER,
+  FP_NO_MATCH,
+  FP_ERROR
+};
+
+enum AuthState : uint8_t {
+  AUTH_IDLE,
+  AUTH_CARD_READ,
+  AUTH_AWAIT_FINGER,
+  AUTH_CAPTURE,
+  AUTH_SEARCH,
+  AUTH_UNLOCK,
+  AUTH_REJECT
+};
+
+// Outcome reported by update() on the tick a decision is made
+enum AuthOutcome : uint8_t {
+  AUTH_PENDING,
+  AUTH_GRANTED,
+  AUTH_CARD_REJECTED,
+  AUTH_FINGER_REJECTED
+};
+
+// Hardware operations needed by the state machine. Each call must be a single
+// bounded exchange with the device; no implementation may wait for the user.
+class AuthDriver {
+public:
+  virtual ~AuthDriver() {}
+  virtual bool cardPresent() = 0;
+  virtual bool readCard(uint8_t uid[], uint8_t &size) = 0;
+  virtual bool cardAuthorized(const uint8_t uid[], uint8_t size) = 0;
+  virtual FpResult captureImage() = 0;
+  virtual FpResult convertImage() = 0;
+  virtual FpResult searchFinger(uint16_t &fingerprintId) = 0;
+
+  // True once per finger contact reported by the sensor's touch output.
+  // Drivers without a touch line keep the default and are polled.
+  virtual bool fingerTouched() { return false; }
+};
+
+class AuthStateMachine {
+private:
+  AuthDriver &driver;
+  AuthState state;
+  uint32_t stateEnteredAt;
+  uint32_t lastPollTime;
+  uint32_t scanTimeout;
+  uint8_t convertFailures;
+
+  uint8_t cardUID[10];
+  uint8_t cardUIDSize;
+  uint16_t fingerprintId;
+
+  void enter(AuthState next, uint32_t now) {
+    state = next;
+    stateEnteredAt = now;
+  }
+
+  AuthOutcome reject(AuthOutcome reason, uint32_t now) {
+    enter(AUTH_REJECT, now);
+    return reason;
+  }
+
+public:
+  AuthStateMachine(AuthDriver &_driver, uint32_t _scanTimeout)
+    : driver(_driver), state(AUTH_IDLE), stateEnteredAt(0), lastPollTime(0),
+      scanTimeout(_scanTimeout), convertFailures(0), cardUIDSize(0), fingerprintId(0) {}
+
+  AuthOutcome update(uint32_t now) {
+    switch (state) {
+      case AUTH_IDLE:
+        if (driver.cardPresent()) {
+          enter(AUTH_CARD_READ, now);
+        }
+        return AUTH_PENDING;
+
+      case AUTH_CARD_READ:
+        if (!driver.readCard(cardUID, cardUIDSize)) {
+          enter(AUTH_IDLE, now);  // Read failure, wait for the next card
+          return AUTH_PENDING;
+        }
+        if (!driver.cardAuthorized(cardUID, cardUIDSize)) {
+          return reject(AUTH_CARD_REJECTED, now);
+        }
+        enter(AUTH_AWAIT_FINGER, now);
+        lastPollTime = now - FP_POLL_INTERVAL;  // Poll on the next tick
+        convertFailures = 0;
+        return AUTH_PENDING;
+
+      case AUTH_AWAIT_FINGER:
+        if (now - stateEnteredAt >= scanTimeout) {
+          return reject(AUTH_FINGER_REJECTED, now);
+        }
+        if (!driver.fingerTouched() && now - lastPollTime < FP_POLL_INTERVAL) {
+          return AUTH_PENDING;
+        }
+        lastPollTime = now;
+        // Anything but a captured image (no finger, imaging glitch) keeps polling
+        if (driver.captureImage() == FP_OK) {
+          state = AUTH_CAPTURE;  // Keep the scan window start
+        }
+        return AUTH_PENDING;
+
+      case AUTH_CAPTURE:
+        if (driver.convertImage() != FP_OK) {
+          if (convertFailures >= FP_CONVERT_RETRIES || now - stateEnteredAt >= scanTimeout) {
+            return reject(AUTH_FINGER_REJECTED, now);
+          }
+          convertFailures++;
+          state = AUTH_AWAIT_FINGER;              // Same scan window
+          lastPollTime = now - FP_POLL_INTERVAL;  // Recapture on the next tick
+          return AUTH_PENDING;
+        }
+        state = AUTH_SEARCH;
+        return AUTH_PENDING;
+
+      case AUTH_SEARCH:
+        if (driver.searchFinger(fingerprintId) != FP_OK) {
+          return reject(AUTH_FINGER_REJECTED, now);
+        }
+        enter(AUTH_UNLOCK, now);
+        return AUTH_GRANTED;
+
+      case AUTH_UNLOCK:
+        enter(AUTH_IDLE, now);
+        return AUTH_PENDING;
+
+      case AUTH_REJECT:
+        if (now - stateEnteredAt >= REJECT_HOLD_TIME) {
+          enter(AUTH_IDLE, now);
+        }
+        return AUTH_PENDING;
+    }
+    return AUTH_PENDING;
+  }
+
+  // Abandon any attempt in progress (e.g. manual lock or lockout)
+  void reset(uint32_t now) {
+    enter(AUTH_IDLE, now);
+  }
+
+  AuthState getState() const { return state; }
+  uint32_t timeInState(uint32_t now) const { return now - stateEnteredAt; }
+
+  // Time until update() has work that no card answer or finger touch
+  // announces (ms): 0 while a read or an image is pending, the next poll
+  // while waiting for a finger, the rest of the hold while rejecting
+  uint32_t nextStepIn(uint32_t now) const {
+    switch (state) {
+      case AUTH_IDLE:
+        return UINT32_MAX;
+      case AUTH_AWAIT_FINGER: {
+        uint32_t sincePoll = now - lastPollTime;
+        uint32_t untilPoll = sincePoll < FP_POLL_INTERVAL ? FP_POLL_INTERVAL - sincePoll : 0;
+        uint32_t waited = now - stateEnteredAt;
+        uint32_t untilTimeout = waited < scanTimeout ? scanTimeout - waited : 0;
+        return untilPoll < untilTimeout ? untilPoll : untilTimeout;
+      }
+      case AUTH_REJECT:
+        return now - stateEnteredAt < REJECT_HOLD_TIME ? REJECT_HOLD_TIME - (now - stateEnteredAt) : 0;
+      default:
+        return 0;
+    }
+  }
+
+  // True while the success LED should blink to prompt for a finger
+  bool promptActive(uint32_t now) const {
+    return (state == AUTH_AWAIT_FINGER || state == AUTH_CAPTURE || state == AUTH_SEARCH) &&
+           now - stateEnteredAt < FP_PROMPT_DURATION;
+  }
+
+  const uint8_t* getCardUID() const { return cardUID; }
+  uint8_t getCardUIDSize() const { return cardUIDSize; }
+  uint16_t getFingerprintId() const { return fingerprintId; }
+};
+
+#endif
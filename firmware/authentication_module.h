@@ -0,0 +1,245 @@
+#ifndef AUTHENTICATION_MODULE_H
+#define AUTHENTICATION_MODULE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+#include "hal.h"
+#include "auth_fsm.h"
+#include "latency_metrics.h"
+#include "boot_timeline.h"
+#include "enroll_job.h"
+
+// ==================== AUTHENTICATION MODULE CLASS ====================
+class AuthenticationModule {
+private:
+  CardReader &reader;
+  FingerprintSensor &finger;
+  Clock &clock;
+  Metrics &metrics;
+  BootTimeline &boot;
+  bool rfidInitialized;
+  
+  // Last card read, to tell one left on the reader from a new presentation
+  uint8_t lastUid[10];
+  uint8_t lastUidSize;
+  uint32_t lastUnanswered;     // Reader's unanswered REQA count at that read
+  bool cardResting;
+  
+  // Written once by the sensor bring-up; the sensor is not touched by the
+  // security task until it is BOOT_OK
+  volatile uint8_t fingerState;
+  uint32_t fingerStoredBaud;
+  
+  // Finger contact, for the decision latency
+  uint32_t lastTouchAt;
+  bool touchSeen;
+  uint32_t contactAt;          // Finger contact for the current capture
+  
+  // Console enrollment, stepped by the security task
+  EnrollJob enrollJob;
+  
+#ifdef ARDUINO
+  static void fingerTaskEntry(void* param) {
+    static_cast<AuthenticationModule*>(param)->bringUpFinger();
+    vTaskDelete(nullptr);
+  }
+#endif
+  
+  // Handshake and baud negotiation; a few hundred ms on the R307
+  void bringUpFinger() {
+    boot.start(BOOT_FINGER, clock.micros());
+    bool initialized = finger.begin(fingerStoredBaud);
+    if (initialized) {
+      Serial.print("Fingerprint sensor initialized at ");
+      Serial.print(finger.getBaud());
+      Serial.println(" baud");
+    } else {
+      Serial.println("WARNING: Fingerprint sensor not found! System will run with RFID only.");
+    }
+    boot.finish(BOOT_FINGER, clock.micros(), initialized);
+    fingerState = initialized ? BOOT_OK : BOOT_FAILED;
+  }
+  
+public:
+  AuthenticationModule(CardReader &_reader, FingerprintSensor &_finger, Clock &_clock, Metrics &_metrics,
+                       BootTimeline &_boot)
+    : reader(_reader), finger(_finger), clock(_clock), metrics(_metrics), boot(_boot),
+      rfidInitialized(false), lastUidSize(0), lastUnanswered(0), cardResting(false), fingerState(BOOT_NOT_STARTED), fingerStoredBaud(FP_BAUD_DEFAULT),
+      lastTouchAt(0), touchSeen(false), contactAt(0), enrollJob(_finger, ENROLL_STEP_TIMEOUT) {}
+  
+  // RFID reader first: the card path is what makes the system usable
+  bool initRfid() {
+    boot.start(BOOT_RFID, clock.micros());
+    rfidInitialized = reader.begin();
+    boot.finish(BOOT_RFID, clock.micros(), rfidInitialized);
+    return rfidInitialized;
+  }
+  
+  // Bring up the fingerprint sensor without holding up boot. storedBaud is
+  // the sensor rate remembered from the last boot.
+  void startFinger(uint32_t storedBaud) {
+    fingerStoredBaud = storedBaud;
+    fingerState = BOOT_RUNNING;
+#ifdef ARDUINO
+    if (xTaskCreatePinnedToCore(fingerTaskEntry, "fp_boot", FINGER_BOOT_STACK, this,
+                                FINGER_BOOT_PRIORITY, nullptr, FINGER_BOOT_CORE) != pdPASS) {
+      bringUpFinger();
+    }
+#else
+    // Host builds have no boot task; bring the sensor up inline
+    bringUpFinger();
+#endif
+  }
+  
+  bool isFingerReady() const {
+    return fingerState == BOOT_OK;
+  }
+  
+  // The bring-up has finished, either way
+  bool isFingerSettled() const {
+    return fingerState == BOOT_OK || fingerState == BOOT_FAILED;
+  }
+  
+  // Card detection windows (power_scheduler.h profiles)
+  void setRfidDutyCycle(uint32_t intervalMs, bool fieldSwitched) {
+    reader.setDutyCycle(intervalMs, fieldSwitched);
+  }
+  
+  // Set by the reader's IRQ; no SPI traffic here
+  bool isRfidCardPresent() {
+    if (!reader.cardPresent()) return false;
+    METRIC_RECORD(metrics, METRIC_CARD_DETECT, reader.getDetectLatency());
+    return true;
+  }
+  
+  // Time from the card's answer to its pickup by isRfidCardPresent()
+  uint32_t getDetectLatency() {
+    return reader.getDetectLatency();
+  }
+  
+  bool readRfidCard(uint8_t uid[], uint8_t &size) {
+    METRIC_START(clock, start);
+    bool read = reader.readCard(uid, size);
+    METRIC_STOP(metrics, METRIC_CARD_READ, clock, start);
+    if (!read) {
+      return false;
+    }
+  
+    // Same card, and every REQA since was answered: it never left the field
+    uint32_t unanswered = reader.getUnanswered();
+    cardResting = size == lastUidSize && memcmp(uid, lastUid, size) == 0 && unanswered == lastUnanswered;
+    memcpy(lastUid, uid, size);
+    lastUidSize = size;
+    lastUnanswered = unanswered;
+    if (cardResting) return true;
+  
+    // Print UID for debugging
+    Serial.print("RFID Tag detected: ");
+    for (uint8_t i = 0; i < size; i++) {
+      Serial.printf("%02X", uid[i]);
+    }
+    Serial.println();
+  
+    return true;
+  }
+  
+  // The last card read is one still lying on the reader since the read
+  // before, not a new presentation
+  bool isCardResting() const {
+    return cardResting;
+  }
+  
+  void printFingerStats() {
+    Serial.print("Fingerprint: ");
+    Serial.print(finger.getBaud());
+    Serial.println(" baud (stage latencies under 'stats')");
+  }
+  
+  void printRfidStats() {
+    reader.printStats();
+  }
+  
+  uint32_t getFingerBaud() const {
+    return finger.getBaud();
+  }
+  
+  // True once per touch edge from the sensor
+  bool takeFingerTouch() {
+    uint32_t touchedAt;
+    if (!finger.takeTouch(touchedAt)) return false;
+    lastTouchAt = touchedAt;
+    touchSeen = true;
+    return true;
+  }
+  
+  // Single-step fingerprint operations used by the authentication state machine
+  FpResult captureImage() {
+    // Sensor still coming up: the state machine keeps polling as for no finger
+    if (!isFingerReady()) return FP_NO_FINGER;
+    uint32_t start = clock.micros();
+    FpResult p = finger.captureImage();
+    if (p == FP_OK) {
+      METRIC_RECORD(metrics, METRIC_FP_CAPTURE, clock.micros() - start);
+      // Contact is the touch edge when there was a recent one, else this capture
+      contactAt = (touchSeen && start - lastTouchAt < FP_TOUCH_MAX_AGE) ? lastTouchAt : start;
+      touchSeen = false;
+    }
+    return p;
+  }
+  
+  FpResult convertImage() {
+    METRIC_START(clock, start);
+    FpResult p = finger.convertImage(1);
+    METRIC_STOP(metrics, METRIC_FP_CONVERT, clock, start);
+    if (p != FP_OK) {
+      Serial.println("Image conversion failed");
+      return FP_ERROR;
+    }
+    return FP_OK;
+  }
+  
+  // Match the captured finger against pageCount pages from startPage (1:1
+  // against the card's fingers, independent of library size), or against
+  // the whole library when pageCount is 0
+  FpResult searchFinger(uint16_t &fingerprintId, uint16_t startPage, uint8_t pageCount) {
+    METRIC_START(clock, start);
+    uint16_t score = 0;
+    FpResult result = finger.search(startPage, pageCount, fingerprintId, score);
+    METRIC_STOP(metrics, METRIC_FP_SEARCH, clock, start);
+    METRIC_STOP(metrics, METRIC_FP_DECISION, clock, contactAt);
+    if (result == FP_OK) {
+      Serial.print("Fingerprint ID #");
+      Serial.print(fingerprintId);
+      Serial.print(" with confidence ");
+      Serial.println(score);
+    } else if (result == FP_NO_MATCH) {
+      Serial.println("Finger not found in database");
+    }
+    return result;
+  }
+  
+  // Start enrolling samples of one finger at firstPage onwards
+  bool startEnrollment(uint16_t firstPage, uint8_t samples) {
+    if (!isFingerReady()) {
+      Serial.println("Fingerprint sensor not ready");
+      return false;
+    }
+    return enrollJob.begin(firstPage, samples, clock.millis());
+  }
+  
+  // One bounded step of the enrollment in progress
+  EnrollOutcome serviceEnrollment() {
+    return enrollJob.update(clock.millis());
+  }
+  
+  bool cancelEnrollment() {
+    return enrollJob.cancel();
+  }
+  
+  const EnrollJob &getEnrollJob() const {
+    return enrollJob;
+  }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef BLOCKCHAIN_INTERFACE_H
+#define BLOCKCHAIN_INTERFACE_H
+
+#include "config.h"
+#include "hal.h"
+#include "access_event.h"
+#include "event_codec.h"
+#include "alloc_audit.h"
+#include "http_transport.h"
+#include "event_chain.h"
+
+static_assert(eventsJsonMax(BATCH_MAX_EVENTS) < PAYLOAD_CAPACITY, "a full /events batch must fit the payload buffer");
+
+class BlockchainInterface {
+private:
+    const char* serverUrl;
+    uint32_t deviceId;                     // Band identifier in every record
+    NetTransport &net;
+    KeepAliveHttp<TransportClient> transport;  // One socket reused for every request
+    
+    char payload[PAYLOAD_CAPACITY];       // Request body, reused for every send
+    
+public:
+    BlockchainInterface(const char* url, uint32_t _deviceId, NetTransport &_net)
+        : serverUrl(url), deviceId(_deviceId), net(_net) {
+        transport.getClient().attach(&net);
+        transport.begin(serverUrl);
+    }
+    
+    void setTimeouts(uint32_t connectMs, uint32_t readMs) {
+        transport.setTimeouts(connectMs, readMs);
+    }
+    
+    // Queue the full events for the gateway's off-chain store, numbered
+    // from firstSeq, without waiting for the answer. Each successful
+    // sendEvents() must be matched by one awaitBatch(), in order.
+    bool sendEvents(const AccessEvent events[], uint32_t count, uint32_t firstSeq) {
+        if (!net.linkUp() || !canPipeline()) {
+            return false;
+        }
+        size_t length;
+        {
+            ALLOC_FREE_SCOPE();
+            length = encodeEventsJson(payload, sizeof(payload), events, count, deviceId, firstSeq);
+        }
+        if (length == 0) return false;
+        return transport.sendPost("/events", payload, length);
+    }
+    
+    // Commit a window of the event chain on-chain. Sent on its own, after
+    // every pipelined request has been answered.
+    bool postAnchor(const AnchorWindow &window) {
+        if (!net.linkUp() || transport.getInFlight() > 0) {
+            return false;
+        }
+        size_t length = encodeAnchorJson(payload, sizeof(payload), deviceId, window.firstSeq,
+                                         window.lastSeq, window.root, window.head);
+        if (length == 0) return false;
+        
+        int httpCode = transport.post("/anchor", payload, length);
+        if (httpCode != 200) {
+            Serial.print("Anchor failed, HTTP Response code: ");
+            Serial.println(httpCode);
+            return false;
+        }
+        return true;
+    }
+    
+    // Answer to the oldest pipelined request
+    bool awaitBatch() {
+        int httpCode = transport.readResponse();
+        if (httpCode != 200) {
+            Serial.print("Batch failed, HTTP Response code: ");
+            Serial.println(httpCode);
+            transport.close();  // Drop any answers still outstanding
+            return false;
+        }
+        return true;
+    }
+    
+    bool canPipeline() const {
+        return transport.getInFlight() < HTTP_MAX_PIPELINE;
+    }
+    
+    uint32_t getConnects() const {
+        return transport.getConnects();
+    }
+    
+    uint32_t getRequests() const {
+        return transport.getRequests();
+    }
+};
+
+#endif
\ No newline at end of file
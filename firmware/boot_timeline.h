@@ -0,0 +1,105 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <stdint.h>
+#include "hal.h"
+
+// ==================== BOOT TIMELINE ====================
+// Start and end of each boot stage, in micros() (time since power-on on the
+// device). The relay safe state, storage and the RFID reader come up in
+// order on the security task; the fingerprint sensor and the network come
+// up on their own tasks after the system is ready, so each stage has one
+// writer and the security task only reads the others.
+
+enum BootStage : uint8_t {
+  BOOT_SAFE_STATE,    // Relay locked, outputs off
+  BOOT_STORAGE,       // Credentials, counters and card table from NVS
+  BOOT_RFID,          // MFRC522 init and IRQ detection armed
+  BOOT_FINGER,        // R307 handshake and baud negotiation
+  BOOT_NETWORK,       // First Wi-Fi association attempt
+  BOOT_STAGE_COUNT
+};
+
+enum BootOutcome : uint8_t {
+  BOOT_NOT_STARTED,
+  BOOT_RUNNING,
+  BOOT_OK,
+  BOOT_FAILED
+};
+
+inline const char* bootStageName(uint8_t stage) {
+  static const char* const NAMES[BOOT_STAGE_COUNT] = {
+    "safe_state", "storage", "rfid", "finger", "network"
+  };
+  return stage < BOOT_STAGE_COUNT ? NAMES[stage] : "?";
+}
+
+class BootTimeline {
+private:
+  volatile uint32_t startedAt[BOOT_STAGE_COUNT];
+  volatile uint32_t finishedAt[BOOT_STAGE_COUNT];
+  volatile uint8_t outcomes[BOOT_STAGE_COUNT];
+  uint32_t readyAt;
+  bool ready;
+
+public:
+  BootTimeline() : readyAt(0), ready(false) {
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+      startedAt[i] = 0;
+      finishedAt[i] = 0;
+      outcomes[i] = BOOT_NOT_STARTED;
+    }
+  }
+
+  void start(uint8_t stage, uint32_t nowUs) {
+    if (stage >= BOOT_STAGE_COUNT) return;
+    startedAt[stage] = nowUs;
+    outcomes[stage] = BOOT_RUNNING;
+  }
+
+  // Written last, so a reader that sees the outcome sees the times too
+  void finish(uint8_t stage, uint32_t nowUs, bool ok) {
+    if (stage >= BOOT_STAGE_COUNT) return;
+    finishedAt[stage] = nowUs;
+    outcomes[stage] = ok ? BOOT_OK : BOOT_FAILED;
+  }
+
+  // The card path works: a card can be presented from here on
+  void markReady(uint32_t nowUs) {
+    readyAt = nowUs;
+    ready = true;
+  }
+
+  bool isReady() const { return ready; }
+  bool finished(uint8_t stage) const {
+    return stage < BOOT_STAGE_COUNT && (outcomes[stage] == BOOT_OK || outcomes[stage] == BOOT_FAILED);
+  }
+  uint8_t getOutcome(uint8_t stage) const { return stage < BOOT_STAGE_COUNT ? outcomes[stage] : (uint8_t)BOOT_NOT_STARTED; }
+  uint32_t getStartedAt(uint8_t stage) const { return stage < BOOT_STAGE_COUNT ? startedAt[stage] : 0; }
+  uint32_t getReadyAt() const { return readyAt; }
+
+  uint32_t duration(uint8_t stage) const {
+    return finished(stage) ? finishedAt[stage] - startedAt[stage] : 0;
+  }
+
+  // Time from the first stage to the ready signal
+  uint32_t timeToReady() const {
+    return ready ? readyAt - startedAt[BOOT_SAFE_STATE] : 0;
+  }
+
+  void printTable() const {
+    static const char* const OUTCOMES[] = {"-", "running", "ok", "failed"};
+    Serial.println("Boot stage     start   duration (us)");
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+      Serial.printf("%-12s %8lu %10lu  %s\n", bootStageName(i), (unsigned long)startedAt[i],
+                    (unsigned long)duration(i), OUTCOMES[outcomes[i]]);
+    }
+    Serial.print("Ready at ");
+    Serial.print(readyAt);
+    Serial.print(" us, ");
+    Serial.print(timeToReady());
+    Serial.println(" us after the safe state");
+  }
+};
+
+#endif
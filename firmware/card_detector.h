@@ -0,0 +1,135 @@
+#ifndef CARD_DETECTOR_H
+#define CARD_DETECTOR_H
+
+#include <stdint.h>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// ==================== CARD DETECTOR ====================
+// Bookkeeping for interrupt-driven MFRC522 card detection. A periodic timer
+// sends REQA and the reader raises its IRQ line when a card answers. The
+// main loop picks the detection up and reads the card without polling the
+// reader itself.
+//
+//   ARMED    -> timer sends REQA                  -> WAITING
+//   WAITING  -> IRQ (a card answered)             -> DETECTED
+//   WAITING  -> next timer tick, no answer        -> REQA again
+//   DETECTED -> main loop reads the card, rearm() -> ARMED
+//
+// REQA is not sent while a detection is pending, since it would reset the
+// card the main loop is about to select. A detection nobody picks up is
+// dropped after the stale timeout. IRQs outside WAITING are the reader's
+// own traffic (anticollision, select) and are ignored.
+//
+// A REQA that finds the reader still WAITING means the one before it went
+// unanswered: no card was in the field, or the one there was halted. The
+// count of those tells the owner whether a card it reads again has left
+// the field in between. A REQA sent over a stale detection does not
+// count: the card that answered is still awake and ignores it.
+//
+// Times are microseconds and may wrap.
+
+enum CardDetectState : uint8_t {
+  DETECT_ARMED,
+  DETECT_WAITING,
+  DETECT_DETECTED
+};
+
+class CardDetector {
+private:
+  volatile CardDetectState state;
+  volatile uint32_t detectedAt;
+  bool pickedUp;             // takeDetection() already reported this answer
+  bool overStale;            // Last REQA went out over a stale detection
+  uint32_t staleTimeout;
+
+  // Counters
+  volatile uint32_t reqaSent;
+  volatile uint32_t busySkips;
+  volatile uint32_t irqs;
+  volatile uint32_t ignoredIrqs;
+  uint32_t detections;
+  uint32_t stale;
+  uint32_t pickupTotal;
+  uint32_t pickupMax;
+  uint32_t pickupLast;
+  uint32_t reqaTimeTotal;
+  uint32_t unanswered;
+
+public:
+  CardDetector(uint32_t _staleTimeout)
+    : state(DETECT_ARMED), detectedAt(0), pickedUp(false), overStale(false), staleTimeout(_staleTimeout),
+      reqaSent(0), busySkips(0), irqs(0), ignoredIrqs(0), detections(0), stale(0),
+      pickupTotal(0), pickupMax(0), pickupLast(0), reqaTimeTotal(0), unanswered(0) {}
+
+  // Timer side: true when a REQA should go out now
+  bool shouldSendReqa(uint32_t nowUs) {
+    if (state == DETECT_DETECTED) {
+      if (nowUs - detectedAt < staleTimeout) return false;
+      stale++;  // Nobody read the card - start over
+    }
+    return true;
+  }
+
+  void onReqaSent(uint32_t spiTimeUs) {
+    reqaSent++;
+    reqaTimeTotal += spiTimeUs;
+    if (state == DETECT_WAITING && !overStale) unanswered++;
+    overStale = state == DETECT_DETECTED;
+    state = DETECT_WAITING;
+  }
+
+  // The reader was busy with a card transaction; try again next tick
+  void onBusy() {
+    busySkips++;
+  }
+
+  // Interrupt handler body
+  void IRAM_ATTR onIrq(uint32_t nowUs) {
+    irqs++;
+    if (state != DETECT_WAITING) {
+      ignoredIrqs++;
+      return;
+    }
+    detectedAt = nowUs;
+    pickedUp = false;
+    state = DETECT_DETECTED;
+  }
+
+  // Main loop side: true once per card answer. The timer keeps holding
+  // off until rearm() says the card has been read.
+  bool takeDetection(uint32_t nowUs) {
+    if (state != DETECT_DETECTED || pickedUp) return false;
+    pickedUp = true;
+    uint32_t pickup = nowUs - detectedAt;
+    pickupTotal += pickup;
+    pickupLast = pickup;
+    if (pickup > pickupMax) pickupMax = pickup;
+    detections++;
+    return true;
+  }
+
+  // Card transaction finished; resume REQA
+  void rearm() {
+    state = DETECT_ARMED;
+  }
+
+  bool isDetected() const { return state == DETECT_DETECTED; }
+  CardDetectState getState() const { return state; }
+
+  uint32_t getReqaSent() const { return reqaSent; }
+  uint32_t getBusySkips() const { return busySkips; }
+  uint32_t getIrqs() const { return irqs; }
+  uint32_t getIgnoredIrqs() const { return ignoredIrqs; }
+  uint32_t getDetections() const { return detections; }
+  uint32_t getStale() const { return stale; }
+  uint32_t getPickupMax() const { return pickupMax; }
+  uint32_t getPickupLast() const { return pickupLast; }
+  uint32_t getPickupAverage() const { return detections ? pickupTotal / detections : 0; }
+  uint32_t getReqaTimeTotal() const { return reqaTimeTotal; }
+  uint32_t getUnanswered() const { return unanswered; }
+};
+
+#endif
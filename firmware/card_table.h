@@ -0,0 +1,197 @@
+#ifndef CARD_TABLE_H
+#define CARD_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+// ==================== CARD TABLE ====================
+// Authorized RFID cards kept in RAM as an array sorted by (UID size, UID
+// bytes), so a lookup is a binary search with no allocation. Each entry
+// carries the sensor pages of the fingers bound to the card (a first page
+// and a count, so one holder can enroll several fingers) and an enabled flag.
+//
+// The header and records are laid out exactly as they are persisted: the
+// whole table is one versioned, CRC-protected blob that is read from and
+// written to storage in place.
+
+#define CARD_UID_MAX        10          // ISO 14443 triple-size UID
+#define CARD_TABLE_MAGIC    0x44524143u // "CARD"
+#define CARD_TABLE_VERSION  1
+#define CARD_FLAG_ENABLED   0x01
+#define CARD_ANY_FINGER     0           // Bound fingerprint: any enrolled finger
+
+struct CardRecord {
+  uint8_t uidSize;
+  uint8_t uid[CARD_UID_MAX];  // Zero padded past uidSize
+  uint8_t flags;
+  uint16_t fingerprintId;      // First bound page, or CARD_ANY_FINGER
+  uint8_t fingerprintCount;    // Bound pages from fingerprintId on
+  uint8_t reserved;
+};
+
+struct CardTableHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint16_t count;
+  uint16_t reserved;
+  uint32_t crc;       // CRC-32 of the records
+};
+
+static_assert(sizeof(CardRecord) == 16, "CardRecord is part of the stored format");
+static_assert(sizeof(CardTableHeader) == 16, "CardTableHeader is part of the stored format");
+
+inline bool isValidUidSize(uint8_t size) {
+  return size == 4 || size == 7 || size == 10;
+}
+
+template <uint16_t CAPACITY>
+class CardTable {
+private:
+  struct Blob {
+    CardTableHeader header;
+    CardRecord records[CAPACITY];
+  } blob;
+
+  static int compare(const CardRecord &record, const uint8_t uid[], uint8_t size) {
+    if (record.uidSize != size) return record.uidSize < size ? -1 : 1;
+    return memcmp(record.uid, uid, size);
+  }
+
+  // First index whose key is not below (uid, size)
+  uint16_t lowerBound(const uint8_t uid[], uint8_t size) const {
+    uint16_t low = 0;
+    uint16_t high = blob.header.count;
+    while (low < high) {
+      uint16_t mid = (uint16_t)((low + high) / 2);
+      if (compare(blob.records[mid], uid, size) < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  CardRecord* lookup(const uint8_t uid[], uint8_t size) {
+    uint16_t index = lowerBound(uid, size);
+    if (index < blob.header.count && compare(blob.records[index], uid, size) == 0) {
+      return &blob.records[index];
+    }
+    return nullptr;
+  }
+
+public:
+  CardTable() {
+    clear();
+  }
+
+  void clear() {
+    memset(&blob.header, 0, sizeof(blob.header));
+    blob.header.magic = CARD_TABLE_MAGIC;
+    blob.header.version = CARD_TABLE_VERSION;
+    blob.header.recordSize = sizeof(CardRecord);
+  }
+
+  // Card entry, or nullptr if the UID is not in the table
+  const CardRecord* find(const uint8_t uid[], uint8_t size) const {
+    return const_cast<CardTable*>(this)->lookup(uid, size);
+  }
+
+  // Insert a card, or update the metadata of one already present
+  bool add(const uint8_t uid[], uint8_t size, uint16_t fingerprintId, bool enabled = true) {
+    if (!isValidUidSize(size)) return false;
+
+    uint16_t index = lowerBound(uid, size);
+    CardRecord* record = &blob.records[index];
+    if (index >= blob.header.count || compare(*record, uid, size) != 0) {
+      if (blob.header.count >= CAPACITY) return false;
+      memmove(record + 1, record, (blob.header.count - index) * sizeof(CardRecord));
+      memset(record, 0, sizeof(CardRecord));
+      record->uidSize = size;
+      memcpy(record->uid, uid, size);
+      blob.header.count++;
+    }
+    record->fingerprintId = fingerprintId;
+    record->fingerprintCount = fingerprintId == CARD_ANY_FINGER ? 0 : 1;
+    record->flags = enabled ? CARD_FLAG_ENABLED : 0;
+    return true;
+  }
+
+  // Bind count consecutive sensor pages starting at firstPage
+  bool bindFingers(const uint8_t uid[], uint8_t size, uint16_t firstPage, uint8_t count) {
+    CardRecord* record = lookup(uid, size);
+    if (record == nullptr) return false;
+    record->fingerprintId = count > 0 ? firstPage : CARD_ANY_FINGER;
+    record->fingerprintCount = firstPage == CARD_ANY_FINGER ? 0 : count;
+    return true;
+  }
+
+  bool remove(const uint8_t uid[], uint8_t size) {
+    CardRecord* record = lookup(uid, size);
+    if (record == nullptr) return false;
+    CardRecord* end = blob.records + blob.header.count;
+    memmove(record, record + 1, (end - record - 1) * sizeof(CardRecord));
+    blob.header.count--;
+    return true;
+  }
+
+  bool setEnabled(const uint8_t uid[], uint8_t size, bool enabled) {
+    CardRecord* record = lookup(uid, size);
+    if (record == nullptr) return false;
+    record->flags = enabled ? (record->flags | CARD_FLAG_ENABLED)
+                            : (record->flags & ~CARD_FLAG_ENABLED);
+    return true;
+  }
+
+  uint16_t size() const { return blob.header.count; }
+  uint16_t capacity() const { return CAPACITY; }
+  const CardRecord &at(uint16_t index) const { return blob.records[index]; }
+
+  // ---- Persistence -------------------------------------------------------
+
+  // Stamp the CRC and return the number of bytes to store from blobData()
+  size_t seal() {
+    blob.header.crc = crc32(reinterpret_cast<const uint8_t*>(blob.records),
+                            blob.header.count * sizeof(CardRecord));
+    return sizeof(CardTableHeader) + blob.header.count * sizeof(CardRecord);
+  }
+
+  uint8_t* blobData() { return reinterpret_cast<uint8_t*>(&blob); }
+  size_t blobCapacity() const { return sizeof(blob); }
+
+  // Validate length bytes just read into blobData(). An unknown version,
+  // corrupt record or unsorted table leaves the table empty.
+  bool accept(size_t length) {
+    const CardTableHeader &header = blob.header;
+    bool valid = length >= sizeof(CardTableHeader) &&
+                 header.magic == CARD_TABLE_MAGIC &&
+                 header.version == CARD_TABLE_VERSION &&
+                 header.recordSize == sizeof(CardRecord) &&
+                 header.count <= CAPACITY &&
+                 length == sizeof(CardTableHeader) + header.count * sizeof(CardRecord) &&
+                 header.crc == crc32(reinterpret_cast<const uint8_t*>(blob.records),
+                                     header.count * sizeof(CardRecord));
+    for (uint16_t i = 0; valid && i < header.count; i++) {
+      const CardRecord &record = blob.records[i];
+      valid = isValidUidSize(record.uidSize) &&
+              (i == 0 || compare(blob.records[i - 1], record.uid, record.uidSize) < 0);
+    }
+    if (!valid) {
+      clear();
+      return false;
+    }
+    // Tables written before page ranges existed bind a single page
+    for (uint16_t i = 0; i < header.count; i++) {
+      CardRecord &record = blob.records[i];
+      if (record.fingerprintId != CARD_ANY_FINGER && record.fingerprintCount == 0) {
+        record.fingerprintCount = 1;
+      }
+    }
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// ==================== CONFIGURATION ====================
+// Pin definitions
+#define SS_PIN       5     // RFID SS (SDA)
+#define RST_PIN      0     // RFID RST
+#define RELAY_PIN    2     // Relay IN (LOW = energize)
+#define TILT_PIN     15    // Tilt sensor (INPUT_PULLUP)
+#define FINGER_RX    21    // R307 TX → ESP32 RX2
+#define FINGER_TX    22    // R307 RX → ESP32 TX2
+#define LED_SUCCESS  13    // Green LED for successful authentication
+#define LED_ERROR    12    // Red LED for authentication failures
+#define BUZZER_PIN   14    // Buzzer for audio feedback
+#define RFID_IRQ_PIN 4     // RFID IRQ (active low)
+#define FP_TOUCH_PIN 27    // R307 touch/WAKEUP output (high while touched)
+
+// System parameters
+#define UNLOCK_DURATION     30000   // Auto-lock after 30 seconds
+#define FP_SCAN_TIMEOUT     10000   // Fingerprint scan timeout (10 seconds)
+#define TILT_ALARM_DURATION 30000   // Alarm duration after tilt detection
+#define TILT_ALARM_REPEAT   5000    // Alert sound interval while the alarm runs
+#define MAX_FAILED_ATTEMPTS 5       // Maximum consecutive failed attempts
+#define LOCKOUT_DURATION    300000  // 5-minute lockout after too many failed attempts
+
+// Network retry parameters
+#define WIFI_CONNECT_TIMEOUT  20000   // Longest one association attempt may take (ms)
+#define WIFI_BACKOFF_MIN      500     // First retry delay after a failed attempt (ms)
+#define WIFI_BACKOFF_MAX      60000   // Retry delay cap; retries never stop (ms)
+#define WIFI_IDLE_WAIT        60000   // Link service interval while nothing is pending (ms)
+
+// Tasks. Core 0 runs the Wi-Fi stack and the network task; core 1 runs the
+// security task, which only yields to the admin console while it sleeps.
+#define SECURITY_TASK_STACK    8192   // Security task: relay, tilt, auth state
+#define SECURITY_TASK_PRIORITY 5      // Above the admin task and Arduino loop
+#define SECURITY_TASK_CORE     1
+#define SECURITY_TICK          100    // Pass period while always on or an attempt runs (ms)
+#define HEAP_SAMPLE_INTERVAL   1000   // Heap gauges for the stats command, taken on the security task (ms)
+#define NETWORK_TASK_STACK     8192   // Network task: Wi-Fi link and logging
+#define NETWORK_TASK_PRIORITY  1      // Below the lwIP and Wi-Fi driver tasks
+#define NETWORK_TASK_CORE      0      // Keep network work off the security core
+#define ADMIN_TASK_STACK       4096   // Admin task: serial console
+#define ADMIN_TASK_PRIORITY    1
+#define ADMIN_TASK_CORE        1
+#define ADMIN_QUEUE_SIZE       4      // Console commands waiting for the security task (power of two)
+#define FINGER_BOOT_STACK      4096   // Fingerprint bring-up, exits once the sensor answers
+#define FINGER_BOOT_PRIORITY   1
+#define FINGER_BOOT_CORE       0      // Handshake retries stay off the security core
+
+// Power (power_scheduler.h)
+#define POWER_PROFILE         POWER_DUTY_CYCLED // always_on, duty_cycled or on_demand
+#define POWER_IDLE_WAIT       1000    // Longest the security task sleeps with nothing due (ms)
+#define RADIO_LINGER          10000   // On-demand Wi-Fi stays up this long after the log drains (ms)
+#define ADMIN_POLL_INTERVAL   200     // Console input check period (ms)
+
+// Admin console (admin_shell.h)
+#define ADMIN_LINE_MAX        64      // Longest console line, terminator included
+#define ADMIN_MAX_ARGS        4       // Words per line, the command included
+#define ADMIN_READ_BUDGET     32      // Console bytes taken per admin pass
+#define ADD_CARD_TIMEOUT      10000   // addcard waits this long for a card (ms)
+
+// Rough datasheet typicals for the estimated average current (uA)
+#define POWER_CPU_ACTIVE_UA   50000   // ESP32 running at 240 MHz, radio off
+#define POWER_CPU_IDLE_UA     30000   // Blocked in the idle task, no light sleep
+#define POWER_LIGHT_SLEEP_UA  800     // Light sleep, RTC and GPIO wake armed
+#define POWER_WINDOW_AWAKE_US 1500    // CPU time per detection window (timer callbacks, sleep exit/entry)
+#define POWER_WIFI_ACTIVE_UA  70000   // Radio receiving between beacons (added to the CPU)
+#define POWER_WIFI_SAVE_UA    8000    // Radio in modem sleep, DTIM1 beacons
+#define POWER_RFID_FIELD_UA   26000   // MFRC522 with the antenna driven
+#define POWER_RFID_IDLE_UA    7000    // MFRC522 with the antenna off
+
+// Boot
+#define BOOT_READY_BUDGET     500     // Target from power-on to the card path being usable (ms)
+
+// Blockchain logging
+#define LOG_QUEUE_SIZE        32      // Pending access events (power of two)
+#define OUTBOX_PARTITION      "outbox" // Flash partition for undelivered events
+#define OUTBOX_RETRY_INTERVAL 5000    // Delay between drain attempts while offline
+#define BATCH_MAX_EVENTS      10      // Events coalesced into one gateway request
+#define BATCH_MAX_DELAY       2000    // Longest an event waits for a batch to fill
+#define DEVICE_ID_DEFAULT     1       // Band identifier in records until "device_id" is stored
+#define PAYLOAD_CAPACITY      1280    // Largest request body: a full /events batch (at most 1152 bytes)
+
+// Event chain anchoring (event_chain.h)
+#define ANCHOR_WINDOW_EVENTS  64      // Events per on-chain Merkle root (at most 255)
+#define ANCHOR_INTERVAL       600000  // Longest a delivered event waits to be anchored (ms)
+
+// Fingerprint sensor link
+#define FP_BAUD_DEFAULT       57600   // R307 factory setting
+#define FP_BAUD_FAST          115200  // Negotiated at init and remembered
+#define FP_POWER_UP_TIME      200     // R307 ignores commands this long after power-on (ms)
+#define FP_TOUCH_MAX_AGE      1000000 // Touch older than this is not the capture's contact (us)
+
+// Fingerprint enrollment (enroll_job.h)
+#define ENROLL_SAMPLES        2       // Models stored per finger unless the command says otherwise
+#define ENROLL_MAX_SAMPLES    5
+#define ENROLL_STEP_TIMEOUT   20000   // Longest wait for the finger to land or lift (ms)
+
+// Card detection (MFRC522 IRQ)
+#define RFID_REQA_INTERVAL    50      // REQA period while no card is present (ms)
+#define RFID_STALE_DETECTION  500000  // Drop a detection nobody read after this (us)
+#define RFID_WINDOW_INTERVAL  100     // Detection window period when duty cycled (ms)
+#define RFID_FIELD_SETTLE     5       // Antenna on before REQA, the ISO 14443 minimum (ms)
+#define RFID_ANSWER_WINDOW    2       // Antenna left on for an answer after REQA (ms)
+
+// Reader bank (reader_bank.h): several MFRC522s on the shared SPI bus
+#define RFID_MAX_READERS      8       // Readers and relays one controller drives
+#define RFID_SLOT_TIME        1000    // Bus time for one REQA and its answer; REQAs are at least this far apart (us)
+
+// Bank build: 2-4 readers, each with its own door relay, in place of the
+// single reader (set with -DRFID_BANK_READERS=n, see platformio.env).
+// Reader 0 is the single build's reader and relay; their IRQ outputs share
+// RFID_IRQ_PIN.
+#ifndef RFID_BANK_READERS
+#define RFID_BANK_READERS     0       // 0 = single reader on SS_PIN, relay on RELAY_PIN
+#endif
+#define RFID_BANK_SS_PINS     {SS_PIN, 16, 17, 25}      // Chip selects, reader 0 first
+#define RFID_BANK_RELAY_PINS  {RELAY_PIN, 26, 32, 33}   // Door relays (LOW = energize), reader 0 first
+
+// Tamper detection (SW-420 pulses on TILT_PIN)
+#define TAMPER_THRESHOLD      3       // Pulses within the window that raise an alarm
+#define TAMPER_WINDOW         200     // Sliding window length (ms)
+#define TAMPER_DEBOUNCE       2       // Edges closer than this are contact bounce (ms)
+#define TAMPER_HOLDOFF        5000    // Minimum spacing between tamper events (ms)
+
+// Authorized cards. The table is one NVS blob of 16 bytes per card plus a
+// 16-byte header (32 KiB RAM and a 32,784-byte blob at 2048 cards). NVS
+// writes the new blob before erasing the old one, so the partition must hold
+// two copies next to the other keys; storage_manager.h checks this.
+#define CARD_TABLE_CAPACITY   2048    // Cards held in RAM (16 bytes each)
+#define NVS_PARTITION_SIZE    0x15000 // "nvs" size in partitions.csv
+#define NVS_RESERVED_BYTES    8192    // Credentials, counters, chain and PHY data
+#define LEGACY_UID_SLOTS      10      // auth_uid_0..9 keys from older firmware
+
+#endif
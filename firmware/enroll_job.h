@@ -0,0 +1,214 @@
+#ifndef ENROLL_JOB_H
+#define ENROLL_JOB_H
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+#include "auth_fsm.h"
+
+// ==================== ENROLLMENT JOB ====================
+// Fingerprint enrollment as a resumable job. Each call to update() does at
+// most one sensor exchange, so the security loop keeps running auto-lock,
+// tamper detection and the console between steps. Waiting for the finger
+// to land or to lift is polled at FP_POLL_INTERVAL (at once on a touch)
+// and gives up after the step timeout; cancel() stops the job between
+// steps.
+//
+// A finger is enrolled as several samples, each a model merged from two
+// images and stored on consecutive pages from firstPage. Binding a card to
+// that page range ("addcard <id> <samples>") matches the finger against
+// its own samples only, so more samples improve acceptance without making
+// the search slower.
+//
+//   AwaitFinger -> Convert -> AwaitLift -> AwaitFinger -> Convert -> Model -> Store
+//        ^                                                                      |
+//        +------------------------ next sample, after AwaitLift ----------------+
+
+enum EnrollState : uint8_t {
+  ENROLL_IDLE,
+  ENROLL_AWAIT_FINGER,    // Polling for the finger for the current image
+  ENROLL_CONVERT,         // Image captured, into the image's character buffer
+  ENROLL_AWAIT_LIFT,      // Finger must leave before the next image
+  ENROLL_MODEL,           // Both buffers filled, merge them
+  ENROLL_STORE            // Model made, store it at the sample's page
+};
+
+// Outcome reported by update() on the step the job ends
+enum EnrollOutcome : uint8_t {
+  ENROLL_PENDING,
+  ENROLL_DONE,
+  ENROLL_FAILED,          // Sensor error, or the images kept failing
+  ENROLL_TIMED_OUT,       // Nobody placed or lifted the finger in time
+  ENROLL_CANCELLED
+};
+
+class EnrollJob {
+private:
+  FingerprintSensor &finger;
+  uint32_t stepTimeout;
+
+  EnrollState state;
+  uint32_t stepStartedAt;     // ms, current wait began
+  uint32_t lastPollTime;
+  uint16_t firstPage;
+  uint8_t samples;
+  uint8_t sample;             // Current sample, from 0
+  uint8_t image;              // Current image of the sample, 1 or 2
+  uint8_t retries;            // Bad images and mismatched pairs so far
+
+  void awaitFinger(uint32_t now) {
+    state = ENROLL_AWAIT_FINGER;
+    stepStartedAt = now;
+    lastPollTime = now - FP_POLL_INTERVAL;  // Poll on the next step
+    Serial.printf("Place finger (sample %u/%u, image %u/2)\n", sample + 1, samples, image);
+  }
+
+  void awaitLift(uint32_t now) {
+    state = ENROLL_AWAIT_LIFT;
+    stepStartedAt = now;
+    lastPollTime = now;  // The finger was just on the sensor
+    Serial.println("Remove finger");
+  }
+
+  EnrollOutcome finish(EnrollOutcome outcome) {
+    state = ENROLL_IDLE;
+    return outcome;
+  }
+
+  // A bad image or pair; false once there have been too many
+  bool retry() {
+    return ++retries <= FP_CONVERT_RETRIES * samples;
+  }
+
+  // Time to look at the sensor: a touch, or the poll interval passed
+  bool pollDue(uint32_t now) {
+    uint32_t touchedAt;
+    if (!finger.takeTouch(touchedAt) && now - lastPollTime < FP_POLL_INTERVAL) return false;
+    lastPollTime = now;
+    return true;
+  }
+
+public:
+  EnrollJob(FingerprintSensor &_finger, uint32_t _stepTimeout)
+    : finger(_finger), stepTimeout(_stepTimeout), state(ENROLL_IDLE), stepStartedAt(0), lastPollTime(0),
+      firstPage(0), samples(0), sample(0), image(1), retries(0) {}
+
+  // Enroll samples models at firstPage onwards. False if a job is running.
+  bool begin(uint16_t _firstPage, uint8_t _samples, uint32_t now) {
+    if (state != ENROLL_IDLE || _samples == 0) return false;
+    firstPage = _firstPage;
+    samples = _samples;
+    sample = 0;
+    image = 1;
+    retries = 0;
+    uint32_t touchedAt;
+    finger.takeTouch(touchedAt);  // An old touch is not this enrollment's
+    awaitFinger(now);
+    return true;
+  }
+
+  EnrollOutcome update(uint32_t now) {
+    FpResult result;
+    switch (state) {
+      case ENROLL_IDLE:
+        return ENROLL_PENDING;
+
+      case ENROLL_AWAIT_FINGER:
+        if (now - stepStartedAt >= stepTimeout) {
+          Serial.println("No finger, enrollment timed out");
+          return finish(ENROLL_TIMED_OUT);
+        }
+        if (!pollDue(now)) return ENROLL_PENDING;
+        // No finger or an imaging glitch keeps polling
+        if (finger.captureImage() == FP_OK) state = ENROLL_CONVERT;
+        return ENROLL_PENDING;
+
+      case ENROLL_CONVERT:
+        if (finger.convertImage(image) != FP_OK) {
+          if (!retry()) {
+            Serial.println("Image conversion failed");
+            return finish(ENROLL_FAILED);
+          }
+          Serial.println("Image unclear, hold the finger still");
+          state = ENROLL_AWAIT_FINGER;   // Same wait, recapture at once
+          lastPollTime = now - FP_POLL_INTERVAL;
+          return ENROLL_PENDING;
+        }
+        if (image == 1) {
+          image = 2;
+          awaitLift(now);
+        } else {
+          state = ENROLL_MODEL;
+        }
+        return ENROLL_PENDING;
+
+      case ENROLL_AWAIT_LIFT:
+        if (now - stepStartedAt >= stepTimeout) {
+          Serial.println("Finger not removed, enrollment timed out");
+          return finish(ENROLL_TIMED_OUT);
+        }
+        if (!pollDue(now)) return ENROLL_PENDING;
+        if (finger.captureImage() == FP_NO_FINGER) awaitFinger(now);
+        return ENROLL_PENDING;
+
+      case ENROLL_MODEL:
+        result = finger.createModel();
+        if (result != FP_OK) {
+          if (!retry()) {
+            Serial.println("Could not create model");
+            return finish(ENROLL_FAILED);
+          }
+          Serial.println("Images did not match, starting the sample again");
+          image = 1;
+          awaitLift(now);
+          return ENROLL_PENDING;
+        }
+        state = ENROLL_STORE;
+        return ENROLL_PENDING;
+
+      case ENROLL_STORE:
+        if (finger.storeModel(firstPage + sample) != FP_OK) {
+          Serial.println("Storing model failed");
+          return finish(ENROLL_FAILED);
+        }
+        Serial.printf("Sample %u/%u stored at #%u\n", sample + 1, samples, firstPage + sample);
+        if (++sample == samples) return finish(ENROLL_DONE);
+        image = 1;
+        awaitLift(now);
+        return ENROLL_PENDING;
+    }
+    return ENROLL_PENDING;
+  }
+
+  // Stop between steps. Samples already stored stay in the library.
+  bool cancel() {
+    if (state == ENROLL_IDLE) return false;
+    state = ENROLL_IDLE;
+    return true;
+  }
+
+  bool isActive() const { return state != ENROLL_IDLE; }
+  EnrollState getState() const { return state; }
+  uint16_t getFirstPage() const { return firstPage; }
+  uint8_t getSamples() const { return samples; }
+  uint8_t getSamplesStored() const { return sample; }
+  uint8_t getImage() const { return image; }
+
+  // Time left for the finger to land or lift (ms)
+  uint32_t getStepTimeLeft(uint32_t now) const {
+    if (state != ENROLL_AWAIT_FINGER && state != ENROLL_AWAIT_LIFT) return stepTimeout;
+    uint32_t elapsed = now - stepStartedAt;
+    return elapsed < stepTimeout ? stepTimeout - elapsed : 0;
+  }
+
+  void printProgress(uint32_t now) const {
+    static const char* const STEPS[] = {"idle", "waiting for the finger", "converting", "waiting for the finger to lift",
+                                        "merging", "storing"};
+    if (state == ENROLL_IDLE) return;
+    Serial.printf("Enrolling #%u-#%u: sample %u/%u, image %u/2, %s (%lu s left)\n", firstPage,
+                  firstPage + samples - 1, sample + 1, samples, image, STEPS[state],
+                  (unsigned long)(getStepTimeLeft(now) / 1000));
+  }
+};
+
+#endif
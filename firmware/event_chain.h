@@ -0,0 +1,180 @@
+#ifndef EVENT_CHAIN_H
+#define EVENT_CHAIN_H
+
+#include <stdint.h>
+#include <string.h>
+#include "access_event.h"
+#include "event_codec.h"
+#include "sha256.h"
+
+// ==================== EVENT CHAIN ====================
+// Hash chain over delivered access events, anchored on-chain a window at a
+// time. Every event gets the next sequence number and a leaf hash that
+// commits to the leaf before it:
+//
+//   leaf = sha256(0x00 | prev leaf | seq | timestamp | packed record)
+//
+// (seq and timestamp as 4-byte big-endian, record as in event_codec.h).
+// The leaves of a window form a Merkle tree with
+//
+//   node = sha256(0x01 | left | right)
+//
+// where a node without a right sibling is carried up a level unchanged.
+// RFIDAccess.anchor() receives only the root and the sequence range; the
+// events themselves go to the gateway, which can then prove any one of
+// them against the root (RFIDAccess.verifyEvent).
+//
+// The root is built while leaves arrive, keeping one pending hash per tree
+// level (the set bits of the leaf count), so a window of n events needs
+// log2(n) hashes of RAM rather than the leaves themselves.
+
+#define CHAIN_MAX_LEVELS 8    // Windows of up to 255 events
+
+#define CHAIN_LEAF_PREFIX 0x00
+#define CHAIN_NODE_PREFIX 0x01
+
+// Persistent chain position, written when an anchor is sent and when it is
+// accepted
+struct ChainCheckpoint {
+  uint32_t nextSeq;                 // Sequence number of the next event
+  uint32_t pendingEnd;              // Last event of an anchor in flight, 0 if none
+  uint8_t  head[SHA256_BYTES];      // Leaf of event nextSeq - 1, zero before the first
+
+  static ChainCheckpoint initial() {
+    ChainCheckpoint checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    checkpoint.nextSeq = 1;
+    return checkpoint;
+  }
+};
+
+// What RFIDAccess.anchor() records for one window
+struct AnchorWindow {
+  uint32_t firstSeq;
+  uint32_t lastSeq;
+  uint8_t  root[SHA256_BYTES];
+  uint8_t  head[SHA256_BYTES];      // Leaf of lastSeq; the next window chains from it
+};
+
+inline void putBigEndian32(uint8_t out[4], uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+inline void hashLeaf(const uint8_t prev[SHA256_BYTES], uint32_t seq, uint32_t timestamp,
+                     const uint8_t record[RECORD_BYTES], uint8_t leaf[SHA256_BYTES]) {
+  uint8_t prefix = CHAIN_LEAF_PREFIX;
+  uint8_t numbers[8];
+  putBigEndian32(numbers, seq);
+  putBigEndian32(numbers + 4, timestamp);
+  Sha256 hash;
+  hash.update(&prefix, 1);
+  hash.update(prev, SHA256_BYTES);
+  hash.update(numbers, sizeof(numbers));
+  hash.update(record, RECORD_BYTES);
+  hash.finish(leaf);
+}
+
+inline void hashNode(const uint8_t left[SHA256_BYTES], const uint8_t right[SHA256_BYTES],
+                     uint8_t node[SHA256_BYTES]) {
+  uint8_t prefix = CHAIN_NODE_PREFIX;
+  Sha256 hash;
+  hash.update(&prefix, 1);
+  hash.update(left, SHA256_BYTES);
+  hash.update(right, SHA256_BYTES);
+  hash.finish(node);
+}
+
+class EventChain {
+private:
+  uint32_t deviceId;
+  uint32_t nextSeq;
+  uint8_t head[SHA256_BYTES];
+
+  // Open window
+  uint32_t windowFirst;
+  uint32_t windowCount;
+  uint32_t windowOpenedAt;          // ms, when its first event was chained
+  uint8_t levels[CHAIN_MAX_LEVELS][SHA256_BYTES];  // levels[i] holds a subtree of 2^i leaves when bit i of windowCount is set
+
+public:
+  EventChain() : deviceId(0), windowFirst(1), windowCount(0), windowOpenedAt(0) {
+    restore(ChainCheckpoint::initial(), 0);
+  }
+
+  // Continue from a stored checkpoint with an empty window
+  void restore(const ChainCheckpoint &checkpoint, uint32_t _deviceId) {
+    deviceId = _deviceId;
+    nextSeq = checkpoint.nextSeq;
+    memcpy(head, checkpoint.head, SHA256_BYTES);
+    windowFirst = nextSeq;
+    windowCount = 0;
+  }
+
+  // Chain one event into the open window. Returns its sequence number.
+  uint32_t append(const AccessEvent &event, uint32_t now) {
+    uint8_t record[RECORD_BYTES];
+    packRecord(record, event, deviceId);
+    uint8_t node[SHA256_BYTES];
+    hashLeaf(head, nextSeq, event.timestamp, record, node);
+    memcpy(head, node, SHA256_BYTES);
+
+    // Binary counter: merge equal-sized subtrees while the low bits carry
+    uint8_t level = 0;
+    while (windowCount & (1u << level)) {
+      hashNode(levels[level], node, node);
+      level++;
+    }
+    memcpy(levels[level], node, SHA256_BYTES);
+
+    if (windowCount == 0) windowOpenedAt = now;
+    windowCount++;
+    return nextSeq++;
+  }
+
+  // Root and range of the open window; false if it is empty
+  bool window(AnchorWindow &out) const {
+    if (windowCount == 0) return false;
+    out.firstSeq = windowFirst;
+    out.lastSeq = nextSeq - 1;
+    memcpy(out.head, head, SHA256_BYTES);
+
+    // Fold the pending subtrees, smallest first, carrying unpaired ones up
+    bool have = false;
+    for (uint8_t level = 0; level < CHAIN_MAX_LEVELS; level++) {
+      if (!(windowCount & (1u << level))) continue;
+      if (have) {
+        hashNode(levels[level], out.root, out.root);
+      } else {
+        memcpy(out.root, levels[level], SHA256_BYTES);
+        have = true;
+      }
+    }
+    return true;
+  }
+
+  // The open window has been anchored; start the next one
+  void commit() {
+    windowFirst = nextSeq;
+    windowCount = 0;
+  }
+
+  // Position to resume from; taken after commit(), with the window empty
+  ChainCheckpoint checkpoint() const {
+    ChainCheckpoint checkpoint;
+    checkpoint.nextSeq = nextSeq;
+    checkpoint.pendingEnd = 0;
+    memcpy(checkpoint.head, head, SHA256_BYTES);
+    return checkpoint;
+  }
+
+  uint32_t getNextSeq() const { return nextSeq; }
+  uint32_t getWindowFirst() const { return windowFirst; }
+  uint32_t getWindowSize() const { return windowCount; }
+  uint32_t getWindowOpenedAt() const { return windowOpenedAt; }
+  const uint8_t* getHead() const { return head; }
+};
+
+#endif
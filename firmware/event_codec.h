@@ -0,0 +1,170 @@
+#ifndef EVENT_CODEC_H
+#define EVENT_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "access_event.h"
+
+// ==================== EVENT CODEC ====================
+// Gateway JSON encoding into caller-provided buffers. No heap, no printf:
+// every helper appends to a FixedWriter, which stops writing and latches an
+// overflow flag once the buffer is full instead of truncating silently.
+
+class FixedWriter {
+private:
+  char* buffer;
+  size_t capacity;
+  size_t length;
+  bool overflow;
+
+public:
+  FixedWriter(char* _buffer, size_t _capacity)
+    : buffer(_buffer), capacity(_capacity), length(0), overflow(_capacity == 0) {
+    if (capacity > 0) buffer[0] = '\0';
+  }
+
+  void append(char c) {
+    if (overflow || length + 1 >= capacity) {
+      overflow = true;
+      return;
+    }
+    buffer[length++] = c;
+    buffer[length] = '\0';
+  }
+
+  void append(const char* text) {
+    while (*text) append(*text++);
+  }
+
+  void appendUInt(uint32_t value) {
+    char digits[10];
+    int count = 0;
+    do {
+      digits[count++] = (char)('0' + value % 10);
+      value /= 10;
+    } while (value > 0);
+    while (count > 0) append(digits[--count]);
+  }
+
+  void appendHexByte(uint8_t value) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    append(HEX_DIGITS[value >> 4]);
+    append(HEX_DIGITS[value & 0x0F]);
+  }
+
+  bool ok() const { return !overflow; }
+  size_t size() const { return length; }
+
+  // Length written, or 0 (with an empty string) if anything did not fit
+  size_t finish() {
+    if (overflow) {
+      if (capacity > 0) buffer[0] = '\0';
+      return 0;
+    }
+    return length;
+  }
+};
+
+// ==================== PACKED RECORDS ====================
+// Each event goes on the wire as the 32-byte word RFIDAccess.logPacked()
+// takes, big-endian from the top byte:
+//   [0..9] uid, left-aligned   [10] uidLength   [11..12] fingerprintId
+//   [13] kind                  [14..17] deviceId  [18..31] zero
+// The contract adds the block timestamp.
+
+#define RECORD_BYTES 32
+
+// RFIDAccess.EventKind
+enum RecordKind : uint8_t {
+  RECORD_UNLOCK,
+  RECORD_DENY,
+  RECORD_TAMPER
+};
+
+inline uint8_t recordKind(const AccessEvent &event) {
+  if (event.type == EVENT_TAMPER) return RECORD_TAMPER;
+  return event.success ? RECORD_UNLOCK : RECORD_DENY;
+}
+
+inline void packRecord(uint8_t out[RECORD_BYTES], const AccessEvent &event, uint32_t deviceId) {
+  memset(out, 0, RECORD_BYTES);
+  if (event.type != EVENT_TAMPER) {
+    uint8_t size = event.uidSize > sizeof(event.uid) ? sizeof(event.uid) : event.uidSize;
+    memcpy(out, event.uid, size);
+    out[10] = size;
+    out[11] = (uint8_t)(event.fingerprintId >> 8);
+    out[12] = (uint8_t)event.fingerprintId;
+  }
+  out[13] = recordKind(event);
+  out[14] = (uint8_t)(deviceId >> 24);
+  out[15] = (uint8_t)(deviceId >> 16);
+  out[16] = (uint8_t)(deviceId >> 8);
+  out[17] = (uint8_t)deviceId;
+}
+
+// A 32-byte word (record or hash) as a quoted "0x..." string
+inline void encodeHash(FixedWriter &out, const uint8_t word[32]) {
+  out.append("\"0x");
+  for (uint8_t i = 0; i < 32; i++) out.appendHexByte(word[i]);
+  out.append('"');
+}
+
+// "0x635A5931000000000000040001000000000700..." (66 characters)
+inline void encodeRecordHex(FixedWriter &out, const AccessEvent &event, uint32_t deviceId) {
+  uint8_t record[RECORD_BYTES];
+  packRecord(record, event, deviceId);
+  encodeHash(out, record);
+}
+
+// Body for POST /events: the full events of the anchored chain, numbered
+// from firstSeq
+// {"device":7,"events":[{"seq":12,"t":1000,"record":"0x..."},...]}
+inline size_t encodeEventsJson(char* buffer, size_t capacity, const AccessEvent events[], uint32_t count,
+                               uint32_t deviceId, uint32_t firstSeq) {
+  FixedWriter out(buffer, capacity);
+  out.append("{\"device\":");
+  out.appendUInt(deviceId);
+  out.append(",\"events\":[");
+  for (uint32_t i = 0; i < count; i++) {
+    if (i > 0) out.append(',');
+    out.append("{\"seq\":");
+    out.appendUInt(firstSeq + i);
+    out.append(",\"t\":");
+    out.appendUInt(events[i].timestamp);
+    out.append(",\"record\":");
+    encodeRecordHex(out, events[i], deviceId);
+    out.append('}');
+  }
+  out.append("]}");
+  return out.finish();
+}
+
+// Longest encodeEventsJson() body for count events: every number at its
+// ten-digit maximum. Sizes the payload buffer at compile time.
+inline constexpr size_t eventsJsonMax(uint32_t count) {
+  return (sizeof("{\"device\":,\"events\":[]}") - 1) + 10 +
+         count * ((sizeof("{\"seq\":,\"t\":,\"record\":}") - 1) + 2 * 10 + (4 + 2 * RECORD_BYTES)) +
+         (count > 0 ? count - 1 : 0);
+}
+
+// Body for POST /anchor
+// {"device":7,"firstSeq":1,"lastSeq":64,"root":"0x...","head":"0x..."}
+inline size_t encodeAnchorJson(char* buffer, size_t capacity, uint32_t deviceId, uint32_t firstSeq,
+                               uint32_t lastSeq, const uint8_t root[32], const uint8_t head[32]) {
+  FixedWriter out(buffer, capacity);
+  out.append("{\"device\":");
+  out.appendUInt(deviceId);
+  out.append(",\"firstSeq\":");
+  out.appendUInt(firstSeq);
+  out.append(",\"lastSeq\":");
+  out.appendUInt(lastSeq);
+  out.append(",\"root\":");
+  encodeHash(out, root);
+  out.append(",\"head\":");
+  encodeHash(out, head);
+  out.append('}');
+  return out.finish();
+}
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef EVENT_OUTBOX_H
+#define EVENT_OUTBOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "access_event.h"
+#include "crc32.h"
+#include "flash_region.h"
+
+// ==================== EVENT OUTBOX ====================
+// Append-only ring log of access events on a raw flash partition. Events are
+// written before they are sent and acknowledged in place once the server has
+// accepted them, so anything not yet delivered survives a reboot and is
+// replayed in order.
+//
+// Each 32-byte record carries a state word, a sequence number and a CRC-32.
+// State transitions only clear bits (erased -> written -> acked), so a record
+// is updated without erasing its sector. Records are written round-robin over
+// all sectors, which spreads erase cycles evenly across the partition.
+
+#define OUTBOX_STATE_ERASED   0xFFFFFFFFu
+#define OUTBOX_STATE_WRITTEN  0xFFFF0000u
+#define OUTBOX_STATE_ACKED    0x00000000u
+#define OUTBOX_NO_SECTOR      0xFFFFFFFFu
+
+struct OutboxRecord {
+  uint32_t state;
+  uint32_t seq;
+  AccessEvent event;
+  uint32_t crc;      // CRC-32 of seq and event
+};
+
+static_assert(sizeof(OutboxRecord) == 32, "OutboxRecord must stay 32 bytes");
+
+class EventOutbox {
+private:
+  FlashRegion &flash;
+  uint32_t slotCount;
+  uint32_t slotsPerSector;
+  uint32_t writeSlot;       // Next slot to program
+  uint32_t readSlot;        // Oldest unacknowledged record
+  uint32_t nextSeq;
+  uint32_t pending;         // Unacknowledged records
+  uint32_t erasedSector;    // Sector erased ahead of the write head
+  bool ready;
+
+  // Counters
+  uint32_t appended;
+  uint32_t acked;
+  uint32_t evicted;
+  uint32_t erases;
+
+  static uint32_t recordCrc(const OutboxRecord &record) {
+    return crc32(reinterpret_cast<const uint8_t*>(&record.seq),
+                 sizeof(record.seq) + sizeof(record.event));
+  }
+
+  static bool isErased(const OutboxRecord &record) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (size_t i = 0; i < sizeof(record); i++) {
+      if (bytes[i] != 0xFF) return false;
+    }
+    return true;
+  }
+
+  static bool isValid(const OutboxRecord &record) {
+    return (record.state == OUTBOX_STATE_WRITTEN || record.state == OUTBOX_STATE_ACKED) &&
+           record.crc == recordCrc(record);
+  }
+
+  bool readSlotRecord(uint32_t slot, OutboxRecord &record) {
+    return flash.read((size_t)slot * sizeof(OutboxRecord), &record, sizeof(record));
+  }
+
+  uint32_t sectorOf(uint32_t slot) const { return slot / slotsPerSector; }
+  uint32_t nextSlot(uint32_t slot) const { return (slot + 1) % slotCount; }
+
+  // Move the read cursor onto the next unacknowledged record
+  void skipToPending() {
+    OutboxRecord record;
+    while (readSlot != writeSlot) {
+      if (readSlotRecord(readSlot, record) && isValid(record) &&
+          record.state == OUTBOX_STATE_WRITTEN) {
+        return;
+      }
+      readSlot = nextSlot(readSlot);
+    }
+  }
+
+  // Count unacknowledged records in a sector
+  uint32_t pendingInSector(uint32_t sector) {
+    OutboxRecord record;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < slotsPerSector; i++) {
+      if (readSlotRecord(sector * slotsPerSector + i, record) && isValid(record) &&
+          record.state == OUTBOX_STATE_WRITTEN) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  // Erase a sector, dropping the oldest undelivered events if it still holds any
+  bool eraseForWrite(uint32_t sector) {
+    if (pending > 0 && sectorOf(readSlot) == sector) {
+      uint32_t lost = pendingInSector(sector);
+      evicted += lost;
+      pending -= lost;
+      readSlot = ((sector + 1) % (slotCount / slotsPerSector)) * slotsPerSector;
+      if (pending == 0) {
+        readSlot = writeSlot;
+      } else {
+        skipToPending();
+      }
+    }
+    if (!flash.eraseSector(sector)) return false;
+    erases++;
+    erasedSector = sector;
+    return true;
+  }
+
+public:
+  EventOutbox(FlashRegion &_flash)
+    : flash(_flash), slotCount(0), slotsPerSector(0), writeSlot(0), readSlot(0),
+      nextSeq(1), pending(0), erasedSector(OUTBOX_NO_SECTOR), ready(false),
+      appended(0), acked(0), evicted(0), erases(0) {}
+
+  // Rebuild the cursors from flash. Reads every record once.
+  bool begin() {
+    slotsPerSector = flash.sectorSize() / sizeof(OutboxRecord);
+    uint32_t sectorCount = flash.size() / flash.sectorSize();
+    if (slotsPerSector == 0 || sectorCount < 2) return false;
+    slotCount = slotsPerSector * sectorCount;
+
+    OutboxRecord record;
+    bool found = false;
+    uint32_t newestSlot = 0, newestSeq = 0;
+    uint32_t oldestPendingSlot = 0, oldestPendingSeq = 0;
+    pending = 0;
+
+    for (uint32_t slot = 0; slot < slotCount; slot++) {
+      if (!readSlotRecord(slot, record)) return false;
+      if (!isValid(record)) continue;
+
+      if (!found || (int32_t)(record.seq - newestSeq) > 0) {
+        newestSeq = record.seq;
+        newestSlot = slot;
+        found = true;
+      }
+      if (record.state == OUTBOX_STATE_WRITTEN) {
+        if (pending == 0 || (int32_t)(record.seq - oldestPendingSeq) < 0) {
+          oldestPendingSeq = record.seq;
+          oldestPendingSlot = slot;
+        }
+        pending++;
+      }
+    }
+
+    writeSlot = found ? nextSlot(newestSlot) : 0;
+    nextSeq = found ? newestSeq + 1 : 1;
+
+    // Step over slots left dirty by an interrupted write
+    while (writeSlot % slotsPerSector != 0) {
+      readSlotRecord(writeSlot, record);
+      if (isErased(record)) break;
+      writeSlot = nextSlot(writeSlot);
+    }
+
+    // A sector the head is about to enter only counts as ready if fully erased
+    erasedSector = OUTBOX_NO_SECTOR;
+    if (writeSlot % slotsPerSector == 0) {
+      bool clean = true;
+      for (uint32_t i = 0; i < slotsPerSector && clean; i++) {
+        readSlotRecord(writeSlot + i, record);
+        clean = isErased(record);
+      }
+      if (clean) erasedSector = sectorOf(writeSlot);
+    }
+
+    readSlot = pending > 0 ? oldestPendingSlot : writeSlot;
+    ready = true;
+    return true;
+  }
+
+  // Persist an event. Programs one record; erases a sector only when the
+  // write head crosses into one that maintain() has not prepared yet.
+  bool append(const AccessEvent &event) {
+    if (!ready) return false;
+
+    uint32_t sector = sectorOf(writeSlot);
+    if (writeSlot % slotsPerSector == 0 && erasedSector != sector) {
+      if (!eraseForWrite(sector)) return false;
+    }
+    if (writeSlot % slotsPerSector == 0) {
+      erasedSector = OUTBOX_NO_SECTOR;  // Sector is in use from here on
+    }
+
+    OutboxRecord record;
+    memset(&record, 0xFF, sizeof(record));
+    record.seq = nextSeq;
+    record.event = event;
+    record.crc = recordCrc(record);
+
+    // Body first, then the state word that commits it
+    size_t offset = (size_t)writeSlot * sizeof(OutboxRecord);
+    if (!flash.write(offset + sizeof(record.state), &record.seq,
+                     sizeof(record) - sizeof(record.state))) {
+      return false;
+    }
+    uint32_t state = OUTBOX_STATE_WRITTEN;
+    if (!flash.write(offset, &state, sizeof(state))) return false;
+
+    if (pending == 0) readSlot = writeSlot;
+    writeSlot = nextSlot(writeSlot);
+    nextSeq++;
+    pending++;
+    appended++;
+    return true;
+  }
+
+  // Oldest event not yet acknowledged by the server
+  bool peek(AccessEvent &event) {
+    if (!ready || pending == 0) return false;
+    OutboxRecord record;
+    if (!readSlotRecord(readSlot, record) || !isValid(record)) return false;
+    event = record.event;
+    return true;
+  }
+
+  // Up to max oldest unacknowledged events, in order, after skipping the
+  // first skip of them. Returns the count.
+  uint32_t peekBatch(AccessEvent events[], uint32_t max, uint32_t skip = 0) {
+    if (!ready) return 0;
+    if (skip >= pending) return 0;
+    uint32_t available = pending - skip;
+    OutboxRecord record;
+    uint32_t count = 0;
+    for (uint32_t slot = readSlot; count < max && count < available && slot != writeSlot;
+         slot = nextSlot(slot)) {
+      if (readSlotRecord(slot, record) && isValid(record) &&
+          record.state == OUTBOX_STATE_WRITTEN) {
+        if (skip > 0) {
+          skip--;
+        } else {
+          events[count++] = record.event;
+        }
+      }
+    }
+    return count;
+  }
+
+  // Mark the event returned by peek() as delivered
+  bool ack() {
+    if (!ready || pending == 0) return false;
+    uint32_t state = OUTBOX_STATE_ACKED;
+    if (!flash.write((size_t)readSlot * sizeof(OutboxRecord), &state, sizeof(state))) {
+      return false;
+    }
+    pending--;
+    acked++;
+    readSlot = nextSlot(readSlot);
+    if (pending == 0) {
+      readSlot = writeSlot;
+    } else {
+      skipToPending();
+    }
+    return true;
+  }
+
+  // Mark the first count events returned by peekBatch() as delivered
+  bool ack(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+      if (!ack()) return false;
+    }
+    return true;
+  }
+
+  // Background housekeeping: erase the next sector ahead of the write head
+  // once everything in it has been delivered, so append() stays a single
+  // record program.
+  void maintain() {
+    if (!ready) return;
+    uint32_t sectorCount = slotCount / slotsPerSector;
+    uint32_t next = writeSlot % slotsPerSector == 0 ? sectorOf(writeSlot)
+                                                   : (sectorOf(writeSlot) + 1) % sectorCount;
+    if (erasedSector == next) return;
+    if (pending > 0 && pendingInSector(next) > 0) return;  // Not delivered yet
+    eraseForWrite(next);
+  }
+
+  bool isReady() const { return ready; }
+  uint32_t getPending() const { return pending; }
+  uint32_t getCapacity() const { return slotCount - slotsPerSector; }
+  uint32_t getAppended() const { return appended; }
+  uint32_t getAcked() const { return acked; }
+  uint32_t getEvicted() const { return evicted; }
+  uint32_t getErases() const { return erases; }
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ==================== EVENT RING ====================
+// Fixed-capacity single-producer / single-consumer ring buffer. push() and
+// pop() are wait-free and O(1); the producer (security task) never blocks on
+// the consumer (network task). When full, new items are dropped and counted.
+template <typename T, size_t CAPACITY>
+class EventRing {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "EventRing capacity must be a power of two");
+
+private:
+  T slots[CAPACITY];
+  std::atomic<uint32_t> head;      // Next slot to write (producer)
+  std::atomic<uint32_t> tail;      // Next slot to read (consumer)
+  std::atomic<uint32_t> dropped;   // Events rejected because the ring was full
+  std::atomic<uint32_t> highWater; // Deepest fill level seen
+
+public:
+  EventRing() : head(0), tail(0), dropped(0), highWater(0) {}
+
+  // Producer side
+  bool push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t depth = h - tail.load(std::memory_order_acquire);
+    if (depth >= CAPACITY) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots[h & (CAPACITY - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+
+    if (depth + 1 > highWater.load(std::memory_order_relaxed)) {
+      highWater.store(depth + 1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T &item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = slots[t & (CAPACITY - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return CAPACITY; }
+  uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+  uint32_t getHighWater() const { return highWater.load(std::memory_order_relaxed); }
+};
+
+#endif
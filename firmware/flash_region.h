@@ -0,0 +1,131 @@
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ==================== FLASH REGION ====================
+// Raw NOR flash area with erase-before-write semantics: erase sets a whole
+// sector to 0xFF, write can only clear bits.
+class FlashRegion {
+public:
+  virtual ~FlashRegion() {}
+  virtual size_t size() const = 0;
+  virtual size_t sectorSize() const = 0;
+  virtual bool read(size_t offset, void* data, size_t length) = 0;
+  virtual bool write(size_t offset, const void* data, size_t length) = 0;
+  virtual bool eraseSector(size_t sector) = 0;
+};
+
+#ifdef ARDUINO
+#include <esp_partition.h>
+
+// Data partition from the partition table (see partitions.csv)
+class PartitionFlash : public FlashRegion {
+private:
+  const esp_partition_t* partition;
+
+public:
+  PartitionFlash() : partition(nullptr) {}
+
+  bool begin(const char* label) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    return partition != nullptr;
+  }
+
+  size_t size() const override { return partition ? partition->size : 0; }
+  size_t sectorSize() const override { return SPI_FLASH_SEC_SIZE; }
+
+  bool read(size_t offset, void* data, size_t length) override {
+    return esp_partition_read(partition, offset, data, length) == ESP_OK;
+  }
+
+  bool write(size_t offset, const void* data, size_t length) override {
+    return esp_partition_write(partition, offset, data, length) == ESP_OK;
+  }
+
+  bool eraseSector(size_t sector) override {
+    return esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+  }
+};
+
+#else
+#include <stdio.h>
+
+// File-backed stand-in for host builds. Emulates NOR behaviour (writes AND
+// into the existing contents) and counts operations for wear reports.
+class FileFlash : public FlashRegion {
+private:
+  FILE* file;
+  size_t totalSize;
+  size_t sector;
+
+public:
+  uint32_t writes;
+  uint32_t erases;
+
+  FileFlash(size_t _size, size_t _sectorSize = 4096)
+    : file(nullptr), totalSize(_size), sector(_sectorSize), writes(0), erases(0) {}
+
+  ~FileFlash() {
+    if (file != nullptr) fclose(file);
+  }
+
+  // Open an existing image, or create a fully erased one
+  bool open(const char* path) {
+    file = fopen(path, "r+b");
+    if (file == nullptr) {
+      file = fopen(path, "w+b");
+      if (file == nullptr) return false;
+      uint8_t blank[256];
+      memset(blank, 0xFF, sizeof(blank));
+      for (size_t done = 0; done < totalSize; done += sizeof(blank)) {
+        fwrite(blank, 1, sizeof(blank), file);
+      }
+      fflush(file);
+    }
+    return true;
+  }
+
+  size_t size() const override { return totalSize; }
+  size_t sectorSize() const override { return sector; }
+
+  bool read(size_t offset, void* data, size_t length) override {
+    if (offset + length > totalSize) return false;
+    fseek(file, (long)offset, SEEK_SET);
+    return fread(data, 1, length, file) == length;
+  }
+
+  bool write(size_t offset, const void* data, size_t length) override {
+    if (offset + length > totalSize) return false;
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    uint8_t current[64];
+    for (size_t done = 0; done < length; done += sizeof(current)) {
+      size_t chunk = length - done < sizeof(current) ? length - done : sizeof(current);
+      read(offset + done, current, chunk);
+      for (size_t i = 0; i < chunk; i++) current[i] &= in[done + i];
+      fseek(file, (long)(offset + done), SEEK_SET);
+      fwrite(current, 1, chunk, file);
+    }
+    fflush(file);
+    writes++;
+    return true;
+  }
+
+  bool eraseSector(size_t index) override {
+    if ((index + 1) * sector > totalSize) return false;
+    uint8_t blank[256];
+    memset(blank, 0xFF, sizeof(blank));
+    fseek(file, (long)(index * sector), SEEK_SET);
+    for (size_t done = 0; done < sector; done += sizeof(blank)) {
+      fwrite(blank, 1, sizeof(blank), file);
+    }
+    fflush(file);
+    erases++;
+    return true;
+  }
+};
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef FP_SEARCH_H
+#define FP_SEARCH_H
+
+#include <stdint.h>
+#include "auth_fsm.h"
+
+// ==================== FINGERPRINT RANGE SEARCH ====================
+// R307 / ZFM "Search" instruction restricted to a page range. The library's
+// fingerFastSearch() always scans the whole template library; this lets a
+// card's bound pages be checked on their own, so the decision time does not
+// grow with the number of enrolled fingers.
+//
+//   command: 0x04, buffer, start page (BE16), page count (BE16)
+//   reply:   confirm, page ID (BE16), match score (BE16)
+
+#define FP_CMD_SEARCH            0x04
+#define FP_SEARCH_COMMAND_LENGTH 6
+#define FP_SEARCH_REPLY_LENGTH   5
+#define FP_CONFIRM_OK            0x00
+#define FP_CONFIRM_NOT_FOUND     0x09
+
+inline void encodeSearchCommand(uint8_t data[FP_SEARCH_COMMAND_LENGTH], uint8_t buffer,
+                                uint16_t startPage, uint16_t pageCount) {
+  data[0] = FP_CMD_SEARCH;
+  data[1] = buffer;
+  data[2] = (uint8_t)(startPage >> 8);
+  data[3] = (uint8_t)startPage;
+  data[4] = (uint8_t)(pageCount >> 8);
+  data[5] = (uint8_t)pageCount;
+}
+
+// length is the payload length (packet length without the checksum)
+inline FpResult decodeSearchReply(const uint8_t* data, uint16_t length, uint16_t &pageId, uint16_t &score) {
+  if (length < 1) return FP_ERROR;
+  if (data[0] == FP_CONFIRM_NOT_FOUND) return FP_NO_MATCH;
+  if (data[0] != FP_CONFIRM_OK || length < FP_SEARCH_REPLY_LENGTH) return FP_ERROR;
+  pageId = (uint16_t)(data[1] << 8 | data[2]);
+  score = (uint16_t)(data[3] << 8 | data[4]);
+  return FP_OK;
+}
+
+#endif
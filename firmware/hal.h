@@ -0,0 +1,207 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "auth_fsm.h"
+
+// ==================== HARDWARE ABSTRACTION ====================
+// Thin driver interfaces between the security logic and the board. The
+// ESP32 implementations live in hal_esp32.h and are only built for the
+// device; hal_sim.h provides simulated ones so SecuritySystem,
+// StorageManager and NetworkManager compile and run on a host.
+//
+// Each interface is the subset of the underlying Arduino API the firmware
+// actually uses, with the same names and meanings where one exists.
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdarg.h>
+#include <stdio.h>
+
+// Pin levels, modes and interrupt edges with the ESP32 Arduino values
+#define LOW           0x0
+#define HIGH          0x1
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+#define RISING        0x01
+#define FALLING       0x02
+
+// Console stand-in for host builds: prints to stdout unless silenced
+class HostSerial {
+public:
+  bool quiet;
+
+  HostSerial() : quiet(false) {}
+
+  void print(const char* text) { if (!quiet) fputs(text, stdout); }
+  void print(char c) { if (!quiet) fputc(c, stdout); }
+  void print(int value) { if (!quiet) ::printf("%d", value); }
+  void print(unsigned value) { if (!quiet) ::printf("%u", value); }
+  void print(long value) { if (!quiet) ::printf("%ld", value); }
+  void print(unsigned long value) { if (!quiet) ::printf("%lu", value); }
+  void print(double value) { if (!quiet) ::printf("%.2f", value); }
+  void println() { print("\n"); }
+  template <typename T> void println(T value) { print(value); println(); }
+
+  void printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    if (quiet) return;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+  }
+};
+
+static HostSerial Serial;
+#endif
+
+// Time source. millis() and micros() wrap like their Arduino counterparts.
+class Clock {
+public:
+  virtual ~Clock() {}
+  virtual uint32_t millis() = 0;
+  virtual uint32_t micros() = 0;
+  virtual void delay(uint32_t ms) = 0;
+};
+
+typedef void (*GpioHandler)(void* arg);
+typedef void (*LinkHandler)(void* arg, bool up);
+
+// Digital pins and pin-change interrupts (pinMode / digitalWrite / attachInterruptArg)
+class Gpio {
+public:
+  virtual ~Gpio() {}
+  virtual void mode(uint8_t pin, uint8_t mode) = 0;
+  virtual void write(uint8_t pin, uint8_t level) = 0;
+  virtual int read(uint8_t pin) = 0;
+  virtual void attachInterrupt(uint8_t pin, GpioHandler handler, void* arg, int edge) = 0;
+};
+
+// Persistent key/value settings (Preferences / NVS on the device). Getters
+// return the number of bytes read, 0 if the key is missing; for strings the
+// count includes the terminator.
+class KeyValueStore {
+public:
+  virtual ~KeyValueStore() {}
+  virtual bool isKey(const char* key) = 0;
+  virtual size_t getBytesLength(const char* key) = 0;
+  virtual size_t getBytes(const char* key, void* data, size_t length) = 0;
+  virtual size_t putBytes(const char* key, const void* data, size_t length) = 0;
+  virtual size_t getString(const char* key, char* value, size_t capacity) = 0;
+  virtual size_t putString(const char* key, const char* value) = 0;
+  virtual uint32_t getUInt(const char* key, uint32_t defaultValue) = 0;
+  virtual size_t putUInt(const char* key, uint32_t value) = 0;
+  virtual bool remove(const char* key) = 0;
+};
+
+// ISO 14443-A card reader
+class CardReader {
+public:
+  virtual ~CardReader() {}
+  virtual bool begin() = 0;
+
+  // True once per card that entered the field; must not block
+  virtual bool cardPresent() = 0;
+
+  // Time from the card's answer to the cardPresent() that reported it
+  virtual uint32_t getDetectLatency() { return 0; }
+
+  // Select the card and copy its UID (up to 10 bytes)
+  virtual bool readCard(uint8_t uid[], uint8_t &size) = 0;
+
+  // REQAs no card answered so far. Unchanged between two reads of a card
+  // means it never left the field: switching the field off between
+  // windows wakes a halted card, so one left on the reader answers again.
+  virtual uint32_t getUnanswered() = 0;
+
+  // Look for cards every intervalMs; with fieldSwitched the antenna is only
+  // on for each detection window and after a card answered
+  virtual void setDutyCycle(uint32_t intervalMs, bool fieldSwitched) { (void)intervalMs; (void)fieldSwitched; }
+
+  // Reader bank: REQA comes from the bank's scheduler instead of the
+  // reader's own timer. Call before begin().
+  virtual void setScheduled() {}
+
+  // Send one REQA now; false if the bus was busy and it should go out later
+  virtual bool detect() { return true; }
+
+  // The bank's shared IRQ line fell during this reader's slot
+  virtual void onAnswer(uint32_t nowUs) { (void)nowUs; }
+
+  virtual void printStats() {}
+};
+
+// Optical fingerprint sensor with an on-board template library (R307)
+class FingerprintSensor {
+public:
+  virtual ~FingerprintSensor() {}
+
+  // Connect, starting at the link rate that worked last time
+  virtual bool begin(uint32_t storedBaud) = 0;
+  virtual uint32_t getBaud() const = 0;
+
+  // True once per touch edge, with the time of the edge (micros)
+  virtual bool takeTouch(uint32_t &touchedAtUs) { (void)touchedAtUs; return false; }
+
+  virtual FpResult captureImage() = 0;
+  virtual FpResult convertImage(uint8_t slot) = 0;
+
+  // Match the converted image against pageCount pages from startPage, or
+  // against the whole library when pageCount is 0
+  virtual FpResult search(uint16_t startPage, uint16_t pageCount, uint16_t &pageId, uint16_t &score) = 0;
+
+  // Enrollment: merge slots 1 and 2 into a model and store it at pageId
+  virtual FpResult createModel() = 0;
+  virtual FpResult storeModel(uint16_t pageId) = 0;
+};
+
+// Station network link plus one TCP stream, the subset of WiFi and
+// WiFiClient the gateway client needs
+class NetTransport {
+public:
+  virtual ~NetTransport() {}
+
+  // Link. beginLink() starts association and returns; the outcome arrives
+  // through the handler given to onLinkChange() (up once an address is
+  // assigned, down when an attempt fails or the link is lost).
+  virtual void beginLink(const char* ssid, const char* password) = 0;
+  virtual void onLinkChange(LinkHandler handler, void* arg) = 0;
+  virtual bool linkUp() = 0;
+  virtual void endLink() {}                       // Disassociate and switch the radio off
+  virtual void setPowerSave(bool enabled) { (void)enabled; }  // Modem sleep between beacons
+  virtual uint32_t localAddress() { return 0; }  // IPv4, first octet in the low byte
+  virtual int32_t signalStrength() { return 0; }  // RSSI in dBm, 0 if unknown
+
+  // Stream
+  virtual int connect(const char* host, uint16_t port, int32_t timeoutMs) = 0;
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+  virtual size_t write(const uint8_t* data, size_t length) = 0;
+  virtual int available() = 0;
+  virtual int read(uint8_t* data, size_t length) = 0;
+};
+
+// Client handle for KeepAliveHttp, which owns its client by value
+class TransportClient {
+private:
+  NetTransport* net;
+
+public:
+  TransportClient() : net(nullptr) {}
+
+  void attach(NetTransport* _net) { net = _net; }
+
+  int connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    return net != nullptr ? net->connect(host, port, timeoutMs) : 0;
+  }
+  uint8_t connected() { return net != nullptr ? net->connected() : 0; }
+  void stop() { if (net != nullptr) net->stop(); }
+  size_t write(const uint8_t* data, size_t length) { return net->write(data, length); }
+  int available() { return net != nullptr ? net->available() : 0; }
+  int read(uint8_t* data, size_t length) { return net->read(data, length); }
+};
+
+#endif
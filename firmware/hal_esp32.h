@@ -0,0 +1,583 @@
+#ifndef HAL_ESP32_H
+#define HAL_ESP32_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <MFRC522.h>
+#include <Adafruit_Fingerprint.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include "config.h"
+#include "hal.h"
+#include "card_detector.h"
+#include "fp_search.h"
+
+// ==================== ESP32 DRIVERS ====================
+// Implementations of the hal.h interfaces on the cashband board: MFRC522
+// on VSPI with its IRQ line, R307 on UART2 with its touch output, NVS
+// through Preferences and the Wi-Fi station.
+
+// Woken by the reader and sensor interrupts so the security task can sleep
+// (defined in main.cpp)
+extern TaskHandle_t securityTaskHandle;
+
+static void IRAM_ATTR wakeSecurityTaskFromISR() {
+  if (securityTaskHandle != nullptr) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(securityTaskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+class EspClock : public Clock {
+public:
+  uint32_t millis() override { return ::millis(); }
+  uint32_t micros() override { return ::micros(); }
+  void delay(uint32_t ms) override { ::delay(ms); }
+};
+
+// Pin interrupts belong to the security task: each one also wakes it
+class EspGpio : public Gpio {
+private:
+  struct PinHandler {
+    GpioHandler handler;
+    void* arg;
+  };
+  PinHandler handlers[GPIO_NUM_MAX];
+
+  static void IRAM_ATTR onEdge(void* param) {
+    PinHandler* pin = static_cast<PinHandler*>(param);
+    pin->handler(pin->arg);
+    wakeSecurityTaskFromISR();
+  }
+
+public:
+  EspGpio() {
+    memset(handlers, 0, sizeof(handlers));
+  }
+
+  void mode(uint8_t pin, uint8_t mode) override { pinMode(pin, mode); }
+  void write(uint8_t pin, uint8_t level) override { digitalWrite(pin, level); }
+  int read(uint8_t pin) override { return digitalRead(pin); }
+
+  void attachInterrupt(uint8_t pin, GpioHandler handler, void* arg, int edge) override {
+    if (pin >= GPIO_NUM_MAX) return;
+    handlers[pin].handler = handler;
+    handlers[pin].arg = arg;
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdge, &handlers[pin], edge);
+  }
+};
+
+// Automatic light sleep: whenever every task is blocked the idle task
+// stops the CPU, and timers, the RFID IRQ, the tilt pin or console input
+// wake it. GPIO outputs, and so the relay, keep their level meanwhile.
+// False if the framework was built without power management.
+inline bool enableLightSleep() {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = 240;
+  pm.min_freq_mhz = 80;
+  pm.light_sleep_enable = true;
+  if (esp_pm_configure(&pm) != ESP_OK) return false;
+
+  // Level wake-ups: the IRQ is active low, tilt pulses are high
+  gpio_wakeup_enable((gpio_num_t)RFID_IRQ_PIN, GPIO_INTR_LOW_LEVEL);
+  gpio_wakeup_enable((gpio_num_t)TILT_PIN, GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  uart_set_wakeup_threshold(UART_NUM_0, 3);
+  esp_sleep_enable_uart_wakeup(0);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// One Preferences namespace
+class PreferencesStore : public KeyValueStore {
+private:
+  Preferences preferences;
+
+public:
+  bool begin(const char* name) { return preferences.begin(name, false); }
+  void end() { preferences.end(); }
+
+  bool isKey(const char* key) override { return preferences.isKey(key); }
+  size_t getBytesLength(const char* key) override { return preferences.getBytesLength(key); }
+  size_t getBytes(const char* key, void* data, size_t length) override { return preferences.getBytes(key, data, length); }
+  size_t putBytes(const char* key, const void* data, size_t length) override { return preferences.putBytes(key, data, length); }
+  size_t getString(const char* key, char* value, size_t capacity) override { return preferences.getString(key, value, capacity); }
+  size_t putString(const char* key, const char* value) override { return preferences.putString(key, value); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue) override { return preferences.getUInt(key, defaultValue); }
+  size_t putUInt(const char* key, uint32_t value) override { return preferences.putUInt(key, value); }
+  bool remove(const char* key) override { return preferences.remove(key); }
+};
+
+// MFRC522 with interrupt-driven card detection: a periodic timer sends REQA
+// and the reader raises its IRQ line when a card answers. When the field is
+// switched, each tick opens a detection window instead: antenna on, REQA
+// once the field has settled, antenna off unless a card answered. On a
+// ReaderBank the bank's slots send REQA and its shared line takes the IRQ.
+class Mfrc522Reader : public CardReader {
+private:
+  MFRC522 rfid;
+  CardDetector detector;
+
+  // The SPI bus, shared by the timers, card reads and any other reader on it
+  SemaphoreHandle_t rfidMutex;
+  esp_timer_handle_t reqaTimer;
+  uint8_t ssPin;
+  uint8_t rstPin;
+  bool scheduled;           // REQA and the IRQ line belong to a ReaderBank
+
+  // Detection windows
+  esp_timer_handle_t windowTimer;
+  uint32_t reqaInterval;
+  bool fieldSwitched;
+  bool windowSettling;      // Next window timer sends REQA, else it closes the window
+
+  // One mutex for every reader: they share the bus
+  static SemaphoreHandle_t busMutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    return mutex;
+  }
+
+  static void IRAM_ATTR onIrq(void* arg) {
+    static_cast<Mfrc522Reader*>(arg)->detector.onIrq(micros());
+    wakeSecurityTaskFromISR();
+  }
+
+  static void reqaTimerEntry(void* param) {
+    Mfrc522Reader* self = static_cast<Mfrc522Reader*>(param);
+    if (self->fieldSwitched) {
+      self->openWindow();
+    } else {
+      self->sendReqa();
+    }
+  }
+
+  static void windowTimerEntry(void* param) {
+    Mfrc522Reader* self = static_cast<Mfrc522Reader*>(param);
+    if (self->windowSettling) {
+      self->windowSettling = false;
+      self->sendReqa();
+      esp_timer_start_once(self->windowTimer, RFID_ANSWER_WINDOW * 1000ULL);
+    } else {
+      self->closeWindow();
+    }
+  }
+
+  // Field on; REQA follows once a card in it has had time to power up
+  void openWindow() {
+    if (!detector.shouldSendReqa(micros())) return;  // Card waiting to be read, field is on
+    if (xSemaphoreTake(rfidMutex, 0) != pdTRUE) {
+      detector.onBusy();
+      return;
+    }
+    rfid.PCD_AntennaOn();
+    xSemaphoreGive(rfidMutex);
+    windowSettling = true;
+    esp_timer_start_once(windowTimer, RFID_FIELD_SETTLE * 1000ULL);
+  }
+
+  // No answer: field off until the next window
+  void closeWindow() {
+    if (detector.isDetected()) return;
+    if (xSemaphoreTake(rfidMutex, 0) != pdTRUE) return;  // Card read in progress, it switches off
+    rfid.PCD_AntennaOff();
+    xSemaphoreGive(rfidMutex);
+  }
+
+  // Timer callback: start a REQA and return; a card answer raises the IRQ.
+  // False if the bus was busy.
+  bool sendReqa() {
+    if (!detector.shouldSendReqa(micros())) return true;  // Card waiting to be read
+    if (xSemaphoreTake(rfidMutex, 0) != pdTRUE) {
+      detector.onBusy();  // Card read in progress
+      return false;
+    }
+
+    uint32_t start = micros();
+    rfid.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Idle);
+    rfid.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);     // Clear IRQs, releases the IRQ line
+    rfid.PCD_WriteRegister(MFRC522::FIFOLevelReg, 0x80);  // Flush FIFO
+    rfid.PCD_WriteRegister(MFRC522::FIFODataReg, MFRC522::PICC_CMD_REQA);
+    rfid.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Transceive);
+    rfid.PCD_WriteRegister(MFRC522::BitFramingReg, 0x87); // StartSend, 7-bit frame
+    detector.onReqaSent(micros() - start);
+
+    xSemaphoreGive(rfidMutex);
+    return true;
+  }
+
+public:
+  // On a reader bank each reader has its own chip select. Only one of them
+  // gets the reset line; the others pass MFRC522::UNUSED_PIN and soft
+  // reset, so bringing one up does not reset those already running.
+  Mfrc522Reader(uint8_t _ssPin = SS_PIN, uint8_t _rstPin = RST_PIN)
+    : rfid(_ssPin, _rstPin), detector(RFID_STALE_DETECTION), rfidMutex(nullptr), reqaTimer(nullptr),
+      ssPin(_ssPin), rstPin(_rstPin), scheduled(false), windowTimer(nullptr), reqaInterval(RFID_REQA_INTERVAL),
+      fieldSwitched(false), windowSettling(false) {}
+
+  // Pins for a reader built in an array; before begin(), which is the
+  // first to drive them
+  void setPins(uint8_t _ssPin, uint8_t _rstPin) {
+    ssPin = _ssPin;
+    rstPin = _rstPin;
+  }
+
+  // One PCD_Init: it resets the chip and waits for the oscillator itself
+  bool begin() override {
+    SPI.begin(18, 19, 23, ssPin);  // No-op for the readers after the first
+    rfid.PCD_Init(ssPin, rstPin);
+
+    // Verify RFID communication
+    bool initialized;
+    byte version = rfid.PCD_ReadRegister(MFRC522::VersionReg);
+    if (version == 0x00 || version == 0xFF) {
+      Serial.println("Warning: MFRC522 communication issue - check wiring");
+      Serial.print("Version register: 0x");
+      Serial.println(version, HEX);
+      initialized = false;
+    } else {
+      Serial.print("MFRC522 version: 0x");
+      Serial.println(version, HEX);
+      initialized = true;
+    }
+
+    // Configure for ISO14443-3A tags
+    rfid.PCD_WriteRegister(rfid.TModeReg, 0x80);
+    rfid.PCD_WriteRegister(rfid.TPrescalerReg, 0xA9);
+    rfid.PCD_WriteRegister(rfid.TReloadRegH, 0x03);
+    rfid.PCD_WriteRegister(rfid.TReloadRegL, 0xE8);
+    rfid.PCD_WriteRegister(rfid.TxASKReg, 0x40);
+    rfid.PCD_WriteRegister(rfid.ModeReg, 0x3D);
+
+    // Set RFID reader for ISO 14443-3A tags, after the init that would reset it
+    rfid.PCD_SetAntennaGain(rfid.RxGain_max);
+
+    // Turn antenna on
+    rfid.PCD_AntennaOn();
+
+    Serial.println("RFID reader initialized for ISO 14443-3A tags");
+
+    // Raise IRQ when a card answers REQA; REQA goes out from a periodic timer
+    rfid.PCD_WriteRegister(MFRC522::ComIEnReg, 0xA0);  // IRqInv (active low) | RxIEn
+    rfidMutex = busMutex();
+    if (scheduled) {
+      // Open drain onto the bank's shared line; the bank sends REQA
+      rfid.PCD_WriteRegister(MFRC522::DivIEnReg, 0x00);
+      return initialized;
+    }
+    rfid.PCD_WriteRegister(MFRC522::DivIEnReg, 0x80);  // IRQPushPull
+    pinMode(RFID_IRQ_PIN, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(RFID_IRQ_PIN), onIrq, this, FALLING);
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = reqaTimerEntry;
+    timerArgs.arg = this;
+    timerArgs.name = "rfid_reqa";
+    if (esp_timer_create(&timerArgs, &reqaTimer) != ESP_OK ||
+        esp_timer_start_periodic(reqaTimer, reqaInterval * 1000ULL) != ESP_OK) {
+      Serial.println("Warning: RFID REQA timer unavailable");
+    }
+    timerArgs.callback = windowTimerEntry;
+    timerArgs.name = "rfid_window";
+    esp_timer_create(&timerArgs, &windowTimer);
+    return initialized;
+  }
+
+  void setDutyCycle(uint32_t intervalMs, bool switched) override {
+    if (scheduled) return;  // The bank's slots set the pace
+    reqaInterval = intervalMs;
+    fieldSwitched = switched && windowTimer != nullptr;
+    if (reqaTimer != nullptr) {
+      esp_timer_stop(reqaTimer);
+      esp_timer_start_periodic(reqaTimer, reqaInterval * 1000ULL);
+    }
+    if (fieldSwitched && rfidMutex != nullptr) {
+      xSemaphoreTake(rfidMutex, portMAX_DELAY);
+      if (!detector.isDetected()) rfid.PCD_AntennaOff();
+      xSemaphoreGive(rfidMutex);
+    }
+  }
+
+  void setScheduled() override {
+    scheduled = true;
+  }
+
+  bool detect() override {
+    return sendReqa();
+  }
+
+  void IRAM_ATTR onAnswer(uint32_t nowUs) override {
+    detector.onIrq(nowUs);
+    wakeSecurityTaskFromISR();
+  }
+
+  // Set by the reader's IRQ; no SPI traffic here, except on a bank, where
+  // the answer is cleared at once so the shared line is free for the next
+  bool cardPresent() override {
+    if (!detector.takeDetection(micros())) return false;
+    if (scheduled) {
+      xSemaphoreTake(rfidMutex, portMAX_DELAY);
+      rfid.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);
+      xSemaphoreGive(rfidMutex);
+    }
+    return true;
+  }
+
+  uint32_t getDetectLatency() override {
+    return detector.getPickupLast();
+  }
+
+  uint32_t getUnanswered() override {
+    return detector.getUnanswered();
+  }
+
+  bool readCard(uint8_t uid[], uint8_t &size) override {
+    xSemaphoreTake(rfidMutex, portMAX_DELAY);
+    // On a shared line the select traffic would look like another reader's answer
+    if (scheduled) rfid.PCD_WriteRegister(MFRC522::ComIEnReg, 0x80);
+    bool read = rfid.PICC_ReadCardSerial();
+    if (read) {
+      // Clean up RFID reader
+      rfid.PICC_HaltA();
+      rfid.PCD_StopCrypto1();
+    }
+    rfid.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);  // Release the IRQ line, a wake source
+    if (scheduled) rfid.PCD_WriteRegister(MFRC522::ComIEnReg, 0xA0);
+    detector.rearm();
+    if (fieldSwitched) rfid.PCD_AntennaOff();  // Until the next window
+    xSemaphoreGive(rfidMutex);
+    if (!read) {
+      return false;
+    }
+
+    // Check if card is ISO 14443-3A compliant
+    MFRC522::PICC_Type piccType = rfid.PICC_GetType(rfid.uid.sak);
+    Serial.print("PICC type: ");
+    Serial.println(rfid.PICC_GetTypeName(piccType));
+
+    size = rfid.uid.size;
+    memcpy(uid, rfid.uid.uidByte, size);
+    return true;
+  }
+
+  void printStats() override {
+    Serial.print("RFID: ");
+    Serial.print(detector.getReqaSent());
+    Serial.print(" REQA, ");
+    Serial.print(detector.getDetections());
+    Serial.print(" detections, ");
+    Serial.print(detector.getIrqs());
+    Serial.print(" IRQs (");
+    Serial.print(detector.getIgnoredIrqs());
+    Serial.print(" ignored), ");
+    Serial.print(detector.getBusySkips());
+    Serial.println(" busy skips");
+    Serial.print("RFID pickup latency: avg ");
+    Serial.print(detector.getPickupAverage());
+    Serial.print(" us, max ");
+    Serial.print(detector.getPickupMax());
+    Serial.print(" us; REQA SPI time ");
+    Serial.print(detector.getReqaTimeTotal() / 1000);
+    Serial.print(" ms over ");
+    Serial.print(millis() / 1000);
+    Serial.println(" s");
+  }
+};
+
+// R307 on UART2. The touch output starts captures without waiting for the
+// next poll.
+class R307Sensor : public FingerprintSensor {
+private:
+  HardwareSerial fpSerial;
+  Adafruit_Fingerprint finger;
+  uint32_t baud;
+
+  volatile bool touchPending;
+  volatile uint32_t touchAt;
+
+  static void IRAM_ATTR onTouch(void* arg) {
+    R307Sensor* self = static_cast<R307Sensor*>(arg);
+    self->touchAt = micros();
+    self->touchPending = true;
+    wakeSecurityTaskFromISR();
+  }
+
+  // Open the UART at rate and check the sensor answers
+  bool connect(uint32_t rate, int attempts) {
+    fpSerial.updateBaudRate(rate);
+    for (int retry = 0; retry < attempts; retry++) {
+      if (finger.verifyPassword()) {
+        baud = rate;
+        return true;
+      }
+      delay(100);  // Wait between retries
+    }
+    return false;
+  }
+
+  static FpResult result(uint8_t p) {
+    if (p == FINGERPRINT_OK) return FP_OK;
+    if (p == FINGERPRINT_NOFINGER) return FP_NO_FINGER;
+    if (p == FINGERPRINT_NOTFOUND) return FP_NO_MATCH;
+    return FP_ERROR;
+  }
+
+public:
+  R307Sensor() : fpSerial(2), finger(&fpSerial), baud(FP_BAUD_DEFAULT),
+                 touchPending(false), touchAt(0) {}
+
+  // Starts at the rate that worked last time, then tries the other one
+  bool begin(uint32_t storedBaud) override {
+    uint32_t otherBaud = storedBaud == FP_BAUD_FAST ? FP_BAUD_DEFAULT : FP_BAUD_FAST;
+    fpSerial.begin(storedBaud, SERIAL_8N1, FINGER_RX, FINGER_TX);
+    finger.begin(storedBaud);
+
+    // Sensor power-up, counted from power-on rather than from here
+    if (millis() < FP_POWER_UP_TIME) delay(FP_POWER_UP_TIME - millis());
+
+    bool initialized = connect(storedBaud, 3) || connect(otherBaud, 3);
+
+    // Move a factory-rate sensor up to the fast rate; the sensor keeps it
+    if (initialized && baud != FP_BAUD_FAST &&
+        finger.setBaudRate(FINGERPRINT_BAUDRATE_115200) == FINGERPRINT_OK) {
+      delay(50);
+      if (!connect(FP_BAUD_FAST, 3)) {
+        initialized = connect(FP_BAUD_DEFAULT, 3);
+      }
+    }
+
+    if (initialized) {
+      pinMode(FP_TOUCH_PIN, INPUT);
+      attachInterruptArg(digitalPinToInterrupt(FP_TOUCH_PIN), onTouch, this, RISING);
+    }
+    return initialized;
+  }
+
+  uint32_t getBaud() const override {
+    return baud;
+  }
+
+  bool takeTouch(uint32_t &touchedAtUs) override {
+    if (!touchPending) return false;
+    touchPending = false;
+    touchedAtUs = touchAt;
+    return true;
+  }
+
+  FpResult captureImage() override {
+    return result(finger.getImage());
+  }
+
+  FpResult convertImage(uint8_t slot) override {
+    return result(finger.image2Tz(slot));
+  }
+
+  FpResult search(uint16_t startPage, uint16_t pageCount, uint16_t &pageId, uint16_t &score) override {
+    if (pageCount == 0) {
+      // 1:N over every enrolled template
+      FpResult p = result(finger.fingerFastSearch());
+      if (p == FP_OK) {
+        pageId = finger.fingerID;
+        score = finger.confidence;
+      }
+      return p;
+    }
+
+    // Search instruction restricted to the given pages
+    uint8_t data[FP_SEARCH_COMMAND_LENGTH];
+    encodeSearchCommand(data, 1, startPage, pageCount);
+    Adafruit_Fingerprint_Packet packet(FINGERPRINT_COMMANDPACKET, sizeof(data), data);
+    finger.writeStructuredPacket(packet);
+    if (finger.getStructuredPacket(&packet) != FINGERPRINT_OK ||
+        packet.type != FINGERPRINT_ACKPACKET || packet.length < 2) {
+      return FP_ERROR;
+    }
+    return decodeSearchReply(packet.data, packet.length - 2, pageId, score);
+  }
+
+  FpResult createModel() override {
+    return result(finger.createModel());
+  }
+
+  FpResult storeModel(uint16_t pageId) override {
+    return result(finger.storeModel(pageId));
+  }
+};
+
+// Wi-Fi station and one plain TCP client. Link events come from the
+// Wi-Fi event task; the driver's own reconnect is off so retries and their
+// backoff are left to the caller.
+class WiFiTransport : public NetTransport {
+private:
+  WiFiClient client;
+  LinkHandler linkHandler;
+  void* linkArg;
+  bool powerSave;
+
+public:
+  WiFiTransport() : linkHandler(nullptr), linkArg(nullptr), powerSave(false) {}
+
+  void beginLink(const char* ssid, const char* password) override {
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+    WiFi.setSleep(powerSave ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE);
+    WiFi.begin(ssid, password);
+  }
+
+  void endLink() override {
+    client.stop();
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+  }
+
+  // Applied by the next beginLink(); light sleep needs it while associated
+  void setPowerSave(bool enabled) override {
+    powerSave = enabled;
+  }
+
+  void onLinkChange(LinkHandler handler, void* arg) override {
+    linkHandler = handler;
+    linkArg = arg;
+    WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+      (void)info;
+      if (linkHandler == nullptr) return;
+      if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        linkHandler(linkArg, true);
+      } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+        linkHandler(linkArg, false);
+      }
+    });
+  }
+
+  bool linkUp() override {
+    return WiFi.status() == WL_CONNECTED;
+  }
+
+  uint32_t localAddress() override {
+    return (uint32_t)WiFi.localIP();
+  }
+
+  int32_t signalStrength() override {
+    return WiFi.RSSI();
+  }
+
+  int connect(const char* host, uint16_t port, int32_t timeoutMs) override {
+    return client.connect(host, port, timeoutMs);
+  }
+
+  uint8_t connected() override { return client.connected(); }
+  void stop() override { client.stop(); }
+  size_t write(const uint8_t* data, size_t length) override { return client.write(data, length); }
+  int available() override { return client.available(); }
+  int read(uint8_t* data, size_t length) override { return client.read(data, length); }
+};
+
+#endif
@@ -0,0 +1,595 @@
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "hal.h"
+#include "flash_region.h"
+
+// ==================== SIMULATED DRIVERS ====================
+// Host implementations of the hal.h interfaces. Time is a manual clock that
+// only moves when the code under test delays or a test advances it, so runs
+// are deterministic. Each device can charge simulated time per operation to
+// model the real part's latency; the defaults are zero.
+//
+// Host builds only, one translation unit per program (this header defines
+// the global millis() used by http_transport.h).
+
+class SimClock : public Clock {
+private:
+  uint64_t nowUs;
+
+public:
+  SimClock() : nowUs(0) {
+    active() = this;
+  }
+
+  ~SimClock() {
+    if (active() == this) active() = nullptr;
+  }
+
+  // Clock behind the global millis()
+  static SimClock*& active() {
+    static SimClock* clock = nullptr;
+    return clock;
+  }
+
+  uint32_t millis() override { return (uint32_t)(nowUs / 1000); }
+  uint32_t micros() override { return (uint32_t)nowUs; }
+  void delay(uint32_t ms) override { nowUs += (uint64_t)ms * 1000; }
+
+  void advanceUs(uint32_t us) { nowUs += us; }
+  void advance(uint32_t ms) { nowUs += (uint64_t)ms * 1000; }
+  uint64_t nowMicros() const { return nowUs; }
+};
+
+unsigned long millis() {
+  return SimClock::active() != nullptr ? SimClock::active()->millis() : 0;
+}
+
+#define SIM_GPIO_PINS 40
+
+class SimGpio : public Gpio {
+private:
+  uint8_t modes[SIM_GPIO_PINS];
+  uint8_t levels[SIM_GPIO_PINS];
+  GpioHandler handlers[SIM_GPIO_PINS];
+  void* args[SIM_GPIO_PINS];
+
+public:
+  uint32_t writes;
+
+  SimGpio() : writes(0) {
+    memset(modes, 0, sizeof(modes));
+    memset(levels, 0, sizeof(levels));
+    memset(handlers, 0, sizeof(handlers));
+    memset(args, 0, sizeof(args));
+  }
+
+  void mode(uint8_t pin, uint8_t pinMode) override {
+    if (pin < SIM_GPIO_PINS) modes[pin] = pinMode;
+  }
+
+  void write(uint8_t pin, uint8_t level) override {
+    if (pin < SIM_GPIO_PINS) levels[pin] = level;
+    writes++;
+  }
+
+  int read(uint8_t pin) override {
+    return pin < SIM_GPIO_PINS ? levels[pin] : LOW;
+  }
+
+  void attachInterrupt(uint8_t pin, GpioHandler handler, void* arg, int edge) override {
+    (void)edge;
+    if (pin >= SIM_GPIO_PINS) return;
+    handlers[pin] = handler;
+    args[pin] = arg;
+  }
+
+  // Fire the pin's interrupt as the hardware would on its edge
+  bool trigger(uint8_t pin) {
+    if (pin >= SIM_GPIO_PINS || handlers[pin] == nullptr) return false;
+    handlers[pin](args[pin]);
+    return true;
+  }
+
+  uint8_t getMode(uint8_t pin) const { return pin < SIM_GPIO_PINS ? modes[pin] : 0; }
+};
+
+// In-memory NVS namespace
+class SimKeyValueStore : public KeyValueStore {
+private:
+  std::map<std::string, std::vector<uint8_t> > entries;
+
+  size_t put(const char* key, const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    entries[key].assign(bytes, bytes + length);
+    writes++;
+    return length;
+  }
+
+public:
+  uint32_t writes;
+  uint32_t reads;
+
+  SimKeyValueStore() : writes(0), reads(0) {}
+
+  bool isKey(const char* key) override {
+    return entries.count(key) > 0;
+  }
+
+  size_t getBytesLength(const char* key) override {
+    std::map<std::string, std::vector<uint8_t> >::const_iterator it = entries.find(key);
+    return it == entries.end() ? 0 : it->second.size();
+  }
+
+  size_t getBytes(const char* key, void* data, size_t length) override {
+    reads++;
+    std::map<std::string, std::vector<uint8_t> >::const_iterator it = entries.find(key);
+    if (it == entries.end() || it->second.size() > length) return 0;
+    memcpy(data, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+  size_t putBytes(const char* key, const void* data, size_t length) override {
+    return put(key, data, length);
+  }
+
+  size_t getString(const char* key, char* value, size_t capacity) override {
+    return getBytes(key, value, capacity);
+  }
+
+  size_t putString(const char* key, const char* value) override {
+    return put(key, value, strlen(value) + 1);
+  }
+
+  uint32_t getUInt(const char* key, uint32_t defaultValue) override {
+    uint32_t value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+  }
+
+  size_t putUInt(const char* key, uint32_t value) override {
+    return put(key, &value, sizeof(value));
+  }
+
+  bool remove(const char* key) override {
+    return entries.erase(key) > 0;
+  }
+};
+
+#define SIM_NO_ANSWER UINT64_MAX  // Scheduled reader with no REQA out yet
+
+// Card reader with one card that a test holds to the antenna. Once a duty
+// cycle is set the card only answers in the next detection window, after
+// the field has settled when the antenna is switched; on a reader bank it
+// answers the first REQA the bank sends after it arrived. A read halts the
+// card, but a switched field wakes it again: a card left on the reader
+// answers every window until it is removed.
+class SimCardReader : public CardReader {
+private:
+  SimClock &clock;
+  uint8_t uid[10];
+  uint8_t uidSize;
+  bool inField;
+  bool reported;
+  uint32_t presentedAt;
+  uint64_t answerAt;
+  uint32_t detectLatency;
+  uint32_t presentLatency;
+  uint32_t unanswered;
+
+  // The next detection window's answer time, or now without a duty cycle
+  uint64_t nextAnswer() const {
+    uint64_t now = clock.nowMicros();
+    if (windowInterval == 0) return now;
+    uint64_t period = (uint64_t)windowInterval * 1000;
+    return (now / period + 1) * period + (fieldSwitched ? RFID_FIELD_SETTLE * 1000 : 0);
+  }
+
+public:
+  bool available;        // Reader answers on SPI
+  uint32_t beginTimeUs;  // Reset and register setup
+  uint32_t readTimeUs;   // Anticollision + select
+  uint32_t windowInterval;  // Detection period (ms), 0 = answers at once
+  bool fieldSwitched;
+  bool scheduled;        // Answers only the REQA sent by detect()
+  bool busBusy;          // detect() finds the bus taken
+  uint32_t reqaSent;
+  uint32_t answers;      // onAnswer() calls routed here
+
+  SimCardReader(SimClock &_clock)
+    : clock(_clock), uidSize(0), inField(false), reported(false), presentedAt(0), answerAt(0), detectLatency(0),
+      presentLatency(0), unanswered(0), available(true), beginTimeUs(0), readTimeUs(0), windowInterval(0), fieldSwitched(false),
+      scheduled(false), busBusy(false), reqaSent(0), answers(0) {}
+
+  bool begin() override {
+    clock.advanceUs(beginTimeUs);
+    return available;
+  }
+
+  void setDutyCycle(uint32_t intervalMs, bool switched) override {
+    windowInterval = intervalMs;
+    fieldSwitched = switched;
+  }
+
+  void setScheduled() override {
+    scheduled = true;
+  }
+
+  bool detect() override {
+    if (busBusy) return false;
+    reqaSent++;
+    if (inField && !reported && answerAt == SIM_NO_ANSWER) answerAt = clock.nowMicros();
+    return true;
+  }
+
+  void onAnswer(uint32_t nowUs) override {
+    (void)nowUs;
+    answers++;
+  }
+
+  void present(const uint8_t cardUid[], uint8_t size) {
+    uidSize = size > sizeof(uid) ? sizeof(uid) : size;
+    memcpy(uid, cardUid, uidSize);
+    inField = true;
+    reported = false;
+    presentedAt = clock.micros();
+    unanswered++;  // It came from outside the field
+    // Until the bank's next REQA to this reader, or the next window
+    answerAt = scheduled ? SIM_NO_ANSWER : nextAnswer();
+  }
+
+  void remove() {
+    inField = false;
+  }
+
+  // When the card in the field raises the IRQ, 0 if none will
+  uint64_t getAnswerAt() const {
+    return inField && !reported && answerAt != SIM_NO_ANSWER ? answerAt : 0;
+  }
+
+  bool cardPresent() override {
+    if (!inField || reported || clock.nowMicros() < answerAt) return false;
+    reported = true;
+    detectLatency = (uint32_t)(clock.nowMicros() - answerAt);
+    presentLatency = clock.micros() - presentedAt;
+    return true;
+  }
+
+  uint32_t getDetectLatency() override { return detectLatency; }
+
+  uint32_t getUnanswered() override { return unanswered; }
+
+  // Card held to the antenna to its detection, windows included
+  uint32_t getPresentLatency() const { return presentLatency; }
+
+  bool readCard(uint8_t out[], uint8_t &size) override {
+    if (!inField) return false;
+    clock.advanceUs(readTimeUs);
+    memcpy(out, uid, uidSize);
+    size = uidSize;
+    if (fieldSwitched && !scheduled) {
+      // Field off until the next window: the card wakes and answers again
+      reported = false;
+      answerAt = nextAnswer();
+    } else {
+      inField = false;  // Halted until presented again
+      unanswered++;
+    }
+    return true;
+  }
+};
+
+#define SIM_FP_PAGES 1000   // R307 library capacity
+#define SIM_NO_FINGER 0
+
+// Fingerprint sensor. Fingers are identified by a nonzero number; the
+// library maps pages to the finger enrolled there.
+class SimFingerprintSensor : public FingerprintSensor {
+private:
+  SimClock &clock;
+  uint16_t library[SIM_FP_PAGES];
+  uint16_t onSensor;          // Finger currently touching, SIM_NO_FINGER if none
+  uint16_t slots[3];          // Image buffer, then character buffers 1 and 2
+  uint32_t baud;
+  bool touchPending;
+  uint32_t touchAt;
+
+public:
+  bool available;
+  uint8_t convertFailures;    // Next conversions that fail (smudged image)
+
+  // Simulated operation times
+  uint32_t beginTimeUs;       // Power-up wait and handshake
+  uint32_t captureTimeUs;
+  uint32_t convertTimeUs;
+  uint32_t searchBaseUs;      // Command and reply packets
+  uint32_t searchPageUs;      // Per template compared
+
+  uint32_t pagesCompared;
+
+  SimFingerprintSensor(SimClock &_clock)
+    : clock(_clock), onSensor(SIM_NO_FINGER), baud(0), touchPending(false), touchAt(0),
+      available(true), convertFailures(0), beginTimeUs(0), captureTimeUs(0), convertTimeUs(0),
+      searchBaseUs(0), searchPageUs(0), pagesCompared(0) {
+    memset(library, 0, sizeof(library));
+    memset(slots, 0, sizeof(slots));
+  }
+
+  void enroll(uint16_t page, uint16_t finger) {
+    if (page < SIM_FP_PAGES) library[page] = finger;
+  }
+
+  // Touch the sensor; raises the touch output
+  void placeFinger(uint16_t finger) {
+    onSensor = finger;
+    touchPending = true;
+    touchAt = clock.micros();
+  }
+
+  void liftFinger() {
+    onSensor = SIM_NO_FINGER;
+  }
+
+  bool begin(uint32_t storedBaud) override {
+    (void)storedBaud;
+    clock.advanceUs(beginTimeUs);
+    baud = 115200;
+    return available;
+  }
+
+  uint32_t getBaud() const override { return baud; }
+
+  bool takeTouch(uint32_t &touchedAtUs) override {
+    if (!touchPending) return false;
+    touchPending = false;
+    touchedAtUs = touchAt;
+    return true;
+  }
+
+  FpResult captureImage() override {
+    clock.advanceUs(captureTimeUs);
+    if (onSensor == SIM_NO_FINGER) return FP_NO_FINGER;
+    slots[0] = onSensor;  // Image buffer
+    return FP_OK;
+  }
+
+  FpResult convertImage(uint8_t slot) override {
+    clock.advanceUs(convertTimeUs);
+    if (slot < 1 || slot > 2) return FP_ERROR;
+    if (convertFailures > 0) {
+      convertFailures--;
+      return FP_ERROR;
+    }
+    slots[slot] = slots[0];
+    return FP_OK;
+  }
+
+  FpResult search(uint16_t startPage, uint16_t pageCount, uint16_t &pageId, uint16_t &score) override {
+    uint32_t end = pageCount == 0 ? SIM_FP_PAGES : (uint32_t)startPage + pageCount;
+    if (pageCount == 0) startPage = 0;
+    if (end > SIM_FP_PAGES) end = SIM_FP_PAGES;
+    clock.advanceUs(searchBaseUs);
+    for (uint32_t page = startPage; page < end; page++) {
+      if (library[page] == SIM_NO_FINGER) continue;
+      clock.advanceUs(searchPageUs);
+      pagesCompared++;
+      if (library[page] == slots[1]) {
+        pageId = (uint16_t)page;
+        score = 150;
+        return FP_OK;
+      }
+    }
+    return FP_NO_MATCH;
+  }
+
+  FpResult createModel() override {
+    return slots[1] != SIM_NO_FINGER && slots[1] == slots[2] ? FP_OK : FP_ERROR;
+  }
+
+  FpResult storeModel(uint16_t pageId) override {
+    if (pageId >= SIM_FP_PAGES) return FP_ERROR;
+    library[pageId] = slots[1];
+    return FP_OK;
+  }
+
+  uint16_t enrolledAt(uint16_t page) const { return page < SIM_FP_PAGES ? library[page] : 0; }
+};
+
+// Network link and gateway. Every POST written is answered with
+// responseStatus, after responseTimeUs of server time when a clock is
+// given; request bodies are kept for inspection. Link events are raised
+// synchronously: up from beginLink() while the access point is in range,
+// down when setNetworkAvailable(false) or endLink() drops the link.
+class SimTransport : public NetTransport {
+private:
+  SimClock* clock;
+  LinkHandler linkHandler;
+  void* linkArg;
+  bool associated;
+  bool open;
+  std::string pending;       // Bytes written, not yet parsed into requests
+  std::string replies;       // Bytes for the client to read
+  size_t replyOffset;
+
+  // Split complete requests out of the written bytes
+  void parseRequests() {
+    for (;;) {
+      size_t headerEnd = pending.find("\r\n\r\n");
+      if (headerEnd == std::string::npos) return;
+      size_t lengthAt = pending.find("Content-Length: ");
+      if (lengthAt == std::string::npos || lengthAt > headerEnd) return;
+      size_t length = strtoul(pending.c_str() + lengthAt + 16, nullptr, 10);
+      size_t total = headerEnd + 4 + length;
+      if (pending.size() < total) return;
+
+      size_t pathStart = pending.find(' ') + 1;
+      paths.push_back(pending.substr(pathStart, pending.find(' ', pathStart) - pathStart));
+      bodies.push_back(pending.substr(headerEnd + 4, length));
+      pending.erase(0, total);
+
+      if (clock != nullptr) clock->advanceUs(responseTimeUs);
+      char reply[96];
+      snprintf(reply, sizeof(reply), "HTTP/1.1 %d OK\r\nContent-Length: 0\r\n\r\n", responseStatus);
+      replies += reply;
+    }
+  }
+
+public:
+  bool networkAvailable;     // Access point in range
+  bool announceFailures;     // A failed association raises a down event (else it just times out)
+  uint32_t linkAttempts;
+  uint32_t linkEnds;
+  bool powerSave;
+  bool serverUp;
+  int responseStatus;
+  uint32_t responseTimeUs;   // Server time per request
+  uint32_t connects;
+  std::vector<std::string> paths;
+  std::vector<std::string> bodies;
+
+  SimTransport()
+    : clock(nullptr), linkHandler(nullptr), linkArg(nullptr), associated(false), open(false), replyOffset(0),
+      networkAvailable(true), announceFailures(true), linkAttempts(0), linkEnds(0), powerSave(false),
+      serverUp(true), responseStatus(200), responseTimeUs(0), connects(0) {}
+
+  SimTransport(SimClock &_clock) : SimTransport() {
+    clock = &_clock;
+  }
+
+  void beginLink(const char* ssid, const char* password) override {
+    (void)ssid;
+    (void)password;
+    linkAttempts++;
+    associated = networkAvailable;
+    if (associated || announceFailures) raise(associated);
+  }
+
+  void onLinkChange(LinkHandler handler, void* arg) override {
+    linkHandler = handler;
+    linkArg = arg;
+  }
+
+  void endLink() override {
+    linkEnds++;
+    if (associated) {
+      associated = false;
+      stop();
+      raise(false);
+    }
+  }
+
+  void setPowerSave(bool enabled) override {
+    powerSave = enabled;
+  }
+
+  void raise(bool up) {
+    if (linkHandler != nullptr) linkHandler(linkArg, up);
+  }
+
+  // Access point in or out of range; going out drops the link at once
+  void setNetworkAvailable(bool available) {
+    networkAvailable = available;
+    if (!available && associated) {
+      associated = false;
+      stop();
+      raise(false);
+    }
+  }
+
+  bool linkUp() override {
+    if (!networkAvailable) associated = false;
+    return associated;
+  }
+
+  uint32_t localAddress() override {
+    return associated ? 0x0A2BA8C0u : 0;  // 192.168.43.10
+  }
+
+  int connect(const char* host, uint16_t port, int32_t timeoutMs) override {
+    (void)host;
+    (void)port;
+    (void)timeoutMs;
+    stop();
+    open = linkUp() && serverUp;
+    if (open) connects++;
+    return open ? 1 : 0;
+  }
+
+  uint8_t connected() override {
+    if (!linkUp() || !serverUp) open = false;
+    return open ? 1 : 0;
+  }
+
+  void stop() override {
+    open = false;
+    pending.clear();
+    replies.clear();
+    replyOffset = 0;
+  }
+
+  size_t write(const uint8_t* data, size_t length) override {
+    if (!connected()) return 0;
+    pending.append(reinterpret_cast<const char*>(data), length);
+    parseRequests();
+    return length;
+  }
+
+  int available() override {
+    return (int)(replies.size() - replyOffset);
+  }
+
+  int read(uint8_t* data, size_t length) override {
+    size_t count = replies.size() - replyOffset;
+    if (count > length) count = length;
+    memcpy(data, replies.data() + replyOffset, count);
+    replyOffset += count;
+    return (int)count;
+  }
+};
+
+// Flash partition in RAM with NOR semantics (writes only clear bits)
+class RamFlash : public FlashRegion {
+private:
+  std::vector<uint8_t> data;
+  size_t sector;
+
+public:
+  uint32_t writes;
+  uint32_t erases;
+
+  RamFlash(size_t size, size_t sectorSize = 4096)
+    : data(size, 0xFF), sector(sectorSize), writes(0), erases(0) {}
+
+  size_t size() const override { return data.size(); }
+  size_t sectorSize() const override { return sector; }
+
+  bool read(size_t offset, void* out, size_t length) override {
+    if (offset + length > data.size()) return false;
+    memcpy(out, &data[offset], length);
+    return true;
+  }
+
+  bool write(size_t offset, const void* in, size_t length) override {
+    if (offset + length > data.size()) return false;
+    const uint8_t* bytes = static_cast<const uint8_t*>(in);
+    for (size_t i = 0; i < length; i++) data[offset + i] &= bytes[i];
+    writes++;
+    return true;
+  }
+
+  bool eraseSector(size_t index) override {
+    if ((index + 1) * sector > data.size()) return false;
+    memset(&data[index * sector], 0xFF, sector);
+    erases++;
+    return true;
+  }
+};
+
+#endif
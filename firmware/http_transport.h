@@ -0,0 +1,335 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "event_codec.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+unsigned long millis();
+#endif
+
+// ==================== KEEP-ALIVE HTTP TRANSPORT ====================
+// Minimal HTTP/1.1 client that keeps one socket open across requests.
+// Connects lazily, bounds connect and read time, and lets the caller write
+// several requests before reading their responses (pipelining).
+//
+// ClientT must provide connect(host, port, timeoutMs), connected(), stop(),
+// write(buf, len), available() and read(buf, len) - WiFiClient on the ESP32,
+// PosixClient on host builds.
+
+#define HTTP_CONNECT_TIMEOUT  3000    // TCP connect timeout
+#define HTTP_READ_TIMEOUT     15000   // Gateway answers after the transaction is mined
+#define HTTP_MAX_PIPELINE     4       // Requests in flight on one connection
+
+template <typename ClientT>
+class KeepAliveHttp {
+private:
+  ClientT client;
+  char host[64];
+  uint16_t port;
+  uint32_t connectTimeout;
+  uint32_t readTimeout;
+  uint8_t inFlight;         // Requests written but not yet answered
+  bool closeAfterResponse;  // Server asked to close the connection
+  bool timedOut;            // Last failure was a read timeout, not a closed socket
+
+  // Statistics
+  uint32_t connects;
+  uint32_t requests;
+
+  // Give other tasks the CPU while waiting for the server
+  static void idle() {
+#ifdef ARDUINO
+    delay(1);
+#endif
+  }
+
+  // Read one CRLF-terminated line; false on timeout or connection loss
+  bool readLine(char* line, size_t capacity, uint32_t deadline) {
+    size_t length = 0;
+    for (;;) {
+      if (client.available() <= 0) {
+        if (!client.connected()) return false;
+        if ((int32_t)(millis() - deadline) >= 0) {
+          timedOut = true;
+          return false;
+        }
+        idle();
+        continue;
+      }
+      uint8_t c;
+      if (client.read(&c, 1) != 1) continue;
+      if (c == '\n') break;
+      if (c != '\r' && length + 1 < capacity) line[length++] = (char)c;
+    }
+    line[length] = '\0';
+    return true;
+  }
+
+  // Consume exactly length body bytes, keeping the first capacity - 1 of
+  // them in out (NUL-terminated) when out is given
+  bool readBody(uint32_t length, char* out, size_t capacity, uint32_t deadline) {
+    uint8_t scratch[64];
+    size_t kept = 0;
+    while (length > 0) {
+      int avail = client.available();
+      if (avail <= 0) {
+        if (!client.connected()) return false;
+        if ((int32_t)(millis() - deadline) >= 0) {
+          timedOut = true;
+          return false;
+        }
+        idle();
+        continue;
+      }
+      size_t chunk = length < sizeof(scratch) ? length : sizeof(scratch);
+      int got = client.read(scratch, chunk);
+      if (got <= 0) continue;
+      for (int i = 0; i < got && out != nullptr && kept + 1 < capacity; i++) {
+        out[kept++] = (char)scratch[i];
+      }
+      length -= got;
+    }
+    if (out != nullptr && capacity > 0) out[kept] = '\0';
+    return true;
+  }
+
+public:
+  KeepAliveHttp()
+    : port(80), connectTimeout(HTTP_CONNECT_TIMEOUT), readTimeout(HTTP_READ_TIMEOUT),
+      inFlight(0), closeAfterResponse(false), timedOut(false), connects(0), requests(0) {
+    host[0] = '\0';
+  }
+
+  // Accepts "http://host[:port]"; any path component is ignored
+  bool begin(const char* baseUrl) {
+    const char* start = strstr(baseUrl, "://");
+    start = start ? start + 3 : baseUrl;
+    size_t length = strcspn(start, ":/");
+    if (length == 0 || length >= sizeof(host)) return false;
+    memcpy(host, start, length);
+    host[length] = '\0';
+    port = start[length] == ':' ? (uint16_t)atoi(start + length + 1) : 80;
+    return true;
+  }
+
+  void setTimeouts(uint32_t connectMs, uint32_t readMs) {
+    connectTimeout = connectMs;
+    readTimeout = readMs;
+  }
+
+  void close() {
+    client.stop();
+    inFlight = 0;
+    closeAfterResponse = false;
+  }
+
+  bool isConnected() {
+    return client.connected();
+  }
+
+  // Write one request. Reuses the open connection or reconnects if idle.
+  bool sendPost(const char* path, const char* body, size_t length) {
+    if (inFlight >= HTTP_MAX_PIPELINE) return false;
+
+    if (!client.connected()) {
+      if (inFlight > 0) {
+        close();  // Lost the connection with answers outstanding
+        return false;
+      }
+      client.stop();
+      if (!client.connect(host, port, (int32_t)connectTimeout)) return false;
+      connects++;
+    }
+
+    char header[192];
+    FixedWriter out(header, sizeof(header));
+    out.append("POST ");
+    out.append(path);
+    out.append(" HTTP/1.1\r\nHost: ");
+    out.append(host);
+    out.append(':');
+    out.appendUInt(port);
+    out.append("\r\nContent-Type: application/json\r\nContent-Length: ");
+    out.appendUInt((uint32_t)length);
+    out.append("\r\nConnection: keep-alive\r\n\r\n");
+    size_t headerLength = out.finish();
+    if (headerLength == 0) return false;
+
+    if (client.write(reinterpret_cast<const uint8_t*>(header), headerLength) != headerLength ||
+        client.write(reinterpret_cast<const uint8_t*>(body), length) != length) {
+      close();
+      return false;
+    }
+    inFlight++;
+    requests++;
+    return true;
+  }
+
+  // Read the oldest outstanding response. Returns the HTTP status code, or -1
+  // on timeout / connection loss (the connection is then closed). The start
+  // of the response body is copied to body when one is given.
+  int readResponse(char* body = nullptr, size_t capacity = 0) {
+    if (body != nullptr && capacity > 0) body[0] = '\0';
+    if (inFlight == 0) return -1;
+    uint32_t deadline = millis() + readTimeout;
+    timedOut = false;
+
+    char line[128];
+    if (!readLine(line, sizeof(line), deadline) || strncmp(line, "HTTP/1.", 7) != 0) {
+      close();
+      return -1;
+    }
+    int status = atoi(line + 9);
+
+    uint32_t contentLength = 0;
+    bool hasLength = false;
+    for (;;) {
+      if (!readLine(line, sizeof(line), deadline)) {
+        close();
+        return -1;
+      }
+      if (line[0] == '\0') break;  // End of headers
+      if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        contentLength = (uint32_t)strtoul(line + 15, nullptr, 10);
+        hasLength = true;
+      } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+        closeAfterResponse = true;
+      }
+    }
+
+    if (!hasLength || !readBody(contentLength, body, capacity, deadline)) {
+      close();  // Body length unknown - connection cannot be reused
+      return hasLength ? -1 : status;
+    }
+
+    inFlight--;
+    if (closeAfterResponse) close();
+    return status;
+  }
+
+  // Single request/response. A reused connection that the server had already
+  // closed (idle timeout) is reopened and the request sent once more.
+  int post(const char* path, const char* body, size_t length, char* response = nullptr, size_t capacity = 0) {
+    bool reused = client.connected();
+    if (!sendPost(path, body, length)) return -1;
+    int status = readResponse(response, capacity);
+    if (status < 0 && reused && !timedOut) {
+      if (!sendPost(path, body, length)) return -1;
+      status = readResponse(response, capacity);
+    }
+    return status;
+  }
+
+  ClientT &getClient() { return client; }
+  uint8_t getInFlight() const { return inFlight; }
+  uint32_t getConnects() const { return connects; }
+  uint32_t getRequests() const { return requests; }
+};
+
+#ifndef ARDUINO
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+
+// POSIX socket client with the subset of the WiFiClient API used above
+class PosixClient {
+private:
+  int fd;
+
+public:
+  PosixClient() : fd(-1) {}
+  ~PosixClient() { stop(); }
+
+  int connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    struct addrinfo hints, *result = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &result) != 0) return 0;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int rc = ::connect(fd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc != 0 && errno == EINPROGRESS) {
+      struct pollfd p = {fd, POLLOUT, 0};
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (poll(&p, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+        rc = 0;
+      }
+    }
+    if (rc != 0) {
+      stop();
+      return 0;
+    }
+    return 1;
+  }
+
+  uint8_t connected() {
+    if (fd < 0) return 0;
+    char c;
+    ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      return available() > 0;
+    }
+    return 1;
+  }
+
+  void stop() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+
+  size_t write(const uint8_t* data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+      ssize_t n = send(fd, data + done, length - done, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return done;
+        struct pollfd p = {fd, POLLOUT, 0};
+        poll(&p, 1, 100);
+        continue;
+      }
+      done += n;
+    }
+    return done;
+  }
+
+  int available() {
+    if (fd < 0) return 0;
+    int count = 0;
+    if (ioctl(fd, FIONREAD, &count) != 0) return 0;
+    if (count == 0) {
+      struct pollfd p = {fd, POLLIN, 0};
+      poll(&p, 1, 1);  // Yield briefly instead of spinning
+      ioctl(fd, FIONREAD, &count);
+    }
+    return count;
+  }
+
+  int read(uint8_t* data, size_t length) {
+    ssize_t n = recv(fd, data, length, MSG_DONTWAIT);
+    return n < 0 ? 0 : (int)n;
+  }
+};
+#endif
+
+#endif
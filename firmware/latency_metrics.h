@@ -0,0 +1,248 @@
+#ifndef LATENCY_METRICS_H
+#define LATENCY_METRICS_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "event_codec.h"
+
+// ==================== LATENCY METRICS ====================
+// Fixed-bucket latency histograms for each stage between a card entering
+// the field and the relay energizing, plus the logging path, loop period
+// and heap gauges. Buckets are powers of two in microseconds, so recording
+// a sample is a count-leading-zeros and a few adds with no locking; every
+// histogram has a single writer (the security task, or the network task
+// for network acks).
+//
+// Probes go through the METRIC_* macros. Release builds (-DCASHBAND_RELEASE,
+// see env:esp32dev_release) compile them away and keep only an empty
+// Metrics object so callers need no #ifdefs.
+//
+// Times are microseconds and may wrap.
+
+#ifndef CASHBAND_RELEASE
+#define METRICS_ENABLED
+#endif
+
+enum MetricStage : uint8_t {
+  METRIC_CARD_DETECT,    // Card IRQ to pickup by the security loop
+  METRIC_CARD_READ,      // Anticollision and select (PICC_ReadCardSerial)
+  METRIC_UID_LOOKUP,     // Card table search
+  METRIC_FP_CAPTURE,     // Image capture
+  METRIC_FP_CONVERT,     // image2Tz
+  METRIC_FP_SEARCH,      // Template search
+  METRIC_FP_DECISION,    // Finger contact to search result
+  METRIC_RELAY,          // Relay actuation
+  METRIC_END_TO_END,     // Card IRQ to relay energized
+  METRIC_NET_ENQUEUE,    // Hand-off to the network task
+  METRIC_NET_ACK,        // Event raised to gateway acknowledgement
+  METRIC_LOOP_PERIOD,    // Spacing of security loop iterations
+  METRIC_STAGE_COUNT
+};
+
+#define METRIC_BUCKETS 28   // [0], [1], [2,3], [4,7] ... [2^26 us, inf)
+
+inline const char* metricStageName(uint8_t stage) {
+  static const char* const NAMES[METRIC_STAGE_COUNT] = {
+    "card_detect", "card_read", "uid_lookup", "fp_capture", "fp_convert", "fp_search",
+    "fp_decision", "relay", "end_to_end", "net_enqueue", "net_ack", "loop_period"
+  };
+  return stage < METRIC_STAGE_COUNT ? NAMES[stage] : "?";
+}
+
+class LatencyHistogram {
+private:
+  uint32_t buckets[METRIC_BUCKETS];
+  uint32_t count;
+  uint64_t total;
+  uint32_t min;
+  uint32_t max;
+
+public:
+  LatencyHistogram() {
+    reset();
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < METRIC_BUCKETS; i++) buckets[i] = 0;
+    count = 0;
+    total = 0;
+    min = 0;
+    max = 0;
+  }
+
+  // Bucket b > 0 holds [2^(b-1), 2^b - 1]; the last one is open-ended
+  static uint8_t bucketFor(uint32_t us) {
+    uint8_t b = us == 0 ? 0 : (uint8_t)(32 - __builtin_clz(us));
+    return b < METRIC_BUCKETS ? b : METRIC_BUCKETS - 1;
+  }
+
+  static uint32_t bucketUpperBound(uint8_t b) {
+    return b == 0 ? 0 : (b >= 32 ? 0xFFFFFFFFu : (1u << b) - 1);
+  }
+
+  void add(uint32_t us) {
+    buckets[bucketFor(us)]++;
+    if (count == 0 || us < min) min = us;
+    if (us > max) max = us;
+    count++;
+    total += us;
+  }
+
+  // Upper bound of the bucket holding the p-th percentile, capped at max
+  uint32_t percentile(uint8_t p) const {
+    if (count == 0) return 0;
+    uint32_t rank = (uint32_t)(((uint64_t)count * p + 99) / 100);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < METRIC_BUCKETS; b++) {
+      seen += buckets[b];
+      if (seen >= rank) {
+        uint32_t bound = bucketUpperBound(b);
+        return (b == METRIC_BUCKETS - 1 || bound > max) ? max : bound;
+      }
+    }
+    return max;
+  }
+
+  uint32_t getCount() const { return count; }
+  uint32_t getMin() const { return min; }
+  uint32_t getMax() const { return max; }
+  uint32_t average() const { return count ? (uint32_t)(total / count) : 0; }
+  uint32_t getBucket(uint8_t b) const { return b < METRIC_BUCKETS ? buckets[b] : 0; }
+};
+
+// {"s":"fp_search","n":4,"avg":..,"p50":..,"p90":..,"p99":..,"max":..,"b":[..]}
+// with trailing empty buckets trimmed
+inline void encodeStageJson(FixedWriter &out, uint8_t stage, const LatencyHistogram &histogram) {
+  out.append("{\"s\":\"");
+  out.append(metricStageName(stage));
+  out.append("\",\"n\":");
+  out.appendUInt(histogram.getCount());
+  out.append(",\"avg\":");
+  out.appendUInt(histogram.average());
+  out.append(",\"p50\":");
+  out.appendUInt(histogram.percentile(50));
+  out.append(",\"p90\":");
+  out.appendUInt(histogram.percentile(90));
+  out.append(",\"p99\":");
+  out.appendUInt(histogram.percentile(99));
+  out.append(",\"max\":");
+  out.appendUInt(histogram.getMax());
+  out.append(",\"b\":[");
+  uint8_t used = METRIC_BUCKETS;
+  while (used > 0 && histogram.getBucket(used - 1) == 0) used--;
+  for (uint8_t b = 0; b < used; b++) {
+    if (b > 0) out.append(',');
+    out.appendUInt(histogram.getBucket(b));
+  }
+  out.append("]}");
+}
+
+#ifdef METRICS_ENABLED
+
+// Start and stop a probe. METRIC_START declares the start time; the other
+// two record into the stage's histogram.
+#define METRIC_START(clock, name)              uint32_t name = (clock).micros()
+#define METRIC_STOP(metrics, stage, clock, name) (metrics).record(stage, (clock).micros() - (name))
+#define METRIC_RECORD(metrics, stage, us)      (metrics).record(stage, us)
+
+class Metrics {
+private:
+  LatencyHistogram stages[METRIC_STAGE_COUNT];
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;
+  uint32_t largestBlock;
+  uint32_t minLargestBlock;
+  uint32_t heapSamples;
+
+public:
+  Metrics() : freeHeap(0), minFreeHeap(0), largestBlock(0), minLargestBlock(0), heapSamples(0) {}
+
+  void record(uint8_t stage, uint32_t us) {
+    if (stage < METRIC_STAGE_COUNT) stages[stage].add(us);
+  }
+
+  // Called periodically with the allocator's view of the heap
+  void sampleHeap(uint32_t free, uint32_t largest) {
+    if (heapSamples == 0 || free < minFreeHeap) minFreeHeap = free;
+    if (heapSamples == 0 || largest < minLargestBlock) minLargestBlock = largest;
+    freeHeap = free;
+    largestBlock = largest;
+    heapSamples++;
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < METRIC_STAGE_COUNT; i++) stages[i].reset();
+    heapSamples = 0;
+  }
+
+  const LatencyHistogram &stage(uint8_t index) const { return stages[index]; }
+  uint32_t getFreeHeap() const { return freeHeap; }
+  uint32_t getMinFreeHeap() const { return minFreeHeap; }
+  uint32_t getLargestBlock() const { return largestBlock; }
+  uint32_t getMinLargestBlock() const { return minLargestBlock; }
+
+  void printTable() const {
+    Serial.println("Stage          count    avg    p50    p90    p99    max (us)");
+    for (uint8_t i = 0; i < METRIC_STAGE_COUNT; i++) {
+      const LatencyHistogram &h = stages[i];
+      Serial.printf("%-12s %7lu %6lu %6lu %6lu %6lu %6lu\n", metricStageName(i),
+                    (unsigned long)h.getCount(), (unsigned long)h.average(),
+                    (unsigned long)h.percentile(50), (unsigned long)h.percentile(90),
+                    (unsigned long)h.percentile(99), (unsigned long)h.getMax());
+    }
+    const LatencyHistogram &loop = stages[METRIC_LOOP_PERIOD];
+    Serial.print("Loop jitter (p99 - p50): ");
+    Serial.print(loop.percentile(99) - loop.percentile(50));
+    Serial.println(" us");
+    Serial.print("Heap: ");
+    Serial.print(freeHeap);
+    Serial.print(" free (min ");
+    Serial.print(minFreeHeap);
+    Serial.print("), largest block ");
+    Serial.print(largestBlock);
+    Serial.print(" (min ");
+    Serial.print(minLargestBlock);
+    Serial.println(")");
+  }
+
+  // One line of JSON for scripts, written a stage at a time
+  void printJson(uint32_t uptimeMs) const {
+    Serial.printf("{\"up\":%lu,\"heap\":{\"free\":%lu,\"min\":%lu,\"block\":%lu,\"minBlock\":%lu},\"stages\":[",
+                  (unsigned long)uptimeMs, (unsigned long)freeHeap, (unsigned long)minFreeHeap,
+                  (unsigned long)largestBlock, (unsigned long)minLargestBlock);
+    char buffer[400];
+    for (uint8_t i = 0; i < METRIC_STAGE_COUNT; i++) {
+      FixedWriter out(buffer, sizeof(buffer));
+      if (i > 0) out.append(',');
+      encodeStageJson(out, i, stages[i]);
+      if (out.finish() > 0) Serial.print(buffer);
+    }
+    Serial.println("]}");
+  }
+};
+
+#else
+
+#define METRIC_START(clock, name)                do {} while (0)
+#define METRIC_STOP(metrics, stage, clock, name) do {} while (0)
+#define METRIC_RECORD(metrics, stage, us)        do {} while (0)
+
+class Metrics {
+public:
+  void record(uint8_t stage, uint32_t us) { (void)stage; (void)us; }
+  void sampleHeap(uint32_t free, uint32_t largest) { (void)free; (void)largest; }
+  void reset() {}
+
+  void printTable() const {
+    Serial.println("Metrics are compiled out of release builds");
+  }
+
+  void printJson(uint32_t uptimeMs) const {
+    Serial.printf("{\"up\":%lu,\"stages\":[]}\n", (unsigned long)uptimeMs);
+  }
+};
+
+#endif
+
+#endif
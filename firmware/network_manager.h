@@ -0,0 +1,639 @@
+#ifndef NETWORK_MANAGER_H
+#define NETWORK_MANAGER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+#include "hal.h"
+#include "access_event.h"
+#include "event_ring.h"
+#include "status_snapshot.h"
+#include "event_outbox.h"
+#include "event_chain.h"
+#include "alloc_audit.h"
+#include "latency_metrics.h"
+#include "boot_timeline.h"
+#include "wifi_link.h"
+#include "power_scheduler.h"
+#include "storage_manager.h"
+#include "blockchain_interface.h"
+
+// Link and delivery state as of the network task's last pass. Published
+// by the network task, read by the console on the security task.
+struct NetworkStatus {
+  uint32_t takenAt;            // clock.millis() at publish
+  uint8_t linkState;
+  bool linkUp;
+  bool radioOn;                // Associated or trying to be
+  uint32_t retryIn;            // Backoff left at publish (ms)
+  uint32_t attempts;
+  uint32_t failures;
+  uint32_t drops;
+  uint32_t reconnects;
+  uint32_t lastReconnect;
+  uint32_t maxReconnect;
+  uint32_t downtime;           // At publish; still growing while down after a drop
+  bool downtimeGrowing;
+  uint32_t radioOnTime;        // At publish; still growing while radioOn
+  uint32_t ip;
+  int32_t rssi;
+  uint32_t eventsLogged;
+  uint32_t eventsFailed;
+  uint32_t outboxPending;
+  uint32_t outboxEvicted;
+  uint32_t outboxErases;
+  uint32_t nextSeq;
+  uint32_t windowSize;
+  uint32_t anchorsSent;
+  uint32_t anchorsFailed;
+  bool gateway;
+  uint32_t httpRequests;
+  uint32_t httpConnects;
+};
+
+// ==================== NETWORK MANAGER CLASS ====================
+static_assert(ANCHOR_WINDOW_EVENTS < (1u << CHAIN_MAX_LEVELS), "Anchor window exceeds the Merkle levels");
+
+class NetworkManager {
+private:
+  NetTransport &net;
+  Clock &clock;
+  Metrics &metrics;
+  BootTimeline &boot;
+  StorageManager &storage;    // Chain checkpoint only
+  NetworkCredentials credentials;
+  WifiLink link;
+  LinkState reportedLinkState;  // Last state logged to the console
+  uint8_t radioPolicy;
+  bool radioIdle;               // On demand: nothing left to deliver...
+  uint32_t radioIdleSince;      // ...since then (ms)
+  BlockchainInterface* blockchain;
+  
+  // Events waiting for the network task
+  EventRing<AccessEvent, LOG_QUEUE_SIZE> logQueue;
+#ifdef ARDUINO
+  TaskHandle_t taskHandle;
+#endif
+  volatile uint32_t eventsLogged;
+  volatile uint32_t eventsFailed;
+  bool batchOpen;
+  uint32_t batchOpenedAt;
+  uint32_t replayedEvents;     // Outbox events left over from the last boot
+  
+  // Flash-backed outbox, owned by the network task
+  EventOutbox outbox;
+  uint32_t evictedSeen;
+  
+  // Hash chain over delivered events. Delivered events stay in the outbox
+  // until the window holding them is anchored, so after a reboot they are
+  // delivered and chained again from the checkpoint, with the same leaves.
+  EventChain chain;
+  ChainCheckpoint checkpoint;  // As stored
+  uint32_t unanchored;         // Oldest outbox events already delivered and chained
+  uint32_t anchorsSent;
+  uint32_t anchorsFailed;
+  
+  // Everything the console reports, copied out at the end of each pass
+  StatusSnapshot<NetworkStatus> status;
+  
+#ifdef ARDUINO
+  static void taskEntry(void* param) {
+    static_cast<NetworkManager*>(param)->taskLoop();
+  }
+  
+  // Network task: owns the Wi-Fi link and the gateway connection, so
+  // reconnects and HTTP never run on the security core
+  void taskLoop() {
+    openOutbox();
+    prepareLink();
+    for (;;) {
+      uint32_t wait = serviceLog();
+      
+      // Sleep until the security loop queues something, a link event
+      // arrives, or a timer is due
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+    }
+  }
+#endif
+  
+  // Wi-Fi event task on the device: cache the state and wake the network task
+  static void onLinkEvent(void* arg, bool up) {
+    NetworkManager* self = static_cast<NetworkManager*>(arg);
+    self->link.onLinkChange(up);
+#ifdef ARDUINO
+    if (self->taskHandle != nullptr) {
+      xTaskNotifyGive(self->taskHandle);
+    }
+#endif
+  }
+  
+  // Route link events here and start the link, unless it only comes up
+  // when there is something to deliver
+  void prepareLink() {
+    net.onLinkChange(onLinkEvent, this);
+    net.setPowerSave(radioPolicy != RADIO_ALWAYS_ON);
+    if (radioPolicy != RADIO_ON_DEMAND) startLink();
+  }
+  
+  // Start associating; the first attempt is timed as the network boot stage
+  void startLink() {
+    Serial.print("Connecting to WiFi: ");
+    Serial.println(credentials.ssid);
+    if (boot.getOutcome(BOOT_NETWORK) == BOOT_NOT_STARTED) boot.start(BOOT_NETWORK, clock.micros());
+    radioIdle = false;
+    link.begin(credentials.ssid, credentials.password, credentials.deviceId * 2654435761u ^ clock.micros());
+  }
+  
+  // On-demand radio: up while events wait for delivery or an anchor is due,
+  // off once nothing has been pending for RADIO_LINGER. Returns how long
+  // until it needs to run again (ms).
+  uint32_t serviceRadio(uint32_t undelivered) {
+    bool work = undelivered > 0 || anchorDue();
+    if (link.getState() == LINK_IDLE) {
+      if (!work) return WIFI_IDLE_WAIT;
+      startLink();
+      return 0;  // Pick up its first link event
+    }
+    if (work) {
+      radioIdle = false;
+      return WIFI_IDLE_WAIT;
+    }
+    if (!radioIdle) {
+      radioIdle = true;
+      radioIdleSince = clock.millis();
+    }
+    uint32_t idle = clock.millis() - radioIdleSince;
+    if (idle < RADIO_LINGER) return RADIO_LINGER - idle;
+    link.end();
+    net.endLink();
+    reportedLinkState = LINK_IDLE;
+    Serial.println("WiFi off until the next event");
+    return WIFI_IDLE_WAIT;
+  }
+  
+  // Advance the link and report its changes. Returns how long until it
+  // needs to run again (ms).
+  uint32_t serviceLink() {
+    uint32_t wait = link.service();
+    LinkState state = link.getState();
+    
+    if (!boot.finished(BOOT_NETWORK) && (state == LINK_UP || link.getFailures() > 0)) {
+      boot.finish(BOOT_NETWORK, clock.micros(), state == LINK_UP);
+      if (state != LINK_UP) {
+        Serial.println("Network initialization failed. Running offline, retrying in the background.");
+      }
+    }
+    
+    if (state == LINK_UP && reportedLinkState != LINK_UP) {
+      uint32_t ip = net.localAddress();
+      Serial.printf("Connected to WiFi, IP address: %u.%u.%u.%u\n", (unsigned)(ip & 0xFF),
+                    (unsigned)((ip >> 8) & 0xFF), (unsigned)((ip >> 16) & 0xFF), (unsigned)(ip >> 24));
+      if (link.getReconnects() > 0) {
+        Serial.print("Reconnected after ");
+        Serial.print(link.getLastReconnect());
+        Serial.println(" ms");
+      }
+    } else if (state != LINK_UP && reportedLinkState == LINK_UP) {
+      Serial.println("WiFi link lost, reconnecting");
+    }
+    reportedLinkState = state;
+    return wait;
+  }
+  
+  void openOutbox() {
+    if (!storage.loadChainCheckpoint(checkpoint)) {
+      checkpoint = ChainCheckpoint::initial();
+    }
+    chain.restore(checkpoint, credentials.deviceId);
+    if (checkpoint.pendingEnd != 0) {
+      Serial.print("[BLOCKCHAIN] Resuming anchor of events ");
+      Serial.print(checkpoint.nextSeq);
+      Serial.print("-");
+      Serial.println(checkpoint.pendingEnd);
+    }
+    
+    if (!outbox.begin()) {
+      Serial.println("[BLOCKCHAIN] Outbox partition unavailable, events are not persisted");
+    } else if (outbox.getPending() > 0) {
+      replayedEvents = outbox.getPending();
+      Serial.print("[BLOCKCHAIN] Replaying ");
+      Serial.print(outbox.getPending());
+      Serial.println(" undelivered events");
+    }
+  }
+  
+  // Event-to-acknowledgement latency. Events replayed from an earlier boot
+  // carry that boot's timestamps and are skipped.
+  void recordAcks(const AccessEvent* acked, uint32_t count) {
+#ifdef METRICS_ENABLED
+    uint32_t now = clock.millis();
+    for (uint32_t i = 0; i < count; i++) {
+      if (replayedEvents > 0) {
+        replayedEvents--;
+        continue;
+      }
+      uint32_t age = now - acked[i].timestamp;
+      metrics.record(METRIC_NET_ACK, age < 0xFFFFFFFFu / 1000 ? age * 1000 : 0xFFFFFFFFu);
+    }
+#else
+    (void)acked;
+    (void)count;
+#endif
+  }
+  
+  // Write an event to the outbox; false if there is none. An outbox that
+  // runs full drops its oldest events, delivered ones first.
+  bool persist(const AccessEvent &event) {
+    if (!outbox.append(event)) return false;
+    uint32_t lost = outbox.getEvicted() - evictedSeen;
+    evictedSeen += lost;
+    unanchored -= lost < unanchored ? lost : unanchored;
+    return true;
+  }
+  
+  // Events the open window can still take. Once its anchor has been sent,
+  // even before a reboot, the window ends exactly there.
+  uint32_t windowRoom() const {
+    uint32_t limit = ANCHOR_WINDOW_EVENTS;
+    if (checkpoint.pendingEnd != 0) {
+      limit = checkpoint.pendingEnd - chain.getWindowFirst() + 1;
+    }
+    return chain.getWindowSize() < limit ? limit - chain.getWindowSize() : 0;
+  }
+  
+  bool anchorDue() const {
+    return chain.getWindowSize() > 0 &&
+           (windowRoom() == 0 || clock.millis() - chain.getWindowOpenedAt() >= ANCHOR_INTERVAL);
+  }
+  
+  // Send the open window's root to the chain and release its events
+  bool submitAnchor() {
+    AnchorWindow window;
+    if (!chain.window(window)) return true;
+    if (!isConnected() || blockchain == nullptr) {
+      anchorsFailed++;
+      return false;
+    }
+    
+    if (checkpoint.pendingEnd != window.lastSeq) {
+      checkpoint.pendingEnd = window.lastSeq;
+      storage.saveChainCheckpoint(checkpoint);
+    }
+    if (!blockchain->postAnchor(window)) {
+      anchorsFailed++;
+      return false;
+    }
+    
+    outbox.ack(unanchored);
+    unanchored = 0;
+    chain.commit();
+    checkpoint = chain.checkpoint();
+    storage.saveChainCheckpoint(checkpoint);
+    anchorsSent++;
+    Serial.print("[BLOCKCHAIN] Anchored events ");
+    Serial.print(window.firstSeq);
+    Serial.print("-");
+    Serial.println(window.lastSeq);
+    return true;
+  }
+  
+  // Deliver outbox events oldest first to the gateway, pipelining several
+  // requests on the keep-alive connection, and chain each acknowledged one
+  // into the open window; stops at the first failure or a full window
+  bool drainOutbox() {
+    AccessEvent events[BATCH_MAX_EVENTS * HTTP_MAX_PIPELINE];
+    uint32_t batchSizes[HTTP_MAX_PIPELINE];
+    uint32_t count;
+    
+    for (;;) {
+      uint32_t room = windowRoom();
+      uint32_t max = room < BATCH_MAX_EVENTS * HTTP_MAX_PIPELINE ? room : BATCH_MAX_EVENTS * HTTP_MAX_PIPELINE;
+      if (max == 0 || (count = outbox.peekBatch(events, max, unanchored)) == 0) break;
+      
+      if (!isConnected() || blockchain == nullptr) {
+        Serial.println("Cannot log to blockchain: No connection");
+        eventsFailed += count;
+        return false;
+      }
+      
+      // Write the requests back to back, then collect the answers in order
+      uint32_t firstSeq = chain.getNextSeq();
+      uint32_t batches = 0;
+      uint32_t offset = 0;
+      uint32_t acked = 0;
+      while (offset < count && batches < HTTP_MAX_PIPELINE) {
+        uint32_t size = count - offset < BATCH_MAX_EVENTS ? count - offset : BATCH_MAX_EVENTS;
+        if (!blockchain->sendEvents(events + offset, size, firstSeq + offset)) break;
+        batchSizes[batches++] = size;
+        offset += size;
+      }
+      
+      for (uint32_t i = 0; i < batches; i++) {
+        if (!blockchain->awaitBatch()) {
+          eventsFailed += count;
+          return false;
+        }
+        recordAcks(events + acked, batchSizes[i]);
+        for (uint32_t j = 0; j < batchSizes[i]; j++) {
+          chain.append(events[acked + j], clock.millis());
+        }
+        acked += batchSizes[i];
+        unanchored += batchSizes[i];
+        eventsLogged += batchSizes[i];
+        count -= batchSizes[i];
+      }
+      if (batches == 0) {
+        eventsFailed += count;
+        return false;
+      }
+      
+      // Pick up fresh events between sends so the RAM ring cannot fill
+      AccessEvent fresh;
+      while (logQueue.pop(fresh)) {
+        persist(fresh);
+      }
+    }
+    batchOpen = false;
+    return true;
+  }
+  
+  // Network task side of the status snapshot
+  void publishStatus() {
+    NetworkStatus next;
+    memset(&next, 0, sizeof(next));
+    next.takenAt = clock.millis();
+    next.linkState = link.getState();
+    next.linkUp = link.isUp();
+    next.radioOn = link.getState() != LINK_IDLE;
+    next.retryIn = link.getRetryIn();
+    next.attempts = link.getAttempts();
+    next.failures = link.getFailures();
+    next.drops = link.getDrops();
+    next.reconnects = link.getReconnects();
+    next.lastReconnect = link.getLastReconnect();
+    next.maxReconnect = link.getMaxReconnect();
+    next.downtime = link.getDowntime();
+    next.downtimeGrowing = link.isDownAfterDrop();
+    next.radioOnTime = link.getActiveTime();
+    if (next.linkUp) {
+      next.ip = net.localAddress();
+      next.rssi = net.signalStrength();
+    }
+    next.eventsLogged = eventsLogged;
+    next.eventsFailed = eventsFailed;
+    next.outboxPending = outbox.getPending();
+    next.outboxEvicted = outbox.getEvicted();
+    next.outboxErases = outbox.getErases();
+    next.nextSeq = chain.getNextSeq();
+    next.windowSize = chain.getWindowSize();
+    next.anchorsSent = anchorsSent;
+    next.anchorsFailed = anchorsFailed;
+    next.gateway = blockchain != nullptr;
+    if (next.gateway) {
+      next.httpRequests = blockchain->getRequests();
+      next.httpConnects = blockchain->getConnects();
+    }
+    status.publish(next);
+  }
+  
+public:
+  // outboxFlash is the raw partition for undelivered events
+  NetworkManager(NetTransport &_net, FlashRegion &outboxFlash, StorageManager &_storage, Clock &_clock,
+                 Metrics &_metrics, BootTimeline &_boot)
+    : net(_net), clock(_clock), metrics(_metrics), boot(_boot), storage(_storage), link(_net, _clock),
+      reportedLinkState(LINK_IDLE), radioPolicy(RADIO_ALWAYS_ON), radioIdle(false),
+      radioIdleSince(0), blockchain(nullptr),
+#ifdef ARDUINO
+      taskHandle(nullptr),
+#endif
+      eventsLogged(0), eventsFailed(0), batchOpen(false), batchOpenedAt(0), replayedEvents(0), outbox(outboxFlash),
+      evictedSeen(0), checkpoint(ChainCheckpoint::initial()), unanchored(0), anchorsSent(0), anchorsFailed(0) {
+    memset(&credentials, 0, sizeof(credentials));
+  }
+  
+  // RadioPolicy; before init()
+  void setRadioPolicy(uint8_t policy) {
+    radioPolicy = policy;
+  }
+  
+  bool init(const NetworkCredentials &_credentials) {
+    credentials = _credentials;
+    
+    // Initialize blockchain interface
+    blockchain = new BlockchainInterface(credentials.serverUrl, credentials.deviceId, net);
+    
+#ifdef ARDUINO
+    // Start the network task; it brings up Wi-Fi without holding up boot
+    if (taskHandle == nullptr) {
+      xTaskCreatePinnedToCore(taskEntry, "network", NETWORK_TASK_STACK, this,
+                              NETWORK_TASK_PRIORITY, &taskHandle, NETWORK_TASK_CORE);
+    }
+    return taskHandle != nullptr;
+#else
+    // Host builds run the network task inline through serviceLog()
+    openOutbox();
+    prepareLink();
+    serviceLink();
+    publishStatus();
+    return true;
+#endif
+  }
+  
+#ifdef ARDUINO
+  TaskHandle_t getTaskHandle() const {
+    return taskHandle;
+  }
+#endif
+  
+  // One pass of the network task: persist queued events, bring an
+  // on-demand radio up or down, anchor the chain window if it is due, then
+  // deliver any batch that is due. Returns how
+  // long the task may sleep (ms).
+  uint32_t serviceLog() {
+    uint32_t linkWait = serviceLink();
+    
+    // Persist new events first, then deliver in order
+    AccessEvent event;
+    while (logQueue.pop(event)) {
+      if (!persist(event)) {
+        eventsFailed++;   // No outbox to hold it
+      }
+    }
+    
+    uint32_t undelivered = outbox.getPending() - unanchored;
+    
+    // An on-demand radio is brought up first and used once its link event arrives
+    bool awaitLink = false;
+    if (radioPolicy == RADIO_ON_DEMAND) {
+      uint32_t radioWait = serviceRadio(undelivered);
+      if (radioWait < linkWait) linkWait = radioWait;
+      awaitLink = !isConnected();
+    }
+    
+    bool anchored = !anchorDue() || awaitLink || submitAnchor();
+    
+    // Batch window opens when the first undelivered event is seen
+    if (undelivered == 0) {
+      batchOpen = false;
+    } else if (!batchOpen) {
+      batchOpen = true;
+      batchOpenedAt = clock.millis();
+    }
+    
+    uint32_t wait = 1000;
+    if (batchOpen && awaitLink) {
+      wait = linkWait;
+    } else if (batchOpen) {
+      uint32_t age = clock.millis() - batchOpenedAt;
+      if (undelivered >= BATCH_MAX_EVENTS || age >= BATCH_MAX_DELAY) {
+        wait = drainOutbox() ? 1000 : OUTBOX_RETRY_INTERVAL;
+      } else {
+        wait = BATCH_MAX_DELAY - age;  // Let the batch fill up
+      }
+    }
+    
+    if (!anchored) {
+      wait = OUTBOX_RETRY_INTERVAL;
+    } else if (anchorDue()) {
+      wait = awaitLink ? linkWait : 0; // Window filled up: anchor it on the next pass
+    } else if (chain.getWindowSize() > 0) {
+      uint32_t left = ANCHOR_INTERVAL - (clock.millis() - chain.getWindowOpenedAt());
+      if (left < wait) wait = left;
+    }
+    if (linkWait < wait) wait = linkWait;
+    outbox.maintain();
+    publishStatus();
+    return wait;
+  }
+  
+  ~NetworkManager() {
+    if (blockchain != nullptr) {
+      delete blockchain;
+    }
+  }
+  
+  // Cached link state, O(1) from any task
+  bool isConnected() const {
+    return link.isUp();
+  }
+  
+  // Host builds have no network task; the security loop drives it instead.
+  // Returns how long until it needs to run again (ms).
+  uint32_t poll() {
+#ifndef ARDUINO
+    return serviceLog();
+#else
+    return WIFI_IDLE_WAIT;
+#endif
+  }
+  
+  // Radio on time, associated or trying to be (ms). From any task.
+  uint32_t getRadioOnTime() const {
+    NetworkStatus now;
+    if (!status.read(now)) return 0;
+    return now.radioOn ? now.radioOnTime + (clock.millis() - now.takenAt) : now.radioOnTime;
+  }
+  
+  // Queue an event for the network task. O(1), never blocks on the network.
+  bool enqueueAccess(const AccessEvent &event) {
+    ALLOC_FREE_SCOPE();
+    METRIC_START(clock, start);
+    bool queued = logQueue.push(event);
+#ifdef ARDUINO
+    if (taskHandle != nullptr) {
+      xTaskNotifyGive(taskHandle);
+    }
+#endif
+    METRIC_STOP(metrics, METRIC_NET_ENQUEUE, clock, start);
+    return queued;
+  }
+  
+  // The printers below report the network task's last published status
+  // and may run on any task
+  void printLinkStatus() {
+    NetworkStatus now;
+    if (!status.read(now)) {
+      Serial.println("WiFi: network task not started");
+      return;
+    }
+    uint32_t age = clock.millis() - now.takenAt;
+    uint32_t downtime = now.downtimeGrowing ? now.downtime + age : now.downtime;
+    Serial.print("WiFi: ");
+    Serial.print(now.linkUp ? "Connected" : "Disconnected");
+    Serial.print(" (");
+    Serial.print(linkStateName(now.linkState));
+    if (now.linkState == LINK_BACKOFF) {
+      Serial.print(", retry in ");
+      Serial.print(now.retryIn > age ? now.retryIn - age : 0);
+      Serial.print(" ms");
+    }
+    Serial.print(", as of ");
+    Serial.print(age);
+    Serial.println(" ms ago)");
+    Serial.print("Link: ");
+    Serial.print(now.attempts);
+    Serial.print(" attempts (");
+    Serial.print(now.failures);
+    Serial.print(" failed), ");
+    Serial.print(now.drops);
+    Serial.print(" drops, ");
+    Serial.print(now.reconnects);
+    Serial.print(" reconnects (last ");
+    Serial.print(now.lastReconnect);
+    Serial.print(" ms, max ");
+    Serial.print(now.maxReconnect);
+    Serial.print(" ms), downtime ");
+    Serial.print(downtime / 1000);
+    Serial.println(" s");
+    Serial.printf("IP Address: %u.%u.%u.%u\n", (unsigned)(now.ip & 0xFF), (unsigned)((now.ip >> 8) & 0xFF),
+                  (unsigned)((now.ip >> 16) & 0xFF), (unsigned)(now.ip >> 24));
+    Serial.print("RSSI: ");
+    Serial.println((int)now.rssi);
+  }
+  
+  void printLogStats() {
+    // The ring's counters are atomic and read live
+    Serial.print("Log queue: ");
+    Serial.print((uint32_t)logQueue.size());
+    Serial.print("/");
+    Serial.print((uint32_t)logQueue.capacity());
+    Serial.print(" (high water ");
+    Serial.print(logQueue.getHighWater());
+    Serial.println(")");
+    NetworkStatus now;
+    if (!status.read(now)) return;
+    Serial.print("Events logged: ");
+    Serial.print(now.eventsLogged);
+    Serial.print(", failed: ");
+    Serial.print(now.eventsFailed);
+    Serial.print(", dropped: ");
+    Serial.println(logQueue.getDropped());
+    Serial.print("Outbox: ");
+    Serial.print(now.outboxPending);
+    Serial.print(" pending, ");
+    Serial.print(now.outboxEvicted);
+    Serial.print(" evicted, ");
+    Serial.print(now.outboxErases);
+    Serial.println(" sector erases");
+    Serial.print("Chain: next event ");
+    Serial.print(now.nextSeq);
+    Serial.print(", window ");
+    Serial.print(now.windowSize);
+    Serial.print("/");
+    Serial.print((uint32_t)ANCHOR_WINDOW_EVENTS);
+    Serial.print(", ");
+    Serial.print(now.anchorsSent);
+    Serial.print(" anchors (");
+    Serial.print(now.anchorsFailed);
+    Serial.println(" failed)");
+    if (now.gateway) {
+      Serial.print("HTTP: ");
+      Serial.print(now.httpRequests);
+      Serial.print(" requests over ");
+      Serial.print(now.httpConnects);
+      Serial.println(" connections");
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef POWER_SCHEDULER_H
+#define POWER_SCHEDULER_H
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+
+// ==================== POWER SCHEDULER ====================
+// Duty cycling for a band that is idle nearly all the time. Instead of a
+// fixed tick, the security task blocks after each pass until its next
+// deadline (auto-lock, buzzer step, LED blink, finger poll) or an interrupt
+// (card answer, tilt pulse, finger touch, console command). On the device
+// the idle task then takes the chip into automatic light sleep, so the CPU
+// only runs for the passes themselves.
+//
+// Cards are looked for in short detection windows: the antenna comes on,
+// REQA goes out once the field has settled, and the antenna goes off again
+// unless a card answered. The radio is always on, in modem sleep between
+// beacons, or only associated while the log has something to deliver.
+//
+// The scheduler keeps the time spent awake and asleep and the wake latency
+// per source, and estimates the average current from them with the
+// POWER_*_UA figures. Times are microseconds and may wrap between calls.
+
+enum PowerProfileId : uint8_t {
+  POWER_ALWAYS_ON,      // Fixed tick, antenna and radio always on
+  POWER_DUTY_CYCLED,    // Light sleep, detection windows, Wi-Fi modem sleep
+  POWER_ON_DEMAND,      // As duty cycled, Wi-Fi only while events are pending
+  POWER_PROFILE_COUNT
+};
+
+enum RadioPolicy : uint8_t {
+  RADIO_ALWAYS_ON,      // Associated, power save off
+  RADIO_MODEM_SLEEP,    // Associated, radio off between beacons
+  RADIO_ON_DEMAND       // Associated only while the log has work, in modem sleep
+};
+
+struct PowerProfile {
+  const char* name;
+  bool lightSleep;        // Sleep to the next deadline instead of ticking
+  uint16_t reqaInterval;  // Card detection period (ms)
+  bool fieldSwitched;     // Antenna only on during detection windows
+  uint8_t radio;          // RadioPolicy
+};
+
+inline const PowerProfile &powerProfile(uint8_t id) {
+  static const PowerProfile PROFILES[POWER_PROFILE_COUNT] = {
+    {"always_on",   false, RFID_REQA_INTERVAL,   false, RADIO_ALWAYS_ON},
+    {"duty_cycled", true,  RFID_WINDOW_INTERVAL, true,  RADIO_MODEM_SLEEP},
+    {"on_demand",   true,  RFID_WINDOW_INTERVAL, true,  RADIO_ON_DEMAND}
+  };
+  return PROFILES[id < POWER_PROFILE_COUNT ? id : (uint8_t)POWER_ALWAYS_ON];
+}
+
+enum WakeSource : uint8_t {
+  WAKE_CARD,            // Card answered a detection window
+  WAKE_TAMPER,          // Tilt pulses crossed the threshold
+  WAKE_SOURCE_COUNT
+};
+
+class PowerScheduler {
+private:
+  const PowerProfile* profile;
+
+  // Residency
+  bool asleep;
+  uint32_t awakeSince;
+  uint32_t sleptAt;
+  uint32_t plannedUs;
+  uint64_t awakeUs;
+  uint64_t sleepUs;
+
+  // Wakes: on the planned deadline, or early for an interrupt
+  uint32_t timerWakes;
+  uint32_t eventWakes;
+
+  // Event to the pass that handled it, per source
+  uint32_t latencyCount[WAKE_SOURCE_COUNT];
+  uint64_t latencyTotal[WAKE_SOURCE_COUNT];
+  uint32_t latencyMax[WAKE_SOURCE_COUNT];
+
+public:
+  PowerScheduler(uint8_t profileId)
+    : profile(&powerProfile(profileId)), asleep(false), awakeSince(0), sleptAt(0), plannedUs(0),
+      awakeUs(0), sleepUs(0), timerWakes(0), eventWakes(0) {
+    for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+      latencyCount[i] = 0;
+      latencyTotal[i] = 0;
+      latencyMax[i] = 0;
+    }
+  }
+
+  void setProfile(uint8_t profileId) {
+    profile = &powerProfile(profileId);
+  }
+
+  const PowerProfile &getProfile() const {
+    return *profile;
+  }
+
+  // The task is about to block for at most ms
+  void sleep(uint32_t nowUs, uint32_t ms) {
+    if (asleep) return;
+    awakeUs += nowUs - awakeSince;
+    asleep = true;
+    sleptAt = nowUs;
+    plannedUs = ms * 1000;
+  }
+
+  // The task is running again; a no-op if it never went to sleep
+  void wake(uint32_t nowUs) {
+    if (!asleep) return;
+    uint32_t slept = nowUs - sleptAt;
+    sleepUs += slept;
+    if (slept >= plannedUs) {
+      timerWakes++;
+    } else {
+      eventWakes++;
+    }
+    asleep = false;
+    awakeSince = nowUs;
+  }
+
+  // A pass picked up an event that happened at eventUs
+  void noteWake(uint8_t source, uint32_t eventUs, uint32_t nowUs) {
+    if (source >= WAKE_SOURCE_COUNT) return;
+    uint32_t latency = nowUs - eventUs;
+    latencyCount[source]++;
+    latencyTotal[source] += latency;
+    if (latency > latencyMax[source]) latencyMax[source] = latency;
+  }
+
+  // Average supply current over the accounted time (uA): the CPU by
+  // residency, the reader by antenna duty and the radio by the time it was
+  // associated or trying to be
+  uint32_t estimateCurrent(uint64_t radioOnUs) const {
+    uint64_t total = awakeUs + sleepUs;
+    if (total == 0) return 0;
+
+    uint64_t windows = 0;
+    uint64_t charge = awakeUs * POWER_CPU_ACTIVE_UA;
+    if (profile->lightSleep) {
+      // Each detection window wakes the CPU for its timer callbacks
+      if (profile->fieldSwitched) windows = total / ((uint64_t)profile->reqaInterval * 1000);
+      uint64_t windowUs = windows * POWER_WINDOW_AWAKE_US;
+      if (windowUs > sleepUs) windowUs = sleepUs;
+      charge += windowUs * POWER_CPU_ACTIVE_UA + (sleepUs - windowUs) * POWER_LIGHT_SLEEP_UA;
+    } else {
+      charge += sleepUs * POWER_CPU_IDLE_UA;
+    }
+
+    if (radioOnUs > total) radioOnUs = total;
+    charge += radioOnUs * (profile->radio == RADIO_ALWAYS_ON ? POWER_WIFI_ACTIVE_UA : POWER_WIFI_SAVE_UA);
+
+    if (profile->fieldSwitched) {
+      uint64_t fieldUs = windows * (RFID_FIELD_SETTLE + RFID_ANSWER_WINDOW) * 1000;
+      if (fieldUs > total) fieldUs = total;
+      charge += fieldUs * POWER_RFID_FIELD_UA + (total - fieldUs) * POWER_RFID_IDLE_UA;
+    } else {
+      charge += total * POWER_RFID_FIELD_UA;
+    }
+    return (uint32_t)(charge / total);
+  }
+
+  uint64_t getAwakeUs() const { return awakeUs; }
+  uint64_t getSleepUs() const { return sleepUs; }
+  uint32_t getTimerWakes() const { return timerWakes; }
+  uint32_t getEventWakes() const { return eventWakes; }
+  uint32_t getWakeCount(uint8_t source) const { return source < WAKE_SOURCE_COUNT ? latencyCount[source] : 0; }
+  uint32_t getWakeLatencyMax(uint8_t source) const { return source < WAKE_SOURCE_COUNT ? latencyMax[source] : 0; }
+  uint32_t getWakeLatencyAverage(uint8_t source) const {
+    return source < WAKE_SOURCE_COUNT && latencyCount[source] ? (uint32_t)(latencyTotal[source] / latencyCount[source]) : 0;
+  }
+
+  void printReport(uint64_t radioOnUs) const {
+    static const char* const SOURCES[WAKE_SOURCE_COUNT] = {"card", "tamper"};
+    uint64_t total = awakeUs + sleepUs;
+    Serial.print("Power: ");
+    Serial.print(profile->name);
+    Serial.print(", awake ");
+    Serial.print(total ? (double)awakeUs * 100.0 / (double)total : 0.0);
+    Serial.print("%, ");
+    Serial.print(timerWakes);
+    Serial.print(" timer wakes, ");
+    Serial.print(eventWakes);
+    Serial.print(" interrupt wakes, est. ");
+    Serial.print(estimateCurrent(radioOnUs) / 1000.0);
+    Serial.println(" mA");
+    for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+      Serial.printf("Wake latency %-6s avg %lu us, max %lu us (%lu)\n", SOURCES[i],
+                    (unsigned long)getWakeLatencyAverage(i), (unsigned long)latencyMax[i],
+                    (unsigned long)latencyCount[i]);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,489 @@
+#ifndef READER_BANK_H
+#define READER_BANK_H
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+#include "auth_fsm.h"
+#include "storage_manager.h"
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// ==================== READER BANK ====================
+// One controller for a rack of bands: up to RFID_MAX_READERS MFRC522s on
+// the shared SPI bus, each with its own chip select, and a door relay per
+// reader. Every lane runs its own authentication state machine, so a card
+// at one reader never waits for another reader's user. The fingerprint
+// sensor is shared: lanes take it first come, first served when their
+// card matches and hold it until their attempt ends. A lane waiting for
+// the sensor spends its own scan window doing so, and the sensor must be
+// seen empty before it serves the next lane, so the last user's finger is
+// never matched against the next card.
+//
+// REQA is interleaved across the readers by ReaderScheduler. The readers'
+// IRQ outputs are wired together (open drain) onto one pin, and REQAs are
+// at least RFID_SLOT_TIME apart, so a falling edge belongs to the reader
+// whose slot it is. Each reader still gets one REQA per RFID_REQA_INTERVAL
+// while the slots fit in it; past that the period stretches to
+// readers * RFID_SLOT_TIME, so the worst-case detection latency grows at
+// most linearly with the readers and the card rate each one can take does
+// not shrink.
+//
+// Lockout and logging stay with the owner: every decision goes to the
+// access handler with the lane it was made on.
+
+// Time-multiplexed REQA. Readers take strict turns; a slot that finds the
+// bus busy (a card read on another lane) keeps the turn and retries a
+// slot later rather than passing it on, so no reader can be starved.
+// Times are microseconds and may wrap.
+class ReaderScheduler {
+private:
+  uint8_t readers;
+  uint32_t slotUs;
+  uint32_t periodUs;      // Between two REQAs to the same reader
+  uint32_t spacingUs;     // Between REQAs to consecutive readers
+  uint8_t turn;           // Reader whose REQA goes out next
+  uint32_t nextAtUs;
+
+  // Counters
+  uint32_t sentCount;
+  uint32_t deferred;      // Slots retried because the bus was busy
+
+public:
+  ReaderScheduler()
+    : readers(0), slotUs(0), periodUs(0), spacingUs(0), turn(0), nextAtUs(0), sentCount(0), deferred(0) {}
+
+  void begin(uint8_t _readers, uint32_t intervalUs, uint32_t _slotUs, uint32_t nowUs) {
+    readers = _readers;
+    slotUs = _slotUs;
+    periodUs = intervalUs;
+    if (periodUs < (uint32_t)readers * slotUs) periodUs = (uint32_t)readers * slotUs;
+    spacingUs = readers > 0 ? periodUs / readers : periodUs;
+    turn = 0;
+    nextAtUs = nowUs;
+  }
+
+  // Reader whose REQA is due, or -1
+  int8_t due(uint32_t nowUs) const {
+    if (readers == 0 || (int32_t)(nowUs - nextAtUs) < 0) return -1;
+    return turn;
+  }
+
+  // The due reader's REQA went out. The next reader follows one spacing
+  // after this slot, and never sooner than a slot from now, so a late
+  // pass does not send two REQAs into the same answer window.
+  void sent(uint32_t nowUs) {
+    sentCount++;
+    turn = (turn + 1) % readers;
+    nextAtUs += spacingUs;
+    if ((int32_t)(nowUs + slotUs - nextAtUs) > 0) nextAtUs = nowUs + slotUs;
+  }
+
+  // The bus was busy: the same reader tries again a slot from now
+  void busy(uint32_t nowUs) {
+    deferred++;
+    nextAtUs = nowUs + slotUs;
+  }
+
+  uint32_t untilNext(uint32_t nowUs) const {
+    int32_t left = (int32_t)(nextAtUs - nowUs);
+    return left > 0 ? (uint32_t)left : 0;
+  }
+
+  uint8_t getReaders() const { return readers; }
+  uint32_t getPeriod() const { return periodUs; }
+  uint32_t getSpacing() const { return spacingUs; }
+  uint32_t getSent() const { return sentCount; }
+  uint32_t getDeferred() const { return deferred; }
+};
+
+class ReaderBank;
+
+// Access decision on a lane, for logging and lockout
+typedef void (*BankAccessHandler)(void* context, uint8_t lane, bool granted, const uint8_t uid[],
+                                  uint8_t uidSize, uint16_t fingerprintId);
+
+// One reader and its relay, driving its own state machine
+class BankLane : public AuthDriver {
+  friend class ReaderBank;
+
+private:
+  ReaderBank* bank;
+  CardReader* reader;
+  uint8_t index;
+  uint8_t relayPin;
+  AuthStateMachine fsm;
+  bool unlocked;
+  uint32_t unlockTime;
+  uint16_t boundFirstPage;
+  uint8_t boundPageCount;
+
+  // Counters
+  uint32_t detections;
+  uint32_t granted;
+  uint32_t rejected;
+  uint32_t pickupMax;       // Card answer to the pass that saw it (us)
+
+public:
+  BankLane()
+    : bank(nullptr), reader(nullptr), index(0), relayPin(0), fsm(*this, FP_SCAN_TIMEOUT), unlocked(false),
+      unlockTime(0), boundFirstPage(0), boundPageCount(0), detections(0), granted(0), rejected(0),
+      pickupMax(0) {}
+
+  // AuthDriver, on this lane's reader and the shared sensor
+  bool cardPresent() override;
+  bool readCard(uint8_t uid[], uint8_t &size) override;
+  bool cardAuthorized(const uint8_t uid[], uint8_t size) override;
+  FpResult captureImage() override;
+  FpResult convertImage() override;
+  FpResult searchFinger(uint16_t &fingerprintId) override;
+  bool fingerTouched() override;
+
+  AuthState getState() const { return fsm.getState(); }
+  bool isUnlocked() const { return unlocked; }
+  uint8_t getRelayPin() const { return relayPin; }
+  uint32_t getDetections() const { return detections; }
+  uint32_t getGranted() const { return granted; }
+  uint32_t getRejected() const { return rejected; }
+  uint32_t getPickupMax() const { return pickupMax; }
+};
+
+class ReaderBank {
+  friend class BankLane;
+
+private:
+  Gpio &gpio;
+  Clock &clock;
+  FingerprintSensor &finger;
+  const AuthorizedCards &cards;
+
+  BankLane lanes[RFID_MAX_READERS];
+  uint8_t laneCount;
+  uint8_t firstLane;            // Lane that steps first on the next pass
+  ReaderScheduler scheduler;
+
+  // Reader whose REQA is out, for the shared IRQ line
+  volatile int8_t answering;
+  volatile uint32_t reqaAt;
+
+  int8_t sensorLane;            // Lane holding the fingerprint sensor, -1 if free
+  bool sensorHandedOver;        // Not yet seen empty since the last lane let go
+  bool suspended;
+
+  BankAccessHandler accessHandler;
+  void* accessContext;
+
+#ifdef ARDUINO
+  esp_timer_handle_t slotTimer;
+
+  static void slotTimerEntry(void* param) {
+    ReaderBank* self = static_cast<ReaderBank*>(param);
+    uint32_t waitUs = self->serviceSlots(::micros());
+    esp_timer_start_once(self->slotTimer, waitUs > 0 ? waitUs : 1);
+  }
+#endif
+
+  static void IRAM_ATTR onIrq(void* arg) {
+    ReaderBank* self = static_cast<ReaderBank*>(arg);
+    int8_t lane = self->answering;
+#ifdef ARDUINO
+    uint32_t nowUs = micros();   // Direct, like Mfrc522Reader: no virtual call from the ISR
+#else
+    uint32_t nowUs = self->clock.micros();
+#endif
+    // Past the slot the edge is not an answer to its REQA
+    if (lane < 0 || nowUs - self->reqaAt > RFID_SLOT_TIME) return;
+    self->lanes[lane].reader->onAnswer(nowUs);
+  }
+
+  // First come, first served: the sensor goes to the lane that has waited
+  // longest for it
+  bool claimSensor(const BankLane &lane) {
+    if (sensorLane == lane.index) return true;
+    if (sensorLane >= 0) return false;
+    uint32_t now = clock.millis();
+    uint32_t waited = lane.fsm.timeInState(now);
+    for (uint8_t i = 0; i < laneCount; i++) {
+      if (i != lane.index && lanes[i].fsm.getState() == AUTH_AWAIT_FINGER &&
+          lanes[i].fsm.timeInState(now) > waited) {
+        return false;
+      }
+    }
+    sensorLane = lane.index;
+    Serial.printf("Reader %u: place finger\n", lane.index);
+    return true;
+  }
+
+  void unlock(BankLane &lane) {
+    gpio.write(lane.relayPin, LOW);  // LOW = energize relay (unlock)
+    lane.unlocked = true;
+    lane.unlockTime = clock.millis();
+    Serial.printf("Reader %u: access granted, unlocking\n", lane.index);
+  }
+
+  void report(BankLane &lane, bool granted) {
+    if (accessHandler == nullptr) return;
+    accessHandler(accessContext, lane.index, granted, lane.fsm.getCardUID(), lane.fsm.getCardUIDSize(),
+                  granted ? lane.fsm.getFingerprintId() : 0);
+  }
+
+  // Lock the doors whose time is up; returns the ms until the next one is
+  uint32_t serviceLocks() {
+    uint32_t wait = UINT32_MAX;
+    uint32_t now = clock.millis();
+    for (uint8_t i = 0; i < laneCount; i++) {
+      if (!lanes[i].unlocked) continue;
+      uint32_t held = now - lanes[i].unlockTime;
+      if (held >= UNLOCK_DURATION) {
+        lock(i);
+      } else if (UNLOCK_DURATION - held < wait) {
+        wait = UNLOCK_DURATION - held;
+      }
+    }
+    return wait;
+  }
+
+  // One authentication step on a lane; returns the ms until it needs the
+  // next one
+  uint32_t step(BankLane &lane) {
+    if (lane.unlocked || suspended) return UINT32_MAX;
+    uint32_t now = clock.millis();
+
+    AuthState previous = lane.fsm.getState();
+    AuthOutcome outcome = lane.fsm.update(now);
+    switch (outcome) {
+      case AUTH_GRANTED:
+        lane.granted++;
+        unlock(lane);
+        report(lane, true);
+        break;
+      case AUTH_CARD_REJECTED:
+      case AUTH_FINGER_REJECTED:
+        lane.rejected++;
+        Serial.printf("Reader %u: %s\n", lane.index,
+                      outcome == AUTH_CARD_REJECTED ? "card rejected"
+                      : previous == AUTH_AWAIT_FINGER ? "fingerprint scan timeout" : "fingerprint rejected");
+        report(lane, false);
+        break;
+      default:
+        break;
+    }
+
+    AuthState state = lane.fsm.getState();
+    if (sensorLane == lane.index && state != AUTH_AWAIT_FINGER && state != AUTH_CAPTURE && state != AUTH_SEARCH) {
+      sensorLane = -1;
+      sensorHandedOver = true;
+    }
+    return lane.fsm.nextStepIn(clock.millis());  // The card answer wakes an idle lane
+  }
+
+public:
+  ReaderBank(Gpio &_gpio, Clock &_clock, FingerprintSensor &_finger, const AuthorizedCards &_cards)
+    : gpio(_gpio), clock(_clock), finger(_finger), cards(_cards), laneCount(0), firstLane(0), answering(-1),
+      reqaAt(0), sensorLane(-1), sensorHandedOver(false), suspended(false), accessHandler(nullptr), accessContext(nullptr) {
+#ifdef ARDUINO
+    slotTimer = nullptr;
+#endif
+  }
+
+  // Add a reader and its relay before begin(). False once the bank is full.
+  bool addLane(CardReader &reader, uint8_t relayPin) {
+    if (laneCount == RFID_MAX_READERS) return false;
+    BankLane &lane = lanes[laneCount];
+    lane.bank = this;
+    lane.reader = &reader;
+    lane.index = laneCount++;
+    lane.relayPin = relayPin;
+    return true;
+  }
+
+  void setAccessHandler(BankAccessHandler handler, void* context) {
+    accessHandler = handler;
+    accessContext = context;
+  }
+
+  // Relays locked, readers up and REQA slots running. False if any reader
+  // did not answer on the bus; the others run regardless.
+  bool begin(uint8_t irqPin) {
+    bool initialized = true;
+    for (uint8_t i = 0; i < laneCount; i++) {
+      gpio.mode(lanes[i].relayPin, OUTPUT);
+      gpio.write(lanes[i].relayPin, HIGH);  // Start locked
+      lanes[i].reader->setScheduled();
+      if (!lanes[i].reader->begin()) {
+        Serial.printf("Warning: reader %u not responding\n", i);
+        initialized = false;
+      }
+    }
+
+    scheduler.begin(laneCount, RFID_REQA_INTERVAL * 1000UL, RFID_SLOT_TIME, clock.micros());
+    gpio.mode(irqPin, INPUT_PULLUP);
+    gpio.attachInterrupt(irqPin, onIrq, this, FALLING);
+    Serial.printf("Reader bank: %u readers, REQA every %lu ms each\n", laneCount,
+                  (unsigned long)(scheduler.getPeriod() / 1000));
+
+#ifdef ARDUINO
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = slotTimerEntry;
+    timerArgs.arg = this;
+    timerArgs.name = "rfid_slots";
+    if (esp_timer_create(&timerArgs, &slotTimer) != ESP_OK || esp_timer_start_once(slotTimer, 1) != ESP_OK) {
+      Serial.println("Warning: reader bank timer unavailable");
+    }
+#endif
+    return initialized;
+  }
+
+  // REQA slot timer body: sends the due reader's REQA, if any, and returns
+  // the us until the next slot. Runs from an esp_timer on the device; host
+  // loops call it themselves.
+  uint32_t serviceSlots(uint32_t nowUs) {
+    int8_t lane = scheduler.due(nowUs);
+    if (lane >= 0) {
+      reqaAt = nowUs;
+      answering = lane;  // Before the REQA: the answer can beat detect()'s return
+      if (lanes[lane].reader->detect()) {
+        scheduler.sent(nowUs);
+      } else {
+        scheduler.busy(nowUs);
+      }
+    }
+    return scheduler.untilNext(nowUs);
+  }
+
+  // One pass: every lane takes one authentication step, starting from a
+  // different lane each pass. Doors due to lock are locked between the
+  // steps, so a relay is held at most one sensor exchange past
+  // UNLOCK_DURATION. Returns the ms until a lane next needs a pass,
+  // UINT32_MAX if only a card answer or a touch can make work.
+  uint32_t update() {
+    uint32_t wait = UINT32_MAX;
+    for (uint8_t k = 0; k < laneCount; k++) {
+      serviceLocks();
+      uint32_t laneWait = step(lanes[(firstLane + k) % laneCount]);
+      if (laneWait < wait) wait = laneWait;
+    }
+    uint32_t lockWait = serviceLocks();
+    if (lockWait < wait) wait = lockWait;
+    if (laneCount > 0) firstLane = (firstLane + 1) % laneCount;
+    return wait;
+  }
+
+  void lock(uint8_t lane) {
+    if (lane >= laneCount || !lanes[lane].unlocked) return;
+    gpio.write(lanes[lane].relayPin, HIGH);  // HIGH = de-energize relay (lock)
+    lanes[lane].unlocked = false;
+    lanes[lane].fsm.reset(clock.millis());
+    Serial.printf("Reader %u: locked\n", lane);
+  }
+
+  // Lockout: abandon every attempt and stop taking cards until resumed.
+  // Doors already open still lock on time.
+  void setSuspended(bool _suspended) {
+    if (_suspended && !suspended) {
+      for (uint8_t i = 0; i < laneCount; i++) {
+        if (!lanes[i].unlocked) lanes[i].fsm.reset(clock.millis());
+      }
+      sensorLane = -1;
+      sensorHandedOver = true;
+    }
+    suspended = _suspended;
+  }
+
+  // Host builds have no slot timer; the security loop sends the due REQA
+  // itself. Returns how long until the next slot (ms, rounded up).
+  uint32_t poll() {
+#ifndef ARDUINO
+    return (serviceSlots(clock.micros()) + 999) / 1000;
+#else
+    return UINT32_MAX;
+#endif
+  }
+
+  // No lane is in the middle of an attempt
+  bool isIdle() const {
+    for (uint8_t i = 0; i < laneCount; i++) {
+      if (!lanes[i].unlocked && lanes[i].fsm.getState() != AUTH_IDLE) return false;
+    }
+    return true;
+  }
+
+  uint8_t getLaneCount() const { return laneCount; }
+  CardReader &getReader(uint8_t lane) { return *lanes[lane].reader; }
+  const BankLane &getLane(uint8_t lane) const { return lanes[lane]; }
+  const ReaderScheduler &getScheduler() const { return scheduler; }
+  int8_t getSensorLane() const { return sensorLane; }
+  bool isSuspended() const { return suspended; }
+
+  void printStats() {
+    Serial.printf("Reader bank: %lu REQA, %lu deferred for a busy bus, period %lu us\n",
+                  (unsigned long)scheduler.getSent(), (unsigned long)scheduler.getDeferred(),
+                  (unsigned long)scheduler.getPeriod());
+    for (uint8_t i = 0; i < laneCount; i++) {
+      const BankLane &lane = lanes[i];
+      Serial.printf("  Reader %u: %lu detections, %lu granted, %lu rejected, pickup max %lu us, %s\n", i,
+                    (unsigned long)lane.detections, (unsigned long)lane.granted, (unsigned long)lane.rejected,
+                    (unsigned long)lane.pickupMax, lane.unlocked ? "unlocked" : "locked");
+    }
+  }
+};
+
+inline bool BankLane::cardPresent() {
+  if (!reader->cardPresent()) return false;
+  detections++;
+  uint32_t pickup = reader->getDetectLatency();
+  if (pickup > pickupMax) pickupMax = pickup;
+  return true;
+}
+
+inline bool BankLane::readCard(uint8_t uid[], uint8_t &size) {
+  return reader->readCard(uid, size);
+}
+
+inline bool BankLane::cardAuthorized(const uint8_t uid[], uint8_t size) {
+  const CardRecord* card = bank->cards.find(uid, size);
+  if (card == nullptr || !(card->flags & CARD_FLAG_ENABLED)) return false;
+  boundFirstPage = card->fingerprintId;
+  boundPageCount = card->fingerprintCount;
+  return true;
+}
+
+// Other lanes keep polling as if no finger were there until the sensor is theirs
+inline FpResult BankLane::captureImage() {
+  if (!bank->claimSensor(*this)) return FP_NO_FINGER;
+  FpResult result = bank->finger.captureImage();
+  if (bank->sensorHandedOver) {
+    if (result == FP_NO_FINGER) bank->sensorHandedOver = false;
+    return FP_NO_FINGER;  // Still the previous user's finger
+  }
+  return result;
+}
+
+inline FpResult BankLane::convertImage() {
+  return bank->finger.convertImage(1) == FP_OK ? FP_OK : FP_ERROR;
+}
+
+inline FpResult BankLane::searchFinger(uint16_t &fingerprintId) {
+  uint16_t score = 0;
+  FpResult result = bank->finger.search(boundFirstPage, boundPageCount, fingerprintId, score);
+  if (result == FP_OK && boundPageCount > 0 &&
+      (fingerprintId < boundFirstPage || fingerprintId - boundFirstPage >= boundPageCount)) {
+    return FP_NO_MATCH;
+  }
+  return result;
+}
+
+// A touch belongs to the lane holding the sensor, or starts the next one's capture
+inline bool BankLane::fingerTouched() {
+  if (bank->sensorLane >= 0 && bank->sensorLane != index) return false;
+  uint32_t touchedAt;
+  return bank->finger.takeTouch(touchedAt);
+}
+
+#endif
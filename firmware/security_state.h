@@ -0,0 +1,189 @@
+#ifndef SECURITY_STATE_H
+#define SECURITY_STATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+// ==================== SECURITY STATE ====================
+// Attempt counters and lockout kept in RAM and written back to storage
+// lazily. A failed attempt and entering or leaving lockout are written
+// before returning, so power-cycling between attempts cannot reset the
+// failure count. Clearing the count on success is written within the flush
+// delay, while the lifetime totals alone wait for the much longer stats
+// interval. A running lockout is checkpointed periodically so a reboot
+// resumes it with roughly the time that was left.
+//
+// The record is double-buffered: writes alternate between two slots and
+// carry a sequence number and CRC-32, so a reset in the middle of a write
+// leaves the previous record intact.
+
+#define STATE_FLUSH_DELAY        10000   // Longest a failure count reset stays in RAM only
+#define STATE_STATS_INTERVAL     300000  // Longest the lifetime totals stay in RAM only
+#define STATE_LOCKOUT_CHECKPOINT 60000   // Refresh the remaining lockout this often
+
+struct SecurityRecord {
+  uint32_t seq;
+  uint32_t failedAttempts;     // Consecutive failures
+  uint32_t lockoutRemaining;   // ms left when written, 0 = not locked out
+  uint32_t granted;            // Lifetime totals
+  uint32_t denied;
+  uint32_t crc;                // CRC-32 of everything above
+};
+
+// Two-slot storage for the record (NVS keys on the device)
+class RecordStore {
+public:
+  virtual ~RecordStore() {}
+  virtual bool readRecord(uint8_t slot, SecurityRecord &record) = 0;
+  virtual bool writeRecord(uint8_t slot, const SecurityRecord &record) = 0;
+};
+
+class SecurityState {
+private:
+  RecordStore &store;
+  uint32_t maxFailures;
+  uint32_t lockoutDuration;
+
+  SecurityRecord current;
+  bool lockedOut;
+  uint32_t lockoutStart;
+  uint32_t lockoutLength;      // May be shorter than lockoutDuration after a reboot
+  bool dirty;                  // Failure count differs from storage
+  uint32_t dirtySince;
+  bool statsDirty;             // Only the lifetime totals differ
+  uint32_t statsDirtySince;
+  uint32_t lastWrite;
+  uint32_t writes;
+
+  static uint32_t recordCrc(const SecurityRecord &record) {
+    return crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(SecurityRecord, crc));
+  }
+
+  bool loadSlot(uint8_t slot, SecurityRecord &record) {
+    return store.readRecord(slot, record) && record.crc == recordCrc(record);
+  }
+
+  void markDirty(uint32_t now) {
+    if (!dirty) dirtySince = now;
+    dirty = true;
+  }
+
+  void markStatsDirty(uint32_t now) {
+    if (!statsDirty) statsDirtySince = now;
+    statsDirty = true;
+  }
+
+public:
+  SecurityState(RecordStore &_store, uint32_t _maxFailures, uint32_t _lockoutDuration)
+    : store(_store), maxFailures(_maxFailures), lockoutDuration(_lockoutDuration),
+      lockedOut(false), lockoutStart(0), lockoutLength(0),
+      dirty(false), dirtySince(0), statsDirty(false), statsDirtySince(0), lastWrite(0), writes(0) {
+    memset(&current, 0, sizeof(current));
+  }
+
+  // Load the newest valid slot and resume any lockout it records
+  void begin(uint32_t now) {
+    SecurityRecord a, b;
+    bool validA = loadSlot(0, a);
+    bool validB = loadSlot(1, b);
+    if (validA && validB) {
+      current = (int32_t)(a.seq - b.seq) > 0 ? a : b;
+    } else if (validA) {
+      current = a;
+    } else if (validB) {
+      current = b;
+    } else {
+      memset(&current, 0, sizeof(current));
+    }
+
+    dirty = false;
+    statsDirty = false;
+    lastWrite = now;
+    lockedOut = current.lockoutRemaining > 0;
+    if (lockedOut) {
+      lockoutStart = now;
+      lockoutLength = current.lockoutRemaining < lockoutDuration ? current.lockoutRemaining : lockoutDuration;
+    }
+  }
+
+  // Count one finished authentication attempt
+  void recordAttempt(bool success, uint32_t now) {
+    if (success) {
+      current.granted++;
+      markStatsDirty(now);
+      if (current.failedAttempts != 0) {
+        current.failedAttempts = 0;
+        markDirty(now);
+      }
+      return;
+    }
+
+    // Failures are written through; the flush carries the totals along
+    current.denied++;
+    current.failedAttempts++;
+    if (!lockedOut && current.failedAttempts >= maxFailures) {
+      lockedOut = true;
+      lockoutStart = now;
+      lockoutLength = lockoutDuration;
+    }
+    flush(now);
+  }
+
+  void resetFailedAttempts(uint32_t now) {
+    if (current.failedAttempts == 0) return;
+    current.failedAttempts = 0;
+    markDirty(now);
+  }
+
+  // End an expired lockout and write back whatever is due
+  void update(uint32_t now) {
+    if (lockedOut && now - lockoutStart >= lockoutLength) {
+      lockedOut = false;
+      current.failedAttempts = 0;
+      flush(now);
+      return;
+    }
+    if (dirty && now - dirtySince >= STATE_FLUSH_DELAY) {
+      flush(now);
+    } else if (statsDirty && now - statsDirtySince >= STATE_STATS_INTERVAL) {
+      flush(now);
+    } else if (lockedOut && now - lastWrite >= STATE_LOCKOUT_CHECKPOINT) {
+      flush(now);
+    }
+  }
+
+  // Write the record to the older slot
+  bool flush(uint32_t now) {
+    SecurityRecord record = current;
+    record.seq = current.seq + 1;
+    record.lockoutRemaining = lockoutRemaining(now);
+    if (lockedOut && record.lockoutRemaining == 0) record.lockoutRemaining = 1;
+    record.crc = recordCrc(record);
+
+    writes++;
+    if (!store.writeRecord((uint8_t)(record.seq & 1), record)) return false;
+    current = record;
+    dirty = false;
+    statsDirty = false;
+    lastWrite = now;
+    return true;
+  }
+
+  bool isLockedOut() const { return lockedOut; }
+
+  uint32_t lockoutRemaining(uint32_t now) const {
+    if (!lockedOut) return 0;
+    uint32_t elapsed = now - lockoutStart;
+    return elapsed >= lockoutLength ? 0 : lockoutLength - elapsed;
+  }
+
+  uint32_t getFailedAttempts() const { return current.failedAttempts; }
+  uint32_t getGranted() const { return current.granted; }
+  uint32_t getDenied() const { return current.denied; }
+  uint32_t getWrites() const { return writes; }
+  bool isDirty() const { return dirty || statsDirty; }
+};
+
+#endif
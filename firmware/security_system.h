@@ -0,0 +1,817 @@
+#ifndef SECURITY_SYSTEM_H
+#define SECURITY_SYSTEM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "config.h"
+#include "hal.h"
+#include "auth_fsm.h"
+#include "access_event.h"
+#include "admin_command.h"
+#include "event_ring.h"
+#include "alloc_audit.h"
+#include "card_table.h"
+#include "tamper_detector.h"
+#include "latency_metrics.h"
+#include "boot_timeline.h"
+#include "power_scheduler.h"
+#include "flash_region.h"
+#include "storage_manager.h"
+#include "network_manager.h"
+#include "authentication_module.h"
+#include "reader_bank.h"
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+// ==================== MAIN SECURITY SYSTEM CLASS ====================
+class SecuritySystem : public AuthDriver {
+private:
+  // Board drivers
+  Gpio &gpio;
+  Clock &clock;
+  
+  // Stage latencies, shared with the components
+  Metrics metrics;
+  uint32_t cardArrivedAt;     // Card answer time (micros), for the end-to-end latency
+  uint32_t lastUpdateAt;      // Previous update() (micros), for the loop period
+  bool updatedBefore;         // lastUpdateAt holds a pass
+  uint32_t heapSampledAt;     // ms
+  
+  // Boot stage times; the finger and network stages finish on their own tasks
+  BootTimeline boot;
+  bool fingerBaudChecked;     // Negotiated sensor rate compared with the stored one
+  
+  // Sleep between passes, residency and wake latency
+  PowerScheduler power;
+  uint32_t networkWait;       // Until the inline network pass is due (host builds, ms)
+  
+  // System components
+  AuthenticationModule auth;
+  StorageManager storage;
+  NetworkManager network;
+  AuthStateMachine authFsm;
+  
+  // System state
+  bool lockState;
+  unsigned long unlockTime;
+  bool systemInitialized;
+  bool tiltAlarmActive;
+  unsigned long tiltAlarmStartTime;
+  unsigned long tiltAlarmBeepTime;
+  bool lockedOut;
+  
+  // Tilt sensor pulses, fed from the pin interrupt
+  TamperDetector tamperDetector;
+  
+  // Authorized cards (loaded from storage)
+  AuthorizedCards cards;
+  uint16_t boundFirstPage;    // Fingers bound to the card being authenticated
+  uint8_t boundPageCount;     // 0 = any enrolled finger
+  
+  // Bank build: several readers and relays in place of the single pair.
+  // Lanes added before init() switch it on.
+  ReaderBank bank;
+  uint32_t bankWait;          // Until a lane next needs a pass (ms)
+  
+  // Console commands from the admin task, and the one that is waiting on
+  // the hardware across passes
+  EventRing<AdminCommand, ADMIN_QUEUE_SIZE> adminQueue;
+  AdminCommand adminJob;
+  bool adminJobActive;
+  uint32_t adminJobStartedAt;
+  
+  // Buzzer pattern playback (alternating on/off durations, starting with on)
+  const uint16_t* buzzerSteps;
+  uint8_t buzzerStepCount;
+  uint8_t buzzerStep;
+  unsigned long buzzerStepTime;
+  
+  static void IRAM_ATTR onTiltEdge(void* arg) {
+    SecuritySystem* self = static_cast<SecuritySystem*>(arg);
+    self->tamperDetector.onEdge(self->clock.micros());
+  }
+  
+  void soundBuzzer(int pattern) {
+    static const uint16_t SUCCESS_STEPS[] = {100, 100, 100, 100};
+    static const uint16_t ERROR_STEPS[]   = {500};
+    static const uint16_t ALERT_STEPS[]   = {50, 50, 50, 50, 50, 50, 50, 50, 50, 50};
+    
+    switch (pattern) {
+      case 0: // Success
+        buzzerSteps = SUCCESS_STEPS;
+        buzzerStepCount = sizeof(SUCCESS_STEPS) / sizeof(SUCCESS_STEPS[0]);
+        break;
+      case 1: // Error
+        buzzerSteps = ERROR_STEPS;
+        buzzerStepCount = sizeof(ERROR_STEPS) / sizeof(ERROR_STEPS[0]);
+        break;
+      case 2: // Alert
+        buzzerSteps = ALERT_STEPS;
+        buzzerStepCount = sizeof(ALERT_STEPS) / sizeof(ALERT_STEPS[0]);
+        break;
+      default:
+        return;
+    }
+    buzzerStep = 0;
+    buzzerStepTime = clock.millis();
+    gpio.write(BUZZER_PIN, HIGH);
+  }
+  
+  // Advance the current buzzer pattern without blocking
+  void updateBuzzer() {
+    if (buzzerSteps == nullptr) return;
+    
+    if (clock.millis() - buzzerStepTime < buzzerSteps[buzzerStep]) return;
+    
+    buzzerStep++;
+    buzzerStepTime = clock.millis();
+    if (buzzerStep >= buzzerStepCount) {
+      gpio.write(BUZZER_PIN, LOW);
+      buzzerSteps = nullptr;
+      return;
+    }
+    gpio.write(BUZZER_PIN, (buzzerStep % 2 == 0) ? HIGH : LOW);
+  }
+  
+  // Heap gauges for the stats command. Taken here rather than on the admin
+  // task, since this task owns the metrics; host builds have no heap to read.
+  void sampleHeap() {
+#ifdef ARDUINO
+    if (clock.millis() - heapSampledAt < HEAP_SAMPLE_INTERVAL) return;
+    heapSampledAt = clock.millis();
+    metrics.sampleHeap(ESP.getFreeHeap(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+#endif
+  }
+  
+  // ms left of a period of length that started at since
+  static uint32_t remaining(uint32_t since, uint32_t length, uint32_t now) {
+    uint32_t elapsed = now - since;
+    return elapsed < length ? length - elapsed : 0;
+  }
+  
+  static void sooner(uint32_t &wait, uint32_t left) {
+    if (left < wait) wait = left;
+  }
+  
+  // Earliest time a pass has work without an interrupt (ms). Counter
+  // write-back and the end of a lockout wait up to POWER_IDLE_WAIT; the
+  // auto-lock deadline is met exactly.
+  uint32_t nextDeadline() {
+    uint32_t now = clock.millis();
+    uint32_t wait = POWER_IDLE_WAIT;
+    if (!systemInitialized || !fingerBaudChecked) wait = SECURITY_TICK;  // Sensor bring-up
+    // A card read or image waiting runs at once; finger polls pace the prompt blink
+    if (lockState && !lockedOut) sooner(wait, authFsm.nextStepIn(now));
+    if (!lockState) sooner(wait, remaining(unlockTime, UNLOCK_DURATION, now));
+    if (buzzerSteps != nullptr) sooner(wait, remaining(buzzerStepTime, buzzerSteps[buzzerStep], now));
+    if (tiltAlarmActive) {
+      sooner(wait, 250 - now % 250);  // LED blink
+      sooner(wait, remaining(tiltAlarmBeepTime, TILT_ALARM_REPEAT, now));
+      sooner(wait, remaining(tiltAlarmStartTime, TILT_ALARM_DURATION, now));
+    }
+    if (lockedOut) sooner(wait, 500 - now % 500);
+    if (usesBank()) sooner(wait, bankWait);
+    if (adminJobActive && adminJob.type == ADMIN_ENROLL) sooner(wait, FP_POLL_INTERVAL);
+    if (adminJobActive && adminJob.type == ADMIN_ADD_CARD) sooner(wait, remaining(adminJobStartedAt, ADD_CARD_TIMEOUT, now));
+    sooner(wait, networkWait);
+    return wait;
+  }
+  
+  void updateLEDs() {
+    // Update LEDs based on system state
+    if (authFsm.getState() == AUTH_REJECT) {
+      gpio.write(LED_ERROR, HIGH);
+      gpio.write(LED_SUCCESS, LOW);
+    } else if (authFsm.promptActive(clock.millis())) {
+      // Card accepted - blink success LED to ask for a finger
+      gpio.write(LED_SUCCESS, (authFsm.timeInState(clock.millis()) / 100) % 2 == 0 ? HIGH : LOW);
+    } else if (tiltAlarmActive) {
+      // Tilt alarm owns the error LED
+      gpio.write(LED_SUCCESS, lockState ? LOW : HIGH);
+    } else if (!lockState) {
+      gpio.write(LED_SUCCESS, HIGH);
+      gpio.write(LED_ERROR, LOW);
+    } else if (lockedOut) {
+      // System in lockout mode - blink error LED
+      if ((clock.millis() / 500) % 2 == 0) {
+        gpio.write(LED_ERROR, HIGH);
+      } else {
+        gpio.write(LED_ERROR, LOW);
+      }
+      gpio.write(LED_SUCCESS, LOW);
+    } else {
+      gpio.write(LED_SUCCESS, LOW);
+      gpio.write(LED_ERROR, LOW);
+    }
+  }
+  
+  bool usesBank() const {
+    return bank.getLaneCount() > 0;
+  }
+  
+  // A decision on one of the bank's lanes counts toward the lockout and is
+  // logged like one on the single reader
+  static void onBankAccess(void* context, uint8_t lane, bool granted, const uint8_t uid[], uint8_t uidSize,
+                           uint16_t fingerprintId) {
+    (void)lane;
+    SecuritySystem* self = static_cast<SecuritySystem*>(context);
+    self->storage.logAccessAttempt(granted);
+    self->soundBuzzer(granted ? 0 : 1);
+    if (granted) {
+      self->network.enqueueAccess(AccessEvent::access(self->clock.millis(), uid, uidSize, true, fingerprintId));
+    }
+  }
+  
+  // Bank counterpart of the lockout check and checkAuthentication(). A
+  // lockout holds every lane; so does a console job, once no attempt is
+  // running, since it needs reader 0 or the sensor. Each lane drives its
+  // own relay.
+  void updateBank() {
+    bool locked = storage.isLockedOut();
+    if (locked && !lockedOut) {
+      Serial.println("Too many failed attempts! System locked for security.");
+      soundBuzzer(1);
+    } else if (!locked && lockedOut) {
+      Serial.println("System lockout period ended");
+    }
+    lockedOut = locked;
+    bank.setSuspended(lockedOut || (adminJobActive && (bank.isSuspended() || bank.isIdle())));
+    uint32_t slotWait = bank.poll();
+    bankWait = bank.update();
+    sooner(bankWait, slotWait);
+  }
+  
+  // The console job's card: the single reader, or reader 0 of a held bank
+  bool adminCardPresent() {
+    if (!usesBank()) return auth.isRfidCardPresent();
+    return bank.isSuspended() && bank.getReader(0).cardPresent();
+  }
+  
+public:
+  SecuritySystem(Gpio &_gpio, Clock &_clock, KeyValueStore &preferences, CardReader &reader,
+                 FingerprintSensor &finger, NetTransport &net, FlashRegion &outboxFlash)
+                   : gpio(_gpio), clock(_clock), cardArrivedAt(0), lastUpdateAt(0), updatedBefore(false), heapSampledAt(0),
+                     fingerBaudChecked(false), power(POWER_PROFILE), networkWait(0), auth(reader, finger, clock, metrics, boot),
+                     storage(preferences, clock), network(net, outboxFlash, storage, clock, metrics, boot),
+                     authFsm(*this, FP_SCAN_TIMEOUT),
+                     lockState(true), unlockTime(0), systemInitialized(false), 
+                     tiltAlarmActive(false), tiltAlarmStartTime(0), tiltAlarmBeepTime(0), lockedOut(false),
+                     boundFirstPage(CARD_ANY_FINGER), boundPageCount(0), bank(_gpio, _clock, finger, cards),
+                     bankWait(UINT32_MAX), adminJobActive(false), adminJobStartedAt(0),
+                     buzzerSteps(nullptr), buzzerStepCount(0), buzzerStep(0), buzzerStepTime(0) {
+    adminJob = AdminCommand::make(ADMIN_ADD_CARD);
+  }
+  
+  // Power profile (power_scheduler.h), POWER_PROFILE unless set before init()
+  void setPowerProfile(uint8_t profileId) {
+    power.setProfile(profileId);
+  }
+  
+  // Bank build: a reader and its door relay, added in order before
+  // enterSafeState() and init(). The first is the bank's reader 0.
+  bool addBankReader(CardReader &reader, uint8_t relayPin) {
+    return !systemInitialized && bank.addLane(reader, relayPin);
+  }
+  
+  // Relay locked and outputs off. Called first thing at power-on, before
+  // the console, so the relay never floats into its energized state.
+  void enterSafeState() {
+    gpio.mode(RELAY_PIN, OUTPUT);
+    gpio.write(RELAY_PIN, HIGH);
+    for (uint8_t i = 0; i < bank.getLaneCount(); i++) {
+      gpio.mode(bank.getLane(i).getRelayPin(), OUTPUT);
+      gpio.write(bank.getLane(i).getRelayPin(), HIGH);
+    }
+    gpio.mode(TILT_PIN, INPUT_PULLUP);
+    gpio.mode(LED_SUCCESS, OUTPUT);
+    gpio.mode(LED_ERROR, OUTPUT);
+    gpio.mode(BUZZER_PIN, OUTPUT);
+    gpio.write(LED_SUCCESS, LOW);
+    gpio.write(LED_ERROR, LOW);
+    gpio.write(BUZZER_PIN, LOW);
+  }
+  
+  // Staged boot: safe state, storage and the RFID reader in order, then the
+  // ready signal. The fingerprint sensor and the network come up on their
+  // own tasks afterwards, so nothing here sleeps.
+  bool init() {
+    boot.start(BOOT_SAFE_STATE, clock.micros());
+    enterSafeState();
+    boot.finish(BOOT_SAFE_STATE, clock.micros(), true);
+    
+    boot.start(BOOT_STORAGE, clock.micros());
+    // Load credentials or use defaults
+    NetworkCredentials credentials;
+    if (!storage.getNetworkCredentials(credentials)) {
+        // No credentials stored, use defaults
+        snprintf(credentials.ssid, sizeof(credentials.ssid), "%s", "Paul Zion SM-A9");
+        snprintf(credentials.password, sizeof(credentials.password), "%s", "whereiswisdom"); // Original password for testing
+        snprintf(credentials.serverUrl, sizeof(credentials.serverUrl), "%s", "http://192.168.43.230:3000");
+        
+        // Save for future use
+        storage.saveNetworkCredentials(credentials);
+    }
+    
+    // Restore attempt counters and lockout
+    storage.loadState();
+    
+    // Load authorized cards
+    if (!storage.loadCardTable(cards)) {
+      // No cards stored, use default
+      static const uint8_t DEFAULT_UID[] = {0x63, 0x5A, 0x59, 0x31};
+      cards.add(DEFAULT_UID, sizeof(DEFAULT_UID), CARD_ANY_FINGER);
+      
+      storage.saveCardTable(cards);
+    }
+    boot.finish(BOOT_STORAGE, clock.micros(), true);
+    Serial.print("Authorized cards: ");
+    Serial.println(cards.size());
+    
+    bool rfidReady;
+    if (usesBank()) {
+      bank.setAccessHandler(onBankAccess, this);
+      rfidReady = bank.begin(RFID_IRQ_PIN);
+    } else {
+      rfidReady = auth.initRfid();
+      auth.setRfidDutyCycle(power.getProfile().reqaInterval, power.getProfile().fieldSwitched);
+    }
+    if (!rfidReady) {
+      Serial.println("Authentication system initialization failed!");
+      // We'll continue anyway with limited functionality
+      Serial.println("Continuing with limited functionality");
+    }
+    
+    // Arm tamper detection last so power-up transients are not reported
+    tamperDetector.configure(TAMPER_THRESHOLD, TAMPER_WINDOW, TAMPER_DEBOUNCE, TAMPER_HOLDOFF);
+    gpio.attachInterrupt(TILT_PIN, onTiltEdge, this, RISING);
+    
+    // Cards are detected from here on; a finger is asked for once one is accepted
+    boot.markReady(clock.micros());
+    systemInitialized = true;
+    Serial.print("=== SYSTEM READY (");
+    Serial.print(boot.getReadyAt() / 1000);
+    Serial.println(" ms) ===");
+    
+    // Short beep to indicate system is ready, error sound without a reader
+    soundBuzzer(rfidReady ? 0 : 1);
+    
+    // Background stages (inline on host builds)
+    auth.startFinger(storage.getFingerBaud());
+    
+    // Initialize network (non-critical, can continue if fails)
+    network.setRadioPolicy(power.getProfile().radio);
+    if (!network.init(credentials)) {
+      Serial.println("Network initialization failed. System will run in offline mode.");
+      // Continue anyway - system can work offline
+    }
+    
+    checkFingerBoot();
+    return true;
+  }
+  
+  // Remember the sensor rate once its bring-up has settled
+  void checkFingerBoot() {
+    if (fingerBaudChecked || !auth.isFingerSettled()) return;
+    fingerBaudChecked = true;
+    if (auth.isFingerReady() && auth.getFingerBaud() != storage.getFingerBaud()) {
+      storage.saveFingerBaud(auth.getFingerBaud());
+    }
+  }
+  
+  // Run queued console commands. Enrolling a finger or a card becomes a
+  // job that waits on the user over later passes, one at a time.
+  void runAdminCommands() {
+    AdminCommand command;
+    while (adminQueue.pop(command)) {
+      switch (command.type) {
+        case ADMIN_ENROLL:
+        case ADMIN_ADD_CARD:
+          if (adminJobActive) {
+            Serial.println("Another command is waiting; cancel it first.");
+            break;
+          }
+          if (command.type == ADMIN_ENROLL && !auth.startEnrollment(command.fingerprintId, command.fingerCount)) {
+            Serial.println("Failed to enroll fingerprint.");
+            break;
+          }
+          if (command.type == ADMIN_ADD_CARD) Serial.println("Place new RFID card to enroll...");
+          adminJob = command;
+          adminJobActive = true;
+          adminJobStartedAt = clock.millis();
+          break;
+        case ADMIN_CANCEL:
+          if (adminJobActive) {
+            if (adminJob.type == ADMIN_ENROLL) auth.cancelEnrollment();
+            adminJobActive = false;
+            Serial.println("Cancelled.");
+          } else {
+            Serial.println("Nothing to cancel.");
+          }
+          break;
+        case ADMIN_LIST_CARDS:
+          printCards();
+          break;
+        case ADMIN_LOCK:
+          lockSystem();
+          Serial.println("System manually locked.");
+          break;
+        case ADMIN_STATUS:
+          Serial.println("System Status:");
+          Serial.println("-------------");
+          network.printLinkStatus();
+          auth.getEnrollJob().printProgress(clock.millis());
+          printLogStats();
+          break;
+        case ADMIN_STATS:
+          printMetrics(false);
+          break;
+        case ADMIN_STATS_JSON:
+          printMetrics(true);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  
+  // One step of the console job. Never waits.
+  void serviceAdminJob() {
+    if (!adminJobActive) return;
+    if (adminJob.type == ADMIN_ENROLL) {
+      // The sensor is shared: an attempt in progress finishes first
+      if (usesBank() ? !bank.isSuspended() : authFsm.getState() != AUTH_IDLE) return;
+      EnrollOutcome outcome = auth.serviceEnrollment();
+      if (outcome == ENROLL_PENDING) return;
+      adminJobActive = false;
+      Serial.println(outcome == ENROLL_DONE ? "Fingerprint enrolled successfully!" : "Failed to enroll fingerprint.");
+      return;
+    }
+    
+    // Add card: take the card if one answered, else check the timeout
+    bool added = false;
+    if (adminCardPresent()) {
+      added = addNewRfidCard(adminJob.fingerprintId, adminJob.fingerCount);
+    } else if (clock.millis() - adminJobStartedAt >= ADD_CARD_TIMEOUT) {
+      Serial.println("RFID enrollment timed out.");
+    } else {
+      return;
+    }
+    adminJobActive = false;
+    Serial.println(added ? "RFID card added successfully!" : "Failed to add RFID card.");
+  }
+  
+  void update() {
+#ifdef METRICS_ENABLED
+    uint32_t now = clock.micros();
+    if (updatedBefore) metrics.record(METRIC_LOOP_PERIOD, now - lastUpdateAt);
+    lastUpdateAt = now;
+    updatedBefore = true;
+    sampleHeap();
+#endif
+    power.wake(clock.micros());
+    checkFingerBoot();
+    storage.updateState();
+    networkWait = network.poll();
+    runAdminCommands();
+    serviceAdminJob();
+    
+    if (usesBank()) {
+      updateBank();
+      checkTiltSensor();
+      updateLEDs();
+      updateBuzzer();
+      return;
+    }
+    
+    // Check tilt sensor (always active, a lockout included)
+    checkTiltSensor();
+    
+    // Then for system lockout
+    if (lockedOut) {
+      if (!storage.isLockedOut()) {
+        Serial.println("System lockout period ended");
+        lockedOut = false;
+      } else {
+        // System is in lockout mode, don't process authentication
+        updateLEDs();
+        updateBuzzer();
+        return;
+      }
+    }
+    
+    // Handle auto-locking based on timer
+    if (!lockState && clock.millis() - unlockTime >= UNLOCK_DURATION) {
+      lockSystem();
+    }
+    
+    // Check for authentication attempts
+    checkAuthentication();
+    
+    // Update LEDs based on system state
+    updateLEDs();
+    updateBuzzer();
+  }
+  
+  // How long the security task may block before its next pass (ms), and
+  // the start of that sleep. Always on ticks every SECURITY_TICK; duty
+  // cycled sleeps to the earliest deadline. Interrupts end it early.
+  uint32_t planSleep() {
+    uint32_t wait = power.getProfile().lightSleep ? nextDeadline() : SECURITY_TICK;
+    power.sleep(clock.micros(), wait);
+    return wait;
+  }
+  
+  // AuthDriver - bounded hardware steps for the authentication state machine
+  bool cardPresent() override {
+    if (!auth.isRfidCardPresent()) return false;
+    cardArrivedAt = clock.micros() - auth.getDetectLatency();
+    power.noteWake(WAKE_CARD, cardArrivedAt, clock.micros());
+    return true;
+  }
+  
+  // A card left on the reader answers every detection window when the
+  // field is switched; it is no new attempt until it has been taken away
+  bool readCard(uint8_t uid[], uint8_t &size) override {
+    return auth.readRfidCard(uid, size) && !auth.isCardResting();
+  }
+  
+  bool cardAuthorized(const uint8_t uid[], uint8_t size) override {
+    METRIC_START(clock, start);
+    const CardRecord* card = cards.find(uid, size);
+    METRIC_STOP(metrics, METRIC_UID_LOOKUP, clock, start);
+    if (card == nullptr || !(card->flags & CARD_FLAG_ENABLED)) {
+      Serial.println("RFID mismatch");
+      return false;
+    }
+    
+    Serial.println("RFID match");
+    boundFirstPage = card->fingerprintId;
+    boundPageCount = card->fingerprintCount;
+    return true;
+  }
+  
+  FpResult captureImage() override {
+    return auth.captureImage();
+  }
+  
+  FpResult convertImage() override {
+    return auth.convertImage();
+  }
+  
+  bool fingerTouched() override {
+    return auth.takeFingerTouch();
+  }
+  
+  FpResult searchFinger(uint16_t &fingerprintId) override {
+    FpResult result = auth.searchFinger(fingerprintId, boundFirstPage, boundPageCount);
+    if (result == FP_OK && boundPageCount > 0 &&
+        (fingerprintId < boundFirstPage || fingerprintId - boundFirstPage >= boundPageCount)) {
+      Serial.println("Fingerprint is not bound to this card");
+      return FP_NO_MATCH;
+    }
+    return result;
+  }
+  
+  void checkAuthentication() {
+    // Only proceed with authentication if currently locked
+    if (!lockState) return;
+    
+    // The reader or sensor belongs to the console job while it runs
+    if (adminJobActive && authFsm.getState() == AUTH_IDLE) return;
+    
+    // Check for too many failed attempts
+    if (storage.isLockedOut()) {
+      if (!lockedOut) {  // Only announce the lockout once
+        Serial.println("Too many failed attempts! System locked for security.");
+        lockedOut = true;
+        authFsm.reset(clock.millis());
+        soundBuzzer(1);  // Error sound
+      }
+      return;
+    }
+    
+    // Advance the authentication state machine by one bounded step
+    AuthState previous = authFsm.getState();
+    AuthOutcome outcome;
+    {
+      ALLOC_FREE_SCOPE();
+      outcome = authFsm.update(clock.millis());
+    }
+    
+    if (previous == AUTH_CARD_READ && authFsm.getState() == AUTH_AWAIT_FINGER) {
+      Serial.println("RFID match. Please place finger...");
+      Serial.println("Waiting for fingerprint...");
+    }
+    
+    switch (outcome) {
+      case AUTH_GRANTED:
+        // Both authentication succeeded
+        storage.logAccessAttempt(true);
+        unlockSystem(authFsm.getFingerprintId());
+        break;
+      case AUTH_CARD_REJECTED:
+      case AUTH_FINGER_REJECTED:
+        // Failed authentication - error LED is held by the reject state
+        if (outcome == AUTH_FINGER_REJECTED && previous == AUTH_AWAIT_FINGER) {
+          Serial.println("Fingerprint scan timeout");
+        }
+        storage.logAccessAttempt(false);
+        soundBuzzer(1);  // Error sound
+        break;
+      default:
+        break;
+    }
+  }
+  
+  void unlockSystem(uint16_t fingerprintId) {
+    METRIC_START(clock, start);
+    gpio.write(RELAY_PIN, LOW);  // LOW = energize relay (unlock)
+    METRIC_STOP(metrics, METRIC_RELAY, clock, start);
+    METRIC_STOP(metrics, METRIC_END_TO_END, clock, cardArrivedAt);
+    Serial.println("Authentication successful. Unlocking...");
+    lockState = false;
+    unlockTime = clock.millis();
+    
+    // Visual and audio feedback
+    gpio.write(LED_SUCCESS, HIGH);
+    soundBuzzer(0);  // Success sound
+    
+    // Log to blockchain (async - handed to the network task)
+    network.enqueueAccess(AccessEvent::access(clock.millis(), authFsm.getCardUID(),
+                                              authFsm.getCardUIDSize(), true, fingerprintId));
+  }
+  
+  void lockSystem() {
+    if (!lockState) {  // Only lock if currently unlocked
+      gpio.write(RELAY_PIN, HIGH);  // HIGH = de-energize relay (lock)
+      lockState = true;
+      authFsm.reset(clock.millis());
+      gpio.write(LED_SUCCESS, LOW);
+      Serial.println("System locked.");
+    }
+  }
+  
+  void checkTiltSensor() {
+    // Pulses are counted by the pin interrupt; only raised events arrive here
+    TamperEvent event;
+    while (tamperDetector.poll(event)) {
+      Serial.print("[ALERT] Unauthorized Access Attempt Detected! (");
+      Serial.print(event.pulses);
+      Serial.println(" pulses)");
+      
+      power.noteWake(WAKE_TAMPER, event.timestampUs, clock.micros());
+      
+      // Start alarm
+      tiltAlarmActive = true;
+      tiltAlarmStartTime = clock.millis();
+      tiltAlarmBeepTime = tiltAlarmStartTime;
+      
+      // Visual and audio feedback
+      gpio.write(LED_ERROR, HIGH);
+      soundBuzzer(2);  // Alert sound
+      
+      // Log tampering attempt to blockchain, stamped with the edge time
+      uint32_t age = (uint32_t)(clock.micros() - event.timestampUs) / 1000;
+      network.enqueueAccess(AccessEvent::tamper(clock.millis() - age));
+    }
+    
+    // Handle active alarm
+    if (tiltAlarmActive) {
+      // Blink error LED and sound alarm periodically
+      if ((clock.millis() / 250) % 2 == 0) {
+        gpio.write(LED_ERROR, HIGH);
+      } else {
+        gpio.write(LED_ERROR, LOW);
+      }
+      
+      // Sound alarm every TILT_ALARM_REPEAT, on a fixed schedule
+      if (clock.millis() - tiltAlarmBeepTime >= TILT_ALARM_REPEAT) {
+        tiltAlarmBeepTime += TILT_ALARM_REPEAT;
+        soundBuzzer(2);
+      }
+      
+      // Automatically stop alarm after set duration
+      if (clock.millis() - tiltAlarmStartTime >= TILT_ALARM_DURATION) {
+        tiltAlarmActive = false;
+        gpio.write(LED_ERROR, LOW);
+      }
+    }
+  }
+  
+  // Admin task side: queue a console command for the next security pass.
+  // False when the queue is full.
+  bool submitCommand(const AdminCommand &command) {
+    return adminQueue.push(command);
+  }
+  
+  void printLogStats() {
+    storage.printStateStats();
+    if (usesBank()) {
+      bank.printStats();
+    } else {
+      auth.printRfidStats();
+    }
+    auth.printFingerStats();
+    Serial.print("Tamper: ");
+    Serial.print(tamperDetector.getEdges());
+    Serial.print(" edges, ");
+    Serial.print(tamperDetector.getBounces());
+    Serial.print(" debounced, ");
+    Serial.print(tamperDetector.getTriggers());
+    Serial.println(" alarms");
+    network.printLogStats();
+    power.printReport((uint64_t)network.getRadioOnTime() * 1000);
+  }
+  
+#ifdef ARDUINO
+  TaskHandle_t getNetworkTaskHandle() const {
+    return network.getTaskHandle();
+  }
+#endif
+  
+  const Metrics &getMetrics() const {
+    return metrics;
+  }
+  
+  const BootTimeline &getBootTimeline() const {
+    return boot;
+  }
+  
+  const PowerScheduler &getPowerScheduler() const {
+    return power;
+  }
+  
+  // Wi-Fi associated or trying to be, since boot (ms)
+  uint32_t getRadioOnTime() const {
+    return network.getRadioOnTime();
+  }
+  
+  // Estimated average supply current since boot (uA)
+  uint32_t estimateCurrent() const {
+    return power.estimateCurrent((uint64_t)network.getRadioOnTime() * 1000);
+  }
+  
+  void printMetrics(bool json) {
+    if (json) {
+      metrics.printJson(clock.millis());
+    } else {
+      metrics.printTable();
+      boot.printTable();
+    }
+  }
+  
+  // Admin function to store the card in the field, optionally bound to
+  // fingerCount fingers from fingerprintId
+  bool addNewRfidCard(uint16_t fingerprintId, uint8_t fingerCount) {
+    uint8_t newUID[10];
+    uint8_t uidSize;
+    bool read = usesBank() ? bank.getReader(0).readCard(newUID, uidSize) : auth.readRfidCard(newUID, uidSize);
+    if (!read) {
+      Serial.println("Card left before it could be read.");
+      return false;
+    }
+    if (!cards.add(newUID, uidSize, fingerprintId)) {
+      Serial.println("Card table full or unsupported UID size.");
+      return false;
+    }
+    cards.bindFingers(newUID, uidSize, fingerprintId, fingerCount);
+    // Save to storage
+    storage.saveCardTable(cards);
+    Serial.println("New RFID card enrolled successfully!");
+    return true;
+  }
+  
+  bool isAdminJobActive() const {
+    return adminJobActive;
+  }
+  
+  void printCards() {
+    Serial.print("Authorized cards: ");
+    Serial.print(cards.size());
+    Serial.print("/");
+    Serial.println(cards.capacity());
+    for (uint16_t i = 0; i < cards.size(); i++) {
+      const CardRecord &card = cards.at(i);
+      Serial.print("  ");
+      for (uint8_t j = 0; j < card.uidSize; j++) {
+        if (j > 0) Serial.print(":");
+        Serial.printf("%02X", card.uid[j]);
+      }
+      Serial.print("  finger ");
+      if (card.fingerprintCount == 0) {
+        Serial.print("any");
+      } else {
+        Serial.print(card.fingerprintId);
+        if (card.fingerprintCount > 1) {
+          Serial.print("-");
+          Serial.print(card.fingerprintId + card.fingerprintCount - 1);
+        }
+      }
+      Serial.println((card.flags & CARD_FLAG_ENABLED) ? "" : "  (disabled)");
+    }
+  }
+};
+
+#endif
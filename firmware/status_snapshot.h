@@ -0,0 +1,47 @@
+#ifndef STATUS_SNAPSHOT_H
+#define STATUS_SNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+// ==================== STATUS SNAPSHOT ====================
+// One writer publishes a copy of its state; readers on another task take a
+// consistent copy without locking the writer out. The sequence number is odd
+// while a publish is in progress, and a read that saw it change is retried.
+// The writer never waits. A reader spins only for the length of one copy,
+// so it must not be able to preempt the writer (here they run on different
+// cores).
+template <typename T>
+class StatusSnapshot {
+private:
+  T value;
+  std::atomic<uint32_t> seq;   // 2 x publishes, +1 while one is in progress
+
+public:
+  StatusSnapshot() : value(), seq(0) {}
+
+  // Writer side
+  void publish(const T &next) {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value = next;
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  // Reader side. False until the first publish.
+  bool read(T &out) const {
+    for (;;) {
+      uint32_t before = seq.load(std::memory_order_acquire);
+      if (before == 0) return false;
+      if (before & 1) continue;
+      out = value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq.load(std::memory_order_relaxed) == before) return true;
+    }
+  }
+
+  uint32_t getPublished() const { return seq.load(std::memory_order_relaxed) / 2; }
+};
+
+#endif
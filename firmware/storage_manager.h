@@ -0,0 +1,175 @@
+#ifndef STORAGE_MANAGER_H
+#define STORAGE_MANAGER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "config.h"
+#include "hal.h"
+#include "card_table.h"
+#include "security_state.h"
+#include "event_chain.h"
+
+typedef CardTable<CARD_TABLE_CAPACITY> AuthorizedCards;
+
+// NVS keeps one page free for compaction, stores 4032 data bytes per 4 KiB
+// page, and needs room for the old and the new table while one is rewritten
+static_assert(2 * (sizeof(CardTableHeader) + CARD_TABLE_CAPACITY * sizeof(CardRecord)) +
+              NVS_RESERVED_BYTES <= (NVS_PARTITION_SIZE / 4096 - 1) * 4032,
+              "card table does not fit the nvs partition twice");
+
+// Wi-Fi and gateway settings, NUL-terminated
+struct NetworkCredentials {
+  char ssid[33];        // 802.11 SSIDs are at most 32 bytes
+  char password[65];    // WPA2 passphrase or 64-digit PSK
+  char serverUrl[96];
+  uint32_t deviceId;    // Band identifier in on-chain records
+};
+
+// ==================== STORAGE MANAGER CLASS ====================
+class StorageManager : public RecordStore {
+private:
+  KeyValueStore &preferences;   // "security" namespace
+  Clock &clock;
+  
+  // Attempt counters and lockout, cached in RAM
+  SecurityState state;
+  
+public:
+  StorageManager(KeyValueStore &_preferences, Clock &_clock)
+    : preferences(_preferences), clock(_clock), state(*this, MAX_FAILED_ATTEMPTS, LOCKOUT_DURATION) {}
+  
+  // Securely save network credentials
+  void saveNetworkCredentials(const NetworkCredentials &credentials) {
+    preferences.putString("wifi_ssid", credentials.ssid);
+    preferences.putString("wifi_pass", credentials.password);
+    preferences.putString("server_url", credentials.serverUrl);
+    preferences.putUInt("device_id", credentials.deviceId);
+  }
+  
+  // Get network credentials
+  bool getNetworkCredentials(NetworkCredentials &credentials) {
+    size_t ssid = preferences.getString("wifi_ssid", credentials.ssid, sizeof(credentials.ssid));
+    size_t password = preferences.getString("wifi_pass", credentials.password, sizeof(credentials.password));
+    size_t serverUrl = preferences.getString("server_url", credentials.serverUrl, sizeof(credentials.serverUrl));
+    credentials.deviceId = preferences.getUInt("device_id", DEVICE_ID_DEFAULT);
+    
+    return (ssid > 1 && password > 1 && serverUrl > 1);
+  }
+  
+  // Load the authorized card table; false if none is stored
+  bool loadCardTable(AuthorizedCards &cards) {
+    size_t length = preferences.isKey("card_table") ? preferences.getBytesLength("card_table") : 0;
+    if (length > 0 && length <= cards.blobCapacity() &&
+        preferences.getBytes("card_table", cards.blobData(), length) == length &&
+        cards.accept(length)) {
+      return true;
+    }
+    cards.clear();
+    return migrateLegacyUIDs(cards);
+  }
+  
+  // Store the whole table as one blob
+  bool saveCardTable(AuthorizedCards &cards) {
+    size_t length = cards.seal();
+    return preferences.putBytes("card_table", cards.blobData(), length) == length;
+  }
+  
+  // Older firmware kept one key per UID plus a single "uid_size" shared by
+  // all of them. Take each UID's size from its own stored length instead.
+  bool migrateLegacyUIDs(AuthorizedCards &cards) {
+    for (uint8_t index = 0; index < LEGACY_UID_SLOTS; index++) {
+      char keyName[20];
+      sprintf(keyName, "auth_uid_%d", index);
+      uint8_t uid[CARD_UID_MAX];
+      size_t size = preferences.isKey(keyName) ? preferences.getBytesLength(keyName) : 0;
+      if (isValidUidSize(size) && preferences.getBytes(keyName, uid, size) == size) {
+        cards.add(uid, (uint8_t)size, CARD_ANY_FINGER);
+      }
+    }
+    if (cards.size() == 0 || !saveCardTable(cards)) return cards.size() > 0;
+    
+    for (uint8_t index = 0; index < LEGACY_UID_SLOTS; index++) {
+      char keyName[20];
+      sprintf(keyName, "auth_uid_%d", index);
+      preferences.remove(keyName);
+    }
+    preferences.remove("uid_size");
+    return true;
+  }
+  
+  // RecordStore - the security state alternates between two keys
+  bool readRecord(uint8_t slot, SecurityRecord &record) override {
+    const char* key = slot == 0 ? "state_a" : "state_b";
+    return preferences.getBytes(key, &record, sizeof(record)) == sizeof(record);
+  }
+  
+  bool writeRecord(uint8_t slot, const SecurityRecord &record) override {
+    const char* key = slot == 0 ? "state_a" : "state_b";
+    return preferences.putBytes(key, &record, sizeof(record)) == sizeof(record);
+  }
+  
+  // Event chain position, written by the network task once per anchor
+  // window; false if none is stored yet
+  bool loadChainCheckpoint(ChainCheckpoint &checkpoint) {
+    return preferences.getBytes("chain", &checkpoint, sizeof(checkpoint)) == sizeof(checkpoint);
+  }
+  
+  bool saveChainCheckpoint(const ChainCheckpoint &checkpoint) {
+    return preferences.putBytes("chain", &checkpoint, sizeof(checkpoint)) == sizeof(checkpoint);
+  }
+  
+  // Fingerprint sensor baud rate that worked last time
+  uint32_t getFingerBaud() {
+    return preferences.getUInt("fp_baud", FP_BAUD_DEFAULT);
+  }
+  
+  void saveFingerBaud(uint32_t baud) {
+    preferences.putUInt("fp_baud", baud);
+  }
+  
+  // Load counters and any lockout that was running before a reboot
+  void loadState() {
+    state.begin(clock.millis());
+  }
+  
+  // Write back counter changes that are due; call every loop
+  void updateState() {
+    state.update(clock.millis());
+  }
+  
+  // Access attempt logging: a failure is written through before this
+  // returns, so a reboot cannot forgive it; the rest is written back later
+  void logAccessAttempt(bool success) {
+    state.recordAttempt(success, clock.millis());
+  }
+  
+  uint32_t getFailedAttempts() {
+    return state.getFailedAttempts();
+  }
+  
+  void resetFailedAttempts() {
+    state.resetFailedAttempts(clock.millis());
+  }
+  
+  bool isLockedOut() {
+    return state.isLockedOut();
+  }
+  
+  void printStateStats() {
+    Serial.print("Failed attempts: ");
+    Serial.print(state.getFailedAttempts());
+    Serial.print("  granted ");
+    Serial.print(state.getGranted());
+    Serial.print("  denied ");
+    Serial.println(state.getDenied());
+    if (state.isLockedOut()) {
+      Serial.print("Lockout remaining: ");
+      Serial.print(state.lockoutRemaining(clock.millis()) / 1000);
+      Serial.println(" s");
+    }
+    Serial.print("State writes: ");
+    Serial.println(state.getWrites());
+  }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef TAMPER_DETECTOR_H
+#define TAMPER_DETECTOR_H
+
+#include <stdint.h>
+#include <string.h>
+#include "event_ring.h"
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// ==================== TAMPER DETECTOR ====================
+// Vibration/tilt detection fed from the sensor pin's edge interrupt. Each
+// rising edge is one pulse; edges closer together than the debounce time
+// are contact bounce and ignored. Pulses are counted in a sliding window
+// made of TAMPER_BUCKETS time buckets, and once the count reaches the
+// threshold a timestamped event is queued for the main loop. After a
+// trigger the detector holds off, so one shake raises one event.
+//
+// onEdge() runs in interrupt context and is O(TAMPER_BUCKETS); poll() runs
+// in the main loop. Timestamps are microseconds and may wrap.
+
+#define TAMPER_BUCKETS      8
+#define TAMPER_QUEUE_SIZE   8
+
+struct TamperEvent {
+  uint32_t timestampUs;  // Edge that crossed the threshold
+  uint16_t pulses;       // Pulses in the window at that moment
+  uint16_t reserved;
+};
+
+class TamperDetector {
+private:
+  // Configuration
+  volatile uint16_t threshold;   // Pulses per window that raise an event
+  volatile uint32_t bucketUs;    // Window length / TAMPER_BUCKETS
+  volatile uint32_t debounceUs;
+  volatile uint32_t holdoffUs;
+
+  // Sliding window
+  uint16_t bucketCount[TAMPER_BUCKETS];
+  uint32_t bucketStart;          // Start time of the current bucket
+  uint8_t bucket;                // Current bucket index
+  uint32_t lastEdge;
+  uint32_t lastTrigger;
+  bool seenEdge;
+  bool triggered;
+
+  EventRing<TamperEvent, TAMPER_QUEUE_SIZE> events;
+
+  // Counters
+  volatile uint32_t edges;
+  volatile uint32_t bounces;
+  volatile uint32_t triggers;
+
+public:
+  TamperDetector() : threshold(1), bucketUs(1), debounceUs(0), holdoffUs(0),
+                     edges(0), bounces(0), triggers(0) {
+    reset();
+  }
+
+  // threshold pulses within windowMs raise an event; edges closer than
+  // debounceMs are ignored; no further event for holdoffMs after one
+  void configure(uint16_t _threshold, uint32_t windowMs, uint32_t debounceMs, uint32_t holdoffMs) {
+    threshold = _threshold > 0 ? _threshold : 1;
+    bucketUs = windowMs * 1000 / TAMPER_BUCKETS > 0 ? windowMs * 1000 / TAMPER_BUCKETS : 1;
+    debounceUs = debounceMs * 1000;
+    holdoffUs = holdoffMs * 1000;
+    reset();
+  }
+
+  void reset() {
+    memset(bucketCount, 0, sizeof(bucketCount));
+    bucketStart = 0;
+    bucket = 0;
+    lastEdge = 0;
+    lastTrigger = 0;
+    seenEdge = false;
+    triggered = false;
+  }
+
+  // Interrupt handler body: one rising edge at nowUs. True if an event was queued.
+  bool IRAM_ATTR onEdge(uint32_t nowUs) {
+    edges++;
+    if (seenEdge && nowUs - lastEdge < debounceUs) {
+      bounces++;
+      return false;
+    }
+    seenEdge = true;
+    lastEdge = nowUs;
+
+    // Advance the window by elapsed time (wrap-safe), clearing buckets that slid out
+    uint32_t steps = (nowUs - bucketStart) / bucketUs;
+    if (steps >= TAMPER_BUCKETS) {
+      memset(bucketCount, 0, sizeof(bucketCount));
+      bucketStart = nowUs - (nowUs - bucketStart) % bucketUs;
+    } else {
+      for (uint32_t i = 0; i < steps; i++) {
+        bucket = (uint8_t)((bucket + 1) % TAMPER_BUCKETS);
+        bucketCount[bucket] = 0;
+      }
+      bucketStart += steps * bucketUs;
+    }
+    if (bucketCount[bucket] < 0xFFFF) bucketCount[bucket]++;
+
+    uint32_t pulses = 0;
+    for (uint32_t i = 0; i < TAMPER_BUCKETS; i++) {
+      pulses += bucketCount[i];
+    }
+
+    if (pulses < threshold) return false;
+    if (triggered && nowUs - lastTrigger < holdoffUs) return false;
+
+    triggered = true;
+    lastTrigger = nowUs;
+    triggers++;
+    TamperEvent event = {nowUs, (uint16_t)(pulses < 0xFFFF ? pulses : 0xFFFF), 0};
+    return events.push(event);
+  }
+
+  // Main loop side
+  bool poll(TamperEvent &event) {
+    return events.pop(event);
+  }
+
+  uint32_t getEdges() const { return edges; }
+  uint32_t getBounces() const { return bounces; }
+  uint32_t getTriggers() const { return triggers; }
+  uint32_t getDropped() const { return events.getDropped(); }
+};
+
+#endif
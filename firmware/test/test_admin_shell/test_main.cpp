@@ -0,0 +1,132 @@
+#include <unity.h>
+#include <string>
+#include "admin_shell.h"
+
+// Records the last call made through the table
+struct Calls {
+  int count;
+  std::string words;
+};
+
+static void record(void* context, uint8_t argc, char* argv[]) {
+  Calls* calls = static_cast<Calls*>(context);
+  calls->count++;
+  calls->words.clear();
+  for (uint8_t i = 0; i < argc; i++) {
+    if (i > 0) calls->words += "|";
+    calls->words += argv[i];
+  }
+}
+
+static const ShellCommand COMMANDS[] = {
+  {"enroll",  "<id>",         "Enroll",   1, 1, record},
+  {"addcard", "[id [count]]", "Add card", 0, 2, record},
+  {"lock",    "",             "Lock",     0, 0, record}
+};
+
+struct Console {
+  Calls calls;
+  AdminShell shell;
+
+  Console() : shell(COMMANDS, sizeof(COMMANDS) / sizeof(COMMANDS[0]), &calls) {
+    calls.count = 0;
+  }
+
+  void type(const char* text) {
+    while (*text != '\0') shell.feed(*text++);
+  }
+};
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_arguments_come_inline(void) {
+  Console console;
+  console.type("enroll 12\n");
+  TEST_ASSERT_EQUAL_INT(1, console.calls.count);
+  TEST_ASSERT_EQUAL_STRING("enroll|12", console.calls.words.c_str());
+
+  console.type("  addcard\t3   2 \r\n");
+  TEST_ASSERT_EQUAL_INT(2, console.calls.count);
+  TEST_ASSERT_EQUAL_STRING("addcard|3|2", console.calls.words.c_str());
+  TEST_ASSERT_EQUAL_UINT32(2, console.shell.getLines());
+}
+
+void test_partial_lines_wait_for_their_end(void) {
+  Console console;
+  console.type("lo");
+  TEST_ASSERT_EQUAL_INT(0, console.calls.count);
+  TEST_ASSERT_EQUAL_UINT8(2, console.shell.pending());
+  console.type("ck");
+  console.type("\r");
+  TEST_ASSERT_EQUAL_INT(1, console.calls.count);
+  console.type("\n\n");   // Rest of a CRLF, then a blank line
+  TEST_ASSERT_EQUAL_INT(1, console.calls.count);
+  TEST_ASSERT_EQUAL_UINT32(0, console.shell.getRejected());
+}
+
+void test_backspace_edits_the_line(void) {
+  Console console;
+  console.type("enroll 19\b2\n");
+  TEST_ASSERT_EQUAL_STRING("enroll|12", console.calls.words.c_str());
+  console.type("\x7F\x7Flock\n");   // Nothing left to erase
+  TEST_ASSERT_EQUAL_STRING("lock", console.calls.words.c_str());
+}
+
+void test_long_line_is_dropped_whole(void) {
+  Console console;
+  console.type("lock ");
+  for (int i = 0; i < 10000; i++) console.shell.feed('x');
+  TEST_ASSERT_TRUE(console.shell.pending() < ADMIN_LINE_MAX);
+  console.type("\n");
+  TEST_ASSERT_EQUAL_INT(0, console.calls.count);
+  TEST_ASSERT_EQUAL_UINT32(1, console.shell.getRejected());
+
+  console.type("lock\n");
+  TEST_ASSERT_EQUAL_INT(1, console.calls.count);
+}
+
+void test_bad_lines_are_rejected_without_a_call(void) {
+  Console console;
+  console.type("enroll\n");               // Missing its id
+  console.type("lock now\n");             // Takes no arguments
+  console.type("addcard 1 2 3\n");        // Too many for the command
+  console.type("a b c d e\n");            // Too many words for the shell
+  console.type("reboot\n");
+  TEST_ASSERT_EQUAL_INT(0, console.calls.count);
+  TEST_ASSERT_EQUAL_UINT32(5, console.shell.getRejected());
+
+  console.type("help\n");
+  TEST_ASSERT_EQUAL_INT(0, console.calls.count);
+  TEST_ASSERT_EQUAL_UINT32(5, console.shell.getRejected());
+}
+
+void test_numbers_parse_strictly(void) {
+  uint32_t value = 99;
+  TEST_ASSERT_TRUE(AdminShell::parseNumber("12", 1, 127, value));
+  TEST_ASSERT_EQUAL_UINT32(12, value);
+  TEST_ASSERT_TRUE(AdminShell::parseNumber("0", 0, 127, value));
+  TEST_ASSERT_EQUAL_UINT32(0, value);
+  TEST_ASSERT_FALSE(AdminShell::parseNumber("0", 1, 127, value));
+  TEST_ASSERT_FALSE(AdminShell::parseNumber("128", 1, 127, value));
+  TEST_ASSERT_FALSE(AdminShell::parseNumber("12a", 1, 127, value));
+  TEST_ASSERT_FALSE(AdminShell::parseNumber("-1", 0, 127, value));
+  TEST_ASSERT_FALSE(AdminShell::parseNumber("", 0, 127, value));
+  TEST_ASSERT_FALSE(AdminShell::parseNumber("99999999999999999999", 0, 127, value));
+  TEST_ASSERT_FALSE(AdminShell::parseNumber(nullptr, 0, 127, value));
+  TEST_ASSERT_EQUAL_UINT32(0, value);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_arguments_come_inline);
+  RUN_TEST(test_partial_lines_wait_for_their_end);
+  RUN_TEST(test_backspace_edits_the_line);
+  RUN_TEST(test_long_line_is_dropped_whole);
+  RUN_TEST(test_bad_lines_are_rejected_without_a_call);
+  RUN_TEST(test_numbers_parse_strictly);
+  return UNITY_END();
+}
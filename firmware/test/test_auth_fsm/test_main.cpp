@@ -0,0 +1,251 @@
+#include <unity.h>
+#include "auth_fsm.h"
+
+// Scripted stand-in for the RFID reader and fingerprint sensor
+class FakeAuthDriver : public AuthDriver {
+public:
+  bool present;
+  bool readOk;
+  bool authorized;
+  uint32_t fingerAt;        // Simulated time the finger lands on the sensor
+  FpResult convertResult;
+  int convertFailsLeft;     // Transient conversion failures before convertResult
+  FpResult searchResult;
+  bool touched;
+  uint32_t *clock;
+  int calls;
+
+  FakeAuthDriver(uint32_t *_clock)
+    : present(false), readOk(true), authorized(true), fingerAt(0xFFFFFFFF),
+      convertResult(FP_OK), convertFailsLeft(0), searchResult(FP_OK), touched(false),
+      clock(_clock), calls(0) {}
+
+  bool cardPresent() override { calls++; return present; }
+
+  bool readCard(uint8_t uid[], uint8_t &size) override {
+    calls++;
+    static const uint8_t CARD[] = {0x63, 0x5A, 0x59, 0x31};
+    memcpy(uid, CARD, sizeof(CARD));
+    size = sizeof(CARD);
+    return readOk;
+  }
+
+  bool cardAuthorized(const uint8_t uid[], uint8_t size) override {
+    (void)uid; (void)size;
+    calls++;
+    return authorized;
+  }
+
+  FpResult captureImage() override {
+    calls++;
+    return *clock >= fingerAt ? FP_OK : FP_NO_FINGER;
+  }
+
+  FpResult convertImage() override {
+    calls++;
+    if (convertFailsLeft > 0) {
+      convertFailsLeft--;
+      return FP_ERROR;
+    }
+    return convertResult;
+  }
+
+  FpResult searchFinger(uint16_t &fingerprintId) override {
+    calls++;
+    fingerprintId = 7;
+    return searchResult;
+  }
+
+  bool fingerTouched() override {
+    bool t = touched;
+    touched = false;
+    return t;
+  }
+};
+
+static uint32_t now;
+
+void setUp(void) {
+  now = 1000;
+}
+
+void tearDown(void) {}
+
+// Run the machine on a 10 ms loop until it reports an outcome or the time limit passes
+static AuthOutcome runUntilOutcome(AuthStateMachine &fsm, uint32_t limit) {
+  uint32_t end = now + limit;
+  while (now < end) {
+    AuthOutcome outcome = fsm.update(now);
+    if (outcome != AUTH_PENDING) return outcome;
+    now += 10;
+  }
+  return AUTH_PENDING;
+}
+
+void test_idle_without_card(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+
+  TEST_ASSERT_EQUAL(AUTH_PENDING, runUntilOutcome(fsm, 5000));
+  TEST_ASSERT_EQUAL(AUTH_IDLE, fsm.getState());
+}
+
+void test_card_and_finger_grant(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+  driver.fingerAt = now + 2000;
+
+  TEST_ASSERT_EQUAL(AUTH_GRANTED, runUntilOutcome(fsm, 5000));
+  TEST_ASSERT_EQUAL(AUTH_UNLOCK, fsm.getState());
+  TEST_ASSERT_EQUAL_UINT16(7, fsm.getFingerprintId());
+  TEST_ASSERT_EQUAL_UINT8(4, fsm.getCardUIDSize());
+
+  fsm.update(now);
+  TEST_ASSERT_EQUAL(AUTH_IDLE, fsm.getState());
+}
+
+void test_unknown_card_rejected_and_held(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+  driver.authorized = false;
+
+  TEST_ASSERT_EQUAL(AUTH_CARD_REJECTED, runUntilOutcome(fsm, 100));
+  TEST_ASSERT_EQUAL(AUTH_REJECT, fsm.getState());
+
+  // Reject indication is held without touching the hardware
+  int callsBefore = driver.calls;
+  now += REJECT_HOLD_TIME - 10;
+  fsm.update(now);
+  TEST_ASSERT_EQUAL(AUTH_REJECT, fsm.getState());
+  TEST_ASSERT_EQUAL(callsBefore, driver.calls);
+
+  now += 10;
+  fsm.update(now);
+  TEST_ASSERT_EQUAL(AUTH_IDLE, fsm.getState());
+}
+
+void test_finger_timeout(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+
+  uint32_t start = now;
+  TEST_ASSERT_EQUAL(AUTH_FINGER_REJECTED, runUntilOutcome(fsm, 20000));
+  TEST_ASSERT_GREATER_OR_EQUAL(10000, now - start);
+  TEST_ASSERT_LESS_THAN(10100, now - start);
+}
+
+void test_sensor_polled_at_interval(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+
+  fsm.update(now);  // Idle -> CardRead
+  fsm.update(now);  // CardRead -> AwaitFinger
+  TEST_ASSERT_EQUAL(AUTH_AWAIT_FINGER, fsm.getState());
+
+  int callsBefore = driver.calls;
+  for (int i = 0; i < 100; i++) {  // One second of 10 ms ticks
+    fsm.update(now);
+    now += 10;
+  }
+  TEST_ASSERT_EQUAL(1000 / FP_POLL_INTERVAL, driver.calls - callsBefore);
+}
+
+void test_conversion_failure_rejects(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+  driver.fingerAt = now;
+  driver.convertResult = FP_ERROR;
+
+  TEST_ASSERT_EQUAL(AUTH_FINGER_REJECTED, runUntilOutcome(fsm, 1000));
+}
+
+void test_conversion_failure_recaptures(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+  driver.fingerAt = now;
+  driver.convertFailsLeft = FP_CONVERT_RETRIES;
+
+  TEST_ASSERT_EQUAL(AUTH_GRANTED, runUntilOutcome(fsm, 1000));
+  TEST_ASSERT_EQUAL(0, driver.convertFailsLeft);
+}
+
+void test_touch_captures_without_waiting_for_poll(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+
+  fsm.update(now);  // Idle -> CardRead
+  fsm.update(now);  // CardRead -> AwaitFinger
+  fsm.update(now);  // First poll, no finger yet
+  now += 10;
+
+  driver.fingerAt = now;
+  driver.touched = true;
+  fsm.update(now);  // Touch reported - captured at once
+  TEST_ASSERT_EQUAL(AUTH_CAPTURE, fsm.getState());
+}
+
+void test_unknown_finger_rejected(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+  driver.fingerAt = now;
+  driver.searchResult = FP_NO_MATCH;
+
+  TEST_ASSERT_EQUAL(AUTH_FINGER_REJECTED, runUntilOutcome(fsm, 1000));
+}
+
+void test_one_driver_call_per_update(void) {
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+  driver.fingerAt = now + 500;
+
+  for (int i = 0; i < 2000; i++) {
+    int callsBefore = driver.calls;
+    fsm.update(now);
+    // CardRead reads and checks the card in the same step
+    TEST_ASSERT_LESS_OR_EQUAL(2, driver.calls - callsBefore);
+    now += 10;
+  }
+}
+
+void test_prompt_and_clock_wrap(void) {
+  now = 0xFFFFFF00;  // millis() rolls over during the attempt
+  FakeAuthDriver driver(&now);
+  AuthStateMachine fsm(driver, 10000);
+  driver.present = true;
+
+  fsm.update(now);
+  fsm.update(now);
+  TEST_ASSERT_TRUE(fsm.promptActive(now));
+  now += FP_PROMPT_DURATION;
+  TEST_ASSERT_FALSE(fsm.promptActive(now));
+
+  driver.fingerAt = 0;  // Finger present from here on
+  fsm.update(now);
+  fsm.update(now);
+  TEST_ASSERT_EQUAL(AUTH_GRANTED, fsm.update(now));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_without_card);
+  RUN_TEST(test_card_and_finger_grant);
+  RUN_TEST(test_unknown_card_rejected_and_held);
+  RUN_TEST(test_finger_timeout);
+  RUN_TEST(test_sensor_polled_at_interval);
+  RUN_TEST(test_conversion_failure_rejects);
+  RUN_TEST(test_conversion_failure_recaptures);
+  RUN_TEST(test_touch_captures_without_waiting_for_poll);
+  RUN_TEST(test_unknown_finger_rejected);
+  RUN_TEST(test_one_driver_call_per_update);
+  RUN_TEST(test_prompt_and_clock_wrap);
+  return UNITY_END();
+}
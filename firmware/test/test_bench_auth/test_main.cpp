@@ -0,0 +1,430 @@
+// End-to-end authentication benchmark: SecuritySystem::update() on the
+// simulated drivers from hal_sim.h, fed with scripted workloads (valid and
+// unknown cards, fingerprint hits, misses and timeouts, tamper bursts, a
+// gateway that is down or slow, a Wi-Fi drop). Each scenario reports touch-to-relay
+// unlock latency, loop period and jitter, NVS and outbox flash writes and
+// heap use (operator new calls inside update() and the most one update()
+// held at once; the simulated drivers' own std::string buffers count
+// too), and the whole run is written as one JSON document for
+// regression tracking (to $CASHBAND_BENCH_REPORT when set, and stdout).
+//
+// Time is simulated, so the report is deterministic for a given firmware.
+// The sensor and reader costs below are rough R307 / MFRC522 figures; what
+// matters is how a change moves the numbers. Host builds have no logging
+// task, so the outbox drain runs inline on the security loop and gateway
+// time shows up in the loop period (the slow_server scenario is the worst
+// case for the device, where the drain runs on the other core).
+//
+// Each scenario asserts its p99 unlock latency budget, so the bench fails
+// when the auth path regresses.
+#include <unity.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+#include "hal_sim.h"
+#include "security_system.h"
+
+#define TICK_MS          2       // Simulated loop wake-up period
+#define FINGER_DELAY_MS  400     // Card tap to finger on the sensor
+#define USER_GAP_MS      300     // Between one user and the next
+
+// Simulated device costs
+#define READ_CARD_US     2500    // Anticollision + select over SPI
+#define CAPTURE_US       130000  // GenImg
+#define CONVERT_US       250000  // Img2Tz
+#define SEARCH_BASE_US   15000   // Search command and reply
+#define SEARCH_PAGE_US   800     // Per template compared
+#define SERVER_US        40000   // Gateway answer
+#define SLOW_SERVER_US   1500000 // Gateway answer while the chain is congested
+
+static const uint8_t OWNER_CARD[] = {0x63, 0x5A, 0x59, 0x31};
+static const uint8_t UNKNOWN_CARD[] = {0x04, 0xA2, 0x3B, 0x1C, 0x5D, 0x80, 0x00};
+
+#define FINGER_OWNER    7
+#define FINGER_STRANGER 9
+#define OWNER_PAGE      3
+#define LIBRARY_FILL    200      // Other enrolled fingers
+
+// ---- Heap accounting ------------------------------------------------------
+
+static bool heapCounting = false;   // Inside update()
+static uint64_t heapAllocs = 0;
+static int64_t heapLive = 0;
+static int64_t heapPeak = 0;
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  void* ptr = malloc(size ? size : 1);
+  if (ptr == nullptr) throw std::bad_alloc();
+  heapLive += (int64_t)malloc_usable_size(ptr);
+  if (heapCounting) {
+    heapAllocs++;
+    if (heapLive > heapPeak) heapPeak = heapLive;
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+  if (ptr == nullptr) return;
+  heapLive -= (int64_t)malloc_usable_size(ptr);
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  operator delete(ptr);
+}
+
+// ---- Bench board ----------------------------------------------------------
+
+// Records when the relay is energized
+class BenchGpio : public SimGpio {
+private:
+  SimClock &clock;
+
+public:
+  uint64_t relayAt;
+  uint32_t unlocks;
+
+  BenchGpio(SimClock &_clock) : clock(_clock), relayAt(0), unlocks(0) {}
+
+  void write(uint8_t pin, uint8_t level) override {
+    SimGpio::write(pin, level);
+    if (pin == RELAY_PIN && level == LOW) {
+      relayAt = clock.nowMicros();
+      unlocks++;
+    }
+  }
+};
+
+enum AttemptKind {
+  ATTEMPT_VALID,          // Enrolled card, owner's finger
+  ATTEMPT_UNKNOWN_CARD,
+  ATTEMPT_WRONG_FINGER,
+  ATTEMPT_NO_FINGER       // Card accepted, nobody touches the sensor
+};
+
+struct ScenarioResult {
+  std::string name;
+  uint32_t attempts;
+  uint32_t granted;
+  uint32_t denied;
+  std::vector<uint32_t> unlockUs;
+  std::vector<uint32_t> loopUs;
+  uint32_t nvsWrites;
+  uint32_t flashWrites;
+  uint32_t flashErases;
+  uint64_t heapAllocs;
+  int64_t heapPeakBytes;
+  uint32_t eventsDelivered;
+  uint32_t eventsExpected;
+};
+
+struct Bench {
+  SimClock clock;
+  BenchGpio gpio;
+  SimKeyValueStore preferences;
+  SimCardReader reader;
+  SimFingerprintSensor finger;
+  SimTransport net;
+  RamFlash outboxFlash;
+  SecuritySystem* system;
+  uint64_t lastUpdateAt;
+  ScenarioResult result;
+
+  Bench(const char* name)
+    : gpio(clock), reader(clock), finger(clock), net(clock), outboxFlash(8 * 4096),
+      system(nullptr), lastUpdateAt(0) {
+    finger.enroll(OWNER_PAGE, FINGER_OWNER);
+    for (uint16_t page = 0; page < LIBRARY_FILL; page++) {
+      if (page != OWNER_PAGE) finger.enroll(page, 1000 + page);
+    }
+    reader.readTimeUs = READ_CARD_US;
+    finger.captureTimeUs = CAPTURE_US;
+    finger.convertTimeUs = CONVERT_US;
+    finger.searchBaseUs = SEARCH_BASE_US;
+    finger.searchPageUs = SEARCH_PAGE_US;
+    net.responseTimeUs = SERVER_US;
+
+    system = new SecuritySystem(gpio, clock, preferences, reader, finger, net, outboxFlash);
+    system->init();
+    run(BATCH_MAX_DELAY);
+
+    // Measure from here on
+    result = ScenarioResult();
+    result.name = name;
+    preferences.writes = 0;
+    outboxFlash.writes = 0;
+    outboxFlash.erases = 0;
+    heapAllocs = 0;
+    lastUpdateAt = 0;
+  }
+
+  ~Bench() {
+    delete system;
+  }
+
+  void step() {
+    uint64_t start = clock.nowMicros();
+    if (lastUpdateAt != 0) result.loopUs.push_back((uint32_t)(start - lastUpdateAt));
+    lastUpdateAt = start;
+    int64_t entryLive = heapLive;
+    heapPeak = heapLive;
+    heapCounting = true;
+    system->update();
+    heapCounting = false;
+    if (heapPeak - entryLive > result.heapPeakBytes) result.heapPeakBytes = heapPeak - entryLive;
+    clock.advance(TICK_MS);
+  }
+
+  void run(uint32_t ms) {
+    uint64_t end = clock.nowMicros() + (uint64_t)ms * 1000;
+    while (clock.nowMicros() < end) step();
+  }
+
+  // Run until the relay is energized or ms pass; true if it was
+  bool runUntilUnlocked(uint32_t ms) {
+    uint32_t before = gpio.unlocks;
+    uint64_t end = clock.nowMicros() + (uint64_t)ms * 1000;
+    while (clock.nowMicros() < end && gpio.unlocks == before) step();
+    return gpio.unlocks != before;
+  }
+
+  void tamperBurst() {
+    for (int i = 0; i < TAMPER_THRESHOLD; i++) {
+      gpio.trigger(TILT_PIN);
+      run(20);
+    }
+    result.eventsExpected++;
+  }
+
+  void attempt(AttemptKind kind) {
+    result.attempts++;
+    result.eventsExpected += kind == ATTEMPT_VALID ? 1 : 0;
+    if (kind == ATTEMPT_UNKNOWN_CARD) {
+      reader.present(UNKNOWN_CARD, sizeof(UNKNOWN_CARD));
+    } else {
+      reader.present(OWNER_CARD, sizeof(OWNER_CARD));
+    }
+    run(FINGER_DELAY_MS);
+
+    if (kind == ATTEMPT_VALID || kind == ATTEMPT_WRONG_FINGER) {
+      finger.placeFinger(kind == ATTEMPT_VALID ? FINGER_OWNER : FINGER_STRANGER);
+    }
+    uint64_t touchAt = clock.nowMicros();
+    bool unlocked = runUntilUnlocked(FP_SCAN_TIMEOUT + REJECT_HOLD_TIME);
+    finger.liftFinger();
+    reader.remove();
+
+    if (unlocked) {
+      result.granted++;
+      result.unlockUs.push_back((uint32_t)(gpio.relayAt - touchAt));
+      run(USER_GAP_MS);
+      system->lockSystem();  // Next user; the door would auto-lock later
+    } else {
+      result.denied++;
+    }
+    run(USER_GAP_MS);
+  }
+
+  // Let the outbox drain, then take the counters
+  ScenarioResult finish() {
+    net.serverUp = true;
+    net.responseTimeUs = SERVER_US;
+    run(BATCH_MAX_DELAY + OUTBOX_RETRY_INTERVAL + 1000);
+
+    result.nvsWrites = preferences.writes;
+    result.flashWrites = outboxFlash.writes;
+    result.flashErases = outboxFlash.erases;
+    result.heapAllocs = heapAllocs;
+    result.eventsDelivered = 0;
+    for (size_t i = 0; i < net.bodies.size(); i++) {
+      if (net.paths[i] != "/events") continue;  // Anchors carry hashes, not records
+      const std::string &body = net.bodies[i];
+      for (size_t at = body.find("\"0x"); at != std::string::npos; at = body.find("\"0x", at + 1)) {
+        result.eventsDelivered++;
+      }
+    }
+    return result;
+  }
+};
+
+// ---- Report ---------------------------------------------------------------
+
+static uint32_t percentile(std::vector<uint32_t> samples, uint32_t p) {
+  if (samples.empty()) return 0;
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (samples.size() * p + 99) / 100;
+  return samples[rank > 0 ? rank - 1 : 0];
+}
+
+static std::vector<ScenarioResult> results;
+
+static void appendf(std::string &out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendf(std::string &out, const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  out += buffer;
+}
+
+static std::string report() {
+  std::string out;
+  appendf(out, "{\"bench\":\"auth\",\"tickMs\":%d,\"scenarios\":[", TICK_MS);
+  for (size_t i = 0; i < results.size(); i++) {
+    const ScenarioResult &r = results[i];
+    uint32_t loop50 = percentile(r.loopUs, 50);
+    uint32_t loop99 = percentile(r.loopUs, 99);
+    appendf(out, "%s\n{\"name\":\"%s\",\"attempts\":%u,\"granted\":%u,\"denied\":%u,", i > 0 ? "," : "",
+            r.name.c_str(), r.attempts, r.granted, r.denied);
+    appendf(out, "\"unlockUs\":{\"p50\":%u,\"p99\":%u,\"max\":%u},", percentile(r.unlockUs, 50),
+            percentile(r.unlockUs, 99), percentile(r.unlockUs, 100));
+    appendf(out, "\"loopUs\":{\"p50\":%u,\"p99\":%u,\"max\":%u,\"jitter\":%u},", loop50, loop99,
+            percentile(r.loopUs, 100), loop99 - loop50);
+    appendf(out, "\"nvsWrites\":%u,\"flashWrites\":%u,\"flashErases\":%u,", r.nvsWrites, r.flashWrites,
+            r.flashErases);
+    appendf(out, "\"heapAllocs\":%llu,\"heapPeakBytes\":%lld,\"eventsDelivered\":%u,\"eventsExpected\":%u}",
+            (unsigned long long)r.heapAllocs, (long long)r.heapPeakBytes, r.eventsDelivered, r.eventsExpected);
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+static void check(const ScenarioResult &r, uint32_t unlockP99BudgetUs) {
+  results.push_back(r);
+  printf("%-16s %3u attempts  unlock p50 %7u p99 %7u us  loop p99 %7u us  nvs %3u  flash %3u\n",
+         r.name.c_str(), r.attempts, percentile(r.unlockUs, 50), percentile(r.unlockUs, 99),
+         percentile(r.loopUs, 99), r.nvsWrites, r.flashWrites);
+  TEST_ASSERT_EQUAL_UINT32(r.eventsExpected, r.eventsDelivered);
+  TEST_ASSERT_TRUE(percentile(r.unlockUs, 99) <= unlockP99BudgetUs);
+}
+
+// ---- Scenarios ------------------------------------------------------------
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_valid_stream(void) {
+  Bench bench("valid_stream");
+  for (int i = 0; i < 40; i++) bench.attempt(ATTEMPT_VALID);
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(40, r.granted);
+  check(r, 600000);
+}
+
+void test_unknown_cards(void) {
+  Bench bench("unknown_cards");
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < MAX_FAILED_ATTEMPTS - 1; j++) bench.attempt(ATTEMPT_UNKNOWN_CARD);
+    bench.attempt(ATTEMPT_VALID);
+  }
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(10, r.granted);
+  check(r, 600000);
+}
+
+void test_finger_misses(void) {
+  Bench bench("finger_misses");
+  for (int i = 0; i < 20; i++) {
+    bench.attempt(ATTEMPT_WRONG_FINGER);
+    bench.attempt(ATTEMPT_VALID);
+  }
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(20, r.granted);
+  check(r, 600000);
+}
+
+void test_finger_timeouts(void) {
+  Bench bench("finger_timeouts");
+  for (int i = 0; i < 5; i++) {
+    bench.attempt(ATTEMPT_NO_FINGER);
+    bench.attempt(ATTEMPT_VALID);
+  }
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(5, r.granted);
+  check(r, 600000);
+}
+
+void test_tamper_bursts(void) {
+  Bench bench("tamper_bursts");
+  for (int i = 0; i < 10; i++) {
+    bench.tamperBurst();
+    bench.attempt(ATTEMPT_VALID);
+    bench.run(TAMPER_HOLDOFF);
+  }
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(10, r.granted);
+  check(r, 600000);
+}
+
+void test_server_outage(void) {
+  Bench bench("server_outage");
+  bench.net.serverUp = false;
+  for (int i = 0; i < 20; i++) bench.attempt(ATTEMPT_VALID);
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(20, r.granted);
+  check(r, 600000);
+}
+
+void test_slow_server(void) {
+  Bench bench("slow_server");
+  bench.net.responseTimeUs = SLOW_SERVER_US;
+  for (int i = 0; i < 20; i++) bench.attempt(ATTEMPT_VALID);
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(20, r.granted);
+  check(r, 600000 + SLOW_SERVER_US * HTTP_MAX_PIPELINE);
+}
+
+void test_link_loss(void) {
+  Bench bench("link_loss");
+  for (int i = 0; i < 5; i++) bench.attempt(ATTEMPT_VALID);
+  bench.net.setNetworkAvailable(false);
+  for (int i = 0; i < 20; i++) bench.attempt(ATTEMPT_VALID);
+  bench.net.setNetworkAvailable(true);
+  bench.run(WIFI_BACKOFF_MAX);  // Longest a retry can be away
+  for (int i = 0; i < 5; i++) bench.attempt(ATTEMPT_VALID);
+  ScenarioResult r = bench.finish();
+  TEST_ASSERT_EQUAL_UINT32(30, r.granted);
+  // Reconnects run between loop passes, never inside one
+  TEST_ASSERT_TRUE(percentile(r.loopUs, 100) < 1000000);
+  check(r, 600000);
+}
+
+void test_write_report(void) {
+  std::string json = report();
+  fputs(json.c_str(), stdout);
+  const char* path = getenv("CASHBAND_BENCH_REPORT");
+  if (path != nullptr) {
+    FILE* file = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(json.c_str(), file);
+    fclose(file);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_valid_stream);
+  RUN_TEST(test_unknown_cards);
+  RUN_TEST(test_finger_misses);
+  RUN_TEST(test_finger_timeouts);
+  RUN_TEST(test_tamper_bursts);
+  RUN_TEST(test_server_outage);
+  RUN_TEST(test_slow_server);
+  RUN_TEST(test_link_loss);
+  RUN_TEST(test_write_report);
+  return UNITY_END();
+}
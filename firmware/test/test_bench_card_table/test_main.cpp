@@ -0,0 +1,94 @@
+// Lookup cost of the sorted card table at 10, 1k and 10k cards, against the
+// linear compare the firmware used when it knew a single UID. Half of the
+// probes are enrolled cards and half are unknown ones.
+#include <unity.h>
+#include <chrono>
+#include <string.h>
+#include "card_table.h"
+
+#define MAX_CARDS  10000
+#define LOOKUPS    1000000
+
+static CardTable<MAX_CARDS> table;
+static CardRecord linear[MAX_CARDS];
+static uint8_t probes[1024][7];
+static volatile uint32_t sink;
+
+static double nowNanos() {
+  using namespace std::chrono;
+  return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Deterministic pseudo-random 7-byte UIDs
+static void makeUid(uint32_t n, uint8_t uid[7]) {
+  uint32_t x = n * 2654435761u + 0x9E3779B9u;
+  for (int i = 0; i < 7; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    uid[i] = (uint8_t)x;
+  }
+}
+
+static void fill(uint32_t count) {
+  table.clear();
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t uid[7];
+    makeUid(i, uid);
+    table.add(uid, 7, (uint16_t)(i % 128));
+    memset(&linear[i], 0, sizeof(CardRecord));
+    linear[i].uidSize = 7;
+    memcpy(linear[i].uid, uid, 7);
+  }
+  for (uint32_t i = 0; i < 1024; i++) {
+    makeUid(i % 2 ? (i * 7919u) % count : MAX_CARDS + i, probes[i]);
+  }
+}
+
+static const CardRecord* linearFind(uint32_t count, const uint8_t uid[], uint8_t size) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (linear[i].uidSize == size && memcmp(linear[i].uid, uid, size) == 0) return &linear[i];
+  }
+  return nullptr;
+}
+
+static void bench(uint32_t count) {
+  fill(count);
+  TEST_ASSERT_EQUAL_UINT16(count, table.size());
+
+  uint32_t hits = 0;
+  double start = nowNanos();
+  for (uint32_t i = 0; i < LOOKUPS; i++) {
+    hits += table.find(probes[i & 1023], 7) != nullptr;
+  }
+  double sorted = (nowNanos() - start) / LOOKUPS;
+  sink = hits;
+  TEST_ASSERT_EQUAL_UINT32(LOOKUPS / 2, hits);
+
+  uint32_t linearLookups = LOOKUPS / (count / 10 + 1);
+  hits = 0;
+  start = nowNanos();
+  for (uint32_t i = 0; i < linearLookups; i++) {
+    hits += linearFind(count, probes[i & 1023], 7) != nullptr;
+  }
+  double scan = (nowNanos() - start) / linearLookups;
+  sink = hits;
+
+  printf("%6u cards  sorted %7.1f ns/lookup  linear %9.1f ns/lookup\n",
+         (unsigned)count, sorted, scan);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_lookup_10_cards(void) { bench(10); }
+void test_lookup_1k_cards(void) { bench(1000); }
+void test_lookup_10k_cards(void) { bench(10000); }
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lookup_10_cards);
+  RUN_TEST(test_lookup_1k_cards);
+  RUN_TEST(test_lookup_10k_cards);
+  return UNITY_END();
+}
@@ -0,0 +1,126 @@
+// Decision latency of a fingerprint search against the size of the template
+// library: the 1:N fingerFastSearch() scan over every enrolled page, against
+// the 1:1 range search over the pages bound to the presented card. The
+// sensor is simulated on the host: it parses the real SEARCH command packet,
+// compares the probe with each template in the requested range and builds
+// the reply, which goes through the firmware's decoder. The host time
+// stands in for the sensor's matcher; what matters is how it scales.
+#include <unity.h>
+#include <chrono>
+#include <string.h>
+#include "fp_search.h"
+
+#define TEMPLATE_SIZE   512     // R307 character file
+#define LIBRARY_PAGES   1000    // R307 library capacity
+#define MATCH_THRESHOLD 50      // Minimum score accepted as a match
+#define SEARCHES        200
+
+static uint8_t library[LIBRARY_PAGES][TEMPLATE_SIZE];
+static uint8_t probe[TEMPLATE_SIZE];
+static uint32_t compared;
+static volatile uint32_t sink;
+
+static double nowNanos() {
+  using namespace std::chrono;
+  return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void makeTemplate(uint32_t seed, uint8_t out[TEMPLATE_SIZE]) {
+  uint32_t x = seed * 2654435761u + 0x9E3779B9u;
+  for (int i = 0; i < TEMPLATE_SIZE; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    out[i] = (uint8_t)x;
+  }
+}
+
+// Agreeing bits above chance, scaled to the sensor's score range
+static uint16_t score(const uint8_t a[TEMPLATE_SIZE], const uint8_t b[TEMPLATE_SIZE]) {
+  uint32_t same = 0;
+  for (int i = 0; i < TEMPLATE_SIZE; i++) {
+    same += 8 - __builtin_popcount((uint8_t)(a[i] ^ b[i]));
+  }
+  uint32_t half = TEMPLATE_SIZE * 4;
+  return same > half ? (uint16_t)((same - half) * 300 / half) : 0;
+}
+
+// Simulated sensor: execute one SEARCH command, write the reply payload
+static uint16_t sensorSearch(const uint8_t command[FP_SEARCH_COMMAND_LENGTH], uint16_t enrolled,
+                             uint8_t reply[FP_SEARCH_REPLY_LENGTH]) {
+  uint16_t start = (uint16_t)(command[2] << 8 | command[3]);
+  uint16_t count = (uint16_t)(command[4] << 8 | command[5]);
+  uint16_t end = start + count < enrolled ? start + count : enrolled;
+  memset(reply, 0, FP_SEARCH_REPLY_LENGTH);
+  reply[0] = FP_CONFIRM_NOT_FOUND;
+  for (uint16_t page = start; page < end; page++) {
+    compared++;
+    uint16_t s = score(probe, library[page]);
+    if (s >= MATCH_THRESHOLD) {
+      reply[0] = FP_CONFIRM_OK;
+      reply[1] = (uint8_t)(page >> 8);
+      reply[2] = (uint8_t)page;
+      reply[3] = (uint8_t)(s >> 8);
+      reply[4] = (uint8_t)s;
+      break;
+    }
+  }
+  return FP_SEARCH_REPLY_LENGTH;
+}
+
+static double timeSearch(uint16_t enrolled, uint16_t start, uint16_t count, uint16_t expectedPage,
+                         uint32_t &matches) {
+  compared = 0;
+  matches = 0;
+  double begin = nowNanos();
+  for (int i = 0; i < SEARCHES; i++) {
+    uint8_t command[FP_SEARCH_COMMAND_LENGTH];
+    uint8_t reply[FP_SEARCH_REPLY_LENGTH];
+    encodeSearchCommand(command, 1, start, count);
+    uint16_t length = sensorSearch(command, enrolled, reply);
+    uint16_t pageId = 0;
+    uint16_t s = 0;
+    if (decodeSearchReply(reply, length, pageId, s) == FP_OK && pageId == expectedPage) matches++;
+  }
+  double elapsed = (nowNanos() - begin) / SEARCHES / 1000.0;
+  sink = matches;
+  return elapsed;
+}
+
+static void bench(uint16_t enrolled) {
+  for (uint16_t page = 0; page < enrolled; page++) {
+    makeTemplate(page, library[page]);
+  }
+
+  // The card holder's finger sits at the end of the library, the worst
+  // case for a scan; the card binds two pages
+  uint16_t bound = enrolled - 2;
+  memcpy(probe, library[enrolled - 1], TEMPLATE_SIZE);
+  for (int i = 0; i < TEMPLATE_SIZE; i += 9) probe[i] ^= 0x11;  // A slightly different capture
+
+  uint32_t matches;
+  double scan = timeSearch(enrolled, 0, enrolled, enrolled - 1, matches);
+  uint32_t scanCompared = compared / SEARCHES;
+  TEST_ASSERT_EQUAL_UINT32(SEARCHES, matches);
+  double range = timeSearch(enrolled, bound, 2, enrolled - 1, matches);
+  uint32_t rangeCompared = compared / SEARCHES;
+  TEST_ASSERT_EQUAL_UINT32(SEARCHES, matches);
+
+  printf("%5u templates  1:N %8.1f us (%4u compared)  bound 1:1 %6.1f us (%u compared)\n",
+         (unsigned)enrolled, scan, (unsigned)scanCompared, range, (unsigned)rangeCompared);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_search_10_templates(void) { bench(10); }
+void test_search_100_templates(void) { bench(100); }
+void test_search_1000_templates(void) { bench(1000); }
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_search_10_templates);
+  RUN_TEST(test_search_100_templates);
+  RUN_TEST(test_search_1000_templates);
+  return UNITY_END();
+}
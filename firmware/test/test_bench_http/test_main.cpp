@@ -0,0 +1,174 @@
+// Per-event transport cost against a local stand-in for the gateway:
+// a fresh connection per event (the old HTTPClient begin/end pattern),
+// a warm keep-alive connection, and pipelined requests on that connection.
+#include <unity.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <arpa/inet.h>
+#include "http_transport.h"
+
+#define EVENTS          2000
+#define PIPELINE_DEPTH  4
+
+unsigned long millis() {
+  using namespace std::chrono;
+  return (unsigned long)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double nowMicros() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// ---- Stand-in gateway: answers every POST with a small JSON body ----------
+
+static int listenFd = -1;
+static uint16_t serverPort = 0;
+static std::atomic<uint32_t> acceptedConnections(0);
+
+static void serveConnection(int fd) {
+  static const char BODY[] = "{\"success\":true,\"txHash\":\"0x00\"}";
+  char reply[256];
+  int replyLength = snprintf(reply, sizeof(reply),
+                             "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                             "Content-Length: %u\r\nConnection: keep-alive\r\n\r\n%s",
+                             (unsigned)strlen(BODY), BODY);
+  std::string buffer;
+  char chunk[4096];
+  for (;;) {
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) break;
+    buffer.append(chunk, n);
+
+    // Answer every complete request in the buffer (supports pipelining)
+    for (;;) {
+      size_t headerEnd = buffer.find("\r\n\r\n");
+      if (headerEnd == std::string::npos) break;
+      size_t lengthAt = buffer.find("Content-Length: ");
+      size_t contentLength = lengthAt < headerEnd ? strtoul(buffer.c_str() + lengthAt + 16, nullptr, 10) : 0;
+      if (buffer.size() < headerEnd + 4 + contentLength) break;
+      buffer.erase(0, headerEnd + 4 + contentLength);
+      send(fd, reply, replyLength, MSG_NOSIGNAL);
+    }
+  }
+  close(fd);
+}
+
+static void startServer() {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  bind(listenFd, (struct sockaddr*)&addr, sizeof(addr));
+  listen(listenFd, 64);
+  socklen_t length = sizeof(addr);
+  getsockname(listenFd, (struct sockaddr*)&addr, &length);
+  serverPort = ntohs(addr.sin_port);
+
+  std::thread([] {
+    for (;;) {
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd < 0) break;
+      int on = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      acceptedConnections++;
+      std::thread(serveConnection, fd).detach();
+    }
+  }).detach();
+}
+
+// ---- Benchmarks -----------------------------------------------------------
+
+static const char EVENT_JSON[] =
+  "{\"record\":\"0x635A593100000000000004000100000000010000000000000000000000000000\"}";
+
+static char baseUrl[64];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void report(const char* mode, double elapsedUs, uint32_t connects) {
+  printf("%-10s %8.1f us/event  %6u connections\n", mode, elapsedUs / EVENTS, (unsigned)connects);
+}
+
+void test_cold_connection_per_event(void) {
+  KeepAliveHttp<PosixClient> http;
+  TEST_ASSERT_TRUE(http.begin(baseUrl));
+
+  double start = nowMicros();
+  for (int i = 0; i < EVENTS; i++) {
+    TEST_ASSERT_EQUAL(200, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+    http.close();
+  }
+  report("cold", nowMicros() - start, http.getConnects());
+  TEST_ASSERT_EQUAL_UINT32(EVENTS, http.getConnects());
+}
+
+void test_warm_keep_alive(void) {
+  KeepAliveHttp<PosixClient> http;
+  TEST_ASSERT_TRUE(http.begin(baseUrl));
+  TEST_ASSERT_EQUAL(200, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+
+  double start = nowMicros();
+  for (int i = 0; i < EVENTS; i++) {
+    TEST_ASSERT_EQUAL(200, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+  }
+  report("warm", nowMicros() - start, http.getConnects());
+  TEST_ASSERT_EQUAL_UINT32(1, http.getConnects());
+}
+
+void test_pipelined(void) {
+  KeepAliveHttp<PosixClient> http;
+  TEST_ASSERT_TRUE(http.begin(baseUrl));
+  TEST_ASSERT_EQUAL(200, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+
+  double start = nowMicros();
+  for (int i = 0; i < EVENTS; i += PIPELINE_DEPTH) {
+    for (int j = 0; j < PIPELINE_DEPTH; j++) {
+      TEST_ASSERT_TRUE(http.sendPost("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+    }
+    for (int j = 0; j < PIPELINE_DEPTH; j++) {
+      TEST_ASSERT_EQUAL(200, http.readResponse());
+    }
+  }
+  report("pipelined", nowMicros() - start, http.getConnects());
+  TEST_ASSERT_EQUAL_UINT32(1, http.getConnects());
+}
+
+void test_reconnects_after_server_close(void) {
+  KeepAliveHttp<PosixClient> http;
+  TEST_ASSERT_TRUE(http.begin(baseUrl));
+  TEST_ASSERT_EQUAL(200, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+  http.close();  // Same as the gateway dropping an idle connection
+  TEST_ASSERT_EQUAL(200, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+  TEST_ASSERT_EQUAL_UINT32(2, http.getConnects());
+}
+
+void test_connect_timeout_is_bounded(void) {
+  KeepAliveHttp<PosixClient> http;
+  TEST_ASSERT_TRUE(http.begin("http://127.0.0.1:1"));  // Nothing listens here
+  http.setTimeouts(200, 200);
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(-1, http.post("/log-access", EVENT_JSON, sizeof(EVENT_JSON) - 1));
+  TEST_ASSERT_LESS_OR_EQUAL(300, millis() - start);
+}
+
+int main() {
+  startServer();
+  snprintf(baseUrl, sizeof(baseUrl), "http://127.0.0.1:%u", (unsigned)serverPort);
+  printf("%d events per mode against %s\n", EVENTS, baseUrl);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_connection_per_event);
+  RUN_TEST(test_warm_keep_alive);
+  RUN_TEST(test_pipelined);
+  RUN_TEST(test_reconnects_after_server_close);
+  RUN_TEST(test_connect_timeout_is_bounded);
+  return UNITY_END();
+}
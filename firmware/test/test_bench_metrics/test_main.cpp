@@ -0,0 +1,80 @@
+// Cost of one latency probe: a METRIC_START / METRIC_STOP pair (two clock
+// reads through the Clock interface and a histogram insert), against the
+// same clock reads alone. On the host the clock is steady_clock; on the
+// ESP32 micros() reads the 64-bit esp_timer counter, so the insert is the
+// part that carries over.
+#include <unity.h>
+#include <chrono>
+#include "latency_metrics.h"
+
+#define PROBES 2000000
+
+class HostClock : public Clock {
+public:
+  uint32_t millis() override { return (uint32_t)(nanos() / 1000000); }
+  uint32_t micros() override { return (uint32_t)(nanos() / 1000); }
+  void delay(uint32_t ms) override { (void)ms; }
+
+  static uint64_t nanos() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+static HostClock hostClock;
+static Metrics metrics;
+static volatile uint32_t sink;
+
+static double timeClockReads() {
+  Clock &clock = hostClock;
+  uint64_t begin = HostClock::nanos();
+  for (uint32_t i = 0; i < PROBES; i++) {
+    uint32_t start = clock.micros();
+    sink = clock.micros() - start;
+  }
+  return (double)(HostClock::nanos() - begin) / PROBES;
+}
+
+static double timeProbes() {
+  Clock &clock = hostClock;
+  uint64_t begin = HostClock::nanos();
+  for (uint32_t i = 0; i < PROBES; i++) {
+    METRIC_START(clock, start);
+    METRIC_STOP(metrics, (uint8_t)(i % METRIC_STAGE_COUNT), clock, start);
+  }
+  return (double)(HostClock::nanos() - begin) / PROBES;
+}
+
+static double timeInserts() {
+  uint64_t begin = HostClock::nanos();
+  for (uint32_t i = 0; i < PROBES; i++) {
+    metrics.record((uint8_t)(i % METRIC_STAGE_COUNT), i & 0xFFFFF);
+  }
+  return (double)(HostClock::nanos() - begin) / PROBES;
+}
+
+void setUp(void) {
+  metrics.reset();
+}
+
+void tearDown(void) {}
+
+void test_probe_overhead(void) {
+  double reads = timeClockReads();
+  double probe = timeProbes();
+  double insert = timeInserts();
+  printf("clock reads %6.1f ns  full probe %6.1f ns  histogram insert %6.1f ns\n",
+         reads, probe, insert);
+  uint32_t recorded = 0;
+  for (uint8_t stage = 0; stage < METRIC_STAGE_COUNT; stage++) {
+    recorded += metrics.stage(stage).getCount();
+  }
+  TEST_ASSERT_EQUAL_UINT32(2 * PROBES, recorded);
+  TEST_ASSERT_TRUE(probe < 1000.0);  // Budget: 1 us per probe
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_probe_overhead);
+  return UNITY_END();
+}
@@ -0,0 +1,261 @@
+// Power profiles compared on the same simulated half hour at a door: a
+// user every three minutes (card, then the finger 400 ms later) and two
+// tamper bursts. The security task runs as it does on the device: it
+// blocks for planSleep() and is woken early by the reader IRQ, the finger
+// touch and tilt pulses, so the residency, wake counts and latencies are
+// the ones the firmware produces. The average current is the scheduler's
+// estimate from that residency and the POWER_*_UA figures in config.h;
+// how the profiles compare matters more than the absolute numbers.
+//
+// Each profile asserts that every user got in, both alarms went off, the
+// card wake latency stays within one detection window and the relay is
+// held for exactly UNLOCK_DURATION (within one tick when always on).
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "hal_sim.h"
+#include "security_system.h"
+
+#define RUN_MS           1800000  // Simulated time per profile
+#define USER_PERIOD_MS   180013   // About one user every three minutes, at any phase of the windows
+#define FIRST_USER_MS    60037
+#define FINGER_DELAY_MS  400      // Card tap to finger on the sensor
+#define FINGER_HOLD_MS   1000
+#define PULSE_GAP_MS     30       // Between tilt pulses in a burst
+
+// Simulated device costs, as in test_bench_auth
+#define READ_CARD_US     2500
+#define CAPTURE_US       130000
+#define CONVERT_US       250000
+#define SEARCH_BASE_US   15000
+#define SERVER_US        40000
+
+static const uint8_t OWNER_CARD[] = {0x63, 0x5A, 0x59, 0x31};
+#define FINGER_OWNER    7
+#define OWNER_PAGE      3
+
+static const uint32_t TAMPER_AT_MS[] = {690000, 1590000};  // Between users
+
+// Records how long the relay stays energized
+class RelayGpio : public SimGpio {
+private:
+  SimClock &clock;
+  bool unlocked;
+  uint64_t unlockedAt;
+
+public:
+  std::vector<uint32_t> holdsMs;
+
+  RelayGpio(SimClock &_clock) : clock(_clock), unlocked(false), unlockedAt(0) {}
+
+  void write(uint8_t pin, uint8_t level) override {
+    if (pin == RELAY_PIN && level == LOW && !unlocked) {
+      unlocked = true;
+      unlockedAt = clock.nowMicros();
+    } else if (pin == RELAY_PIN && level == HIGH && unlocked) {
+      unlocked = false;
+      holdsMs.push_back((uint32_t)((clock.nowMicros() - unlockedAt) / 1000));
+    }
+    SimGpio::write(pin, level);
+  }
+};
+
+enum ActionKind {
+  ACTION_PRESENT,     // Card to the reader; its IRQ comes in the next window
+  ACTION_TAKE,        // Card taken away; left there it would answer every window
+  ACTION_FINGER,      // Touch output: wakes the task
+  ACTION_LIFT,
+  ACTION_TILT         // Pin interrupt: wakes the task
+};
+
+struct Action {
+  uint64_t atUs;
+  ActionKind kind;
+};
+
+struct ProfileResult {
+  const char* name;
+  uint32_t currentUa;
+  double awakePercent;
+  double wakesPerSecond;
+  double radioPercent;
+  uint32_t cardWakeAvgUs;
+  uint32_t cardWakeMaxUs;
+  uint32_t holdMinMs;
+  uint32_t holdMaxMs;
+  uint32_t users;
+  uint32_t unlocks;
+  uint32_t alarms;
+};
+
+struct Door {
+  SimClock clock;
+  RelayGpio gpio;
+  SimKeyValueStore preferences;
+  SimCardReader reader;
+  SimFingerprintSensor finger;
+  SimTransport net;
+  RamFlash outboxFlash;
+  SecuritySystem system;
+  std::vector<Action> script;
+  size_t next;
+  std::vector<uint32_t> cardWakes;
+
+  Door(uint8_t profile)
+    : gpio(clock), reader(clock), finger(clock), net(clock), outboxFlash(8 * 4096),
+      system(gpio, clock, preferences, reader, finger, net, outboxFlash), next(0) {
+    finger.enroll(OWNER_PAGE, FINGER_OWNER);
+    reader.readTimeUs = READ_CARD_US;
+    finger.captureTimeUs = CAPTURE_US;
+    finger.convertTimeUs = CONVERT_US;
+    finger.searchBaseUs = SEARCH_BASE_US;
+    net.responseTimeUs = SERVER_US;
+    system.setPowerProfile(profile);
+    system.init();
+
+    for (uint32_t t = FIRST_USER_MS; t + USER_PERIOD_MS / 2 < RUN_MS; t += USER_PERIOD_MS) {
+      add(t, ACTION_PRESENT);
+      add(t + FINGER_DELAY_MS, ACTION_TAKE);
+      add(t + FINGER_DELAY_MS, ACTION_FINGER);
+      add(t + FINGER_DELAY_MS + FINGER_HOLD_MS, ACTION_LIFT);
+    }
+    for (size_t i = 0; i < sizeof(TAMPER_AT_MS) / sizeof(TAMPER_AT_MS[0]); i++) {
+      for (uint32_t pulse = 0; pulse < TAMPER_THRESHOLD; pulse++) {
+        add(TAMPER_AT_MS[i] + pulse * PULSE_GAP_MS, ACTION_TILT);
+      }
+    }
+    std::sort(script.begin(), script.end(), [](const Action &a, const Action &b) { return a.atUs < b.atUs; });
+  }
+
+  void add(uint32_t atMs, ActionKind kind) {
+    Action action = {(uint64_t)atMs * 1000, kind};
+    script.push_back(action);
+  }
+
+  // Apply an action; true if it raises an interrupt that wakes the task
+  bool fire(const Action &action) {
+    switch (action.kind) {
+      case ACTION_PRESENT: reader.present(OWNER_CARD, sizeof(OWNER_CARD)); return false;
+      case ACTION_TAKE:    reader.remove(); return false;
+      case ACTION_FINGER:  finger.placeFinger(FINGER_OWNER); return true;
+      case ACTION_LIFT:    finger.liftFinger(); return false;
+      case ACTION_TILT:    gpio.trigger(TILT_PIN); return true;
+    }
+    return false;
+  }
+
+  // Sleep until the planned wake-up or the first interrupt before it
+  void sleep(uint32_t ms, uint64_t endUs) {
+    uint64_t wake = clock.nowMicros() + (uint64_t)ms * 1000;
+    for (;;) {
+      uint64_t irq = reader.getAnswerAt();
+      if (irq > clock.nowMicros() && irq < wake) wake = irq;
+      if (wake > endUs) wake = endUs;
+      if (next >= script.size() || script[next].atUs >= wake) break;
+      // Actions that fell inside the last pass happen as soon as it ends
+      if (script[next].atUs > clock.nowMicros()) clock.advanceUs((uint32_t)(script[next].atUs - clock.nowMicros()));
+      if (fire(script[next++])) return;
+    }
+    if (wake > clock.nowMicros()) clock.advanceUs((uint32_t)(wake - clock.nowMicros()));
+  }
+
+  void run() {
+    uint64_t endUs = (uint64_t)RUN_MS * 1000;
+    const PowerScheduler &power = system.getPowerScheduler();
+    while (clock.nowMicros() < endUs) {
+      uint32_t cardsBefore = power.getWakeCount(WAKE_CARD);
+      system.update();
+      if (power.getWakeCount(WAKE_CARD) != cardsBefore) cardWakes.push_back(reader.getPresentLatency());
+      sleep(system.planSleep(), endUs);
+    }
+  }
+
+  ProfileResult result(const char* name) {
+    const PowerScheduler &power = system.getPowerScheduler();
+    ProfileResult r = ProfileResult();
+    r.name = name;
+    r.currentUa = system.estimateCurrent();
+    uint64_t total = power.getAwakeUs() + power.getSleepUs();
+    r.awakePercent = total ? 100.0 * (double)power.getAwakeUs() / (double)total : 0;
+    r.wakesPerSecond = (double)(power.getTimerWakes() + power.getEventWakes()) * 1000.0 / RUN_MS;
+    r.radioPercent = 100.0 * system.getRadioOnTime() / RUN_MS;
+    r.alarms = power.getWakeCount(WAKE_TAMPER);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < cardWakes.size(); i++) {
+      sum += cardWakes[i];
+      if (cardWakes[i] > r.cardWakeMaxUs) r.cardWakeMaxUs = cardWakes[i];
+    }
+    r.cardWakeAvgUs = cardWakes.empty() ? 0 : (uint32_t)(sum / cardWakes.size());
+    r.holdMinMs = 0xFFFFFFFFu;
+    for (size_t i = 0; i < gpio.holdsMs.size(); i++) {
+      if (gpio.holdsMs[i] < r.holdMinMs) r.holdMinMs = gpio.holdsMs[i];
+      if (gpio.holdsMs[i] > r.holdMaxMs) r.holdMaxMs = gpio.holdsMs[i];
+    }
+    r.unlocks = (uint32_t)gpio.holdsMs.size();
+    for (size_t i = 0; i < script.size(); i++) {
+      if (script[i].kind == ACTION_PRESENT) r.users++;
+    }
+    return r;
+  }
+};
+
+static ProfileResult results[POWER_PROFILE_COUNT];
+
+static void runProfile(uint8_t profile) {
+  Door door(profile);
+  door.run();
+  ProfileResult r = door.result(powerProfile(profile).name);
+  results[profile] = r;
+
+  printf("%-12s %7.2f mA  awake %5.2f%%  %6.2f wakes/s  card wake avg %3u ms max %3u ms  "
+         "alarms %u  radio on %5.1f%%  relay held %u-%u ms\n",
+         r.name, r.currentUa / 1000.0, r.awakePercent, r.wakesPerSecond, r.cardWakeAvgUs / 1000,
+         r.cardWakeMaxUs / 1000, r.alarms, r.radioPercent, r.holdMinMs, r.holdMaxMs);
+
+  TEST_ASSERT_EQUAL_UINT32(r.users, r.unlocks);
+  TEST_ASSERT_EQUAL_UINT32(2, r.alarms);
+  const PowerProfile &settings = powerProfile(profile);
+  TEST_ASSERT_TRUE(r.cardWakeMaxUs <= (settings.reqaInterval + RFID_FIELD_SETTLE) * 1000UL);
+  if (settings.lightSleep) {
+    TEST_ASSERT_EQUAL_UINT32(UNLOCK_DURATION, r.holdMinMs);
+    TEST_ASSERT_EQUAL_UINT32(UNLOCK_DURATION, r.holdMaxMs);
+  } else {
+    TEST_ASSERT_TRUE(r.holdMinMs >= UNLOCK_DURATION && r.holdMaxMs < UNLOCK_DURATION + SECURITY_TICK);
+  }
+}
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_always_on(void) {
+  runProfile(POWER_ALWAYS_ON);
+}
+
+void test_duty_cycled(void) {
+  runProfile(POWER_DUTY_CYCLED);
+}
+
+void test_on_demand(void) {
+  runProfile(POWER_ON_DEMAND);
+}
+
+void test_profiles_rank_by_current(void) {
+  TEST_ASSERT_TRUE(results[POWER_DUTY_CYCLED].currentUa < results[POWER_ALWAYS_ON].currentUa / 4);
+  TEST_ASSERT_TRUE(results[POWER_ON_DEMAND].currentUa < results[POWER_DUTY_CYCLED].currentUa);
+  TEST_ASSERT_TRUE(results[POWER_ON_DEMAND].radioPercent < 25.0);
+}
+
+int main() {
+  printf("%d s per profile, a user every %d s, %u tamper bursts\n", RUN_MS / 1000, USER_PERIOD_MS / 1000,
+         (unsigned)(sizeof(TAMPER_AT_MS) / sizeof(TAMPER_AT_MS[0])));
+  UNITY_BEGIN();
+  RUN_TEST(test_always_on);
+  RUN_TEST(test_duty_cycled);
+  RUN_TEST(test_on_demand);
+  RUN_TEST(test_profiles_rank_by_current);
+  return UNITY_END();
+}
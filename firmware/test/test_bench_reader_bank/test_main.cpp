@@ -0,0 +1,295 @@
+// Reader bank scaling: the same traffic on one controller with 1, 2, 4 and
+// 8 readers. Two loads per size:
+//
+//   taps  every reader is tapped again as soon as it takes cards, with a
+//         card the table rejects, so detection runs flat out without
+//         queuing for the shared finger sensor. Aggregate detections/s
+//         should grow in proportion to the readers, and the worst
+//         card-to-detection latency stay within one REQA period plus the
+//         card reads queued ahead of it on the bus.
+//   rack  a user at every reader every 20 s with card and finger. Everyone
+//         gets in and the wait for the shared sensor is reported. Passes
+//         run the lanes one after another, so a relay is held for
+//         UNLOCK_DURATION plus at most one sensor exchange on another lane.
+//
+// REQA slots run as the bank's timer would and passes as the security task
+// would: the loop sleeps until the next slot, card answer, lane deadline or
+// user action.
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "hal_sim.h"
+#include "reader_bank.h"
+
+#define TAP_RUN_MS       60000
+#define RACK_RUN_MS      600000
+#define TAP_GAP_MS       150      // Next card after the reader takes cards again,
+#define TAP_JITTER_MS    47       // plus up to this much, so taps land at any phase of the slots
+#define USER_PERIOD_MS   20011    // A user per reader about every 20 s
+#define USER_STAGGER_MS  1009     // Between the readers' first users
+#define FINGER_DELAY_MS  400      // Prompt to finger on the sensor
+
+// Simulated device costs, as in test_bench_auth
+#define READ_CARD_US     2500
+#define CAPTURE_US       130000
+#define CONVERT_US       250000
+#define SEARCH_BASE_US   15000
+
+#define BANK_IRQ         4
+#define FIRST_RELAY      25
+#define FIRST_FINGER     100
+
+static const uint8_t STRANGER[] = {0xEE, 0x01, 0x02, 0x03};
+static const uint8_t SIZES[] = {1, 2, 4, 8};
+#define SIZE_COUNT (sizeof(SIZES) / sizeof(SIZES[0]))
+
+// Records how long each relay stays energized
+class RelayGpio : public SimGpio {
+private:
+  SimClock &clock;
+  uint64_t unlockedAt[SIM_GPIO_PINS];
+
+public:
+  std::vector<uint32_t> holdsUs;
+
+  RelayGpio(SimClock &_clock) : clock(_clock) {
+    memset(unlockedAt, 0, sizeof(unlockedAt));
+  }
+
+  void write(uint8_t pin, uint8_t level) override {
+    if (pin >= FIRST_RELAY && pin < FIRST_RELAY + RFID_MAX_READERS) {
+      if (level == LOW && unlockedAt[pin] == 0) {
+        unlockedAt[pin] = clock.nowMicros();
+      } else if (level == HIGH && unlockedAt[pin] != 0) {
+        holdsUs.push_back((uint32_t)(clock.nowMicros() - unlockedAt[pin]));
+        unlockedAt[pin] = 0;
+      }
+    }
+    SimGpio::write(pin, level);
+  }
+};
+
+struct SizeResult {
+  uint8_t readers;
+  uint32_t periodUs;
+  double tapsPerSecond;
+  uint32_t detectAvgUs;
+  uint32_t detectMaxUs;
+  uint32_t users;
+  uint32_t granted;
+  uint32_t refused;
+  uint32_t holdMinUs;
+  uint32_t holdMaxUs;
+  uint32_t sensorWaitMaxMs;
+};
+
+// One person per reader
+struct Visitor {
+  uint8_t card[4];
+  uint64_t arriveAtUs;    // Next card, 0 until a tapped reader takes cards again
+  uint64_t fingerAtUs;    // Finger on the sensor once prompted, 0 if not due
+  bool carding;           // Card presented, not detected yet
+  bool attempting;        // Card detected, waiting for the decision
+  bool prompted;
+  uint32_t detections;
+  uint32_t decisions;
+  uint64_t matchedAt;     // Lane reached the finger step
+};
+
+struct Rack {
+  SimClock clock;
+  RelayGpio gpio;
+  SimFingerprintSensor finger;
+  AuthorizedCards cards;
+  std::vector<SimCardReader> readers;
+  ReaderBank bank;
+  std::vector<Visitor> visitors;
+  bool taps;
+
+  std::vector<uint32_t> detectUs;
+  uint32_t sensorWaitMaxMs;
+
+  Rack(uint8_t count, bool _taps)
+    : gpio(clock), finger(clock), bank(gpio, clock, finger, cards), taps(_taps), sensorWaitMaxMs(0) {
+    finger.captureTimeUs = CAPTURE_US;
+    finger.convertTimeUs = CONVERT_US;
+    finger.searchBaseUs = SEARCH_BASE_US;
+    clock.advance(1000);
+    readers.reserve(count);
+    for (uint8_t i = 0; i < count; i++) {
+      readers.emplace_back(clock);
+      readers[i].readTimeUs = READ_CARD_US;
+      bank.addLane(readers[i], FIRST_RELAY + i);
+
+      Visitor visitor = Visitor();
+      uint8_t card[4] = {0xC0, i, 0x5A, 0x31};
+      memcpy(visitor.card, taps ? STRANGER : card, sizeof(visitor.card));
+      visitor.arriveAtUs = clock.nowMicros() + (uint64_t)(taps ? TAP_GAP_MS + i * 7 : 1000 + i * USER_STAGGER_MS) * 1000;
+      visitors.push_back(visitor);
+      if (!taps) {
+        cards.add(card, sizeof(card), i + 1);
+        finger.enroll(i + 1, FIRST_FINGER + i);
+      }
+    }
+    bank.begin(BANK_IRQ);
+  }
+
+  // Users react to what the last pass did; true if one acted now
+  bool observe() {
+    uint64_t now = clock.nowMicros();
+    bool acted = false;
+    for (uint8_t i = 0; i < visitors.size(); i++) {
+      Visitor &v = visitors[i];
+      const BankLane &lane = bank.getLane(i);
+      if (v.carding && lane.getDetections() != v.detections) {
+        v.carding = false;
+        v.attempting = true;
+        v.detections = lane.getDetections();
+        detectUs.push_back(readers[i].getPresentLatency());
+      }
+      if (v.attempting && lane.getGranted() + lane.getRejected() != v.decisions) {
+        v.decisions = lane.getGranted() + lane.getRejected();
+        v.attempting = false;
+        v.prompted = false;
+        if (!taps) {
+          finger.liftFinger();
+          v.arriveAtUs += (uint64_t)USER_PERIOD_MS * 1000;
+        }
+      }
+      if (v.attempting && !v.prompted && lane.getState() == AUTH_AWAIT_FINGER && v.matchedAt == 0) v.matchedAt = now;
+      if (v.attempting && !v.prompted && bank.getSensorLane() == i) {
+        v.prompted = true;
+        uint32_t waited = (uint32_t)((now - v.matchedAt) / 1000);
+        if (waited > sensorWaitMaxMs) sensorWaitMaxMs = waited;
+        v.matchedAt = 0;
+        v.fingerAtUs = now + (uint64_t)FINGER_DELAY_MS * 1000;
+      }
+
+      if (v.fingerAtUs != 0 && v.fingerAtUs <= now) {
+        finger.placeFinger(FIRST_FINGER + i);
+        v.fingerAtUs = 0;
+        acted = true;
+      }
+      if (taps && !v.carding && !v.attempting && lane.getState() == AUTH_IDLE && v.arriveAtUs == 0) {
+        v.arriveAtUs = now + (uint64_t)(TAP_GAP_MS + (v.detections * 13 + i * 7) % TAP_JITTER_MS) * 1000;
+      }
+      if (!v.carding && !v.attempting && v.arriveAtUs != 0 && v.arriveAtUs <= now) {
+        readers[i].present(v.card, sizeof(v.card));
+        v.carding = true;
+        if (taps) v.arriveAtUs = 0;
+        acted = true;
+      }
+    }
+    return acted;
+  }
+
+  void run(uint32_t ms) {
+    uint64_t endUs = clock.nowMicros() + (uint64_t)ms * 1000;
+    while (clock.nowMicros() < endUs) {
+      uint32_t slotWaitUs = bank.serviceSlots(clock.micros());
+      uint32_t waitMs = bank.update();
+      if (observe()) continue;
+
+      uint64_t now = clock.nowMicros();
+      uint64_t wake = now + slotWaitUs;
+      if (waitMs != UINT32_MAX && now + (uint64_t)waitMs * 1000 < wake) wake = now + (uint64_t)waitMs * 1000;
+      for (uint8_t i = 0; i < readers.size(); i++) {
+        uint64_t answer = readers[i].getAnswerAt();
+        if (answer > now && answer < wake) wake = answer;
+        uint64_t actions[] = {visitors[i].arriveAtUs, visitors[i].fingerAtUs};
+        for (uint8_t k = 0; k < 2; k++) {
+          if (actions[k] > now && actions[k] < wake) wake = actions[k];
+        }
+      }
+      if (wake > endUs) wake = endUs;
+      if (wake > now) clock.advanceUs((uint32_t)(wake - now));
+    }
+  }
+};
+
+static SizeResult results[SIZE_COUNT];
+
+static void runSize(uint8_t index) {
+  SizeResult &r = results[index];
+  r.readers = SIZES[index];
+
+  Rack tapped(r.readers, true);
+  tapped.run(TAP_RUN_MS);
+  r.periodUs = tapped.bank.getScheduler().getPeriod();
+  r.tapsPerSecond = (double)tapped.detectUs.size() * 1000.0 / TAP_RUN_MS;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < tapped.detectUs.size(); i++) {
+    sum += tapped.detectUs[i];
+    if (tapped.detectUs[i] > r.detectMaxUs) r.detectMaxUs = tapped.detectUs[i];
+  }
+  r.detectAvgUs = tapped.detectUs.empty() ? 0 : (uint32_t)(sum / tapped.detectUs.size());
+
+  Rack rack(r.readers, false);
+  rack.run(RACK_RUN_MS);
+  r.holdMinUs = 0xFFFFFFFFu;
+  for (size_t i = 0; i < rack.gpio.holdsUs.size(); i++) {
+    if (rack.gpio.holdsUs[i] < r.holdMinUs) r.holdMinUs = rack.gpio.holdsUs[i];
+    if (rack.gpio.holdsUs[i] > r.holdMaxUs) r.holdMaxUs = rack.gpio.holdsUs[i];
+  }
+  for (uint8_t i = 0; i < r.readers; i++) {
+    r.users += rack.visitors[i].detections;
+    r.granted += rack.bank.getLane(i).getGranted();
+    r.refused += rack.bank.getLane(i).getRejected();
+  }
+  r.sensorWaitMaxMs = rack.sensorWaitMaxMs;
+
+  printf("%u readers  period %5.1f ms  taps %6.2f/s  detect avg %5.1f ms max %5.1f ms  |  "
+         "users %3u granted %3u refused %u  sensor wait max %4u ms  hold max +%u ms\n",
+         r.readers, r.periodUs / 1000.0, r.tapsPerSecond, r.detectAvgUs / 1000.0, r.detectMaxUs / 1000.0,
+         (unsigned)r.users, (unsigned)r.granted, (unsigned)r.refused, (unsigned)r.sensorWaitMaxMs,
+         (unsigned)(r.holdMaxUs / 1000 - UNLOCK_DURATION));
+
+  TEST_ASSERT_TRUE(r.detectMaxUs <= r.periodUs + r.readers * READ_CARD_US);
+  TEST_ASSERT_TRUE(r.users > 0);
+  TEST_ASSERT_EQUAL_UINT32(r.users, r.granted);
+  TEST_ASSERT_EQUAL_UINT32(0, r.refused);
+  TEST_ASSERT_TRUE(r.holdMinUs >= (UNLOCK_DURATION - 1) * 1000UL);
+  TEST_ASSERT_TRUE(r.holdMaxUs <= (UNLOCK_DURATION + 1) * 1000UL + CONVERT_US);
+  TEST_ASSERT_TRUE(r.sensorWaitMaxMs < FP_SCAN_TIMEOUT / 2);
+}
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_one_reader(void) {
+  runSize(0);
+}
+
+void test_two_readers(void) {
+  runSize(1);
+}
+
+void test_four_readers(void) {
+  runSize(2);
+}
+
+void test_eight_readers(void) {
+  runSize(3);
+}
+
+void test_detection_scales_with_readers(void) {
+  for (uint8_t i = 1; i < SIZE_COUNT; i++) {
+    TEST_ASSERT_TRUE(results[i].tapsPerSecond >= 0.95 * results[i].readers * results[0].tapsPerSecond);
+    TEST_ASSERT_TRUE(results[i].detectMaxUs <= results[i].readers * results[0].detectMaxUs);
+  }
+}
+
+int main() {
+  printf("Taps for %d s, then a user per reader every %d s for %d s\n", TAP_RUN_MS / 1000,
+         USER_PERIOD_MS / 1000, RACK_RUN_MS / 1000);
+  UNITY_BEGIN();
+  RUN_TEST(test_one_reader);
+  RUN_TEST(test_two_readers);
+  RUN_TEST(test_four_readers);
+  RUN_TEST(test_eight_readers);
+  RUN_TEST(test_detection_scales_with_readers);
+  return UNITY_END();
+}
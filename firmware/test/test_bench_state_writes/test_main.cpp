@@ -0,0 +1,142 @@
+// Storage traffic for 1,000 authentication attempts, replayed against the
+// old per-attempt NVS counter and against the write-back SecurityState.
+// The security loop ticks every 100 ms; one attempt starts every 4 s, about
+// a third of them fail, and every 100th attempt opens a burst of failures
+// long enough to trigger a lockout.
+#include <unity.h>
+#include <string.h>
+#include "security_state.h"
+
+#define ATTEMPTS        1000
+#define TICK            100
+#define ATTEMPT_PERIOD  4000
+#define MAX_FAILURES    5
+#define LOCKOUT         300000
+
+class CountingStore : public RecordStore {
+public:
+  SecurityRecord slots[2];
+  bool present[2];
+  uint32_t reads;
+  uint32_t writes;
+
+  CountingStore() : reads(0), writes(0) { present[0] = present[1] = false; }
+
+  bool readRecord(uint8_t slot, SecurityRecord &record) override {
+    reads++;
+    if (!present[slot]) return false;
+    record = slots[slot];
+    return true;
+  }
+
+  bool writeRecord(uint8_t slot, const SecurityRecord &record) override {
+    writes++;
+    slots[slot] = record;
+    present[slot] = true;
+    return true;
+  }
+};
+
+// The previous StorageManager: every check reads "fail_attempt", every
+// attempt reads and writes it. NVS skips writes of an unchanged value, so
+// only changing writes are counted.
+class LegacyCounter {
+public:
+  uint32_t value;
+  uint32_t reads;
+  uint32_t writes;
+
+  LegacyCounter() : value(0), reads(0), writes(0) {}
+
+  uint32_t get() {
+    reads++;
+    return value;
+  }
+
+  void put(uint32_t v) {
+    if (v != value) writes++;
+    value = v;
+  }
+};
+
+static uint32_t rng = 12345;
+static uint32_t legacyWrites = 0;
+
+static bool attemptFails(uint32_t n, uint32_t &burst) {
+  if (n % 100 == 50) burst = MAX_FAILURES;
+  if (burst > 0) {
+    burst--;
+    return true;
+  }
+  rng = rng * 1103515245u + 12345u;
+  return (rng >> 16) % 3 == 0;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_legacy_writes(void) {
+  LegacyCounter nvs;
+  uint32_t lockoutStart = 0;
+  uint32_t attempts = 0, burst = 0, lockouts = 0;
+  rng = 12345;
+
+  for (uint32_t now = TICK; attempts < ATTEMPTS; now += TICK) {
+    if (lockoutStart > 0) {
+      if (now - lockoutStart < LOCKOUT) continue;
+      lockoutStart = 0;
+      nvs.put(0);  // resetFailedAttempts()
+    }
+    if (nvs.get() >= MAX_FAILURES) {  // checkAuthentication(), every tick
+      lockoutStart = now;
+      lockouts++;
+      continue;
+    }
+    if (now % ATTEMPT_PERIOD == 0) {
+      bool success = !attemptFails(attempts++, burst);
+      uint32_t failed = nvs.get();  // logAccessAttempt()
+      nvs.put(success ? 0 : failed + 1);
+    }
+  }
+  printf("legacy       %5u writes  %6u reads  %u lockouts\n",
+         (unsigned)nvs.writes, (unsigned)nvs.reads, (unsigned)lockouts);
+  TEST_ASSERT_GREATER_THAN(0, lockouts);
+  legacyWrites = nvs.writes;
+}
+
+void test_write_back_writes(void) {
+  CountingStore store;
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  uint32_t attempts = 0, burst = 0, lockouts = 0;
+  bool wasLocked = false;
+  rng = 12345;
+
+  for (uint32_t now = TICK; attempts < ATTEMPTS; now += TICK) {
+    state.update(now);
+    if (state.isLockedOut()) {
+      if (!wasLocked) lockouts++;
+      wasLocked = true;
+      continue;
+    }
+    wasLocked = false;
+    if (now % ATTEMPT_PERIOD == 0) {
+      state.recordAttempt(!attemptFails(attempts++, burst), now);
+    }
+  }
+  printf("write-back   %5u writes  %6u reads  %u lockouts\n",
+         (unsigned)store.writes, (unsigned)store.reads, (unsigned)lockouts);
+  TEST_ASSERT_GREATER_THAN(0, lockouts);
+  // Every failure is written through, so the saving is the success resets
+  // and the polling reads
+  TEST_ASSERT_LESS_THAN(legacyWrites, store.writes);
+  TEST_ASSERT_LESS_THAN(10, store.reads);
+}
+
+int main() {
+  printf("%d attempts, one every %d ms\n", ATTEMPTS, ATTEMPT_PERIOD);
+  UNITY_BEGIN();
+  RUN_TEST(test_legacy_writes);
+  RUN_TEST(test_write_back_writes);
+  return UNITY_END();
+}
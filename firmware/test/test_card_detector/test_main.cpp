@@ -0,0 +1,112 @@
+#include <unity.h>
+#include "card_detector.h"
+
+#define STALE  500000
+
+static CardDetector* detector;
+
+// One timer tick: send REQA if allowed
+static bool tick(uint32_t now) {
+  if (!detector->shouldSendReqa(now)) return false;
+  detector->onReqaSent(40);
+  return true;
+}
+
+void setUp(void) {
+  static CardDetector instance(STALE);
+  instance = CardDetector(STALE);
+  detector = &instance;
+}
+
+void tearDown(void) {}
+
+void test_no_card_keeps_polling(void) {
+  for (uint32_t t = 0; t < 1000000; t += 50000) {
+    TEST_ASSERT_TRUE(tick(t));
+    TEST_ASSERT_FALSE(detector->takeDetection(t + 1000));
+  }
+  TEST_ASSERT_EQUAL_UINT32(20, detector->getReqaSent());
+  TEST_ASSERT_EQUAL_UINT32(20 * 40, detector->getReqaTimeTotal());
+}
+
+void test_answer_is_reported_once(void) {
+  tick(0);
+  detector->onIrq(1200);
+  TEST_ASSERT_TRUE(detector->takeDetection(5200));
+  TEST_ASSERT_FALSE(detector->takeDetection(5300));
+  TEST_ASSERT_EQUAL_UINT32(1, detector->getDetections());
+  TEST_ASSERT_EQUAL_UINT32(4000, detector->getPickupAverage());
+}
+
+void test_holds_off_until_card_is_read(void) {
+  tick(0);
+  detector->onIrq(1000);
+  TEST_ASSERT_TRUE(detector->takeDetection(2000));
+  TEST_ASSERT_FALSE(tick(50000));   // Would reset the card before select
+  TEST_ASSERT_FALSE(tick(100000));
+  detector->rearm();
+  TEST_ASSERT_TRUE(tick(150000));
+}
+
+void test_reader_traffic_is_ignored(void) {
+  tick(0);
+  detector->onIrq(1000);
+  detector->takeDetection(2000);
+  detector->onIrq(3000);  // Anticollision / select answers during the read
+  detector->onIrq(3500);
+  detector->rearm();
+  detector->onIrq(4000);  // Nothing outstanding
+  TEST_ASSERT_FALSE(detector->takeDetection(5000));
+  TEST_ASSERT_EQUAL_UINT32(4, detector->getIrqs());
+  TEST_ASSERT_EQUAL_UINT32(3, detector->getIgnoredIrqs());
+}
+
+void test_unread_detection_goes_stale(void) {
+  tick(0);
+  detector->onIrq(1000);
+  TEST_ASSERT_FALSE(tick(STALE));
+  TEST_ASSERT_TRUE(tick(STALE + 1000));
+  TEST_ASSERT_EQUAL_UINT32(1, detector->getStale());
+}
+
+void test_counts_unanswered_reqa(void) {
+  tick(0);
+  detector->onIrq(1000);           // Answered
+  detector->takeDetection(2000);
+  detector->rearm();
+  tick(100000);                    // Answered again: the card never left
+  detector->onIrq(101000);
+  detector->takeDetection(102000);
+  detector->rearm();
+  TEST_ASSERT_EQUAL_UINT32(0, detector->getUnanswered());
+  tick(200000);
+  tick(300000);                    // The one at 200 ms found the field empty
+  TEST_ASSERT_EQUAL_UINT32(1, detector->getUnanswered());
+}
+
+void test_reqa_over_a_stale_detection_is_not_unanswered(void) {
+  tick(0);
+  detector->onIrq(1000);
+  tick(STALE + 1000);              // The awake card ignores this one
+  tick(STALE + 50000);
+  TEST_ASSERT_EQUAL_UINT32(0, detector->getUnanswered());
+}
+
+void test_busy_reader_skips_tick(void) {
+  detector->onBusy();
+  TEST_ASSERT_EQUAL_UINT32(1, detector->getBusySkips());
+  TEST_ASSERT_EQUAL_UINT32(0, detector->getReqaSent());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_card_keeps_polling);
+  RUN_TEST(test_answer_is_reported_once);
+  RUN_TEST(test_holds_off_until_card_is_read);
+  RUN_TEST(test_reader_traffic_is_ignored);
+  RUN_TEST(test_unread_detection_goes_stale);
+  RUN_TEST(test_counts_unanswered_reqa);
+  RUN_TEST(test_reqa_over_a_stale_detection_is_not_unanswered);
+  RUN_TEST(test_busy_reader_skips_tick);
+  return UNITY_END();
+}
@@ -0,0 +1,152 @@
+#include <unity.h>
+#include <string.h>
+#include "card_table.h"
+
+static const uint8_t UID4[] = {0x63, 0x5A, 0x59, 0x31};
+static const uint8_t UID7[] = {0x04, 0xA2, 0x3B, 0x1C, 0x5D, 0x80, 0x00};
+static const uint8_t UID10[] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x10, 0xFE};
+
+static CardTable<64> table;
+
+void setUp(void) {
+  table.clear();
+}
+
+void tearDown(void) {}
+
+void test_lookup_all_uid_sizes(void) {
+  TEST_ASSERT_TRUE(table.add(UID4, 4, 1));
+  TEST_ASSERT_TRUE(table.add(UID7, 7, 2));
+  TEST_ASSERT_TRUE(table.add(UID10, 10, CARD_ANY_FINGER));
+  TEST_ASSERT_EQUAL_UINT16(3, table.size());
+
+  const CardRecord* card = table.find(UID7, 7);
+  TEST_ASSERT_NOT_NULL(card);
+  TEST_ASSERT_EQUAL_UINT16(2, card->fingerprintId);
+  TEST_ASSERT_TRUE(card->flags & CARD_FLAG_ENABLED);
+  TEST_ASSERT_NOT_NULL(table.find(UID4, 4));
+  TEST_ASSERT_NOT_NULL(table.find(UID10, 10));
+}
+
+void test_uid_size_is_part_of_the_key(void) {
+  // A 4-byte card must not match the first 4 bytes of a longer UID
+  TEST_ASSERT_TRUE(table.add(UID10, 10, 0));
+  TEST_ASSERT_NULL(table.find(UID10, 4));
+  TEST_ASSERT_NULL(table.find(UID10, 7));
+  TEST_ASSERT_FALSE(table.add(UID10, 5, 0));  // Not an ISO 14443 size
+}
+
+void test_add_existing_updates_metadata(void) {
+  TEST_ASSERT_TRUE(table.add(UID4, 4, 1));
+  TEST_ASSERT_TRUE(table.add(UID4, 4, 9, false));
+  TEST_ASSERT_EQUAL_UINT16(1, table.size());
+  TEST_ASSERT_EQUAL_UINT16(9, table.find(UID4, 4)->fingerprintId);
+  TEST_ASSERT_FALSE(table.find(UID4, 4)->flags & CARD_FLAG_ENABLED);
+  TEST_ASSERT_TRUE(table.setEnabled(UID4, 4, true));
+  TEST_ASSERT_TRUE(table.find(UID4, 4)->flags & CARD_FLAG_ENABLED);
+}
+
+void test_stays_sorted_and_removes(void) {
+  uint8_t uid[4] = {0, 0, 0, 0};
+  for (int i = 63; i >= 0; i--) {
+    uid[3] = (uint8_t)(i * 7 % 64);  // Insert out of order
+    TEST_ASSERT_TRUE(table.add(uid, 4, (uint16_t)i));
+  }
+  TEST_ASSERT_EQUAL_UINT16(64, table.size());
+  TEST_ASSERT_FALSE(table.add(UID7, 7, 0));  // Full
+  for (uint16_t i = 0; i < 64; i++) {
+    TEST_ASSERT_EQUAL_UINT8(i, table.at(i).uid[3]);
+  }
+
+  uid[3] = 10;
+  TEST_ASSERT_TRUE(table.remove(uid, 4));
+  TEST_ASSERT_FALSE(table.remove(uid, 4));
+  TEST_ASSERT_NULL(table.find(uid, 4));
+  uid[3] = 11;
+  TEST_ASSERT_NOT_NULL(table.find(uid, 4));
+  TEST_ASSERT_EQUAL_UINT16(63, table.size());
+  TEST_ASSERT_TRUE(table.add(UID7, 7, 0));
+}
+
+void test_blob_round_trip(void) {
+  table.add(UID4, 4, 1);
+  table.add(UID7, 7, 2, false);
+  table.add(UID10, 10, 3);
+  size_t length = table.seal();
+  TEST_ASSERT_EQUAL_UINT32(sizeof(CardTableHeader) + 3 * sizeof(CardRecord), length);
+
+  static uint8_t stored[sizeof(CardTableHeader) + 64 * sizeof(CardRecord)];
+  memcpy(stored, table.blobData(), length);
+
+  static CardTable<64> loaded;
+  memcpy(loaded.blobData(), stored, length);
+  TEST_ASSERT_TRUE(loaded.accept(length));
+  TEST_ASSERT_EQUAL_UINT16(3, loaded.size());
+  TEST_ASSERT_EQUAL_UINT16(2, loaded.find(UID7, 7)->fingerprintId);
+  TEST_ASSERT_FALSE(loaded.find(UID7, 7)->flags & CARD_FLAG_ENABLED);
+}
+
+void test_rejects_corrupt_or_foreign_blobs(void) {
+  table.add(UID4, 4, 1);
+  table.add(UID7, 7, 2);
+  size_t length = table.seal();
+  static uint8_t stored[sizeof(CardTableHeader) + 2 * sizeof(CardRecord)];
+  memcpy(stored, table.blobData(), length);
+
+  static CardTable<64> loaded;
+
+  // Flipped record byte
+  memcpy(loaded.blobData(), stored, length);
+  loaded.blobData()[sizeof(CardTableHeader) + 3] ^= 0x01;
+  TEST_ASSERT_FALSE(loaded.accept(length));
+  TEST_ASSERT_EQUAL_UINT16(0, loaded.size());
+
+  // Truncated
+  memcpy(loaded.blobData(), stored, length);
+  TEST_ASSERT_FALSE(loaded.accept(length - 1));
+
+  // Newer format version
+  memcpy(loaded.blobData(), stored, length);
+  reinterpret_cast<CardTableHeader*>(loaded.blobData())->version = CARD_TABLE_VERSION + 1;
+  TEST_ASSERT_FALSE(loaded.accept(length));
+
+  // More records than this build can hold
+  static CardTable<1> small;
+  memcpy(small.blobData(), stored, sizeof(CardTableHeader) + sizeof(CardRecord));
+  TEST_ASSERT_FALSE(small.accept(length));
+}
+
+void test_bound_finger_ranges(void) {
+  TEST_ASSERT_TRUE(table.add(UID4, 4, 20));
+  TEST_ASSERT_EQUAL_UINT8(1, table.find(UID4, 4)->fingerprintCount);
+  TEST_ASSERT_TRUE(table.bindFingers(UID4, 4, 20, 3));
+  TEST_ASSERT_EQUAL_UINT16(20, table.find(UID4, 4)->fingerprintId);
+  TEST_ASSERT_EQUAL_UINT8(3, table.find(UID4, 4)->fingerprintCount);
+  TEST_ASSERT_TRUE(table.bindFingers(UID4, 4, 20, 0));  // Back to any finger
+  TEST_ASSERT_EQUAL_UINT16(CARD_ANY_FINGER, table.find(UID4, 4)->fingerprintId);
+  TEST_ASSERT_EQUAL_UINT8(0, table.find(UID4, 4)->fingerprintCount);
+  TEST_ASSERT_FALSE(table.bindFingers(UID7, 7, 1, 1));  // Not enrolled
+
+  // Tables stored before page ranges existed have a zero count
+  table.add(UID7, 7, 5);
+  table.add(UID10, 10, CARD_ANY_FINGER);
+  const_cast<CardRecord&>(*table.find(UID7, 7)).fingerprintCount = 0;
+  size_t length = table.seal();
+  static CardTable<64> loaded;
+  memcpy(loaded.blobData(), table.blobData(), length);
+  TEST_ASSERT_TRUE(loaded.accept(length));
+  TEST_ASSERT_EQUAL_UINT8(1, loaded.find(UID7, 7)->fingerprintCount);
+  TEST_ASSERT_EQUAL_UINT8(0, loaded.find(UID10, 10)->fingerprintCount);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lookup_all_uid_sizes);
+  RUN_TEST(test_uid_size_is_part_of_the_key);
+  RUN_TEST(test_add_existing_updates_metadata);
+  RUN_TEST(test_stays_sorted_and_removes);
+  RUN_TEST(test_blob_round_trip);
+  RUN_TEST(test_rejects_corrupt_or_foreign_blobs);
+  RUN_TEST(test_bound_finger_ranges);
+  return UNITY_END();
+}
@@ -0,0 +1,140 @@
+#include <unity.h>
+#include "hal_sim.h"
+#include "enroll_job.h"
+
+#define FINGER        5
+#define OTHER_FINGER  6
+#define STEP_TIMEOUT  5000
+
+// Simulated R307 timings, so each step's cost is visible on the clock
+#define CAPTURE_US    130000
+#define CONVERT_US    250000
+
+struct Rig {
+  SimClock clock;
+  SimFingerprintSensor sensor;
+  EnrollJob job;
+  uint32_t longestStepUs;
+
+  Rig() : sensor(clock), job(sensor, STEP_TIMEOUT), longestStepUs(0) {
+    sensor.captureTimeUs = CAPTURE_US;
+    sensor.convertTimeUs = CONVERT_US;
+  }
+
+  // Step the job on a 10 ms loop for up to ms; stops at an outcome
+  EnrollOutcome run(uint32_t ms) {
+    uint32_t end = clock.millis() + ms;
+    while ((int32_t)(end - clock.millis()) > 0) {
+      uint64_t before = clock.nowMicros();
+      EnrollOutcome outcome = job.update(clock.millis());
+      uint32_t took = (uint32_t)(clock.nowMicros() - before);
+      if (took > longestStepUs) longestStepUs = took;
+      if (outcome != ENROLL_PENDING) return outcome;
+      clock.advance(10);
+    }
+    return ENROLL_PENDING;
+  }
+
+  // Touch and lift the finger once per image until the job ends
+  EnrollOutcome present(uint16_t finger, uint8_t images) {
+    EnrollOutcome outcome = ENROLL_PENDING;
+    for (uint8_t i = 0; i < images && outcome == ENROLL_PENDING; i++) {
+      sensor.placeFinger(finger);
+      outcome = run(1000);
+      sensor.liftFinger();
+      if (outcome == ENROLL_PENDING) outcome = run(300);
+    }
+    return outcome;
+  }
+};
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_samples_go_to_consecutive_pages(void) {
+  Rig rig;
+  TEST_ASSERT_TRUE(rig.job.begin(20, 3, rig.clock.millis()));
+  TEST_ASSERT_FALSE(rig.job.begin(40, 1, rig.clock.millis()));   // One job at a time
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_DONE, rig.present(FINGER, 6));
+  for (uint16_t page = 20; page < 23; page++) {
+    TEST_ASSERT_EQUAL_UINT16(FINGER, rig.sensor.enrolledAt(page));
+  }
+  TEST_ASSERT_EQUAL_UINT16(0, rig.sensor.enrolledAt(23));
+  TEST_ASSERT_EQUAL_UINT8(3, rig.job.getSamplesStored());
+  TEST_ASSERT_FALSE(rig.job.isActive());
+
+  // Never more than one sensor exchange per step
+  TEST_ASSERT_TRUE(rig.longestStepUs <= CONVERT_US);
+}
+
+void test_nobody_at_the_sensor_times_out(void) {
+  Rig rig;
+  rig.job.begin(20, 1, rig.clock.millis());
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_PENDING, rig.run(STEP_TIMEOUT - 200));
+  uint32_t left = rig.job.getStepTimeLeft(rig.clock.millis());
+  TEST_ASSERT_TRUE(left > 0 && left <= 200);
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_TIMED_OUT, rig.run(1000));
+  TEST_ASSERT_FALSE(rig.job.isActive());
+  TEST_ASSERT_EQUAL_UINT16(0, rig.sensor.enrolledAt(20));
+}
+
+void test_finger_left_on_the_sensor_times_out(void) {
+  Rig rig;
+  rig.job.begin(20, 1, rig.clock.millis());
+  rig.sensor.placeFinger(FINGER);
+  rig.run(1000);
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_AWAIT_LIFT, rig.job.getState());
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_TIMED_OUT, rig.run(STEP_TIMEOUT + 1000));
+  TEST_ASSERT_EQUAL_UINT16(0, rig.sensor.enrolledAt(20));
+}
+
+void test_cancel_keeps_stored_samples(void) {
+  Rig rig;
+  rig.job.begin(20, 2, rig.clock.millis());
+  rig.present(FINGER, 3);
+  TEST_ASSERT_EQUAL_UINT8(1, rig.job.getSamplesStored());
+  TEST_ASSERT_TRUE(rig.job.cancel());
+  TEST_ASSERT_FALSE(rig.job.cancel());
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_PENDING, rig.run(STEP_TIMEOUT * 2));   // Stays stopped
+  TEST_ASSERT_EQUAL_UINT16(FINGER, rig.sensor.enrolledAt(20));
+  TEST_ASSERT_EQUAL_UINT16(0, rig.sensor.enrolledAt(21));
+}
+
+void test_unclear_image_is_captured_again(void) {
+  Rig rig;
+  rig.sensor.convertFailures = 1;
+  rig.job.begin(20, 1, rig.clock.millis());
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_DONE, rig.present(FINGER, 2));
+  TEST_ASSERT_EQUAL_UINT16(FINGER, rig.sensor.enrolledAt(20));
+
+  // A sensor that never converts gives up instead of looping
+  rig.sensor.convertFailures = 255;
+  rig.job.begin(30, 1, rig.clock.millis());
+  rig.sensor.placeFinger(FINGER);
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_FAILED, rig.run(STEP_TIMEOUT));
+}
+
+void test_mismatched_images_restart_the_sample(void) {
+  Rig rig;
+  rig.job.begin(20, 1, rig.clock.millis());
+  rig.present(FINGER, 1);
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_PENDING, rig.present(OTHER_FINGER, 1));
+  TEST_ASSERT_EQUAL_UINT8(1, rig.job.getImage());
+  TEST_ASSERT_EQUAL_UINT16(0, rig.sensor.enrolledAt(20));
+  TEST_ASSERT_EQUAL_UINT8(ENROLL_DONE, rig.present(FINGER, 2));
+  TEST_ASSERT_EQUAL_UINT16(FINGER, rig.sensor.enrolledAt(20));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_samples_go_to_consecutive_pages);
+  RUN_TEST(test_nobody_at_the_sensor_times_out);
+  RUN_TEST(test_finger_left_on_the_sensor_times_out);
+  RUN_TEST(test_cancel_keeps_stored_samples);
+  RUN_TEST(test_unclear_image_is_captured_again);
+  RUN_TEST(test_mismatched_images_restart_the_sample);
+  return UNITY_END();
+}
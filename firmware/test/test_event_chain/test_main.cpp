@@ -0,0 +1,224 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "event_chain.h"
+
+static const uint8_t UID4[] = {0x63, 0x5A, 0x59, 0x31};
+
+#define DEVICE 7
+
+// Same vectors as "Anchoring" in blockchain/test.js
+static const char* LEAF1 = "8bb8b4008c9ba4f979e3658ca942e8cc246c897fbfe109764e90e9c92fffba27";
+static const char* LEAF3 = "e2b75e0c23ec9c5b8e0d363b7a88c66f2415874921250cbe2dd7348a6aa30ae0";
+static const char* ROOT3 = "8a3d5530ff9695dccd4866de83577f4733c77f221a4f49d1f62edeab88f61604";
+
+typedef std::vector<uint8_t> Hash;
+
+static void toHex(const uint8_t* hash, char hex[65]) {
+  static const char DIGITS[] = "0123456789abcdef";
+  for (int i = 0; i < 32; i++) {
+    hex[2 * i] = DIGITS[hash[i] >> 4];
+    hex[2 * i + 1] = DIGITS[hash[i] & 0x0F];
+  }
+  hex[64] = '\0';
+}
+
+static AccessEvent eventNumber(uint32_t i) {
+  uint8_t uid[4] = {0x63, 0x5A, (uint8_t)(i >> 8), (uint8_t)i};
+  if (i % 9 == 8) return AccessEvent::tamper(i * 1000);
+  return AccessEvent::access(i * 1000, uid, 4, i % 3 != 0, (uint16_t)(i % 128));
+}
+
+// Leaves of events first..first+count-1, chained from prev
+static std::vector<Hash> leavesOf(uint32_t first, uint32_t count, const uint8_t prev[32]) {
+  std::vector<Hash> leaves;
+  Hash head(prev, prev + 32);
+  for (uint32_t i = 0; i < count; i++) {
+    AccessEvent event = eventNumber(first + i);
+    uint8_t record[RECORD_BYTES];
+    packRecord(record, event, DEVICE);
+    Hash leaf(32);
+    hashLeaf(head.data(), first + i, event.timestamp, record, leaf.data());
+    leaves.push_back(leaf);
+    head = leaf;
+  }
+  return leaves;
+}
+
+// Reference tree, level by level; an unpaired node moves up unchanged
+static Hash referenceRoot(std::vector<Hash> level) {
+  while (level.size() > 1) {
+    std::vector<Hash> next;
+    for (size_t i = 0; i < level.size(); i += 2) {
+      if (i + 1 == level.size()) {
+        next.push_back(level[i]);
+      } else {
+        Hash node(32);
+        hashNode(level[i].data(), level[i + 1].data(), node.data());
+        next.push_back(node);
+      }
+    }
+    level = next;
+  }
+  return level[0];
+}
+
+static std::vector<Hash> referenceProof(std::vector<Hash> level, size_t index) {
+  std::vector<Hash> proof;
+  while (level.size() > 1) {
+    size_t sibling = index ^ 1;
+    if (sibling < level.size()) proof.push_back(level[sibling]);
+    std::vector<Hash> next;
+    for (size_t i = 0; i < level.size(); i += 2) {
+      if (i + 1 == level.size()) {
+        next.push_back(level[i]);
+      } else {
+        Hash node(32);
+        hashNode(level[i].data(), level[i + 1].data(), node.data());
+        next.push_back(node);
+      }
+    }
+    level = next;
+    index /= 2;
+  }
+  return proof;
+}
+
+// Mirror of RFIDAccess.verifyEvent
+static bool verify(Hash leaf, size_t index, size_t count, const std::vector<Hash> &proof, const uint8_t root[32]) {
+  size_t used = 0;
+  while (count > 1) {
+    if (index % 2 == 1) {
+      if (used == proof.size()) return false;
+      hashNode(proof[used++].data(), leaf.data(), leaf.data());
+    } else if (index + 1 < count) {
+      if (used == proof.size()) return false;
+      hashNode(leaf.data(), proof[used++].data(), leaf.data());
+    }
+    index /= 2;
+    count = (count + 1) / 2;
+  }
+  return used == proof.size() && memcmp(leaf.data(), root, 32) == 0;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_leaf_and_root_vectors(void) {
+  EventChain chain;
+  chain.restore(ChainCheckpoint::initial(), DEVICE);
+  TEST_ASSERT_EQUAL_UINT32(1, chain.append(AccessEvent::access(1000, UID4, 4, true, 1), 0));
+  char hex[65];
+  toHex(chain.getHead(), hex);
+  TEST_ASSERT_EQUAL_STRING(LEAF1, hex);
+
+  chain.append(AccessEvent::access(2000, UID4, 4, false, 0), 0);
+  chain.append(AccessEvent::tamper(3000), 0);
+  AnchorWindow window;
+  TEST_ASSERT_TRUE(chain.window(window));
+  TEST_ASSERT_EQUAL_UINT32(1, window.firstSeq);
+  TEST_ASSERT_EQUAL_UINT32(3, window.lastSeq);
+  toHex(window.root, hex);
+  TEST_ASSERT_EQUAL_STRING(ROOT3, hex);
+  toHex(window.head, hex);
+  TEST_ASSERT_EQUAL_STRING(LEAF3, hex);
+}
+
+void test_streaming_root_matches_tree(void) {
+  uint8_t zero[32] = {0};
+  for (uint32_t count = 1; count <= 70; count++) {
+    EventChain chain;
+    chain.restore(ChainCheckpoint::initial(), DEVICE);
+    for (uint32_t i = 0; i < count; i++) chain.append(eventNumber(1 + i), 0);
+    AnchorWindow window;
+    TEST_ASSERT_TRUE(chain.window(window));
+    Hash expected = referenceRoot(leavesOf(1, count, zero));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), window.root, 32);
+  }
+}
+
+void test_every_event_has_an_inclusion_proof(void) {
+  uint8_t zero[32] = {0};
+  for (uint32_t count = 1; count <= 20; count++) {
+    std::vector<Hash> leaves = leavesOf(1, count, zero);
+    Hash root = referenceRoot(leaves);
+    for (uint32_t index = 0; index < count; index++) {
+      std::vector<Hash> proof = referenceProof(leaves, index);
+      TEST_ASSERT_TRUE(verify(leaves[index], index, count, proof, root.data()));
+
+      // A different event or position, or a cut proof, does not verify
+      Hash forged = leaves[index];
+      forged[0] ^= 1;
+      TEST_ASSERT_FALSE(verify(forged, index, count, proof, root.data()));
+      if (count > 1) {
+        TEST_ASSERT_FALSE(verify(leaves[index], (index + 1) % count, count, proof, root.data()));
+        std::vector<Hash> cut(proof.begin(), proof.end() - 1);
+        TEST_ASSERT_FALSE(verify(leaves[index], index, count, cut, root.data()));
+      }
+    }
+  }
+}
+
+void test_windows_chain_into_each_other(void) {
+  EventChain chain;
+  chain.restore(ChainCheckpoint::initial(), DEVICE);
+  for (uint32_t i = 1; i <= 5; i++) chain.append(eventNumber(i), 100);
+  AnchorWindow first;
+  chain.window(first);
+  chain.commit();
+  AnchorWindow empty;
+  TEST_ASSERT_FALSE(chain.window(empty));
+  TEST_ASSERT_EQUAL_UINT32(0, chain.getWindowSize());
+
+  for (uint32_t i = 6; i <= 8; i++) chain.append(eventNumber(i), 200);
+  AnchorWindow second;
+  TEST_ASSERT_TRUE(chain.window(second));
+  TEST_ASSERT_EQUAL_UINT32(6, second.firstSeq);
+  TEST_ASSERT_EQUAL_UINT32(8, second.lastSeq);
+  TEST_ASSERT_EQUAL_UINT32(200, chain.getWindowOpenedAt());
+
+  // The second window's first leaf commits to the first window's head
+  Hash expected = referenceRoot(leavesOf(6, 3, first.head));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), second.root, 32);
+}
+
+void test_restore_replays_the_same_window(void) {
+  EventChain live;
+  live.restore(ChainCheckpoint::initial(), DEVICE);
+  for (uint32_t i = 1; i <= 4; i++) live.append(eventNumber(i), 0);
+  live.commit();
+  ChainCheckpoint checkpoint = live.checkpoint();
+  TEST_ASSERT_EQUAL_UINT32(5, checkpoint.nextSeq);
+  for (uint32_t i = 5; i <= 11; i++) live.append(eventNumber(i), 0);
+  AnchorWindow before;
+  live.window(before);
+
+  // Reboot: the same undelivered events are chained again from the checkpoint
+  EventChain rebooted;
+  rebooted.restore(checkpoint, DEVICE);
+  for (uint32_t i = 5; i <= 11; i++) TEST_ASSERT_EQUAL_UINT32(i, rebooted.append(eventNumber(i), 0));
+  AnchorWindow after;
+  rebooted.window(after);
+  TEST_ASSERT_EQUAL_UINT32(before.firstSeq, after.firstSeq);
+  TEST_ASSERT_EQUAL_UINT32(before.lastSeq, after.lastSeq);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(before.root, after.root, 32);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(before.head, after.head, 32);
+
+  // Another band's records give another chain
+  EventChain other;
+  other.restore(checkpoint, DEVICE + 1);
+  for (uint32_t i = 5; i <= 11; i++) other.append(eventNumber(i), 0);
+  other.window(after);
+  TEST_ASSERT_NOT_EQUAL(0, memcmp(before.root, after.root, 32));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_leaf_and_root_vectors);
+  RUN_TEST(test_streaming_root_matches_tree);
+  RUN_TEST(test_every_event_has_an_inclusion_proof);
+  RUN_TEST(test_windows_chain_into_each_other);
+  RUN_TEST(test_restore_replays_the_same_window);
+  return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#define CASHBAND_ALLOC_AUDIT
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "alloc_audit.h"
+#include "config.h"
+#include "event_codec.h"
+
+static const uint8_t UID4[] = {0x63, 0x5A, 0x59, 0x31};
+static const uint8_t UID7[] = {0x04, 0xA2, 0x3B, 0x1C, 0x5D, 0x80, 0x00};
+static const uint8_t UID10[] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x10, 0xFE};
+
+#define GUARD 0x5A
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Same vector as "Should accept the firmware's packed record" in blockchain/test.js
+static const char RECORD4[] =
+  "0x635A593100000000000004000100000000070000000000000000000000000000";
+
+void test_record_layout(void) {
+  uint8_t record[RECORD_BYTES];
+  packRecord(record, AccessEvent::access(0, UID7, 7, false, 0x1234), 0xA1B2C3D4);
+  static const uint8_t expected[RECORD_BYTES] = {
+    0x04, 0xA2, 0x3B, 0x1C, 0x5D, 0x80, 0x00, 0x00, 0x00, 0x00,   // uid, left-aligned
+    7,                                                              // uidLength
+    0x12, 0x34,                                                     // fingerprintId
+    RECORD_DENY,
+    0xA1, 0xB2, 0xC3, 0xD4                                          // deviceId
+  };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, record, RECORD_BYTES);
+
+  packRecord(record, AccessEvent::access(0, UID10, 10, true, 65535), 1);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(UID10, record, 10);
+  TEST_ASSERT_EQUAL_UINT8(10, record[10]);
+  TEST_ASSERT_EQUAL_UINT8(RECORD_UNLOCK, record[13]);
+}
+
+void test_events(void) {
+  char buffer[256];
+  AccessEvent events[2] = {AccessEvent::access(1000, UID4, 4, true, 1), AccessEvent::tamper(3000)};
+  encodeEventsJson(buffer, sizeof(buffer), events, 2, 7, 41);
+  char expected[256];
+  snprintf(expected, sizeof(expected), "{\"device\":7,\"events\":[{\"seq\":41,\"t\":1000,\"record\":\"%s\"},"
+           "{\"seq\":42,\"t\":3000,\"record\":\"0x"
+           "0000000000000000000000000002000000070000000000000000000000000000\"}]}", RECORD4);
+  TEST_ASSERT_EQUAL_STRING(expected, buffer);
+  encodeEventsJson(buffer, sizeof(buffer), events, 0, 7, 41);
+  TEST_ASSERT_EQUAL_STRING("{\"device\":7,\"events\":[]}", buffer);
+}
+
+void test_full_events_batch_fits_payload(void) {
+  char buffer[PAYLOAD_CAPACITY];
+  AccessEvent events[BATCH_MAX_EVENTS];
+  for (int i = 0; i < BATCH_MAX_EVENTS; i++) events[i] = AccessEvent::access(4000000000u, UID10, 10, true, 100);
+  size_t length = encodeEventsJson(buffer, sizeof(buffer), events, BATCH_MAX_EVENTS, 0xFFFFFFFF, 4000000000u);
+  TEST_ASSERT_EQUAL_UINT32(eventsJsonMax(BATCH_MAX_EVENTS), length);
+  TEST_ASSERT_EQUAL_UINT32(1152, length);
+  TEST_ASSERT_TRUE(length < PAYLOAD_CAPACITY);
+}
+
+void test_anchor(void) {
+  uint8_t root[32], head[32];
+  for (int i = 0; i < 32; i++) {
+    root[i] = (uint8_t)i;
+    head[i] = (uint8_t)(0xFF - i);
+  }
+  char buffer[256];
+  size_t length = encodeAnchorJson(buffer, sizeof(buffer), 7, 65, 128, root, head);
+  TEST_ASSERT_EQUAL_UINT32(strlen(buffer), length);
+  TEST_ASSERT_EQUAL_STRING("{\"device\":7,\"firstSeq\":65,\"lastSeq\":128,"
+                           "\"root\":\"0x000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F\","
+                           "\"head\":\"0xFFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F0EFEEEDECEBEAE9E8E7E6E5E4E3E2E1E0\"}",
+                           buffer);
+}
+
+void test_exact_fit(void) {
+  char reference[128];
+  AccessEvent event = AccessEvent::access(0, UID4, 4, true, 1);
+  size_t length = encodeEventsJson(reference, sizeof(reference), &event, 1, 1, 1);
+
+  char buffer[128];
+  TEST_ASSERT_EQUAL_UINT32(length, encodeEventsJson(buffer, length + 1, &event, 1, 1, 1));
+  TEST_ASSERT_EQUAL_STRING(reference, buffer);
+  TEST_ASSERT_EQUAL_UINT32(0, encodeEventsJson(buffer, length, &event, 1, 1, 1));
+}
+
+void test_overflow_stays_in_bounds(void) {
+  AccessEvent events[10];
+  for (int i = 0; i < 10; i++) events[i] = AccessEvent::access(0, UID10, 10, true, 100);
+
+  for (size_t capacity = 0; capacity < 64; capacity++) {
+    char buffer[80];
+    memset(buffer, GUARD, sizeof(buffer));
+    TEST_ASSERT_EQUAL_UINT32(0, encodeEventsJson(buffer, capacity, events, 10, 1, 1));
+    if (capacity > 0) TEST_ASSERT_EQUAL_CHAR('\0', buffer[0]);
+    for (size_t i = capacity; i < sizeof(buffer); i++) {
+      TEST_ASSERT_EQUAL_HEX8(GUARD, (uint8_t)buffer[i]);
+    }
+  }
+}
+
+void test_encoding_does_not_allocate(void) {
+  char buffer[PAYLOAD_CAPACITY];
+  AccessEvent events[10];
+  for (int i = 0; i < 10; i++) events[i] = AccessEvent::access(0, UID10, 10, true, (uint16_t)i);
+  uint8_t root[32] = {0};
+
+  uint32_t before = allocationCount();
+  encodeEventsJson(buffer, sizeof(buffer), events, 10, 1, 1);
+  encodeEventsJson(buffer, 16, events, 10, 1, 1);
+  encodeAnchorJson(buffer, sizeof(buffer), 1, 1, 10, root, root);
+  TEST_ASSERT_EQUAL_UINT32(before, allocationCount());
+
+  char* probe = new char[8];  // The counter itself works
+  delete[] probe;
+  TEST_ASSERT_EQUAL_UINT32(before + 1, allocationCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_record_layout);
+  RUN_TEST(test_events);
+  RUN_TEST(test_full_events_batch_fits_payload);
+  RUN_TEST(test_anchor);
+  RUN_TEST(test_exact_fit);
+  RUN_TEST(test_overflow_stays_in_bounds);
+  RUN_TEST(test_encoding_does_not_allocate);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <unity.h>
+#include <stdio.h>
+#include "event_outbox.h"
+
+// Four 4 KiB sectors = 512 records, of which one sector is kept as erase headroom
+#define FLASH_SIZE   (4 * 4096)
+#define FLASH_IMAGE  "outbox_test.bin"
+
+static AccessEvent makeEvent(uint32_t n) {
+  uint8_t uid[4] = {0x63, 0x5A, 0x59, (uint8_t)n};
+  return AccessEvent::access(n, uid, sizeof(uid), true, (uint16_t)n);
+}
+
+void setUp(void) {
+  remove(FLASH_IMAGE);
+}
+
+void tearDown(void) {
+  remove(FLASH_IMAGE);
+}
+
+void test_empty_outbox(void) {
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+
+  AccessEvent event;
+  TEST_ASSERT_FALSE(outbox.peek(event));
+  TEST_ASSERT_FALSE(outbox.ack());
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.getPending());
+}
+
+void test_replay_in_order(void) {
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+
+  for (uint32_t i = 0; i < 10; i++) {
+    TEST_ASSERT_TRUE(outbox.append(makeEvent(i)));
+  }
+
+  AccessEvent event;
+  for (uint32_t i = 0; i < 10; i++) {
+    TEST_ASSERT_TRUE(outbox.peek(event));
+    TEST_ASSERT_EQUAL_UINT32(i, event.timestamp);
+    TEST_ASSERT_TRUE(outbox.ack());
+  }
+  TEST_ASSERT_FALSE(outbox.peek(event));
+}
+
+void test_survives_reboot_without_resending(void) {
+  {
+    FileFlash flash(FLASH_SIZE);
+    TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+    EventOutbox outbox(flash);
+    TEST_ASSERT_TRUE(outbox.begin());
+    for (uint32_t i = 0; i < 20; i++) {
+      outbox.append(makeEvent(i));
+    }
+    for (uint32_t i = 0; i < 7; i++) {
+      outbox.ack();
+    }
+  }
+
+  // Power cycle
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+  TEST_ASSERT_EQUAL_UINT32(13, outbox.getPending());
+
+  AccessEvent event;
+  TEST_ASSERT_TRUE(outbox.peek(event));
+  TEST_ASSERT_EQUAL_UINT32(7, event.timestamp);
+
+  // New events continue after the recovered ones
+  TEST_ASSERT_TRUE(outbox.append(makeEvent(100)));
+  for (uint32_t i = 7; i < 20; i++) {
+    TEST_ASSERT_TRUE(outbox.peek(event));
+    TEST_ASSERT_EQUAL_UINT32(i, event.timestamp);
+    outbox.ack();
+  }
+  TEST_ASSERT_TRUE(outbox.peek(event));
+  TEST_ASSERT_EQUAL_UINT32(100, event.timestamp);
+}
+
+void test_torn_write_is_skipped(void) {
+  {
+    FileFlash flash(FLASH_SIZE);
+    TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+    EventOutbox outbox(flash);
+    TEST_ASSERT_TRUE(outbox.begin());
+    for (uint32_t i = 0; i < 3; i++) {
+      outbox.append(makeEvent(i));
+    }
+    // Power lost after the body of record 3 was written but before its state word
+    uint8_t body[28];
+    memset(body, 0x00, sizeof(body));
+    flash.write(3 * sizeof(OutboxRecord) + 4, body, sizeof(body));
+  }
+
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+  TEST_ASSERT_EQUAL_UINT32(3, outbox.getPending());
+
+  TEST_ASSERT_TRUE(outbox.append(makeEvent(3)));
+  AccessEvent event;
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(outbox.peek(event));
+    TEST_ASSERT_EQUAL_UINT32(i, event.timestamp);
+    outbox.ack();
+  }
+
+  // The interrupted record must not reappear after another reboot
+  EventOutbox again(flash);
+  TEST_ASSERT_TRUE(again.begin());
+  TEST_ASSERT_EQUAL_UINT32(0, again.getPending());
+}
+
+void test_wraps_and_levels_wear(void) {
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+
+  // Several laps around the ring with prompt delivery
+  AccessEvent event;
+  for (uint32_t i = 0; i < 2000; i++) {
+    TEST_ASSERT_TRUE(outbox.append(makeEvent(i)));
+    TEST_ASSERT_TRUE(outbox.peek(event));
+    TEST_ASSERT_EQUAL_UINT32(i, event.timestamp);
+    TEST_ASSERT_TRUE(outbox.ack());
+    outbox.maintain();
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.getEvicted());
+  // 2000 records over 128-record sectors: each erase covers one sector in turn
+  TEST_ASSERT_LESS_OR_EQUAL(2000 / 128 + 2, outbox.getErases());
+
+  EventOutbox reopened(flash);
+  TEST_ASSERT_TRUE(reopened.begin());
+  TEST_ASSERT_EQUAL_UINT32(0, reopened.getPending());
+  TEST_ASSERT_TRUE(reopened.append(makeEvent(5000)));
+  TEST_ASSERT_TRUE(reopened.peek(event));
+  TEST_ASSERT_EQUAL_UINT32(5000, event.timestamp);
+}
+
+void test_overflow_evicts_oldest(void) {
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+
+  // Server unreachable: far more events than the outbox holds
+  for (uint32_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_TRUE(outbox.append(makeEvent(i)));
+    outbox.maintain();
+  }
+  TEST_ASSERT_GREATER_THAN(0, outbox.getEvicted());
+  TEST_ASSERT_EQUAL_UINT32(1000, outbox.getPending() + outbox.getEvicted());
+
+  // The newest events are kept, still in order
+  AccessEvent event;
+  uint32_t previous = 0;
+  bool first = true;
+  while (outbox.peek(event)) {
+    if (!first) TEST_ASSERT_EQUAL_UINT32(previous + 1, event.timestamp);
+    previous = event.timestamp;
+    first = false;
+    outbox.ack();
+  }
+  TEST_ASSERT_EQUAL_UINT32(999, previous);
+}
+
+void test_append_is_single_program_when_maintained(void) {
+  FileFlash flash(FLASH_SIZE);
+  TEST_ASSERT_TRUE(flash.open(FLASH_IMAGE));
+  EventOutbox outbox(flash);
+  TEST_ASSERT_TRUE(outbox.begin());
+
+  AccessEvent event;
+  for (uint32_t i = 0; i < 600; i++) {
+    outbox.maintain();
+    uint32_t erasesBefore = flash.erases;
+    uint32_t writesBefore = flash.writes;
+    TEST_ASSERT_TRUE(outbox.append(makeEvent(i)));
+    TEST_ASSERT_EQUAL_UINT32(erasesBefore, flash.erases);
+    TEST_ASSERT_EQUAL_UINT32(writesBefore + 2, flash.writes);  // Body + commit word
+    outbox.peek(event);
+    outbox.ack();
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_outbox);
+  RUN_TEST(test_replay_in_order);
+  RUN_TEST(test_survives_reboot_without_resending);
+  RUN_TEST(test_torn_write_is_skipped);
+  RUN_TEST(test_wraps_and_levels_wear);
+  RUN_TEST(test_overflow_evicts_oldest);
+  RUN_TEST(test_append_is_single_program_when_maintained);
+  return UNITY_END();
+}
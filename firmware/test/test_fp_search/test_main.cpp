@@ -0,0 +1,53 @@
+#include <unity.h>
+#include "fp_search.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_encode_range_command(void) {
+  uint8_t data[FP_SEARCH_COMMAND_LENGTH];
+  encodeSearchCommand(data, 1, 0x0123, 3);
+  const uint8_t expected[] = {0x04, 0x01, 0x01, 0x23, 0x00, 0x03};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, data, sizeof(expected));
+}
+
+void test_decode_match(void) {
+  const uint8_t reply[] = {0x00, 0x00, 0x2A, 0x00, 0x9C};
+  uint16_t pageId = 0;
+  uint16_t score = 0;
+  FpResult result = decodeSearchReply(reply, sizeof(reply), pageId, score);
+  TEST_ASSERT_EQUAL(FP_OK, result);
+  TEST_ASSERT_EQUAL_UINT16(42, pageId);
+  TEST_ASSERT_EQUAL_UINT16(156, score);
+}
+
+void test_decode_not_found(void) {
+  const uint8_t reply[] = {0x09, 0x00, 0x00, 0x00, 0x00};
+  uint16_t pageId = 7;
+  uint16_t score = 7;
+  FpResult result = decodeSearchReply(reply, sizeof(reply), pageId, score);
+  TEST_ASSERT_EQUAL(FP_NO_MATCH, result);
+  TEST_ASSERT_EQUAL_UINT16(7, pageId);  // Untouched
+}
+
+void test_decode_errors(void) {
+  const uint8_t commError[] = {0x01, 0x00, 0x00, 0x00, 0x00};
+  const uint8_t shortReply[] = {0x00, 0x00, 0x2A};
+  uint16_t pageId = 0;
+  uint16_t score = 0;
+  FpResult result = decodeSearchReply(commError, sizeof(commError), pageId, score);
+  TEST_ASSERT_EQUAL(FP_ERROR, result);
+  result = decodeSearchReply(shortReply, sizeof(shortReply), pageId, score);
+  TEST_ASSERT_EQUAL(FP_ERROR, result);
+  result = decodeSearchReply(shortReply, 0, pageId, score);
+  TEST_ASSERT_EQUAL(FP_ERROR, result);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_encode_range_command);
+  RUN_TEST(test_decode_match);
+  RUN_TEST(test_decode_not_found);
+  RUN_TEST(test_decode_errors);
+  return UNITY_END();
+}
@@ -0,0 +1,96 @@
+#include <unity.h>
+#include <string.h>
+#include "latency_metrics.h"
+
+static LatencyHistogram histogram;
+
+void setUp(void) {
+  histogram.reset();
+}
+
+void tearDown(void) {}
+
+void test_bucket_boundaries(void) {
+  TEST_ASSERT_EQUAL_UINT8(0, LatencyHistogram::bucketFor(0));
+  TEST_ASSERT_EQUAL_UINT8(1, LatencyHistogram::bucketFor(1));
+  TEST_ASSERT_EQUAL_UINT8(2, LatencyHistogram::bucketFor(2));
+  TEST_ASSERT_EQUAL_UINT8(2, LatencyHistogram::bucketFor(3));
+  TEST_ASSERT_EQUAL_UINT8(3, LatencyHistogram::bucketFor(4));
+  TEST_ASSERT_EQUAL_UINT8(10, LatencyHistogram::bucketFor(1000));
+  TEST_ASSERT_EQUAL_UINT8(METRIC_BUCKETS - 1, LatencyHistogram::bucketFor(1u << 26));
+  TEST_ASSERT_EQUAL_UINT8(METRIC_BUCKETS - 1, LatencyHistogram::bucketFor(0xFFFFFFFFu));
+  TEST_ASSERT_EQUAL_UINT32(1023, LatencyHistogram::bucketUpperBound(10));
+}
+
+void test_count_average_and_extremes(void) {
+  histogram.add(10);
+  histogram.add(20);
+  histogram.add(30);
+  histogram.add(0xFFFFFFF0u);
+  TEST_ASSERT_EQUAL_UINT32(4, histogram.getCount());
+  TEST_ASSERT_EQUAL_UINT32(10, histogram.getMin());
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0u, histogram.getMax());
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)((60ULL + 0xFFFFFFF0u) / 4), histogram.average());  // No overflow
+}
+
+void test_percentiles_report_bucket_upper_bound(void) {
+  for (int i = 0; i < 90; i++) histogram.add(100);   // Bucket [64, 127]
+  for (int i = 0; i < 9; i++) histogram.add(1000);   // Bucket [512, 1023]
+  histogram.add(5000);
+  TEST_ASSERT_EQUAL_UINT32(127, histogram.percentile(50));
+  TEST_ASSERT_EQUAL_UINT32(127, histogram.percentile(90));
+  TEST_ASSERT_EQUAL_UINT32(1023, histogram.percentile(99));
+  TEST_ASSERT_EQUAL_UINT32(5000, histogram.percentile(100));  // Capped at max
+}
+
+void test_empty_histogram(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.percentile(50));
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.average());
+}
+
+void test_stage_json(void) {
+  histogram.add(3);
+  histogram.add(5);
+  char buffer[256];
+  FixedWriter out(buffer, sizeof(buffer));
+  encodeStageJson(out, METRIC_FP_SEARCH, histogram);
+  TEST_ASSERT_TRUE(out.finish() > 0);
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"s\":\"fp_search\",\"n\":2,\"avg\":4,\"p50\":3,\"p90\":5,\"p99\":5,\"max\":5,\"b\":[0,0,1,1]}", buffer);
+}
+
+void test_stage_json_overflow(void) {
+  histogram.add(1u << 25);
+  char buffer[32];
+  FixedWriter out(buffer, sizeof(buffer));
+  encodeStageJson(out, METRIC_NET_ACK, histogram);
+  TEST_ASSERT_EQUAL_UINT32(0, out.finish());
+  TEST_ASSERT_EQUAL_STRING("", buffer);
+}
+
+void test_metrics_heap_low_water(void) {
+  Metrics metrics;
+  metrics.sampleHeap(200000, 110000);
+  metrics.sampleHeap(150000, 60000);
+  metrics.sampleHeap(180000, 90000);
+  TEST_ASSERT_EQUAL_UINT32(180000, metrics.getFreeHeap());
+  TEST_ASSERT_EQUAL_UINT32(150000, metrics.getMinFreeHeap());
+  TEST_ASSERT_EQUAL_UINT32(90000, metrics.getLargestBlock());
+  TEST_ASSERT_EQUAL_UINT32(60000, metrics.getMinLargestBlock());
+
+  metrics.record(METRIC_RELAY, 4);
+  metrics.record(METRIC_STAGE_COUNT, 4);  // Ignored
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.stage(METRIC_RELAY).getCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_boundaries);
+  RUN_TEST(test_count_average_and_extremes);
+  RUN_TEST(test_percentiles_report_bucket_upper_bound);
+  RUN_TEST(test_empty_histogram);
+  RUN_TEST(test_stage_json);
+  RUN_TEST(test_stage_json_overflow);
+  RUN_TEST(test_metrics_heap_low_water);
+  return UNITY_END();
+}
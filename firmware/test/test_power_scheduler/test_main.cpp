@@ -0,0 +1,78 @@
+#include <unity.h>
+#include "power_scheduler.h"
+
+#define HOUR_US 3600000000ULL
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_residency_splits_awake_and_asleep(void) {
+  PowerScheduler power(POWER_DUTY_CYCLED);
+  power.sleep(2000, 100);          // Awake from 0 to 2 ms
+  power.sleep(3000, 100);          // Already asleep: ignored
+  power.wake(102000);              // Slept the planned 100 ms
+  power.sleep(103000, 1000);
+  power.wake(153000);              // An interrupt after 50 ms
+  power.wake(160000);              // Not asleep: ignored
+  TEST_ASSERT_EQUAL_UINT32(3000, (uint32_t)power.getAwakeUs());
+  TEST_ASSERT_EQUAL_UINT32(150000, (uint32_t)power.getSleepUs());
+  TEST_ASSERT_EQUAL_UINT32(1, power.getTimerWakes());
+  TEST_ASSERT_EQUAL_UINT32(1, power.getEventWakes());
+}
+
+void test_residency_survives_micros_wrap(void) {
+  PowerScheduler power(POWER_DUTY_CYCLED);
+  power.wake(0);
+  power.sleep(0xFFFFFF00u, 1);
+  power.wake(0x00000100u);
+  TEST_ASSERT_EQUAL_UINT32(0x200, (uint32_t)power.getSleepUs());
+}
+
+void test_wake_latency_per_source(void) {
+  PowerScheduler power(POWER_DUTY_CYCLED);
+  power.noteWake(WAKE_CARD, 1000, 1400);
+  power.noteWake(WAKE_CARD, 5000, 5200);
+  power.noteWake(WAKE_TAMPER, 0xFFFFFFF0u, 0x10);
+  power.noteWake(WAKE_SOURCE_COUNT, 0, 99);
+  TEST_ASSERT_EQUAL_UINT32(2, power.getWakeCount(WAKE_CARD));
+  TEST_ASSERT_EQUAL_UINT32(300, power.getWakeLatencyAverage(WAKE_CARD));
+  TEST_ASSERT_EQUAL_UINT32(400, power.getWakeLatencyMax(WAKE_CARD));
+  TEST_ASSERT_EQUAL_UINT32(0x20, power.getWakeLatencyMax(WAKE_TAMPER));
+}
+
+// An hour at 0.1% awake, radio on throughout or for a tenth of it
+static uint32_t idleHour(uint8_t profile, uint64_t radioOnUs) {
+  PowerScheduler power(profile);
+  power.sleep((uint32_t)(HOUR_US / 1000), 1000);
+  power.wake((uint32_t)HOUR_US);
+  return power.estimateCurrent(radioOnUs);
+}
+
+void test_estimate_ranks_the_profiles(void) {
+  uint32_t alwaysOn = idleHour(POWER_ALWAYS_ON, HOUR_US);
+  uint32_t dutyCycled = idleHour(POWER_DUTY_CYCLED, HOUR_US);
+  uint32_t onDemand = idleHour(POWER_ON_DEMAND, HOUR_US / 10);
+
+  // Idle CPU, full field and the radio receiving
+  uint32_t floor = POWER_CPU_IDLE_UA + POWER_RFID_FIELD_UA + POWER_WIFI_ACTIVE_UA;
+  TEST_ASSERT_TRUE(alwaysOn >= floor && alwaysOn < floor + 100);
+  TEST_ASSERT_TRUE(dutyCycled < alwaysOn / 5);
+  TEST_ASSERT_TRUE(onDemand < dutyCycled);
+  TEST_ASSERT_TRUE(onDemand > POWER_RFID_IDLE_UA);
+}
+
+void test_no_time_no_estimate(void) {
+  PowerScheduler power(POWER_ALWAYS_ON);
+  TEST_ASSERT_EQUAL_UINT32(0, power.estimateCurrent(0));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_residency_splits_awake_and_asleep);
+  RUN_TEST(test_residency_survives_micros_wrap);
+  RUN_TEST(test_wake_latency_per_source);
+  RUN_TEST(test_estimate_ranks_the_profiles);
+  RUN_TEST(test_no_time_no_estimate);
+  return UNITY_END();
+}
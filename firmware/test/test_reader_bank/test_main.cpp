@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <vector>
+#include "hal_sim.h"
+#include "reader_bank.h"
+
+#define READERS     4
+#define BANK_IRQ    4
+#define STEP_US     250
+
+static const uint8_t RELAYS[READERS] = {25, 26, 32, 33};
+static const uint8_t CARD_A[] = {0xA1, 0x01, 0x02, 0x03};
+static const uint8_t CARD_B[] = {0xB2, 0x01, 0x02, 0x03};
+static const uint8_t STRANGER[] = {0xEE, 0x01, 0x02, 0x03};
+#define FINGER_A    11
+#define FINGER_B    12
+
+struct Rack {
+  SimClock clock;
+  SimGpio gpio;
+  SimFingerprintSensor sensor;
+  AuthorizedCards cards;
+  std::vector<SimCardReader> readers;
+  ReaderBank bank;
+
+  Rack(uint8_t count = READERS) : sensor(clock), bank(gpio, clock, sensor, cards) {
+    clock.advance(1000);
+    readers.reserve(count);
+    for (uint8_t i = 0; i < count; i++) {
+      readers.emplace_back(clock);
+      bank.addLane(readers[i], RELAYS[i % READERS]);
+    }
+    cards.add(CARD_A, sizeof(CARD_A), 1);
+    cards.add(CARD_B, sizeof(CARD_B), 2);
+    sensor.enroll(1, FINGER_A);
+    sensor.enroll(2, FINGER_B);
+    bank.begin(BANK_IRQ);
+  }
+
+  // REQA slots and passes as the timer and the security task would run them
+  void run(uint32_t ms) {
+    uint64_t end = clock.nowMicros() + (uint64_t)ms * 1000;
+    while (clock.nowMicros() < end) {
+      bank.serviceSlots(clock.micros());
+      bank.update();
+      clock.advanceUs(STEP_US);
+    }
+  }
+};
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_readers_take_turns_within_the_interval(void) {
+  ReaderScheduler scheduler;
+  scheduler.begin(4, 50000, 1000, 0);
+  TEST_ASSERT_EQUAL_UINT32(50000, scheduler.getPeriod());
+  TEST_ASSERT_EQUAL_UINT32(12500, scheduler.getSpacing());
+
+  uint32_t lastAt[4] = {0, 0, 0, 0};
+  int8_t expected = 0;
+  for (uint32_t now = 0; now < 200000; now += 100) {
+    int8_t reader = scheduler.due(now);
+    if (reader < 0) continue;
+    TEST_ASSERT_EQUAL_INT(expected, reader);
+    if (now >= 50000) TEST_ASSERT_EQUAL_UINT32(50000, now - lastAt[reader]);
+    lastAt[reader] = now;
+    scheduler.sent(now);
+    expected = (expected + 1) % 4;
+  }
+  TEST_ASSERT_EQUAL_UINT32(16, scheduler.getSent());
+}
+
+void test_period_stretches_when_slots_do_not_fit(void) {
+  ReaderScheduler scheduler;
+  scheduler.begin(8, 5000, 1000, 0);
+  TEST_ASSERT_EQUAL_UINT32(8000, scheduler.getPeriod());
+  TEST_ASSERT_EQUAL_UINT32(1000, scheduler.getSpacing());
+
+  // A late pass sends the due REQA but the next still waits a slot
+  TEST_ASSERT_EQUAL_INT(0, scheduler.due(4500));
+  scheduler.sent(4500);
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.due(4500));
+  TEST_ASSERT_EQUAL_UINT32(1000, scheduler.untilNext(4500));
+}
+
+void test_busy_bus_keeps_the_turn(void) {
+  ReaderScheduler scheduler;
+  scheduler.begin(3, 30000, 1000, 0);
+  scheduler.sent(0);
+  TEST_ASSERT_EQUAL_INT(1, scheduler.due(10000));
+  scheduler.busy(10000);
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.due(10500));
+  TEST_ASSERT_EQUAL_INT(1, scheduler.due(11000));   // Same reader, a slot later
+  scheduler.sent(11000);
+  TEST_ASSERT_EQUAL_INT(2, scheduler.due(21000));
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.getDeferred());
+
+  // Through the bank: a reader that finds the bus busy is asked again
+  Rack rack(2);
+  rack.readers[1].busBusy = true;
+  rack.run(100);
+  TEST_ASSERT_EQUAL_UINT32(0, rack.readers[1].reqaSent);
+  TEST_ASSERT_EQUAL_UINT32(1, rack.readers[0].reqaSent);
+  rack.readers[1].busBusy = false;
+  rack.run(2);
+  TEST_ASSERT_EQUAL_UINT32(1, rack.readers[1].reqaSent);
+}
+
+void test_card_answers_its_own_readers_reqa(void) {
+  Rack rack;
+  rack.run(60);
+  rack.readers[2].present(STRANGER, sizeof(STRANGER));
+  TEST_ASSERT_TRUE(rack.readers[2].getAnswerAt() == 0);   // No REQA to it yet
+
+  rack.run(RFID_REQA_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT32(1, rack.bank.getLane(2).getDetections());
+  TEST_ASSERT_TRUE(rack.readers[2].getPresentLatency() <= RFID_REQA_INTERVAL * 1000UL + STEP_US);
+  for (uint8_t i = 0; i < READERS; i++) {
+    if (i != 2) TEST_ASSERT_EQUAL_UINT32(0, rack.bank.getLane(i).getDetections());
+    TEST_ASSERT_TRUE(rack.readers[i].reqaSent >= 2);
+  }
+}
+
+void test_lanes_authenticate_independently(void) {
+  Rack rack;
+  rack.readers[0].present(CARD_A, sizeof(CARD_A));
+  rack.readers[1].present(CARD_B, sizeof(CARD_B));
+  rack.readers[3].present(STRANGER, sizeof(STRANGER));
+  rack.run(100);
+  TEST_ASSERT_EQUAL_UINT8(AUTH_AWAIT_FINGER, rack.bank.getLane(0).getState());
+  TEST_ASSERT_EQUAL_UINT8(AUTH_AWAIT_FINGER, rack.bank.getLane(1).getState());
+  TEST_ASSERT_EQUAL_UINT32(1, rack.bank.getLane(3).getRejected());
+  TEST_ASSERT_EQUAL_INT(0, rack.bank.getSensorLane());   // First card matched first
+
+  // Finger A stays on past the grant: lane 1 must not take it for its own
+  rack.sensor.placeFinger(FINGER_A);
+  rack.run(300);
+  TEST_ASSERT_EQUAL_INT(1, rack.bank.getSensorLane());
+  rack.sensor.liftFinger();
+  TEST_ASSERT_TRUE(rack.bank.getLane(0).isUnlocked());
+  TEST_ASSERT_EQUAL_INT(LOW, rack.gpio.read(RELAYS[0]));
+  TEST_ASSERT_EQUAL_INT(HIGH, rack.gpio.read(RELAYS[1]));
+
+  rack.run(300);
+  rack.sensor.placeFinger(FINGER_B);
+  rack.run(300);
+  rack.sensor.liftFinger();
+  TEST_ASSERT_TRUE(rack.bank.getLane(1).isUnlocked());
+  TEST_ASSERT_EQUAL_INT(LOW, rack.gpio.read(RELAYS[1]));
+  TEST_ASSERT_EQUAL_UINT32(0, rack.bank.getLane(1).getRejected());
+  TEST_ASSERT_EQUAL_INT(-1, rack.bank.getSensorLane());
+  TEST_ASSERT_EQUAL_INT(HIGH, rack.gpio.read(RELAYS[3]));
+
+  // Each door locks UNLOCK_DURATION after its own grant
+  rack.run(UNLOCK_DURATION - 700);
+  TEST_ASSERT_EQUAL_INT(HIGH, rack.gpio.read(RELAYS[0]));
+  TEST_ASSERT_EQUAL_INT(LOW, rack.gpio.read(RELAYS[1]));
+  rack.run(700);
+  TEST_ASSERT_EQUAL_INT(HIGH, rack.gpio.read(RELAYS[1]));
+}
+
+void test_shared_irq_goes_to_the_reader_in_its_slot(void) {
+  Rack rack;
+  uint32_t now = rack.clock.micros();
+  rack.bank.serviceSlots(now);   // Reader 0's slot
+  rack.gpio.trigger(BANK_IRQ);
+  TEST_ASSERT_EQUAL_UINT32(1, rack.readers[0].answers);
+
+  rack.clock.advanceUs(RFID_SLOT_TIME + 1);
+  rack.gpio.trigger(BANK_IRQ);    // Slot over: nobody's answer
+  TEST_ASSERT_EQUAL_UINT32(1, rack.readers[0].answers);
+
+  rack.clock.advanceUs(rack.bank.serviceSlots(rack.clock.micros()));
+  rack.bank.serviceSlots(rack.clock.micros());   // Reader 1's slot
+  rack.gpio.trigger(BANK_IRQ);
+  TEST_ASSERT_EQUAL_UINT32(1, rack.readers[1].answers);
+  TEST_ASSERT_EQUAL_UINT32(1, rack.readers[0].answers);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_readers_take_turns_within_the_interval);
+  RUN_TEST(test_period_stretches_when_slots_do_not_fit);
+  RUN_TEST(test_busy_bus_keeps_the_turn);
+  RUN_TEST(test_card_answers_its_own_readers_reqa);
+  RUN_TEST(test_lanes_authenticate_independently);
+  RUN_TEST(test_shared_irq_goes_to_the_reader_in_its_slot);
+  return UNITY_END();
+}
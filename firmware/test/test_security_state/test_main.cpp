@@ -0,0 +1,164 @@
+#include <unity.h>
+#include <string.h>
+#include "security_state.h"
+
+#define MAX_FAILURES  5
+#define LOCKOUT       300000
+
+// Two slots in RAM; can simulate a write torn by a reset
+class MemoryStore : public RecordStore {
+public:
+  SecurityRecord slots[2];
+  bool present[2];
+  uint32_t writes;
+  bool tearNextWrite;
+
+  MemoryStore() { wipe(); }
+
+  void wipe() {
+    memset(slots, 0, sizeof(slots));
+    present[0] = present[1] = false;
+    writes = 0;
+    tearNextWrite = false;
+  }
+
+  bool readRecord(uint8_t slot, SecurityRecord &record) override {
+    if (!present[slot]) return false;
+    record = slots[slot];
+    return true;
+  }
+
+  bool writeRecord(uint8_t slot, const SecurityRecord &record) override {
+    writes++;
+    slots[slot] = record;
+    present[slot] = true;
+    if (tearNextWrite) {
+      memset(reinterpret_cast<uint8_t*>(&slots[slot]) + 8, 0xFF, sizeof(SecurityRecord) - 8);
+      tearNextWrite = false;
+    }
+    return true;
+  }
+};
+
+static MemoryStore store;
+
+void setUp(void) {
+  store.wipe();
+}
+
+void tearDown(void) {}
+
+void test_failures_are_written_through(void) {
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  for (uint32_t i = 0; i < 3; i++) state.recordAttempt(false, 1000 + i * 1000);
+  TEST_ASSERT_EQUAL_UINT32(3, store.writes);
+  TEST_ASSERT_FALSE(state.isDirty());
+
+  // Clearing the count on success is coalesced
+  state.recordAttempt(true, 4000);
+  state.update(5000);
+  TEST_ASSERT_EQUAL_UINT32(3, store.writes);
+  TEST_ASSERT_EQUAL_UINT32(0, state.getFailedAttempts());
+  state.update(4000 + STATE_FLUSH_DELAY);
+  TEST_ASSERT_EQUAL_UINT32(4, store.writes);
+  TEST_ASSERT_FALSE(state.isDirty());
+  state.update(100000);
+  TEST_ASSERT_EQUAL_UINT32(4, store.writes);
+}
+
+void test_failures_survive_reboot(void) {
+  {
+    SecurityState state(store, MAX_FAILURES, LOCKOUT);
+    state.begin(0);
+    for (uint32_t i = 0; i < MAX_FAILURES - 1; i++) state.recordAttempt(false, 100 + i);
+  }
+
+  // Power cut straight after the last failure, before any update()
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  TEST_ASSERT_EQUAL_UINT32(MAX_FAILURES - 1, state.getFailedAttempts());
+  state.recordAttempt(false, 0);
+  TEST_ASSERT_TRUE(state.isLockedOut());
+}
+
+void test_lockout_is_written_immediately(void) {
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  for (uint32_t i = 0; i < MAX_FAILURES; i++) state.recordAttempt(false, 100 + i);
+  TEST_ASSERT_TRUE(state.isLockedOut());
+  TEST_ASSERT_EQUAL_UINT32(MAX_FAILURES, store.writes);
+  TEST_ASSERT_EQUAL_UINT32(LOCKOUT, state.lockoutRemaining(100 + MAX_FAILURES - 1));
+
+  // End of lockout clears the counter and is written too
+  state.update(100 + MAX_FAILURES - 1 + LOCKOUT);
+  TEST_ASSERT_FALSE(state.isLockedOut());
+  TEST_ASSERT_EQUAL_UINT32(0, state.getFailedAttempts());
+  TEST_ASSERT_GREATER_OR_EQUAL(2, store.writes);
+}
+
+void test_lockout_survives_reboot(void) {
+  {
+    SecurityState state(store, MAX_FAILURES, LOCKOUT);
+    state.begin(0);
+    for (uint32_t i = 0; i < MAX_FAILURES; i++) state.recordAttempt(false, 0);
+    for (uint32_t t = 0; t <= 125000; t += 100) state.update(t);  // Two checkpoints
+  }
+
+  // millis() restarts at zero after the reset
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  TEST_ASSERT_TRUE(state.isLockedOut());
+  TEST_ASSERT_EQUAL_UINT32(LOCKOUT - 120000, state.lockoutRemaining(0));
+  TEST_ASSERT_EQUAL_UINT32(MAX_FAILURES, state.getFailedAttempts());
+  state.update(LOCKOUT - 120000);
+  TEST_ASSERT_FALSE(state.isLockedOut());
+}
+
+void test_torn_write_keeps_previous_record(void) {
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  state.recordAttempt(false, 0);
+  store.tearNextWrite = true;
+  state.recordAttempt(false, 10);
+
+  SecurityState rebooted(store, MAX_FAILURES, LOCKOUT);
+  rebooted.begin(0);
+  TEST_ASSERT_EQUAL_UINT32(1, rebooted.getFailedAttempts());
+}
+
+void test_newest_slot_wins(void) {
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  for (uint32_t i = 0; i < 4; i++) {
+    state.recordAttempt(i % 2 == 1, i);
+    state.flush(i);
+  }
+  SecurityState rebooted(store, MAX_FAILURES, LOCKOUT);
+  rebooted.begin(0);
+  TEST_ASSERT_EQUAL_UINT32(2, rebooted.getGranted());
+  TEST_ASSERT_EQUAL_UINT32(2, rebooted.getDenied());
+  TEST_ASSERT_EQUAL_UINT32(0, rebooted.getFailedAttempts());
+}
+
+void test_success_resets_failures(void) {
+  SecurityState state(store, MAX_FAILURES, LOCKOUT);
+  state.begin(0);
+  for (uint32_t i = 0; i < MAX_FAILURES - 1; i++) state.recordAttempt(false, i);
+  state.recordAttempt(true, 10);
+  state.recordAttempt(false, 11);
+  TEST_ASSERT_FALSE(state.isLockedOut());
+  TEST_ASSERT_EQUAL_UINT32(1, state.getFailedAttempts());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_failures_are_written_through);
+  RUN_TEST(test_failures_survive_reboot);
+  RUN_TEST(test_lockout_is_written_immediately);
+  RUN_TEST(test_lockout_survives_reboot);
+  RUN_TEST(test_torn_write_keeps_previous_record);
+  RUN_TEST(test_newest_slot_wins);
+  RUN_TEST(test_success_resets_failures);
+  return UNITY_END();
+}
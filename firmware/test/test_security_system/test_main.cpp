@@ -0,0 +1,587 @@
+#include <unity.h>
+#include <string.h>
+#include "hal_sim.h"
+#include "security_system.h"
+
+static const uint8_t DEFAULT_CARD[] = {0x63, 0x5A, 0x59, 0x31};
+static const uint8_t UNKNOWN_CARD[] = {0x04, 0xA2, 0x3B, 0x1C, 0x5D, 0x80, 0x00};
+
+#define FINGER_OWNER    7
+#define FINGER_STRANGER 9
+#define BANK_RELAY      26    // Second reader's door in the bank tests
+
+// One board: simulated drivers plus the system under test. Storage and the
+// outbox outlive a reboot().
+struct Board {
+  SimClock clock;
+  SimGpio gpio;
+  SimKeyValueStore preferences;
+  SimCardReader reader;
+  SimCardReader second;       // Reader 1 of a bank build
+  SimFingerprintSensor finger;
+  SimTransport net;
+  RamFlash outboxFlash;
+  SecuritySystem* system;
+  bool bank;
+
+  Board(bool _bank = false)
+    : reader(clock), second(clock), finger(clock), outboxFlash(8 * 4096), system(nullptr), bank(_bank) {
+    finger.enroll(3, FINGER_OWNER);
+    reboot();
+  }
+
+  ~Board() {
+    delete system;
+  }
+
+  void reboot(uint8_t powerProfile = POWER_PROFILE) {
+    delete system;
+    system = new SecuritySystem(gpio, clock, preferences, reader, finger, net, outboxFlash);
+    if (bank) {
+      system->addBankReader(reader, RELAY_PIN);
+      system->addBankReader(second, BANK_RELAY);
+    }
+    system->setPowerProfile(powerProfile);
+    system->init();
+  }
+
+  void run(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 10) {
+      system->update();
+      clock.advance(10);
+    }
+  }
+
+  // The card is held to the reader until its detection window and taken
+  // away, then the finger follows 100 ms later
+  void attempt(const uint8_t uid[], uint8_t size, uint16_t fingerId) {
+    reader.present(uid, size);
+    run((uint32_t)((reader.getAnswerAt() - clock.nowMicros()) / 1000) + 50);
+    reader.remove();
+    run(50);
+    finger.placeFinger(fingerId);
+    run(200);
+    finger.liftFinger();
+    run(REJECT_HOLD_TIME);
+  }
+
+  // Bank build: the card waits for its reader's next REQA slot
+  void bankAttempt(SimCardReader &at, const uint8_t uid[], uint8_t size, uint16_t fingerId) {
+    at.present(uid, size);
+    run(RFID_REQA_INTERVAL + 100);
+    finger.placeFinger(fingerId);
+    run(200);
+    finger.liftFinger();
+    run(REJECT_HOLD_TIME);
+  }
+
+  // One pass as the device task makes it: sleep to the planned deadline or
+  // the reader's IRQ, whichever comes first. Returns the time of the pass.
+  uint32_t sleepPass() {
+    uint32_t at = clock.millis();
+    system->update();
+    uint64_t wake = clock.nowMicros() + system->planSleep() * 1000ULL;
+    uint64_t irq = reader.getAnswerAt();
+    if (irq > clock.nowMicros() && irq < wake) wake = irq;
+    clock.advanceUs((uint32_t)(wake - clock.nowMicros()));
+    return at;
+  }
+
+  bool unlocked() {
+    return gpio.read(RELAY_PIN) == LOW;  // LOW = energize relay
+  }
+};
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_boots_locked_with_default_card(void) {
+  Board board;
+  TEST_ASSERT_FALSE(board.unlocked());
+  TEST_ASSERT_TRUE(board.preferences.isKey("card_table"));
+  TEST_ASSERT_EQUAL_UINT32(115200, board.preferences.getUInt("fp_baud", 0));
+  TEST_ASSERT_EQUAL_UINT8(INPUT_PULLUP, board.gpio.getMode(TILT_PIN));
+}
+
+void test_card_and_finger_unlock_and_log(void) {
+  Board board;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.net.bodies.size());
+  TEST_ASSERT_EQUAL_STRING("/events", board.net.paths[0].c_str());
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[0].c_str(), "{\"seq\":1,"));
+  // 63:5A:59:31, unlock with finger page 3, on band DEVICE_ID_DEFAULT
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[0].c_str(), "\"0x635A5931000000000000040003000000000100"));
+
+  board.run(UNLOCK_DURATION);
+  TEST_ASSERT_FALSE(board.unlocked());
+}
+
+void test_rejects_unknown_card_and_wrong_finger(void) {
+  Board board;
+  board.attempt(UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_OWNER);
+  TEST_ASSERT_FALSE(board.unlocked());
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_STRANGER);
+  TEST_ASSERT_FALSE(board.unlocked());
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+}
+
+void test_lockout_survives_reboot(void) {
+  Board board;
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS; i++) {
+    board.attempt(UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_OWNER);
+  }
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_FALSE(board.unlocked());
+
+  board.reboot();
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_FALSE(board.unlocked());
+
+  board.run(LOCKOUT_DURATION);
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+}
+
+void test_tamper_pulses_raise_logged_alarm(void) {
+  Board board;
+  for (int i = 0; i < TAMPER_THRESHOLD; i++) {
+    TEST_ASSERT_TRUE(board.gpio.trigger(TILT_PIN));
+    board.clock.advance(20);
+  }
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.net.bodies.size());
+  // Kind byte 13 is RECORD_TAMPER
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[0].c_str(), "\"0x00000000000000000000000000020000000100"));
+}
+
+void test_tamper_is_raised_during_a_lockout(void) {
+  Board board;
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS; i++) {
+    board.attempt(UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_OWNER);
+  }
+  uint32_t before = (uint32_t)board.net.bodies.size();
+  for (int i = 0; i < TAMPER_THRESHOLD; i++) {
+    board.gpio.trigger(TILT_PIN);
+    board.clock.advance(20);
+  }
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_TRUE(board.clock.millis() < LOCKOUT_DURATION);
+  TEST_ASSERT_EQUAL_UINT32(1, board.system->getPowerScheduler().getWakeCount(WAKE_TAMPER));
+  TEST_ASSERT_EQUAL_UINT32(before + 1, board.net.bodies.size());
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[before].c_str(), "\"0x00000000000000000000000000020000000100"));
+}
+
+void test_events_wait_in_outbox_while_offline(void) {
+  Board board;
+  board.net.serverUp = false;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(0, board.net.bodies.size());
+
+  board.reboot();
+  board.net.serverUp = true;
+  board.run(BATCH_MAX_DELAY + OUTBOX_RETRY_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT32(1, board.net.bodies.size());
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[0].c_str(), "\"0x635A5931"));
+}
+
+void test_admin_commands_run_on_the_security_pass(void) {
+  Board board;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_LOCK)));
+  TEST_ASSERT_TRUE(board.unlocked());  // Not until the security task runs
+  board.run(10);
+  TEST_ASSERT_FALSE(board.unlocked());
+
+  // Enroll a second card for any finger; it is waiting at the reader
+  board.reader.present(UNKNOWN_CARD, sizeof(UNKNOWN_CARD));
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ADD_CARD, 0, 0)));
+  board.run((uint32_t)((board.reader.getAnswerAt() - board.clock.nowMicros()) / 1000) + 10);
+  TEST_ASSERT_FALSE(board.system->isAdminJobActive());
+  board.attempt(UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+}
+
+void test_add_card_waits_without_holding_the_loop(void) {
+  Board board;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ADD_CARD, 0, 0)));
+  board.run(10);
+  TEST_ASSERT_TRUE(board.system->isAdminJobActive());
+
+  // Tamper detection and the auto-lock carry on while it waits
+  for (int i = 0; i < TAMPER_THRESHOLD; i++) {
+    board.gpio.trigger(TILT_PIN);
+    board.clock.advance(20);
+  }
+  board.run(100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.system->getPowerScheduler().getWakeCount(WAKE_TAMPER));
+  board.run(ADD_CARD_TIMEOUT - 1000);
+  TEST_ASSERT_TRUE(board.system->isAdminJobActive());
+  board.run(1000);
+  TEST_ASSERT_FALSE(board.system->isAdminJobActive());   // Timed out
+  board.run(UNLOCK_DURATION);
+  TEST_ASSERT_FALSE(board.unlocked());
+
+  // A cancelled job leaves the next card to the normal path
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ADD_CARD, 0, 0)));
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_CANCEL)));
+  board.run(10);
+  TEST_ASSERT_FALSE(board.system->isAdminJobActive());
+  board.attempt(UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_OWNER);
+  TEST_ASSERT_FALSE(board.unlocked());
+}
+
+void test_enrollment_runs_alongside_the_loop(void) {
+  Board board;
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ENROLL, 40, 2)));
+  board.run(10);
+  TEST_ASSERT_TRUE(board.system->isAdminJobActive());
+
+  // Nobody comes: tamper detection carries on and the job gives up
+  for (int i = 0; i < TAMPER_THRESHOLD; i++) {
+    board.gpio.trigger(TILT_PIN);
+    board.clock.advance(20);
+  }
+  board.run(100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.system->getPowerScheduler().getWakeCount(WAKE_TAMPER));
+  board.run(ENROLL_STEP_TIMEOUT);
+  TEST_ASSERT_FALSE(board.system->isAdminJobActive());
+  TEST_ASSERT_EQUAL_UINT16(0, board.finger.enrolledAt(40));
+
+  // Two samples, two images each
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ENROLL, 40, 2)));
+  for (int i = 0; i < 4; i++) {
+    board.finger.placeFinger(FINGER_STRANGER);
+    board.run(1000);
+    board.finger.liftFinger();
+    board.run(300);
+  }
+  TEST_ASSERT_FALSE(board.system->isAdminJobActive());
+  TEST_ASSERT_EQUAL_UINT16(FINGER_STRANGER, board.finger.enrolledAt(40));
+  TEST_ASSERT_EQUAL_UINT16(FINGER_STRANGER, board.finger.enrolledAt(41));
+
+  // A card bound to both samples lets the new finger in
+  board.reader.present(UNKNOWN_CARD, sizeof(UNKNOWN_CARD));
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ADD_CARD, 40, 2)));
+  board.run((uint32_t)((board.reader.getAnswerAt() - board.clock.nowMicros()) / 1000) + 10);
+  board.attempt(UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_STRANGER);
+  TEST_ASSERT_TRUE(board.unlocked());
+}
+
+void test_admin_queue_is_bounded(void) {
+  Board board;
+  for (int i = 0; i < ADMIN_QUEUE_SIZE; i++) {
+    TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_LIST_CARDS)));
+  }
+  TEST_ASSERT_FALSE(board.system->submitCommand(AdminCommand::make(ADMIN_LIST_CARDS)));
+  board.run(10);
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_STATUS)));
+}
+
+void test_metrics_cover_the_auth_path(void) {
+  Board board;
+  board.reader.readTimeUs = 900;
+  board.finger.captureTimeUs = 120000;
+  board.finger.convertTimeUs = 300000;
+  board.finger.searchBaseUs = 40000;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_TRUE(board.unlocked());
+
+  const Metrics &metrics = board.system->getMetrics();
+  for (uint8_t stage = 0; stage < METRIC_STAGE_COUNT; stage++) {
+    TEST_ASSERT_TRUE(metrics.stage(stage).getCount() >= 1);
+  }
+  TEST_ASSERT_EQUAL_UINT32(900, metrics.stage(METRIC_CARD_READ).getMax());
+  TEST_ASSERT_EQUAL_UINT32(300000, metrics.stage(METRIC_FP_CONVERT).getMax());
+  TEST_ASSERT_EQUAL_UINT32(40000, metrics.stage(METRIC_FP_SEARCH).getMax());
+  // Touch to result is the three sensor stages plus a loop tick between each
+  uint32_t decision = metrics.stage(METRIC_FP_DECISION).getMax();
+  TEST_ASSERT_TRUE(decision >= 120000 + 300000 + 40000);
+  TEST_ASSERT_TRUE(decision < 120000 + 300000 + 40000 + 50000);
+  // The card waited 100 ms for the finger, plus empty captures meanwhile
+  TEST_ASSERT_TRUE(metrics.stage(METRIC_END_TO_END).getMax() >= 100000 + decision);
+  TEST_ASSERT_TRUE(metrics.stage(METRIC_NET_ACK).getMax() <= (BATCH_MAX_DELAY + 100) * 1000UL);
+}
+
+// Index of the first request to path, or -1
+static int findRequest(Board &board, const char* path) {
+  for (size_t i = 0; i < board.net.paths.size(); i++) {
+    if (board.net.paths[i] == path) return (int)i;
+  }
+  return -1;
+}
+
+void test_loop_period_is_measured_exactly(void) {
+  Board board;
+  board.run(10);   // First pass after init(): nothing to measure yet
+  uint32_t before = board.system->getMetrics().stage(METRIC_LOOP_PERIOD).getCount();
+  board.run(100);
+  const LatencyHistogram &period = board.system->getMetrics().stage(METRIC_LOOP_PERIOD);
+  TEST_ASSERT_EQUAL_UINT32(before + 10, period.getCount());
+  TEST_ASSERT_EQUAL_UINT32(10000, period.getMin());
+  TEST_ASSERT_EQUAL_UINT32(10000, period.getMax());
+}
+
+void test_delivered_events_are_anchored_after_interval(void) {
+  Board board;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  board.run(UNLOCK_DURATION);
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_INT(-1, findRequest(board, "/anchor"));
+
+  board.run(ANCHOR_INTERVAL);
+  int anchor = findRequest(board, "/anchor");
+  TEST_ASSERT_TRUE(anchor > 0);
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[anchor].c_str(), "\"firstSeq\":1,\"lastSeq\":2,\"root\":\"0x"));
+
+  // Anchored events are released: a reboot does not deliver them again
+  size_t requests = board.net.paths.size();
+  board.reboot();
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(requests, board.net.paths.size());
+
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies.back().c_str(), "{\"seq\":3,"));
+}
+
+void test_unanchored_events_are_chained_again_after_reboot(void) {
+  Board board;
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.net.bodies.size());
+  std::string delivered = board.net.bodies[0];
+
+  // Delivered but not anchored: the same event goes out with the same number
+  board.reboot();
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(2, board.net.bodies.size());
+  TEST_ASSERT_EQUAL_STRING(delivered.c_str(), board.net.bodies[1].c_str());
+
+  // An anchor that fails is retried, and the window does not move on
+  board.net.serverUp = false;
+  board.run(ANCHOR_INTERVAL);
+  TEST_ASSERT_EQUAL_INT(-1, findRequest(board, "/anchor"));
+  board.net.serverUp = true;
+  board.run(OUTBOX_RETRY_INTERVAL + 100);
+  int anchor = findRequest(board, "/anchor");
+  TEST_ASSERT_TRUE(anchor > 0);
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[anchor].c_str(), "\"firstSeq\":1,\"lastSeq\":1,"));
+}
+
+void test_ready_before_sensor_and_network(void) {
+  Board board;
+  board.reader.beginTimeUs = 50000;
+  board.finger.beginTimeUs = 800000;
+  board.net.networkAvailable = false;
+  board.reboot();
+
+  // The card path is usable within budget; the slow stages start after it
+  const BootTimeline &boot = board.system->getBootTimeline();
+  TEST_ASSERT_TRUE(boot.isReady());
+  TEST_ASSERT_TRUE(boot.timeToReady() < BOOT_READY_BUDGET * 1000UL);
+  TEST_ASSERT_EQUAL_UINT32(50000, boot.duration(BOOT_RFID));
+  TEST_ASSERT_EQUAL_UINT8(BOOT_OK, boot.getOutcome(BOOT_FINGER));
+  TEST_ASSERT_EQUAL_UINT32(800000, boot.duration(BOOT_FINGER));
+  TEST_ASSERT_TRUE(boot.getStartedAt(BOOT_FINGER) >= boot.getReadyAt());
+  TEST_ASSERT_EQUAL_UINT8(BOOT_FAILED, boot.getOutcome(BOOT_NETWORK));
+  TEST_ASSERT_TRUE(boot.getStartedAt(BOOT_NETWORK) >= boot.getReadyAt());
+  TEST_ASSERT_FALSE(board.unlocked());
+
+  // The access point is still down; the card path does not wait for it
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+}
+
+void test_no_reader_still_boots_locked(void) {
+  Board board;
+  board.reader.available = false;
+  board.reboot();
+  const BootTimeline &boot = board.system->getBootTimeline();
+  TEST_ASSERT_TRUE(boot.isReady());
+  TEST_ASSERT_EQUAL_UINT8(BOOT_FAILED, boot.getOutcome(BOOT_RFID));
+  TEST_ASSERT_EQUAL_UINT8(BOOT_OK, boot.getOutcome(BOOT_FINGER));
+  TEST_ASSERT_FALSE(board.unlocked());
+}
+
+void test_duty_cycled_sleep_keeps_the_auto_lock_exact(void) {
+  Board board;
+  board.reader.present(DEFAULT_CARD, sizeof(DEFAULT_CARD));
+  board.finger.placeFinger(FINGER_OWNER);
+  uint32_t at = 0;
+  while (!board.unlocked()) at = board.sleepPass();
+  uint32_t unlockedAt = at;
+  board.reader.remove();
+
+  uint32_t passes = 0;
+  while (board.unlocked()) {
+    at = board.sleepPass();
+    passes++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(UNLOCK_DURATION, at - unlockedAt);
+  TEST_ASSERT_TRUE(passes < UNLOCK_DURATION / SECURITY_TICK / 4);
+
+  // Nothing due: the task sleeps as long as it may
+  board.finger.liftFinger();
+  board.reader.remove();
+  for (int i = 0; i < 20; i++) board.sleepPass();
+  TEST_ASSERT_EQUAL_UINT32(POWER_IDLE_WAIT, board.system->planSleep());
+  TEST_ASSERT_TRUE(board.system->getPowerScheduler().getSleepUs() > 0);
+  TEST_ASSERT_EQUAL_UINT32(1, board.system->getPowerScheduler().getWakeCount(WAKE_CARD));
+  TEST_ASSERT_TRUE(board.reader.windowInterval == RFID_WINDOW_INTERVAL && board.reader.fieldSwitched);
+}
+
+void test_duty_cycled_attempt_runs_without_a_tick_between_steps(void) {
+  Board board;
+  // The card read, first poll, image and search follow the answer at once
+  board.finger.placeFinger(FINGER_OWNER);
+  board.reader.present(DEFAULT_CARD, sizeof(DEFAULT_CARD));
+  uint32_t answeredAt = (uint32_t)(board.reader.getAnswerAt() / 1000);
+  uint32_t at = 0;
+  while (!board.unlocked()) at = board.sleepPass();
+  TEST_ASSERT_TRUE(at - answeredAt < SECURITY_TICK);
+}
+
+void test_card_left_on_the_reader_is_one_attempt(void) {
+  Board board;
+  // Every window wakes it, but it is read as one failed attempt, not one
+  // per reject hold
+  board.reader.present(UNKNOWN_CARD, sizeof(UNKNOWN_CARD));
+  board.run(MAX_FAILED_ATTEMPTS * (REJECT_HOLD_TIME + 500));
+  TEST_ASSERT_TRUE(board.system->getPowerScheduler().getWakeCount(WAKE_CARD) > MAX_FAILED_ATTEMPTS);
+  board.reader.remove();
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());   // Not locked out
+
+  board.run(UNLOCK_DURATION);
+
+  // An enrolled card left there after its unlock asks for no finger once
+  // the door locks again
+  board.reader.present(DEFAULT_CARD, sizeof(DEFAULT_CARD));
+  board.run((uint32_t)((board.reader.getAnswerAt() - board.clock.nowMicros()) / 1000) + 100);
+  board.finger.placeFinger(FINGER_OWNER);
+  board.run(200);
+  board.finger.liftFinger();
+  TEST_ASSERT_TRUE(board.unlocked());
+  board.run(UNLOCK_DURATION);
+  TEST_ASSERT_FALSE(board.unlocked());
+  board.finger.placeFinger(FINGER_OWNER);
+  board.run(1000);
+  board.finger.liftFinger();
+  TEST_ASSERT_FALSE(board.unlocked());
+
+  // Taken away and presented again, it is a new attempt
+  board.reader.remove();
+  board.run(RFID_WINDOW_INTERVAL * 2);
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+}
+
+void test_always_on_keeps_the_tick(void) {
+  Board board;
+  board.reboot(POWER_ALWAYS_ON);
+  board.run(100);
+  TEST_ASSERT_EQUAL_UINT32(SECURITY_TICK, board.system->planSleep());
+  TEST_ASSERT_EQUAL_UINT32(RFID_REQA_INTERVAL, board.reader.windowInterval);
+  TEST_ASSERT_FALSE(board.reader.fieldSwitched);
+  TEST_ASSERT_FALSE(board.net.powerSave);
+}
+
+void test_on_demand_radio_is_up_only_for_events(void) {
+  Board board;
+  board.reboot(POWER_ON_DEMAND);
+  uint32_t attempts = board.net.linkAttempts;   // The first boot's radio was always on
+  board.run(10000);
+  TEST_ASSERT_EQUAL_UINT32(attempts, board.net.linkAttempts);
+  TEST_ASSERT_TRUE(board.net.powerSave);
+
+  board.attempt(DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_TRUE(board.unlocked());
+  TEST_ASSERT_EQUAL_UINT32(attempts + 1, board.net.linkAttempts);
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.net.bodies.size());
+
+  uint32_t ends = board.net.linkEnds;
+  board.run(RADIO_LINGER + 100);
+  TEST_ASSERT_EQUAL_UINT32(ends + 1, board.net.linkEnds);
+  board.run(60000);
+  TEST_ASSERT_EQUAL_UINT32(attempts + 1, board.net.linkAttempts);
+}
+
+void test_bank_lanes_share_the_lockout_and_the_log(void) {
+  Board board(true);
+  TEST_ASSERT_EQUAL_INT(HIGH, board.gpio.read(BANK_RELAY));
+  board.bankAttempt(board.second, DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_EQUAL_INT(LOW, board.gpio.read(BANK_RELAY));
+  TEST_ASSERT_FALSE(board.unlocked());   // Reader 0's door stays shut
+
+  board.run(BATCH_MAX_DELAY + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, board.net.bodies.size());
+  TEST_ASSERT_NOT_NULL(strstr(board.net.bodies[0].c_str(), "\"0x635A5931000000000000040003000000000100"));
+  board.run(UNLOCK_DURATION);
+  TEST_ASSERT_EQUAL_INT(HIGH, board.gpio.read(BANK_RELAY));
+
+  // Failures on reader 0 lock reader 1 out too
+  for (int i = 0; i < MAX_FAILED_ATTEMPTS; i++) {
+    board.bankAttempt(board.reader, UNKNOWN_CARD, sizeof(UNKNOWN_CARD), FINGER_OWNER);
+  }
+  board.bankAttempt(board.second, DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_EQUAL_INT(HIGH, board.gpio.read(BANK_RELAY));
+
+  board.run(LOCKOUT_DURATION);
+  board.bankAttempt(board.second, DEFAULT_CARD, sizeof(DEFAULT_CARD), FINGER_OWNER);
+  TEST_ASSERT_EQUAL_INT(LOW, board.gpio.read(BANK_RELAY));
+}
+
+void test_bank_add_card_takes_reader_zero(void) {
+  Board board(true);
+  static const uint8_t NEW_CARD[] = {0x11, 0x22, 0x33, 0x44};
+  TEST_ASSERT_TRUE(board.system->submitCommand(AdminCommand::make(ADMIN_ADD_CARD)));
+  board.run(50);
+  board.reader.present(NEW_CARD, sizeof(NEW_CARD));
+  board.run(RFID_REQA_INTERVAL + 100);
+  TEST_ASSERT_FALSE(board.system->isAdminJobActive());
+
+  board.bankAttempt(board.second, NEW_CARD, sizeof(NEW_CARD), FINGER_OWNER);
+  TEST_ASSERT_EQUAL_INT(LOW, board.gpio.read(BANK_RELAY));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_boots_locked_with_default_card);
+  RUN_TEST(test_card_and_finger_unlock_and_log);
+  RUN_TEST(test_rejects_unknown_card_and_wrong_finger);
+  RUN_TEST(test_lockout_survives_reboot);
+  RUN_TEST(test_tamper_pulses_raise_logged_alarm);
+  RUN_TEST(test_tamper_is_raised_during_a_lockout);
+  RUN_TEST(test_events_wait_in_outbox_while_offline);
+  RUN_TEST(test_admin_commands_run_on_the_security_pass);
+  RUN_TEST(test_add_card_waits_without_holding_the_loop);
+  RUN_TEST(test_enrollment_runs_alongside_the_loop);
+  RUN_TEST(test_admin_queue_is_bounded);
+  RUN_TEST(test_metrics_cover_the_auth_path);
+  RUN_TEST(test_loop_period_is_measured_exactly);
+  RUN_TEST(test_delivered_events_are_anchored_after_interval);
+  RUN_TEST(test_unanchored_events_are_chained_again_after_reboot);
+  RUN_TEST(test_ready_before_sensor_and_network);
+  RUN_TEST(test_no_reader_still_boots_locked);
+  RUN_TEST(test_duty_cycled_sleep_keeps_the_auto_lock_exact);
+  RUN_TEST(test_duty_cycled_attempt_runs_without_a_tick_between_steps);
+  RUN_TEST(test_card_left_on_the_reader_is_one_attempt);
+  RUN_TEST(test_always_on_keeps_the_tick);
+  RUN_TEST(test_on_demand_radio_is_up_only_for_events);
+  RUN_TEST(test_bank_lanes_share_the_lockout_and_the_log);
+  RUN_TEST(test_bank_add_card_takes_reader_zero);
+  return UNITY_END();
+}
@@ -0,0 +1,86 @@
+#include <unity.h>
+#include <string.h>
+#include "sha256.h"
+
+// FIPS 180-2 examples
+static const char* ABC = "abc";
+static const char* TWO_BLOCKS = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+static void toHex(const uint8_t digest[SHA256_BYTES], char hex[2 * SHA256_BYTES + 1]) {
+  static const char DIGITS[] = "0123456789abcdef";
+  for (int i = 0; i < SHA256_BYTES; i++) {
+    hex[2 * i] = DIGITS[digest[i] >> 4];
+    hex[2 * i + 1] = DIGITS[digest[i] & 0x0F];
+  }
+  hex[2 * SHA256_BYTES] = '\0';
+}
+
+static void expectDigest(const char* expected, const void* data, size_t length) {
+  uint8_t digest[SHA256_BYTES];
+  char hex[2 * SHA256_BYTES + 1];
+  sha256(data, length, digest);
+  toHex(digest, hex);
+  TEST_ASSERT_EQUAL_STRING(expected, hex);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_known_digests(void) {
+  expectDigest("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", "", 0);
+  expectDigest("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", ABC, strlen(ABC));
+  expectDigest("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+               TWO_BLOCKS, strlen(TWO_BLOCKS));
+}
+
+void test_million_a(void) {
+  uint8_t chunk[1000];
+  memset(chunk, 'a', sizeof(chunk));
+  Sha256 hash;
+  for (int i = 0; i < 1000; i++) hash.update(chunk, sizeof(chunk));
+  uint8_t digest[SHA256_BYTES];
+  char hex[2 * SHA256_BYTES + 1];
+  hash.finish(digest);
+  toHex(digest, hex);
+  TEST_ASSERT_EQUAL_STRING("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", hex);
+}
+
+// Any split of the input gives the one-shot digest, across the padding boundaries
+void test_incremental_matches_one_shot(void) {
+  uint8_t message[130];
+  for (size_t i = 0; i < sizeof(message); i++) message[i] = (uint8_t)(i * 7 + 1);
+
+  for (size_t length = 0; length <= sizeof(message); length += 13) {
+    uint8_t expected[SHA256_BYTES];
+    sha256(message, length, expected);
+    for (size_t split = 0; split <= length; split++) {
+      Sha256 hash;
+      hash.update(message, split);
+      hash.update(message + split, length - split);
+      uint8_t digest[SHA256_BYTES];
+      hash.finish(digest);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, digest, SHA256_BYTES);
+    }
+  }
+}
+
+void test_begin_restarts(void) {
+  Sha256 hash;
+  hash.update("garbage", 7);
+  hash.begin();
+  hash.update(ABC, 3);
+  uint8_t digest[SHA256_BYTES];
+  uint8_t expected[SHA256_BYTES];
+  hash.finish(digest);
+  sha256(ABC, 3, expected);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, digest, SHA256_BYTES);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_known_digests);
+  RUN_TEST(test_million_a);
+  RUN_TEST(test_incremental_matches_one_shot);
+  RUN_TEST(test_begin_restarts);
+  return UNITY_END();
+}
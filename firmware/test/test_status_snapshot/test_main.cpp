@@ -0,0 +1,55 @@
+#include <unity.h>
+#include <string.h>
+#include "status_snapshot.h"
+
+struct Counters {
+  uint32_t a;
+  uint32_t b;
+  uint32_t sum;   // a + b when consistent
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_nothing_to_read_before_the_first_publish(void) {
+  StatusSnapshot<Counters> snapshot;
+  Counters out;
+  TEST_ASSERT_FALSE(snapshot.read(out));
+  TEST_ASSERT_EQUAL_UINT32(0, snapshot.getPublished());
+}
+
+void test_read_returns_the_latest_publish(void) {
+  StatusSnapshot<Counters> snapshot;
+  for (uint32_t i = 1; i <= 5; i++) {
+    Counters next = {i, 10 * i, 11 * i};
+    snapshot.publish(next);
+  }
+  Counters out;
+  memset(&out, 0, sizeof(out));
+  TEST_ASSERT_TRUE(snapshot.read(out));
+  TEST_ASSERT_EQUAL_UINT32(5, out.a);
+  TEST_ASSERT_EQUAL_UINT32(50, out.b);
+  TEST_ASSERT_EQUAL_UINT32(out.a + out.b, out.sum);
+  TEST_ASSERT_EQUAL_UINT32(5, snapshot.getPublished());
+}
+
+void test_copy_is_independent_of_later_publishes(void) {
+  StatusSnapshot<Counters> snapshot;
+  Counters first = {1, 2, 3};
+  snapshot.publish(first);
+  Counters out;
+  TEST_ASSERT_TRUE(snapshot.read(out));
+  Counters second = {7, 8, 15};
+  snapshot.publish(second);
+  TEST_ASSERT_EQUAL_UINT32(1, out.a);
+  TEST_ASSERT_TRUE(snapshot.read(out));
+  TEST_ASSERT_EQUAL_UINT32(7, out.a);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_to_read_before_the_first_publish);
+  RUN_TEST(test_read_returns_the_latest_publish);
+  RUN_TEST(test_copy_is_independent_of_later_publishes);
+  return UNITY_END();
+}
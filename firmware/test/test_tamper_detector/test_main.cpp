@@ -0,0 +1,117 @@
+#include <unity.h>
+#include "tamper_detector.h"
+
+#define THRESHOLD  3
+#define WINDOW     200
+#define DEBOUNCE   2
+#define HOLDOFF    5000
+
+// Rising-edge traces (microseconds) in the shape the SW-420 produces:
+// each mechanical pulse arrives as a short burst of contact bounce.
+
+// One knock on the housing
+static const uint32_t SINGLE_BUMP[] = {1000, 1180, 1420, 1900};
+
+// Three knocks 60 ms apart, each with bounce
+static const uint32_t TRIPLE_KNOCK[] = {
+  10000, 10300, 10700,
+  70000, 70250,
+  130000, 130400, 131100,
+};
+
+// Footsteps nearby: single pulses 300 ms apart never fill the window
+static const uint32_t SLOW_TAPS[] = {0, 300000, 600000, 900000, 1200000, 1500000};
+
+// Two pulses, then a gap longer than the window, then two more
+static const uint32_t SPLIT_BURST[] = {0, 50000, 400000, 450000};
+
+static TamperDetector detector;
+
+static uint32_t replay(const uint32_t* trace, size_t length, uint32_t offset = 0) {
+  uint32_t raised = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (detector.onEdge(trace[i] + offset)) raised++;
+  }
+  return raised;
+}
+
+void setUp(void) {
+  detector.configure(THRESHOLD, WINDOW, DEBOUNCE, HOLDOFF);
+  TamperEvent event;
+  while (detector.poll(event)) {}
+}
+
+void tearDown(void) {}
+
+void test_bounce_is_one_pulse(void) {
+  uint32_t bounces = detector.getBounces();
+  TEST_ASSERT_EQUAL_UINT32(0, replay(SINGLE_BUMP, 4));
+  TEST_ASSERT_EQUAL_UINT32(3, detector.getBounces() - bounces);
+}
+
+void test_triple_knock_raises_one_event(void) {
+  TEST_ASSERT_EQUAL_UINT32(1, replay(TRIPLE_KNOCK, 8));
+  TamperEvent event;
+  TEST_ASSERT_TRUE(detector.poll(event));
+  TEST_ASSERT_EQUAL_UINT32(130000, event.timestampUs);  // Raised on the crossing edge itself
+  TEST_ASSERT_EQUAL_UINT16(3, event.pulses);
+  TEST_ASSERT_FALSE(detector.poll(event));
+}
+
+void test_slow_taps_do_not_trigger(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, replay(SLOW_TAPS, 6));
+}
+
+void test_window_slides(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, replay(SPLIT_BURST, 4));
+}
+
+void test_sustained_shaking_respects_holdoff(void) {
+  // 12 s of pulses every 20 ms: events at the start, +5 s and +10 s
+  uint32_t raised = 0;
+  for (uint32_t t = 0; t < 12000000; t += 20000) {
+    if (detector.onEdge(t)) raised++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, raised);
+  TamperEvent event;
+  TEST_ASSERT_TRUE(detector.poll(event));
+  TEST_ASSERT_EQUAL_UINT32(40000, event.timestampUs);
+  TEST_ASSERT_TRUE(detector.poll(event));
+  TEST_ASSERT_EQUAL_UINT32(5040000, event.timestampUs);
+}
+
+void test_sensitivity_is_configurable(void) {
+  detector.configure(1, WINDOW, DEBOUNCE, HOLDOFF);
+  TEST_ASSERT_EQUAL_UINT32(1, replay(SINGLE_BUMP, 4));
+
+  detector.configure(4, WINDOW, DEBOUNCE, HOLDOFF);
+  TEST_ASSERT_EQUAL_UINT32(0, replay(TRIPLE_KNOCK, 8));
+
+  // A longer debounce merges the knock's bounce-free edges too
+  detector.configure(THRESHOLD, WINDOW, 100, HOLDOFF);
+  TEST_ASSERT_EQUAL_UINT32(0, replay(TRIPLE_KNOCK, 8));
+}
+
+void test_survives_timer_wrap(void) {
+  uint32_t raised = replay(TRIPLE_KNOCK, 8, 0xFFFFFFFFu - 100000);
+  TEST_ASSERT_EQUAL_UINT32(1, raised);
+}
+
+void test_full_queue_drops_and_counts(void) {
+  detector.configure(1, WINDOW, 0, 0);
+  for (uint32_t t = 0; t < TAMPER_QUEUE_SIZE + 3; t++) detector.onEdge(t * 1000);
+  TEST_ASSERT_EQUAL_UINT32(3, detector.getDropped());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bounce_is_one_pulse);
+  RUN_TEST(test_triple_knock_raises_one_event);
+  RUN_TEST(test_slow_taps_do_not_trigger);
+  RUN_TEST(test_window_slides);
+  RUN_TEST(test_sustained_shaking_respects_holdoff);
+  RUN_TEST(test_sensitivity_is_configurable);
+  RUN_TEST(test_survives_timer_wrap);
+  RUN_TEST(test_full_queue_drops_and_counts);
+  return UNITY_END();
+}
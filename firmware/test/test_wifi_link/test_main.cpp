@@ -0,0 +1,182 @@
+#include <unity.h>
+#include <vector>
+#include "hal_sim.h"
+#include "wifi_link.h"
+
+// Link on a simulated access point, with its events wired as NetworkManager does
+struct Station {
+  SimClock clock;
+  SimTransport net;
+  WifiLink link;
+
+  Station() : net(clock), link(net, clock) {
+    net.onLinkChange(forward, &link);
+  }
+
+  static void forward(void* arg, bool up) {
+    static_cast<WifiLink*>(arg)->onLinkChange(up);
+  }
+
+  // Service the link whenever it asks to be, for ms
+  void run(uint32_t ms) {
+    uint32_t end = clock.millis() + ms;
+    while ((int32_t)(end - clock.millis()) > 0) {
+      uint32_t wait = link.service();
+      uint32_t left = end - clock.millis();
+      clock.advance(wait < left ? wait : left);
+    }
+    link.service();
+  }
+
+  // Times (ms) of the association attempts made while running for ms
+  std::vector<uint32_t> attemptTimes(uint32_t ms) {
+    std::vector<uint32_t> times;
+    uint32_t end = clock.millis() + ms;
+    while ((int32_t)(end - clock.millis()) > 0) {
+      uint32_t before = net.linkAttempts;
+      uint32_t wait = link.service();
+      if (net.linkAttempts != before) times.push_back(clock.millis());
+      clock.advance(wait);
+    }
+    return times;
+  }
+};
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {}
+
+void test_connects_from_the_up_event(void) {
+  Station station;
+  station.link.begin("ap", "key", 1);
+  TEST_ASSERT_EQUAL_UINT8(LINK_CONNECTING, station.link.getState());
+  TEST_ASSERT_EQUAL_UINT32(WIFI_IDLE_WAIT, station.link.service());
+  TEST_ASSERT_EQUAL_UINT8(LINK_UP, station.link.getState());
+  TEST_ASSERT_TRUE(station.link.isUp());
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getAttempts());
+  TEST_ASSERT_EQUAL_UINT32(0, station.link.getReconnects());
+}
+
+void test_failed_attempts_back_off_with_jitter_and_never_stop(void) {
+  Station station;
+  station.net.networkAvailable = false;
+  station.link.begin("ap", "key", 12345);
+  std::vector<uint32_t> times = station.attemptTimes(30 * 60000);
+
+  // Each gap is between half and all of a doubling backoff, capped
+  uint32_t backoff = WIFI_BACKOFF_MIN;
+  uint32_t previous = 0;  // begin() made the first attempt at 0
+  for (size_t i = 0; i < times.size(); i++) {
+    uint32_t gap = times[i] - previous;
+    TEST_ASSERT_GREATER_OR_EQUAL(backoff / 2, gap);
+    TEST_ASSERT_LESS_OR_EQUAL(backoff, gap);
+    previous = times[i];
+    backoff = backoff < WIFI_BACKOFF_MAX / 2 ? backoff * 2 : WIFI_BACKOFF_MAX;
+  }
+  TEST_ASSERT_GREATER_THAN(30, times.size());
+  TEST_ASSERT_FALSE(station.link.isUp());
+
+  // The access point comes back: the next retry gets through
+  station.net.networkAvailable = true;
+  station.run(WIFI_BACKOFF_MAX);
+  TEST_ASSERT_TRUE(station.link.isUp());
+}
+
+void test_jitter_spreads_devices(void) {
+  Station first, second;
+  first.net.networkAvailable = false;
+  second.net.networkAvailable = false;
+  first.link.begin("ap", "key", 1);
+  second.link.begin("ap", "key", 2);
+  std::vector<uint32_t> a = first.attemptTimes(120000);
+  std::vector<uint32_t> b = second.attemptTimes(120000);
+  bool differ = a.size() != b.size();
+  for (size_t i = 0; !differ && i < a.size(); i++) differ = a[i] != b[i];
+  TEST_ASSERT_TRUE(differ);
+}
+
+void test_silent_attempt_times_out(void) {
+  Station station;
+  station.net.networkAvailable = false;
+  station.net.announceFailures = false;
+  station.link.begin("ap", "key", 1);
+  TEST_ASSERT_EQUAL_UINT32(WIFI_CONNECT_TIMEOUT, station.link.service());
+  station.clock.advance(WIFI_CONNECT_TIMEOUT);
+  station.link.service();
+  TEST_ASSERT_EQUAL_UINT8(LINK_BACKOFF, station.link.getState());
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getFailures());
+  TEST_ASSERT_TRUE(station.link.getRetryIn() <= WIFI_BACKOFF_MIN);
+}
+
+void test_drop_is_retried_and_measured(void) {
+  Station station;
+  station.link.begin("ap", "key", 7);
+  station.run(1000);
+  TEST_ASSERT_TRUE(station.link.isUp());
+
+  station.net.setNetworkAvailable(false);
+  TEST_ASSERT_FALSE(station.link.isUp());   // Cached from the event
+  uint32_t attempts = station.link.getAttempts();
+  station.link.service();
+  TEST_ASSERT_EQUAL_UINT32(attempts + 1, station.link.getAttempts());  // Retried at once
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getDrops());
+
+  station.run(10000);
+  TEST_ASSERT_TRUE(station.link.getDowntime() >= 10000);
+  station.net.networkAvailable = true;
+  station.run(20000);
+  TEST_ASSERT_TRUE(station.link.isUp());
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getReconnects());
+  TEST_ASSERT_TRUE(station.link.getLastReconnect() >= 10000);
+  TEST_ASSERT_TRUE(station.link.getLastReconnect() <= 10000 + 8000);  // Within the backoff reached
+  TEST_ASSERT_EQUAL_UINT32(station.link.getLastReconnect(), station.link.getDowntime());
+  TEST_ASSERT_EQUAL_UINT32(station.link.getLastReconnect(), station.link.getMaxReconnect());
+}
+
+void test_flap_between_passes_counts_a_drop(void) {
+  Station station;
+  station.link.begin("ap", "key", 1);
+  station.link.service();
+  station.link.onLinkChange(false);
+  station.link.onLinkChange(true);
+  station.link.service();
+  TEST_ASSERT_EQUAL_UINT8(LINK_UP, station.link.getState());
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getDrops());
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getReconnects());
+  TEST_ASSERT_EQUAL_UINT32(1, station.link.getAttempts());
+}
+
+void test_end_turns_the_link_off_without_downtime(void) {
+  Station station;
+  station.link.begin("ap", "key", 1);
+  station.run(5000);
+  station.link.end();
+  station.net.endLink();
+  station.run(60000);
+  TEST_ASSERT_EQUAL_UINT8(LINK_IDLE, station.link.getState());
+  TEST_ASSERT_FALSE(station.link.isUp());
+  TEST_ASSERT_EQUAL_UINT32(1, station.net.linkAttempts);   // No retries while off
+  TEST_ASSERT_EQUAL_UINT32(0, station.link.getDrops());
+  TEST_ASSERT_EQUAL_UINT32(5000, station.link.getActiveTime());
+
+  station.link.begin("ap", "key", 1);
+  station.run(3000);
+  TEST_ASSERT_TRUE(station.link.isUp());
+  TEST_ASSERT_EQUAL_UINT32(0, station.link.getReconnects());
+  TEST_ASSERT_EQUAL_UINT32(0, station.link.getDowntime());
+  TEST_ASSERT_EQUAL_UINT32(8000, station.link.getActiveTime());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_from_the_up_event);
+  RUN_TEST(test_failed_attempts_back_off_with_jitter_and_never_stop);
+  RUN_TEST(test_jitter_spreads_devices);
+  RUN_TEST(test_silent_attempt_times_out);
+  RUN_TEST(test_drop_is_retried_and_measured);
+  RUN_TEST(test_flap_between_passes_counts_a_drop);
+  RUN_TEST(test_end_turns_the_link_off_without_downtime);
+  return UNITY_END();
+}
@@ -0,0 +1,605 @@
+// Fleet load generator for the blockchain gateway (blockchain/index.js).
+//
+// Simulates a fleet of bands delivering access events the way
+// NetworkManager does: each band posts its events to /events in batches
+// numbered along its own sequence, chains the acknowledged ones into an
+// EventChain and commits every full window with /anchor. The bodies come
+// from the firmware's encoders (encodeEventsJson, encodeAnchorJson) and each
+// connection is the firmware's KeepAliveHttp client. Arrivals are
+// open-loop: a generator thread schedules them by the chosen process and
+// a pool of connections serves them, so a gateway that falls behind shows
+// up as queueing delay instead of a lower offered rate. A band has at most
+// one request out at a time, as on the device, so its sequence numbers
+// reach the gateway in order.
+//
+// Modes:
+//   events   arrivals are access events, delivered in /events batches of
+//            up to --batch and anchored every --window events (default)
+//   anchor   arrivals are anchors: the band delivers a window of --window
+//            events, then its /anchor request is the one timed
+//
+// For each anchor the txHash is looked up on the JSON-RPC node
+// (eth_getTransactionReceipt) to measure how long after the request the
+// transaction was mined, and in how many blocks. /events does not go
+// on-chain.
+//
+// Build and run from the repository root, with a Hardhat node, the deployed
+// contract and the gateway running:
+//
+//   g++ -std=gnu++11 -O2 -pthread -I firmware firmware/tools/fleet_loadgen.cpp -o fleet_loadgen
+//   ./fleet_loadgen --devices 2000 --arrival poisson --rate 20 --duration 60
+//
+// Arrival processes (aggregate over the fleet):
+//   poisson   exponential gaps at --rate events/s
+//   periodic  every device once per --period s, random phase
+//   burst     --burst-fraction of the fleet within --burst-window ms, every --period s
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "access_event.h"
+#include "event_codec.h"
+#include "event_chain.h"
+#include "http_transport.h"
+
+unsigned long millis() {
+  using namespace std::chrono;
+  return (unsigned long)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double nowMs() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+#define GATEWAY_MAX_BATCH 50   // MAX_BATCH_SIZE in blockchain/index.js
+#define CHAIN_MAX_WINDOW  ((1u << CHAIN_MAX_LEVELS) - 1)
+
+// ==================== OPTIONS ====================
+struct Options {
+  std::string gateway;
+  std::string rpc;
+  std::string mode;
+  std::string arrival;
+  std::string jsonPath;
+  uint32_t devices;
+  uint32_t deviceBase;    // Device ID of the first band
+  double rate;            // poisson: events/s
+  double period;          // periodic, burst: seconds
+  double burstFraction;
+  double burstWindow;     // ms
+  double duration;        // seconds of arrivals
+  uint32_t connections;
+  uint32_t batch;         // Most events per /events request
+  uint32_t window;        // Events per anchor, 0 = no anchors
+  double denyRatio;
+  uint32_t readTimeout;   // ms
+  bool confirm;
+  uint32_t seed;
+
+  Options()
+    : gateway("http://127.0.0.1:3000"), rpc("http://127.0.0.1:8545"), mode("events"), arrival("poisson"),
+      devices(1000), deviceBase(DEVICE_ID_DEFAULT), rate(10), period(60), burstFraction(0.2), burstWindow(2000),
+      duration(30), connections(16), batch(BATCH_MAX_EVENTS), window(ANCHOR_WINDOW_EVENTS), denyRatio(0.05),
+      readTimeout(60000), confirm(true), seed(1) {}
+};
+
+static void usage() {
+  fprintf(stderr,
+    "usage: fleet_loadgen [options]\n"
+    "  --gateway URL          gateway base URL (http://127.0.0.1:3000)\n"
+    "  --rpc URL              JSON-RPC node for receipts (http://127.0.0.1:8545)\n"
+    "  --no-confirm           skip the receipt lookups\n"
+    "  --mode KIND            events | anchor (events)\n"
+    "  --devices N            simulated bands (1000)\n"
+    "  --device-base N        first band's device ID; the gateway keeps each\n"
+    "                         band's chain, so rerun with a fresh range (1)\n"
+    "  --arrival KIND         poisson | periodic | burst (poisson)\n"
+    "  --rate R               poisson arrivals per second (10)\n"
+    "  --period S             periodic / burst period in seconds (60)\n"
+    "  --burst-fraction F     share of the fleet in each burst (0.2)\n"
+    "  --burst-window MS      spread of one burst (2000)\n"
+    "  --duration S           seconds of arrivals (30)\n"
+    "  --connections N        concurrent keep-alive connections (16)\n"
+    "  --batch N              most events per /events request (10)\n"
+    "  --window N             events per anchor, 0 = no anchors in events mode (64)\n"
+    "  --deny R               share of denied attempts (0.05)\n"
+    "  --timeout MS           per-request read timeout (60000)\n"
+    "  --seed N               random seed (1)\n"
+    "  --json PATH            also write the report as JSON\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--no-confirm") {
+      options.confirm = false;
+      continue;
+    }
+    if (i + 1 >= argc) return false;
+    const char* value = argv[++i];
+    if (arg == "--gateway") options.gateway = value;
+    else if (arg == "--rpc") options.rpc = value;
+    else if (arg == "--mode") options.mode = value;
+    else if (arg == "--devices") options.devices = (uint32_t)atoi(value);
+    else if (arg == "--device-base") options.deviceBase = (uint32_t)atoi(value);
+    else if (arg == "--arrival") options.arrival = value;
+    else if (arg == "--rate") options.rate = atof(value);
+    else if (arg == "--period") options.period = atof(value);
+    else if (arg == "--burst-fraction") options.burstFraction = atof(value);
+    else if (arg == "--burst-window") options.burstWindow = atof(value);
+    else if (arg == "--duration") options.duration = atof(value);
+    else if (arg == "--connections") options.connections = (uint32_t)atoi(value);
+    else if (arg == "--batch") options.batch = (uint32_t)atoi(value);
+    else if (arg == "--window") options.window = (uint32_t)atoi(value);
+    else if (arg == "--deny") options.denyRatio = atof(value);
+    else if (arg == "--timeout") options.readTimeout = (uint32_t)atoi(value);
+    else if (arg == "--seed") options.seed = (uint32_t)atoi(value);
+    else if (arg == "--json") options.jsonPath = value;
+    else return false;
+  }
+  if (options.arrival != "poisson" && options.arrival != "periodic" && options.arrival != "burst") return false;
+  if (options.mode != "events" && options.mode != "anchor") return false;
+  if (options.batch == 0 || options.batch > GATEWAY_MAX_BATCH) return false;
+  if (options.window > CHAIN_MAX_WINDOW || (options.mode == "anchor" && options.window == 0)) return false;
+  return options.devices > 0 && options.connections > 0 && options.duration > 0;
+}
+
+// ==================== ARRIVALS ====================
+struct Arrival {
+  double at;              // Scheduled time (ms, steady clock)
+  uint32_t device;
+};
+
+// Arrival times relative to the start, sorted
+static std::vector<Arrival> schedule(const Options &options) {
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_int_distribution<uint32_t> anyDevice(0, options.devices - 1);
+  std::vector<Arrival> arrivals;
+  double end = options.duration * 1000.0;
+
+  if (options.arrival == "poisson") {
+    std::exponential_distribution<double> gap(options.rate / 1000.0);
+    for (double t = gap(random); t < end; t += gap(random)) {
+      Arrival arrival = {t, anyDevice(random)};
+      arrivals.push_back(arrival);
+    }
+  } else if (options.arrival == "periodic") {
+    double period = options.period * 1000.0;
+    for (uint32_t device = 0; device < options.devices; device++) {
+      for (double t = unit(random) * period; t < end; t += period) {
+        Arrival arrival = {t, device};
+        arrivals.push_back(arrival);
+      }
+    }
+  } else {
+    double period = options.period * 1000.0;
+    uint32_t perBurst = (uint32_t)(options.devices * options.burstFraction);
+    std::vector<uint32_t> fleet(options.devices);
+    for (uint32_t i = 0; i < options.devices; i++) fleet[i] = i;
+    for (double start = 0; start < end; start += period) {
+      std::shuffle(fleet.begin(), fleet.end(), random);
+      for (uint32_t i = 0; i < perBurst; i++) {
+        Arrival arrival = {start + unit(random) * options.burstWindow, fleet[i]};
+        arrivals.push_back(arrival);
+      }
+    }
+  }
+  std::sort(arrivals.begin(), arrivals.end(),
+            [](const Arrival &a, const Arrival &b) { return a.at < b.at; });
+  return arrivals;
+}
+
+// Band n holds card 63:5A:hi:lo, the default card with the index folded in
+static AccessEvent deviceEvent(uint32_t device, bool granted, uint32_t now) {
+  uint8_t uid[4] = {0x63, 0x5A, (uint8_t)(device >> 8), (uint8_t)device};
+  return AccessEvent::access(now, uid, sizeof(uid), granted, granted ? (uint16_t)(device % 128) : 0);
+}
+
+// ==================== SHARED STATE ====================
+struct Pending {
+  double scheduledAt;
+  bool granted;
+};
+
+// One simulated band. The chain belongs to the connection serving the
+// band; the rest is under queueLock.
+struct Band {
+  uint32_t deviceId;
+  EventChain chain;
+  std::deque<Pending> waiting;
+  bool queued;            // In the ready list
+  bool busy;              // A connection is sending for it
+};
+
+struct Confirmation {
+  std::string txHash;
+  double sentAt;
+  uint32_t events;
+};
+
+struct Results {
+  std::mutex lock;
+  std::vector<double> latency;      // Scheduled to answered, per arrival (ms)
+  std::vector<double> service;      // /events request written to answered (ms)
+  std::vector<double> anchorService;// /anchor request written to answered (ms)
+  std::vector<double> confirmDelay; // /anchor request written to receipt seen (ms)
+  std::set<uint64_t> blocks;
+  uint32_t requests;
+  uint32_t eventsOk;
+  uint32_t anchorsOk;
+  uint32_t httpErrors;              // Answered with a status other than 200
+  uint32_t transportErrors;         // No answer (connect, timeout, reset)
+  uint32_t unconfirmed;
+  uint32_t maxBacklog;
+
+  Results()
+    : requests(0), eventsOk(0), anchorsOk(0), httpErrors(0), transportErrors(0), unconfirmed(0), maxBacklog(0) {}
+};
+
+static std::mutex queueLock;
+static std::condition_variable queueReady;
+static std::vector<Band> bands;
+static std::deque<uint32_t> ready;  // Bands with arrivals waiting and no request out
+static uint32_t backlog = 0;
+static bool arrivalsDone = false;
+
+static std::mutex confirmLock;
+static std::condition_variable confirmReady;
+static std::deque<Confirmation> confirmations;
+static bool requestsDone = false;
+
+static Results results;
+
+// "key":"value" from a flat JSON answer
+static std::string jsonString(const char* body, const char* key) {
+  std::string pattern = std::string("\"") + key + "\"";
+  const char* at = strstr(body, pattern.c_str());
+  if (at == nullptr) return std::string();
+  at += pattern.size();
+  while (*at == ' ' || *at == ':') at++;
+  if (*at++ != '"') return std::string();
+  const char* end = strchr(at, '"');
+  return end != nullptr ? std::string(at, end - at) : std::string();
+}
+
+// Caller holds queueLock
+static void markReady(uint32_t device) {
+  Band &band = bands[device];
+  if (band.busy || band.queued || band.waiting.empty()) return;
+  band.queued = true;
+  ready.push_back(device);
+  queueReady.notify_one();
+}
+
+// ==================== WORKERS ====================
+static void generator(const std::vector<Arrival> &arrivals, double start, double denyRatio, uint32_t seed) {
+  std::mt19937 random(seed ^ 0x5bd1e995u);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  for (size_t i = 0; i < arrivals.size(); i++) {
+    double due = start + arrivals[i].at;
+    double wait = due - nowMs();
+    if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(wait * 1000)));
+    Pending pending = {due, unit(random) >= denyRatio};
+    std::lock_guard<std::mutex> guard(queueLock);
+    bands[arrivals[i].device].waiting.push_back(pending);
+    if (++backlog > results.maxBacklog) results.maxBacklog = backlog;
+    markReady(arrivals[i].device);
+  }
+  std::lock_guard<std::mutex> guard(queueLock);
+  arrivalsDone = true;
+  queueReady.notify_all();
+}
+
+// One keep-alive connection serving whichever band is ready next
+class Connection {
+private:
+  const Options &options;
+  KeepAliveHttp<PosixClient> http;
+  std::vector<AccessEvent> events;
+  std::vector<char> payload;
+  char answer[512];
+
+  int post(const char* path, size_t length, std::vector<double> &service) {
+    double sentAt = nowMs();
+    int status = length > 0 ? http.post(path, payload.data(), length, answer, sizeof(answer)) : -1;
+    double answeredAt = nowMs();
+    std::lock_guard<std::mutex> guard(results.lock);
+    results.requests++;
+    if (status < 0) {
+      results.transportErrors++;
+    } else if (status != 200) {
+      results.httpErrors++;
+    } else {
+      service.push_back(answeredAt - sentAt);
+    }
+    return status;
+  }
+
+  // The first count events as one /events request, numbered on from the
+  // band's chain; chained once acknowledged, as drainOutbox() does
+  bool postEvents(Band &band, uint32_t count) {
+    size_t length = encodeEventsJson(payload.data(), payload.size(), events.data(), count, band.deviceId,
+                                     band.chain.getNextSeq());
+    if (post("/events", length, results.service) != 200) return false;
+    for (uint32_t i = 0; i < count; i++) band.chain.append(events[i], (uint32_t)millis());
+    std::lock_guard<std::mutex> guard(results.lock);
+    results.eventsOk += count;
+    return true;
+  }
+
+  // The band's open window, as submitAnchor() sends it
+  bool postAnchor(Band &band) {
+    AnchorWindow window;
+    if (!band.chain.window(window)) return true;
+    size_t length = encodeAnchorJson(payload.data(), payload.size(), band.deviceId, window.firstSeq,
+                                     window.lastSeq, window.root, window.head);
+    double sentAt = nowMs();
+    if (post("/anchor", length, results.anchorService) != 200) return false;
+    band.chain.commit();
+    {
+      std::lock_guard<std::mutex> guard(results.lock);
+      results.anchorsOk++;
+    }
+
+    std::string txHash = jsonString(answer, "txHash");
+    if (options.confirm && !txHash.empty()) {
+      Confirmation confirmation = {txHash, sentAt, window.lastSeq - window.firstSeq + 1};
+      std::lock_guard<std::mutex> confirmGuard(confirmLock);
+      confirmations.push_back(confirmation);
+      confirmReady.notify_one();
+    }
+    return true;
+  }
+
+  static void answered(const std::vector<Pending> &taken) {
+    double answeredAt = nowMs();
+    std::lock_guard<std::mutex> guard(results.lock);
+    for (size_t i = 0; i < taken.size(); i++) results.latency.push_back(answeredAt - taken[i].scheduledAt);
+  }
+
+  // Events mode: the waiting events the window has room for, then the
+  // anchor once the window is full. A failed anchor is sent again before
+  // more events, since the window must not outgrow it.
+  void serveEvents(uint32_t device, Band &band, const std::vector<Pending> &taken) {
+    for (size_t i = 0; i < taken.size(); i++) {
+      events[i] = deviceEvent(device, taken[i].granted, (uint32_t)millis());
+    }
+    if (!taken.empty() && !postEvents(band, (uint32_t)taken.size())) return;
+    answered(taken);
+    if (options.window > 0 && band.chain.getWindowSize() >= options.window) postAnchor(band);
+  }
+
+  // Anchor mode: deliver a full window, then time its anchor
+  void serveAnchor(uint32_t device, Band &band, const std::vector<Pending> &taken) {
+    while (band.chain.getWindowSize() < options.window) {
+      uint32_t count = options.window - band.chain.getWindowSize();
+      if (count > options.batch) count = options.batch;
+      for (uint32_t i = 0; i < count; i++) {
+        events[i] = deviceEvent(device, taken[0].granted, (uint32_t)millis());
+      }
+      if (!postEvents(band, count)) return;
+    }
+    if (postAnchor(band)) answered(taken);
+  }
+
+public:
+  explicit Connection(const Options &_options)
+    : options(_options), events(_options.batch),
+      payload(std::max(eventsJsonMax(_options.batch), (size_t)256)) {
+    http.begin(options.gateway.c_str());
+    http.setTimeouts(HTTP_CONNECT_TIMEOUT, options.readTimeout);
+  }
+
+  void run() {
+    bool anchorMode = options.mode == "anchor";
+    std::vector<Pending> taken;
+    for (;;) {
+      uint32_t device;
+      taken.clear();
+      {
+        std::unique_lock<std::mutex> guard(queueLock);
+        queueReady.wait(guard, [] { return !ready.empty() || arrivalsDone; });
+        if (ready.empty()) return;
+        device = ready.front();
+        ready.pop_front();
+        Band &band = bands[device];
+        band.queued = false;
+        band.busy = true;
+        uint32_t room = options.batch;
+        if (!anchorMode && options.window > 0) {
+          uint32_t left = options.window - band.chain.getWindowSize();
+          if (left < room) room = left;
+        }
+        if (anchorMode) room = 1;
+        while (!band.waiting.empty() && taken.size() < room) {
+          taken.push_back(band.waiting.front());
+          band.waiting.pop_front();
+        }
+        backlog -= (uint32_t)taken.size();
+      }
+
+      Band &band = bands[device];
+      if (anchorMode) {
+        serveAnchor(device, band, taken);
+      } else {
+        serveEvents(device, band, taken);
+      }
+
+      std::lock_guard<std::mutex> guard(queueLock);
+      band.busy = false;
+      markReady(device);
+    }
+  }
+};
+
+static void connection(const Options &options) {
+  Connection connection(options);
+  connection.run();
+}
+
+// Poll eth_getTransactionReceipt for every outstanding transaction each
+// pass, so one slow receipt does not delay the others
+static void confirmer(const Options &options) {
+  KeepAliveHttp<PosixClient> rpc;
+  rpc.begin(options.rpc.c_str());
+  std::vector<Confirmation> outstanding;
+  char answer[4096];
+  char request[256];
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> guard(confirmLock);
+      if (outstanding.empty()) {
+        confirmReady.wait(guard, [] { return !confirmations.empty() || requestsDone; });
+        if (confirmations.empty()) return;
+      }
+      outstanding.insert(outstanding.end(), confirmations.begin(), confirmations.end());
+      confirmations.clear();
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < outstanding.size(); i++) {
+      const Confirmation &confirmation = outstanding[i];
+      int length = snprintf(request, sizeof(request),
+                            "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"eth_getTransactionReceipt\",\"params\":[\"%s\"]}",
+                            confirmation.txHash.c_str());
+      // A pending transaction answers "result":null, with no blockNumber
+      std::string block;
+      if (rpc.post("/", request, (size_t)length, answer, sizeof(answer)) == 200) {
+        block = jsonString(answer, "blockNumber");
+      }
+      double seenAt = nowMs();
+      if (!block.empty()) {
+        std::lock_guard<std::mutex> guard(results.lock);
+        results.confirmDelay.push_back(seenAt - confirmation.sentAt);
+        results.blocks.insert(strtoull(block.c_str(), nullptr, 16));
+      } else if (seenAt - confirmation.sentAt > options.readTimeout) {
+        std::lock_guard<std::mutex> guard(results.lock);
+        results.unconfirmed++;
+      } else {
+        outstanding[kept++] = confirmation;
+      }
+    }
+    outstanding.resize(kept);
+    if (!outstanding.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+}
+
+// ==================== REPORT ====================
+static double percentile(std::vector<double> samples, double p) {
+  if (samples.empty()) return 0;
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (size_t)(samples.size() * p / 100.0 + 0.999999);
+  return samples[rank > 0 ? rank - 1 : 0];
+}
+
+static std::string distribution(const std::vector<double> &samples) {
+  char text[160];
+  snprintf(text, sizeof(text), "{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}",
+           percentile(samples, 50), percentile(samples, 90), percentile(samples, 99),
+           percentile(samples, 100));
+  return text;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage();
+    return 2;
+  }
+
+  bool anchorMode = options.mode == "anchor";
+  bands.resize(options.devices);
+  for (uint32_t i = 0; i < options.devices; i++) {
+    bands[i].deviceId = options.deviceBase + i;
+    bands[i].chain.restore(ChainCheckpoint::initial(), bands[i].deviceId);
+    bands[i].queued = false;
+    bands[i].busy = false;
+  }
+
+  std::vector<Arrival> arrivals = schedule(options);
+  printf("%u devices, %s arrivals, %zu %s over %.0f s, %u connections, %u events per request, window %u\n",
+         options.devices, options.arrival.c_str(), arrivals.size(), anchorMode ? "anchors" : "events",
+         options.duration, options.connections, options.batch, options.window);
+
+  double start = nowMs() + 100;
+  std::thread arrivalThread(generator, std::cref(arrivals), start, options.denyRatio, options.seed);
+  std::vector<std::thread> pool;
+  for (uint32_t i = 0; i < options.connections; i++) pool.push_back(std::thread(connection, std::cref(options)));
+  std::thread confirmThread;
+  if (options.confirm) confirmThread = std::thread(confirmer, std::cref(options));
+
+  arrivalThread.join();
+  for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+  double elapsed = (nowMs() - start) / 1000.0;
+  {
+    std::lock_guard<std::mutex> guard(confirmLock);
+    requestsDone = true;
+    confirmReady.notify_all();
+  }
+  if (confirmThread.joinable()) confirmThread.join();
+
+  uint32_t offered = (uint32_t)arrivals.size();
+  uint32_t delivered = anchorMode ? results.anchorsOk : results.eventsOk;
+  double errorRate = results.requests ? (double)(results.httpErrors + results.transportErrors) / results.requests : 0;
+  char json[2048];
+  snprintf(json, sizeof(json),
+           "{\"mode\":\"%s\",\"arrival\":\"%s\",\"devices\":%u,\"connections\":%u,\"batch\":%u,\"window\":%u,"
+           "\"durationS\":%.1f,\"offered\":%u,\"offeredPerS\":%.2f,\"requests\":%u,\"eventsOk\":%u,"
+           "\"anchorsOk\":%u,\"throughputPerS\":%.2f,\"httpErrors\":%u,\"transportErrors\":%u,\"errorRate\":%.4f,"
+           "\"maxBacklog\":%u,\"latencyMs\":%s,\"serviceMs\":%s,\"anchorMs\":%s,\"confirmMs\":%s,\"blocks\":%zu,"
+           "\"unconfirmed\":%u}\n",
+           options.mode.c_str(), options.arrival.c_str(), options.devices, options.connections, options.batch,
+           options.window, elapsed, offered, offered / options.duration, results.requests, results.eventsOk,
+           results.anchorsOk, delivered / elapsed, results.httpErrors, results.transportErrors, errorRate,
+           results.maxBacklog, distribution(results.latency).c_str(), distribution(results.service).c_str(),
+           distribution(results.anchorService).c_str(), distribution(results.confirmDelay).c_str(),
+           results.blocks.size(), results.unconfirmed);
+
+  printf("offered %.2f/s, delivered %.2f/s over %.1f s (%u of %u %s; %u events, %u anchors)\n",
+         offered / options.duration, delivered / elapsed, elapsed, delivered, offered,
+         anchorMode ? "anchors" : "events", results.eventsOk, results.anchorsOk);
+  printf("errors: %u HTTP, %u transport (%.2f%%), backlog peak %u\n",
+         results.httpErrors, results.transportErrors, errorRate * 100, results.maxBacklog);
+  printf("latency ms   p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f  (arrival to answer)\n",
+         percentile(results.latency, 50), percentile(results.latency, 90),
+         percentile(results.latency, 99), percentile(results.latency, 100));
+  printf("events ms    p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f  (/events request to answer)\n",
+         percentile(results.service, 50), percentile(results.service, 90),
+         percentile(results.service, 99), percentile(results.service, 100));
+  printf("anchor ms    p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f  (/anchor request to answer)\n",
+         percentile(results.anchorService, 50), percentile(results.anchorService, 90),
+         percentile(results.anchorService, 99), percentile(results.anchorService, 100));
+  if (options.confirm) {
+    printf("confirm ms   p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f  (request to receipt), %zu blocks, %u unconfirmed\n",
+           percentile(results.confirmDelay, 50), percentile(results.confirmDelay, 90),
+           percentile(results.confirmDelay, 99), percentile(results.confirmDelay, 100),
+           results.blocks.size(), results.unconfirmed);
+  }
+  fputs(json, stdout);
+
+  if (!options.jsonPath.empty()) {
+    FILE* file = fopen(options.jsonPath.c_str(), "w");
+    if (file == nullptr) {
+      perror(options.jsonPath.c_str());
+      return 1;
+    }
+    fputs(json, file);
+    fclose(file);
+  }
+  return 0;
+}
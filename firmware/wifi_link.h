@@ -0,0 +1,205 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+
+// ==================== WI-FI LINK ====================
+// Station link management without blocking. Association is started with
+// beginLink() and reported back through the transport's link events
+// (WiFi.onEvent on the device); service() only compares times and never
+// waits. Failed attempts back off exponentially with jitter, from
+// WIFI_BACKOFF_MIN up to WIFI_BACKOFF_MAX, and retries go on for as long as
+// the link is down. A dropped link is retried at once. end() leaves the
+// link idle until the next begin(), for radios that only come up on demand.
+//
+// onLinkChange() may run on another task (the Wi-Fi event task). It only
+// writes the cached state and an event count; everything else belongs to
+// the task that calls service().
+
+enum LinkState : uint8_t {
+  LINK_IDLE,          // Not started
+  LINK_CONNECTING,    // Association in progress
+  LINK_UP,            // Associated with an address
+  LINK_BACKOFF        // Waiting to retry
+};
+
+inline const char* linkStateName(uint8_t state) {
+  static const char* const NAMES[] = {"idle", "connecting", "up", "backoff"};
+  return state <= LINK_BACKOFF ? NAMES[state] : "?";
+}
+
+class WifiLink {
+private:
+  NetTransport &net;
+  Clock &clock;
+  const char* ssid;
+  const char* password;
+
+  // Written by the event callback
+  volatile bool up;
+  volatile uint32_t changes;
+
+  LinkState state;
+  uint32_t seenChanges;
+  uint32_t attemptAt;         // ms, current association started
+  uint32_t retryAt;           // ms, end of the current backoff
+  uint32_t backoff;           // Next backoff before jitter (ms)
+  uint32_t downSince;         // ms, link lost
+  bool everUp;
+  uint32_t activeSince;       // ms, begin()
+  uint32_t activeTotal;       // Radio on in earlier begin()..end() spans (ms)
+  uint32_t random;            // xorshift32 state for the jitter
+
+  // Counters
+  uint32_t attempts;
+  uint32_t failures;
+  uint32_t drops;
+  uint32_t reconnects;
+  uint32_t lastReconnect;     // Drop to link up (ms)
+  uint32_t maxReconnect;
+  uint32_t downtime;          // Total after drops, closed periods only (ms)
+
+  uint32_t nextRandom() {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return random;
+  }
+
+  void startAttempt(uint32_t now) {
+    state = LINK_CONNECTING;
+    attemptAt = now;
+    attempts++;
+    net.beginLink(ssid, password);
+  }
+
+  // Half the backoff plus up to the other half at random, so a fleet that
+  // lost the same access point does not retry in step
+  void scheduleRetry(uint32_t now) {
+    failures++;
+    state = LINK_BACKOFF;
+    retryAt = now + backoff / 2 + nextRandom() % (backoff / 2 + 1);
+    backoff = backoff < WIFI_BACKOFF_MAX / 2 ? backoff * 2 : WIFI_BACKOFF_MAX;
+  }
+
+  void linkUp(uint32_t now) {
+    if (everUp) {
+      uint32_t took = now - downSince;
+      reconnects++;
+      lastReconnect = took;
+      if (took > maxReconnect) maxReconnect = took;
+      downtime += took;
+    }
+    everUp = true;
+    state = LINK_UP;
+    backoff = WIFI_BACKOFF_MIN;
+  }
+
+public:
+  WifiLink(NetTransport &_net, Clock &_clock)
+    : net(_net), clock(_clock), ssid(""), password(""), up(false), changes(0), state(LINK_IDLE),
+      seenChanges(0), attemptAt(0), retryAt(0), backoff(WIFI_BACKOFF_MIN), downSince(0), everUp(false),
+      activeSince(0), activeTotal(0), random(1), attempts(0), failures(0), drops(0), reconnects(0), lastReconnect(0), maxReconnect(0),
+      downtime(0) {}
+
+  // Start associating. The strings must outlive the link; seed spreads the
+  // retry jitter across devices.
+  void begin(const char* _ssid, const char* _password, uint32_t seed) {
+    ssid = _ssid;
+    password = _password;
+    random = seed != 0 ? seed : 1;
+    backoff = WIFI_BACKOFF_MIN;
+    activeSince = clock.millis();
+    startAttempt(activeSince);
+  }
+
+  // Leave the link. The caller switches the radio off; its events are
+  // ignored until the next begin(), and the time off is not downtime.
+  void end() {
+    if (state == LINK_IDLE) return;
+    activeTotal += clock.millis() - activeSince;
+    state = LINK_IDLE;
+    everUp = false;
+    up = false;
+  }
+
+  // Link event from the transport
+  void onLinkChange(bool linkUp) {
+    up = linkUp;
+    changes++;
+  }
+
+  // Act on events and timers. Returns the ms until it needs to run again,
+  // 0 if an event came in meanwhile, or WIFI_IDLE_WAIT when only an event
+  // can change anything.
+  uint32_t service() {
+    uint32_t now = clock.millis();
+    uint32_t seen = changes;
+    bool nowUp = up;
+
+    if (seen != seenChanges) {
+      seenChanges = seen;
+      if (state == LINK_IDLE) {
+        // Radio off: the disconnect end() caused
+      } else if (state == LINK_UP) {
+        // Lost at least once since the last pass, maybe already back
+        drops++;
+        downSince = now;
+        if (nowUp) {
+          linkUp(now);
+        } else {
+          state = LINK_BACKOFF;
+          retryAt = now;
+        }
+      } else if (nowUp) {
+        linkUp(now);
+      } else if (state == LINK_CONNECTING) {
+        scheduleRetry(now);   // Attempt failed (no AP, wrong key)
+      }
+    }
+
+    if (state == LINK_CONNECTING && now - attemptAt >= WIFI_CONNECT_TIMEOUT) {
+      scheduleRetry(now);
+    }
+    if (state == LINK_BACKOFF && (int32_t)(now - retryAt) >= 0) {
+      startAttempt(now);
+    }
+
+    if (changes != seenChanges) return 0;   // An event arrived during this pass
+    switch (state) {
+      case LINK_CONNECTING: return WIFI_CONNECT_TIMEOUT - (now - attemptAt);
+      case LINK_BACKOFF:    return retryAt - now;
+      default:              return WIFI_IDLE_WAIT;
+    }
+  }
+
+  // Cached; safe from any task
+  bool isUp() const { return up; }
+
+  LinkState getState() const { return state; }
+  uint32_t getAttempts() const { return attempts; }
+  uint32_t getFailures() const { return failures; }
+  uint32_t getDrops() const { return drops; }
+  uint32_t getReconnects() const { return reconnects; }
+  uint32_t getLastReconnect() const { return lastReconnect; }
+  uint32_t getMaxReconnect() const { return maxReconnect; }
+  uint32_t getRetryIn() const {
+    int32_t left = (int32_t)(retryAt - clock.millis());
+    return state == LINK_BACKOFF && left > 0 ? (uint32_t)left : 0;
+  }
+
+  // Time the radio has been on, associated or trying to be (ms)
+  uint32_t getActiveTime() const {
+    return state != LINK_IDLE ? activeTotal + (clock.millis() - activeSince) : activeTotal;
+  }
+
+  // Time spent down after drops, including a drop still in progress (ms)
+  uint32_t getDowntime() const {
+    return isDownAfterDrop() ? downtime + (clock.millis() - downSince) : downtime;
+  }
+  bool isDownAfterDrop() const { return everUp && state != LINK_UP; }
+};
+
+#endif